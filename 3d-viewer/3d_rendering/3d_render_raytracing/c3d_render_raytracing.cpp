@@ -37,6 +37,7 @@
 #include "3d_math.h"
 #include "../common_ogl/ogl_utils.h"
 #include <profile.h>        // To use GetRunningMicroSecs or an other profiling utility
+#include <thread_pool.h>
 
 // This should be used in future for the function
 // convertLinearToSRGB
@@ -368,46 +369,33 @@ void C3D_RENDER_RAYTRACING::rt_render_tracing( GLubyte *ptrPBO ,
 
     const long nrBlocks = (long) m_blockPositions.size();
     const unsigned startTime = GetRunningMicroSecs();
-    bool breakLoop = false;
-    int numBlocksRendered = 0;
+    std::atomic_bool breakLoop( false );
+    std::atomic_int numBlocksRendered( 0 );
+    std::mutex processedLock;
 
-    #pragma omp parallel for schedule(dynamic) shared(breakLoop) \
-        firstprivate(ptrPBO) reduction(+:numBlocksRendered) default(none)
-    for( long iBlock = 0; iBlock < nrBlocks; iBlock++ )
+    THREAD_POOL::Instance().ParallelFor( nrBlocks, [&]( size_t iBlock )
     {
+        bool process_block;
 
-        #pragma omp flush(breakLoop)
-        if( !breakLoop )
+        // std::vector<bool> stuffs eight bools to each byte, so access to
+        // them can never be natively atomic.
         {
-            bool process_block;
-
-            // std::vector<bool> stuffs eight bools to each byte, so access to
-            // them can never be natively atomic.
-            #pragma omp critical(checkProcessBlock)
-            {
-                process_block = !m_blockPositionsWasProcessed[iBlock];
-                m_blockPositionsWasProcessed[iBlock] = true;
-            }
-
-            if( process_block )
-            {
-                rt_render_trace_block( ptrPBO, iBlock );
-                numBlocksRendered++;
+            std::lock_guard<std::mutex> lock( processedLock );
+            process_block = !m_blockPositionsWasProcessed[iBlock];
+            m_blockPositionsWasProcessed[iBlock] = true;
+        }
 
+        if( process_block )
+        {
+            rt_render_trace_block( ptrPBO, iBlock );
+            numBlocksRendered++;
 
-                // Check if it spend already some time render and request to exit
-                // to display the progress
-                #ifdef _OPENMP
-                if( omp_get_thread_num() == 0 )
-                #endif
-                    if( (GetRunningMicroSecs() - startTime) > 150000 )
-                    {
-                        breakLoop = true;
-                        #pragma omp flush(breakLoop)
-                    }
-            }
+            // Check if it spend already some time render and request to exit
+            // to display the progress (the blocks not started yet are skipped)
+            if( (GetRunningMicroSecs() - startTime) > 150000 )
+                breakLoop = true;
         }
-    }
+    }, nullptr, &breakLoop );
 
     m_nrBlocksRenderProgress += numBlocksRendered;
 
@@ -33,6 +33,9 @@
 # source and header files will not be generated and a build error will
 # occur.
 #
+# The generated cpp file also holds a perfect hash of the tokens, so the lexer
+# can classify a symbol with a single string comparison.
+#
 # Valid tokens:    a a1 foo_1 foo_bar2
 # Invalid tokens:  1 A _foo bar_ foO
 #
@@ -199,6 +202,180 @@ if( NOT ( tokensBefore EQUAL tokensAfter ) )
     message( FATAL_ERROR "Duplicate tokens found in file <${inputFile}>." )
 endif()
 
+# Generate a perfect hash of the keywords for DSNLEXER::findToken(), see struct
+# KEYWORD_HASH in dsnlexer.h for the hash function.  The keywords are put in the buckets
+# chosen by the lower half of their hash, then each bucket, the biggest ones first, is
+# given the smallest displacement moving all its keywords to free slots.  If a bucket
+# cannot be placed, everything starts again with another seed.
+#
+# The 32 bit FNV-1a hashes are computed as two 16 bit halves, so that the products fit
+# in the 32 bit integers of the old CMake versions.
+
+# The codes of the characters allowed in the tokens.
+set( hashChars "0123456789_abcdefghijklmnopqrstuvwxyz" )
+set( hashCodes 48 49 50 51 52 53 54 55 56 57 95
+    97 98 99 100 101 102 103 104 105 106 107 108 109
+    110 111 112 113 114 115 116 117 118 119 120 121 122 )
+
+# Set ${resultHigh} and ${resultLow} to the halves of the FNV-1a hash of the character
+# codes ${codes}, whose offset basis is ${basisHigh} * 65536 + ${basisLow}.
+function( fnv1a codes basisHigh basisLow resultHigh resultLow )
+    set( high ${basisHigh} )
+    set( low ${basisLow} )
+
+    foreach( code ${codes} )
+        # hash = ( hash ^ code ) * 16777619, with 16777619 = 256 * 65536 + 403
+        math( EXPR low "${low} ^ ${code}" )
+        math( EXPR lowProduct "${low} * 403" )
+        math( EXPR high "( ${high} * 403 + ${low} * 256 + ( ${lowProduct} >> 16 ) ) & 65535" )
+        math( EXPR low "${lowProduct} & 65535" )
+    endforeach()
+
+    set( ${resultHigh} ${high} PARENT_SCOPE )
+    set( ${resultLow} ${low} PARENT_SCOPE )
+endfunction()
+
+# The tables have a power of 2 size, at least the count of tokens.
+set( hashSize 1 )
+
+while( hashSize LESS tokensAfter )
+    math( EXPR hashSize "${hashSize} * 2" )
+endwhile()
+
+if( hashSize GREATER 32768 )
+    message( FATAL_ERROR "Too many tokens in file <${inputFile}>." )
+endif()
+
+math( EXPR hashMask "${hashSize} - 1" )
+math( EXPR lastToken "${tokensAfter} - 1" )
+
+# The character codes of each token
+set( tokenIndex 0 )
+
+foreach( token ${tokens} )
+    set( codes "" )
+    string( LENGTH "${token}" tokenLength )
+    math( EXPR lastChar "${tokenLength} - 1" )
+
+    foreach( charIndex RANGE ${lastChar} )
+        string( SUBSTRING "${token}" ${charIndex} 1 char )
+        string( FIND "${hashChars}" "${char}" codeIndex )
+        list( GET hashCodes ${codeIndex} code )
+        list( APPEND codes ${code} )
+    endforeach()
+
+    set( codes_${tokenIndex} "${codes}" )
+    math( EXPR tokenIndex "${tokenIndex} + 1" )
+endforeach()
+
+# The seeds are the FNV-1a offset basis 2166136261 = 33052 * 65536 + 40389, its lower
+# half xored with 0, 1, 2...
+set( hashSeed -1 )
+set( hashFound FALSE )
+
+while( NOT hashFound )
+    math( EXPR hashSeed "${hashSeed} + 1" )
+
+    if( hashSeed GREATER 65535 )
+        message( FATAL_ERROR "No perfect hash found for the tokens of file <${inputFile}>." )
+    endif()
+
+    math( EXPR seedLow "40389 ^ ${hashSeed}" )
+
+    foreach( ii RANGE ${hashMask} )
+        set( bucket_${ii} "" )
+        set( displacement_${ii} 0 )
+        set( slot_${ii} -1 )
+    endforeach()
+
+    set( maxBucketSize 0 )
+
+    foreach( tokenIndex RANGE ${lastToken} )
+        fnv1a( "${codes_${tokenIndex}}" 33052 ${seedLow} high low )
+        math( EXPR slotBase_${tokenIndex} "${high} & ${hashMask}" )
+        math( EXPR bucket "${low} & ${hashMask}" )
+        list( APPEND bucket_${bucket} ${tokenIndex} )
+        list( LENGTH bucket_${bucket} bucketSize )
+
+        if( bucketSize GREATER maxBucketSize )
+            set( maxBucketSize ${bucketSize} )
+        endif()
+    endforeach()
+
+    set( hashFound TRUE )
+
+    foreach( size RANGE ${maxBucketSize} 1 -1 )
+        foreach( bucket RANGE ${hashMask} )
+            list( LENGTH bucket_${bucket} bucketSize )
+
+            if( bucketSize EQUAL size )
+                set( placed FALSE )
+
+                foreach( displacement RANGE ${hashMask} )
+                    set( freeSlots "" )
+
+                    foreach( tokenIndex ${bucket_${bucket}} )
+                        math( EXPR slot "( ${slotBase_${tokenIndex}} + ${displacement} ) & ${hashMask}" )
+
+                        if( slot_${slot} EQUAL -1 )
+                            list( APPEND freeSlots ${slot} )
+                        endif()
+                    endforeach()
+
+                    list( LENGTH freeSlots freeCount )
+
+                    if( freeCount EQUAL size )
+                        list( REMOVE_DUPLICATES freeSlots )
+                        list( LENGTH freeSlots freeCount )
+                    endif()
+
+                    if( freeCount EQUAL size )
+                        set( displacement_${bucket} ${displacement} )
+
+                        foreach( tokenIndex ${bucket_${bucket}} )
+                            math( EXPR slot "( ${slotBase_${tokenIndex}} + ${displacement} ) & ${hashMask}" )
+                            set( slot_${slot} ${tokenIndex} )
+                        endforeach()
+
+                        set( placed TRUE )
+                        break()
+                    endif()
+                endforeach()
+
+                if( NOT placed )
+                    set( hashFound FALSE )
+                    break()
+                endif()
+            endif()
+        endforeach()
+
+        if( NOT hashFound )
+            break()
+        endif()
+    endforeach()
+endwhile()
+
+# The C++ initializers of the tables, 16 values per line
+set( displacementValues "" )
+set( slotValues "" )
+
+foreach( ii RANGE ${hashMask} )
+    math( EXPR column "${ii} % 16" )
+
+    if( ii GREATER 0 )
+        set( displacementValues "${displacementValues}," )
+        set( slotValues "${slotValues}," )
+    endif()
+
+    if( column EQUAL 0 )
+        set( displacementValues "${displacementValues}\n   " )
+        set( slotValues "${slotValues}\n   " )
+    endif()
+
+    set( displacementValues "${displacementValues} ${displacement_${ii}}" )
+    set( slotValues "${slotValues} ${slot_${ii}}" )
+endforeach()
+
 file( WRITE "${outHeaderFile}" "${includeFileHeader}" )
 file( WRITE "${outCppFile}" "${sourceFileHeader}" )
 
@@ -237,8 +414,9 @@ file( APPEND "${outHeaderFile}"
 class ${LEXERCLASS} : public DSNLEXER
 {
     /// Auto generated lexer keywords table and length:
-    static const KEYWORD  keywords[];
-    static const unsigned keyword_count;
+    static const KEYWORD      keywords[];
+    static const unsigned     keyword_count;
+    static const KEYWORD_HASH keywords_hash;
 
 public:
     /**
@@ -248,7 +426,7 @@ public:
      *   If left empty, then _(\"clipboard\") is used.
      */
     ${LEXERCLASS}( const std::string& aSExpression, const wxString& aSource = wxEmptyString ) :
-        DSNLEXER( keywords, keyword_count, aSExpression, aSource )
+        DSNLEXER( keywords, keyword_count, aSExpression, aSource, &keywords_hash )
     {
     }
 
@@ -262,7 +440,7 @@ public:
      * @param aFilename is the name of the opened file, needed for error reporting.
      */
     ${LEXERCLASS}( FILE* aFile, const wxString& aFilename ) :
-        DSNLEXER( keywords, keyword_count, aFile, aFilename )
+        DSNLEXER( keywords, keyword_count, aFile, aFilename, &keywords_hash )
     {
     }
 
@@ -278,7 +456,7 @@ public:
      *  STRING_LINE_READER or FILE_LINE_READER.  No ownership is taken of aLineReader.
      */
     ${LEXERCLASS}( LINE_READER* aLineReader ) :
-        DSNLEXER( keywords, keyword_count, aLineReader )
+        DSNLEXER( keywords, keyword_count, aLineReader, &keywords_hash )
     {
     }
 
@@ -370,6 +548,18 @@ file( APPEND "${outCppFile}"
 const unsigned ${LEXERCLASS}::keyword_count = unsigned( sizeof( ${LEXERCLASS}::keywords )/sizeof( ${LEXERCLASS}::keywords[0] ) );
 
 
+// The perfect hash of the keywords, see struct KEYWORD_HASH.
+static const uint16_t keyword_displacements[] = {${displacementValues}
+};
+
+static const int16_t keyword_slots[] = {${slotValues}
+};
+
+const KEYWORD_HASH ${LEXERCLASS}::keywords_hash = {
+    ${hashMask}u, ( 33052u << 16 ) | ${seedLow}u, keyword_displacements, keyword_slots
+};
+
+
 const char* ${LEXERCLASS}::TokenName( T aTok )
 {
     const char* ret;
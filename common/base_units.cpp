@@ -39,6 +39,7 @@
 #include <title_block.h>
 #include <common.h>
 #include <base_units.h>
+#include <kicad_string.h>
 #include "libeval/numeric_evaluator.h"
 
 
@@ -60,31 +61,18 @@
 
 std::string Double2Str( double aValue )
 {
-    char    buf[50];
-    int     len;
-
     if( aValue != 0.0 && fabs( aValue ) <= 0.0001 )
     {
         // For these small values, %f works fine,
         // and %g gives an exponent
-        len = sprintf( buf,  "%.16f", aValue );
-
-        while( --len > 0 && buf[len] == '0' )
-            buf[len] = '\0';
-
-        if( buf[len] == '.' )
-            buf[len] = '\0';
-        else
-            ++len;
+        return FormatDouble( aValue, 16, true );
     }
     else
     {
         // For these values, %g works fine, and sometimes %f
         // gives a bad value (try aValue = 1.222222222222, with %.16f format!)
-        len = sprintf( buf, "%.16g", aValue );
+        return FormatDouble( aValue, 16 );
     }
-
-    return std::string( buf, len );
 }
 
 
@@ -28,6 +28,7 @@
 #include <cstdio>
 #include <cstdlib>         // bsearch()
 #include <cctype>
+#include <climits>
 
 #include <macros.h>
 #include <fctsys.h>
@@ -39,6 +40,129 @@
 #define FMT_CLIPBOARD       _( "clipboard" )
 
 
+//-----<TOKEN_READER>---------------------------------------------------------
+
+/// The tokens which are recorded with their text: neither keywords nor parentheses
+static inline bool isTextToken( int aTok )
+{
+    return aTok < 0 && aTok != DSN_LEFT && aTok != DSN_RIGHT && aTok != DSN_EOF;
+}
+
+
+/// Records aValue as a variable length integer: 7 bits per byte, low bits first
+static void appendNumber( std::string& aTokens, size_t aValue )
+{
+    while( aValue >= 0x80 )
+    {
+        aTokens += char( ( aValue & 0x7F ) | 0x80 );
+        aValue >>= 7;
+    }
+
+    aTokens += char( aValue );
+}
+
+
+/// @return the end of the variable length integer decoded from aData, or NULL if corrupt
+static const char* decodeNumber( const char* aData, const char* aEnd, size_t* aValue )
+{
+    size_t value = 0;
+
+    for( unsigned shift = 0; aData < aEnd && shift < 8 * sizeof( size_t ); shift += 7 )
+    {
+        unsigned char c = *aData++;
+
+        value |= size_t( c & 0x7F ) << shift;
+
+        if( !( c & 0x80 ) )
+        {
+            *aValue = value;
+            return aData;
+        }
+    }
+
+    return NULL;
+}
+
+
+TOKEN_READER::TOKEN_READER( const std::string& aTokens, const wxString& aSource ) :
+    m_tokens( aTokens ),
+    m_ndx( 0 )
+{
+    m_source = aSource;
+}
+
+
+bool TOKEN_READER::ReadToken( int* aTok, std::string* aText )
+{
+    if( m_ndx >= m_tokens.size() )
+        return false;
+
+    const char* data = m_tokens.data();
+    const char* next = DecodeToken( data + m_ndx, data + m_tokens.size(), aTok, aText );
+
+    if( !next )
+    {
+        wxString msg = wxString::Format( _( "Corrupt tokens in \"%s\"" ), GetChars( m_source ) );
+        THROW_IO_ERROR( msg );
+    }
+
+    m_ndx = next - data;
+
+    return true;
+}
+
+
+void TOKEN_READER::AppendToken( std::string& aTokens, int aTok, const std::string& aText )
+{
+    appendNumber( aTokens, aTok - DSN_NONE );
+
+    if( isTextToken( aTok ) )
+    {
+        appendNumber( aTokens, aText.size() );
+        aTokens += aText;
+    }
+}
+
+
+const char* TOKEN_READER::DecodeToken( const char* aData, const char* aEnd, int* aTok,
+                                       std::string* aText )
+{
+    size_t number;
+
+    aData = decodeNumber( aData, aEnd, &number );
+
+    if( !aData || number > INT_MAX )
+        return NULL;
+
+    *aTok = int( number ) + DSN_NONE;
+
+    if( isTextToken( *aTok ) )
+    {
+        size_t len;
+
+        aData = decodeNumber( aData, aEnd, &len );
+
+        if( !aData || len > size_t( aEnd - aData ) )
+            return NULL;
+
+        if( aText )
+            aText->assign( aData, len );
+
+        aData += len;
+    }
+    else if( aText && *aTok == DSN_LEFT )
+    {
+        *aText = '(';
+    }
+    else if( aText && *aTok == DSN_RIGHT )
+    {
+        *aText = ')';
+    }
+
+    return aData;
+}
+
+
 //-----<DSNLEXER>-------------------------------------------------------------
 
 void DSNLEXER::init()
@@ -55,6 +179,10 @@ void DSNLEXER::init()
     curOffset = 0;
 
 #if 1
+    // The generated perfect hash makes the hashtable useless
+    if( keywordsHash )
+        return;
+
     if( keywordCount > 11 )
     {
         // resize the hashtable bucket count
@@ -74,14 +202,17 @@ void DSNLEXER::init()
 
 
 DSNLEXER::DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-                    FILE* aFile, const wxString& aFilename ) :
+                    FILE* aFile, const wxString& aFilename,
+                    const KEYWORD_HASH* aKeywordsHash ) :
     iOwnReaders( true ),
     start( NULL ),
     next( NULL ),
     limit( NULL ),
     reader( NULL ),
+    tokenReader( NULL ),
     keywords( aKeywordTable ),
-    keywordCount( aKeywordCount )
+    keywordCount( aKeywordCount ),
+    keywordsHash( aKeywordsHash )
 {
     FILE_LINE_READER* fileReader = new FILE_LINE_READER( aFile, aFilename );
     PushReader( fileReader );
@@ -90,14 +221,17 @@ DSNLEXER::DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
 
 
 DSNLEXER::DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-                    const std::string& aClipboardTxt, const wxString& aSource ) :
+                    const std::string& aClipboardTxt, const wxString& aSource,
+                    const KEYWORD_HASH* aKeywordsHash ) :
     iOwnReaders( true ),
     start( NULL ),
     next( NULL ),
     limit( NULL ),
     reader( NULL ),
+    tokenReader( NULL ),
     keywords( aKeywordTable ),
-    keywordCount( aKeywordCount )
+    keywordCount( aKeywordCount ),
+    keywordsHash( aKeywordsHash )
 {
     STRING_LINE_READER* stringReader = new STRING_LINE_READER( aClipboardTxt, aSource.IsEmpty() ?
                                         wxString( FMT_CLIPBOARD ) : aSource );
@@ -107,14 +241,16 @@ DSNLEXER::DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
 
 
 DSNLEXER::DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-                    LINE_READER* aLineReader ) :
+                    LINE_READER* aLineReader, const KEYWORD_HASH* aKeywordsHash ) :
     iOwnReaders( false ),
     start( NULL ),
     next( NULL ),
     limit( NULL ),
     reader( NULL ),
+    tokenReader( NULL ),
     keywords( aKeywordTable ),
-    keywordCount( aKeywordCount )
+    keywordCount( aKeywordCount ),
+    keywordsHash( aKeywordsHash )
 {
     if( aLineReader )
         PushReader( aLineReader );
@@ -130,8 +266,10 @@ DSNLEXER::DSNLEXER( const std::string& aSExpression, const wxString& aSource ) :
     next( NULL ),
     limit( NULL ),
     reader( NULL ),
+    tokenReader( NULL ),
     keywords( empty_keywords ),
-    keywordCount( 0 )
+    keywordCount( 0 ),
+    keywordsHash( NULL )
 {
     STRING_LINE_READER* stringReader = new STRING_LINE_READER( aSExpression, aSource.IsEmpty() ?
                                         wxString( FMT_CLIPBOARD ) : aSource );
@@ -193,6 +331,7 @@ void DSNLEXER::PushReader( LINE_READER* aLineReader )
 {
     readerStack.push_back( aLineReader );
     reader = aLineReader;
+    tokenReader = dynamic_cast<TOKEN_READER*>( aLineReader );
     start  = (const char*) (*reader);
 
     // force a new readLine() as first thing.
@@ -213,6 +352,7 @@ LINE_READER* DSNLEXER::PopReader()
         if( readerStack.size() )
         {
             reader = readerStack.back();
+            tokenReader = dynamic_cast<TOKEN_READER*>( reader );
             start  = reader->Line();
 
             // force a new readLine() as first thing.
@@ -222,6 +362,7 @@ LINE_READER* DSNLEXER::PopReader()
         else
         {
             reader = 0;
+            tokenReader = 0;
             start  = dummy;
             limit  = dummy;
         }
@@ -259,6 +400,17 @@ int DSNLEXER::findToken( const std::string& tok )
 
 inline int DSNLEXER::findToken( const std::string& tok )
 {
+    if( keywordsHash )
+    {
+        int token = keywordsHash->Find( tok.data(), tok.size() );
+
+        // The text of a keyword slot can still be any other symbol
+        if( token >= 0 && tok == keywords[token].name )
+            return token;
+
+        return DSN_SYMBOL;
+    }
+
     KEYWORD_MAP::const_iterator it = keyword_hash.find( tok.c_str() );
     if( it != keyword_hash.end() )
         return it->second;
@@ -542,6 +694,9 @@ int DSNLEXER::NextTok()
     const char*   cur  = next;
     const char*   head = cur;
 
+    if( tokenReader )
+        return nextRecordedTok();
+
     prevTok = curTok;
 
     if( curTok == DSN_EOF )
@@ -829,3 +984,48 @@ wxArrayString* DSNLEXER::ReadCommentLines()
 
     return ret;
 }
+
+
+int DSNLEXER::nextRecordedTok()
+{
+    prevTok = curTok;
+    curOffset = 0;
+
+    if( curTok == DSN_EOF )
+        return curTok;
+
+    do
+    {
+        if( !tokenReader->ReadToken( &curTok, &curText ) )
+        {
+            curTok = DSN_EOF;
+        }
+        else if( curTok >= 0 )
+        {
+            if( (unsigned) curTok >= keywordCount )
+            {
+                wxString msg = wxString::Format( _( "Corrupt tokens in \"%s\"" ),
+                                                 GetChars( CurSource() ) );
+                THROW_IO_ERROR( msg );
+            }
+
+            curText = keywords[curTok].name;
+        }
+    } while( curTok == DSN_COMMENT && !commentsAreTokens );
+
+    return curTok;
+}
+
+
+std::string DSNLEXER::RecordTokens()
+{
+    std::string tokens;
+    bool        cmt_setting = SetCommentsAreTokens( true );
+
+    for( int tok = NextTok(); tok != DSN_EOF; tok = NextTok() )
+        TOKEN_READER::AppendToken( tokens, tok, curText );
+
+    SetCommentsAreTokens( cmt_setting );
+
+    return tokens;
+}
@@ -0,0 +1,410 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <geometry/seg_batch.h>
+#include <geometry/shape_line_chain.h>
+#include <math/box2.h>
+
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+#define SEG_BATCH_USE_AVX2
+#include <immintrin.h>
+#endif
+
+
+int SEG_BATCH::collideScalar( const SEG& aSeg, int aClearance, int aFirst,
+        std::vector<bool>& aHits ) const
+{
+    int count = 0;
+
+    for( int i = aFirst; i < Size(); i++ )
+    {
+        if( aSeg.Collide( Segment( i ), aClearance + m_clearance[i] ) )
+        {
+            aHits[i] = true;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+int SEG_BATCH::collideScalar( const SHAPE_LINE_CHAIN& aLine, int aClearance, int aFirst,
+        std::vector<bool>& aHits ) const
+{
+    int count = 0;
+
+    for( int i = aFirst; i < Size(); i++ )
+    {
+        if( aLine.Collide( Segment( i ), aClearance + m_clearance[i] ) )
+        {
+            aHits[i] = true;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+
+#ifdef SEG_BATCH_USE_AVX2
+
+/*
+ * The AVX2 kernels.  They are compiled for AVX2 whatever the target of the build, and only
+ * called when the CPU supports it.
+ *
+ * The coordinates are loaded four at a time as 32 bit integers, and the differences of
+ * coordinates are computed on 32 bits, so they wrap exactly like the VECTOR2I ones do.  The
+ * products are then made on 64 bits like the ecoord ones of SEG, hence the results of the
+ * comparisons are the ones of the scalar code.
+ */
+
+#define AVX2_FN __attribute__(( target( "avx2" ) ))
+#define AVX2_INLINE inline __attribute__(( target( "avx2" ), always_inline ))
+
+namespace
+{
+
+struct POINTS
+{
+    __m128i x, y;
+};
+
+
+AVX2_INLINE __m256i widen( __m128i aA )
+{
+    return _mm256_cvtepi32_epi64( aA );
+}
+
+
+///> (ecoord) aA * aB, for each lane
+AVX2_INLINE __m256i mul( __m128i aA, __m128i aB )
+{
+    return _mm256_mul_epi32( widen( aA ), widen( aB ) );
+}
+
+
+AVX2_INLINE __m256i ones()
+{
+    return _mm256_set1_epi64x( -1 );
+}
+
+
+///> SEG::ccw( aA, aB, aC ), for each lane
+AVX2_INLINE __m256i ccw( const POINTS& aA, const POINTS& aB, const POINTS& aC )
+{
+    __m256i l = mul( _mm_sub_epi32( aC.y, aA.y ), _mm_sub_epi32( aB.x, aA.x ) );
+    __m256i r = mul( _mm_sub_epi32( aB.y, aA.y ), _mm_sub_epi32( aC.x, aA.x ) );
+
+    return _mm256_cmpgt_epi64( l, r );
+}
+
+
+/**
+ * SEG( aA, aB ).PointCloserThan( aP, aDist ), for each lane.
+ * @param aYes set to the lanes where the point is closer
+ * @return the lanes the kernel could not decide: the point projects inside the segment and
+ * the segment is neither axis-aligned nor diagonal (or the diagonal test is ambiguous)
+ */
+AVX2_INLINE __m256i pointCloserThan( const POINTS& aA, const POINTS& aB, const POINTS& aP,
+        __m256i aDistSq, __m256i& aYes )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m256i zero64 = _mm256_setzero_si256();
+
+    __m128i dx = _mm_sub_epi32( aB.x, aA.x );
+    __m128i dy = _mm_sub_epi32( aB.y, aA.y );
+    __m128i px = _mm_sub_epi32( aP.x, aA.x );
+    __m128i py = _mm_sub_epi32( aP.y, aA.y );
+    __m128i qx = _mm_sub_epi32( aP.x, aB.x );
+    __m128i qy = _mm_sub_epi32( aP.y, aB.y );
+
+    __m256i lSq = _mm256_add_epi64( mul( dx, dx ), mul( dy, dy ) );
+    __m256i t = _mm256_add_epi64( mul( dx, px ), mul( dy, py ) );
+
+    // t <= 0 || !l_squared: the distance to A
+    __m256i beforeA = _mm256_or_si256( _mm256_xor_si256( _mm256_cmpgt_epi64( t, zero64 ), ones() ),
+                                       _mm256_cmpeq_epi64( lSq, zero64 ) );
+    // t >= l_squared: the distance to B
+    __m256i afterB = _mm256_andnot_si256( beforeA,
+            _mm256_xor_si256( _mm256_cmpgt_epi64( lSq, t ), ones() ) );
+    __m256i inside = _mm256_xor_si256( _mm256_or_si256( beforeA, afterB ), ones() );
+
+    __m256i distA = _mm256_add_epi64( mul( px, px ), mul( py, py ) );
+    __m256i distB = _mm256_add_epi64( mul( qx, qx ), mul( qy, qy ) );
+
+    // the axis-aligned and diagonal segments: distance to the line
+    __m128i adx = _mm_abs_epi32( dx );
+    __m128i ady = _mm_abs_epi32( dy );
+    __m128i dxdy = _mm_sub_epi32( adx, ady );
+    __m128i two = _mm_set1_epi32( 2 );
+
+    __m128i simple = _mm_or_si128(
+            _mm_and_si128( _mm_cmpgt_epi32( dxdy, _mm_set1_epi32( -2 ) ), _mm_cmpgt_epi32( two, dxdy ) ),
+            _mm_or_si128( _mm_cmpgt_epi32( two, adx ), _mm_cmpgt_epi32( two, ady ) ) );
+
+    __m128i ca = _mm_sub_epi32( _mm_cmpgt_epi32( dy, zero ), _mm_cmpgt_epi32( zero, dy ) );
+    __m128i cb = _mm_sub_epi32( _mm_cmpgt_epi32( zero, dx ), _mm_cmpgt_epi32( dx, zero ) );
+    __m128i cc = _mm_sub_epi32( _mm_sub_epi32( zero, _mm_mullo_epi32( ca, aA.x ) ),
+                                _mm_mullo_epi32( cb, aA.y ) );
+
+    __m256i num = _mm256_add_epi64( _mm256_add_epi64( mul( ca, aP.x ), mul( cb, aP.y ) ), widen( cc ) );
+
+    // the square is exact only if num fits in 32 bits, leave the others to SEG
+    __m256i fits = _mm256_and_si256( _mm256_cmpgt_epi64( num, _mm256_set1_epi64x( INT_MIN - 1LL ) ),
+                                     _mm256_cmpgt_epi64( _mm256_set1_epi64x( INT_MAX + 1LL ), num ) );
+
+    __m256i sq = _mm256_mul_epi32( num, num );
+    __m128i diagonal = _mm_andnot_si128( _mm_or_si128( _mm_cmpeq_epi32( ca, zero ), _mm_cmpeq_epi32( cb, zero ) ),
+                                         _mm_set1_epi32( -1 ) );
+
+    sq = _mm256_blendv_epi8( sq, _mm256_srli_epi64( sq, 1 ), widen( diagonal ) );
+
+    __m256i margin = _mm256_set1_epi64x( 100 );
+    __m256i far = _mm256_cmpgt_epi64( sq, _mm256_add_epi64( aDistSq, margin ) );
+    __m256i near = _mm256_cmpgt_epi64( _mm256_sub_epi64( aDistSq, margin ), sq );
+    __m256i heuristic = _mm256_and_si256( inside, _mm256_and_si256( widen( simple ), fits ) );
+
+    aYes = _mm256_or_si256( _mm256_or_si256( _mm256_and_si256( beforeA, _mm256_cmpgt_epi64( aDistSq, distA ) ),
+                                             _mm256_and_si256( afterB, _mm256_cmpgt_epi64( aDistSq, distB ) ) ),
+                            _mm256_and_si256( heuristic, near ) );
+
+    return _mm256_andnot_si256( _mm256_and_si256( heuristic, _mm256_or_si256( far, near ) ), inside );
+}
+
+
+/**
+ * SEG( aA, aB ).Collide( SEG( aP, aR ), aDist ), for each lane.
+ * @return the lanes that are undecided and do not collide so far
+ */
+AVX2_INLINE __m256i segCollide( const POINTS& aA, const POINTS& aB, const POINTS& aP,
+        const POINTS& aR, __m256i aDistSq, __m256i& aYes )
+{
+    __m256i cross = _mm256_and_si256( _mm256_xor_si256( ccw( aA, aP, aR ), ccw( aB, aP, aR ) ),
+                                      _mm256_xor_si256( ccw( aA, aB, aP ), ccw( aA, aB, aR ) ) );
+    __m256i yes[4], undecided[4];
+
+    undecided[0] = pointCloserThan( aA, aB, aP, aDistSq, yes[0] );
+    undecided[1] = pointCloserThan( aA, aB, aR, aDistSq, yes[1] );
+    undecided[2] = pointCloserThan( aP, aR, aA, aDistSq, yes[2] );
+    undecided[3] = pointCloserThan( aP, aR, aB, aDistSq, yes[3] );
+
+    aYes = _mm256_or_si256( _mm256_or_si256( cross, yes[0] ),
+                            _mm256_or_si256( _mm256_or_si256( yes[1], yes[2] ), yes[3] ) );
+
+    return _mm256_andnot_si256( aYes, _mm256_or_si256( _mm256_or_si256( undecided[0], undecided[1] ),
+                                                       _mm256_or_si256( undecided[2], undecided[3] ) ) );
+}
+
+
+AVX2_INLINE int laneMask( __m256i aMask )
+{
+    return _mm256_movemask_pd( _mm256_castsi256_pd( aMask ) );
+}
+
+
+AVX2_INLINE POINTS broadcast( const VECTOR2I& aP )
+{
+    return POINTS{ _mm_set1_epi32( aP.x ), _mm_set1_epi32( aP.y ) };
+}
+
+
+AVX2_INLINE __m128i load( const int* aPtr )
+{
+    return _mm_loadu_si128( reinterpret_cast<const __m128i*>( aPtr ) );
+}
+
+
+/**
+ * BOX2I( aA, aB - aA ).SquaredDistance( aBox ) < aDistSq, for each lane: the bounding box
+ * test SHAPE_LINE_CHAIN::Collide() does before testing each of its segments.
+ */
+AVX2_INLINE __m256i boxCloserThan( const POINTS& aA, const POINTS& aB, const BOX2I& aBox,
+        __m256i aDistSq )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i axis[2];
+
+    for( int i = 0; i < 2; i++ )
+    {
+        __m128i a = i ? aA.y : aA.x;
+        __m128i size = _mm_sub_epi32( i ? aB.y : aB.x, a );
+        __m128i pos = _mm_blendv_epi8( a, i ? aB.y : aB.x, _mm_cmpgt_epi32( zero, size ) );
+
+        size = _mm_abs_epi32( size );
+
+        __m128i boxPos = _mm_set1_epi32( i ? aBox.GetY() : aBox.GetX() );
+        __m128i boxSize = _mm_set1_epi32( i ? aBox.GetHeight() : aBox.GetWidth() );
+        __m128i boxEnd = _mm_add_epi32( boxPos, boxSize );
+
+        __m128i left = _mm_cmpgt_epi32( pos, boxEnd );
+        __m128i right = _mm_andnot_si128( left, _mm_cmpgt_epi32( boxPos, _mm_add_epi32( pos, size ) ) );
+
+        axis[i] = _mm_or_si128( _mm_and_si128( left, _mm_sub_epi32( boxEnd, pos ) ),
+                                _mm_and_si128( right, _mm_sub_epi32( _mm_sub_epi32( boxPos, size ), pos ) ) );
+    }
+
+    __m256i d = _mm256_add_epi64( mul( axis[0], axis[0] ), mul( axis[1], axis[1] ) );
+
+    return _mm256_cmpgt_epi64( aDistSq, d );
+}
+
+
+bool hasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports( "avx2" );
+
+    return avx2;
+}
+
+}
+
+
+/**
+ * Tests aSeg against the segments of the batch, four at a time.
+ * @return the index of the first segment left to test
+ */
+AVX2_FN static int collideAvx2( const SEG_BATCH& aBatch, const int* aAx, const int* aAy,
+        const int* aBx, const int* aBy, const int* aClearance, const SEG& aSeg,
+        int aSegClearance, std::vector<bool>& aHits, int& aCount )
+{
+    const POINTS a = broadcast( aSeg.A );
+    const POINTS b = broadcast( aSeg.B );
+    const int n = aBatch.Size() & ~3;
+
+    for( int i = 0; i < n; i += 4 )
+    {
+        POINTS p{ load( aAx + i ), load( aAy + i ) };
+        POINTS r{ load( aBx + i ), load( aBy + i ) };
+        __m128i dist = _mm_add_epi32( _mm_set1_epi32( aSegClearance ), load( aClearance + i ) );
+        __m256i yes;
+
+        int undecided = laneMask( segCollide( a, b, p, r, mul( dist, dist ), yes ) );
+        int hits = laneMask( yes );
+
+        for( int k = 0; k < 4; k++ )
+        {
+            if( ( undecided >> k ) & 1 )
+            {
+                if( aSeg.Collide( aBatch.Segment( i + k ), aSegClearance + aClearance[i + k] ) )
+                    hits |= 1 << k;
+            }
+
+            if( ( hits >> k ) & 1 )
+            {
+                aHits[i + k] = true;
+                aCount++;
+            }
+        }
+    }
+
+    return n;
+}
+
+
+AVX2_FN static int collideAvx2( const SEG_BATCH& aBatch, const int* aAx, const int* aAy,
+        const int* aBx, const int* aBy, const int* aClearance, const SHAPE_LINE_CHAIN& aLine,
+        int aLineClearance, std::vector<bool>& aHits, int& aCount )
+{
+    const int n = aBatch.Size() & ~3;
+
+    for( int i = 0; i < n; i += 4 )
+    {
+        POINTS p{ load( aAx + i ), load( aAy + i ) };
+        POINTS r{ load( aBx + i ), load( aBy + i ) };
+        __m128i dist = _mm_add_epi32( _mm_set1_epi32( aLineClearance ), load( aClearance + i ) );
+        __m256i distSq = mul( dist, dist );
+        int hits = 0;
+
+        for( int j = 0; j < aLine.SegmentCount() && hits != 0xf; j++ )
+        {
+            const SEG& s = aLine.CSegment( j );
+            __m256i yes;
+
+            __m256i close = boxCloserThan( p, r, BOX2I( s.A, s.B - s.A ), distSq );
+
+            // most of the segments of the line are far from the batch
+            if( !( laneMask( close ) & ~hits ) )
+                continue;
+
+            __m256i undecided = segCollide( broadcast( s.A ), broadcast( s.B ), p, r, distSq, yes );
+
+            hits |= laneMask( _mm256_and_si256( close, yes ) );
+
+            int left = laneMask( _mm256_and_si256( close, undecided ) ) & ~hits;
+
+            for( int k = 0; left; k++, left >>= 1 )
+            {
+                if( ( left & 1 )
+                    && s.Collide( aBatch.Segment( i + k ), aLineClearance + aClearance[i + k] ) )
+                    hits |= 1 << k;
+            }
+        }
+
+        for( int k = 0; k < 4; k++ )
+        {
+            if( ( hits >> k ) & 1 )
+            {
+                aHits[i + k] = true;
+                aCount++;
+            }
+        }
+    }
+
+    return n;
+}
+
+#endif
+
+
+int SEG_BATCH::Collide( const SEG& aSeg, int aClearance, std::vector<bool>& aHits ) const
+{
+    int first = 0, count = 0;
+
+    aHits.assign( Size(), false );
+
+#ifdef SEG_BATCH_USE_AVX2
+    if( hasAvx2() )
+        first = collideAvx2( *this, m_ax.data(), m_ay.data(), m_bx.data(), m_by.data(),
+                             m_clearance.data(), aSeg, aClearance, aHits, count );
+#endif
+
+    return count + collideScalar( aSeg, aClearance, first, aHits );
+}
+
+
+int SEG_BATCH::Collide( const SHAPE_LINE_CHAIN& aLine, int aClearance,
+        std::vector<bool>& aHits ) const
+{
+    int first = 0, count = 0;
+
+    aHits.assign( Size(), false );
+
+#ifdef SEG_BATCH_USE_AVX2
+    if( hasAvx2() )
+        first = collideAvx2( *this, m_ax.data(), m_ay.data(), m_bx.data(), m_by.data(),
+                             m_clearance.data(), aLine, aClearance, aHits, count );
+#endif
+
+    return count + collideScalar( aLine, aClearance, first, aHits );
+}
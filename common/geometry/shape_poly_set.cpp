@@ -32,11 +32,12 @@
 #include <set>
 #include <list>
 #include <algorithm>
+#include <limits>
 #include <unordered_set>
 
 #include <common.h>
-#include <md5_hash.h>
 #include <map>
+#include <unordered_map>
 
 #include <geometry/geometry_utils.h>
 #include <geometry/shape.h>
@@ -56,6 +57,10 @@ SHAPE_POLY_SET::SHAPE_POLY_SET() :
 SHAPE_POLY_SET::SHAPE_POLY_SET( const SHAPE_POLY_SET& aOther ) :
     SHAPE( SH_POLY_SET ), m_polys( aOther.m_polys )
 {
+    std::lock_guard<std::mutex> lock( aOther.m_edgeIndexMutex );
+
+    if( aOther.isEdgeIndexCurrent() )
+        m_edgeIndex = aOther.m_edgeIndex;
 }
 
 
@@ -155,6 +160,8 @@ bool SHAPE_POLY_SET::GetGlobalIndex( SHAPE_POLY_SET::VERTEX_INDEX aRelativeIndic
 
 int SHAPE_POLY_SET::NewOutline()
 {
+    invalidateEdgeIndex();
+
     SHAPE_LINE_CHAIN empty_path;
     POLYGON poly;
 
@@ -167,6 +174,8 @@ int SHAPE_POLY_SET::NewOutline()
 
 int SHAPE_POLY_SET::NewHole( int aOutline )
 {
+    invalidateEdgeIndex();
+
     SHAPE_LINE_CHAIN empty_path;
 
     empty_path.SetClosed( true );
@@ -184,6 +193,8 @@ int SHAPE_POLY_SET::NewHole( int aOutline )
 
 int SHAPE_POLY_SET::Append( int x, int y, int aOutline, int aHole, bool aAllowDuplication )
 {
+    invalidateEdgeIndex();
+
     if( aOutline < 0 )
         aOutline += m_polys.size();
 
@@ -205,6 +216,8 @@ int SHAPE_POLY_SET::Append( int x, int y, int aOutline, int aHole, bool aAllowDu
 
 void SHAPE_POLY_SET::InsertVertex( int aGlobalIndex, VECTOR2I aNewVertex )
 {
+    invalidateEdgeIndex();
+
     VERTEX_INDEX index;
 
     if( aGlobalIndex < 0 )
@@ -258,7 +271,7 @@ SHAPE_POLY_SET SHAPE_POLY_SET::Subset( int aFirstPolygon, int aLastPolygon )
 
     for( int index = aFirstPolygon; index < aLastPolygon; index++ )
     {
-        newPolySet.m_polys.push_back( Polygon( index ) );
+        newPolySet.m_polys.push_back( CPolygon( index ) );
     }
 
     return newPolySet;
@@ -267,6 +280,8 @@ SHAPE_POLY_SET SHAPE_POLY_SET::Subset( int aFirstPolygon, int aLastPolygon )
 
 VECTOR2I& SHAPE_POLY_SET::Vertex( int aIndex, int aOutline, int aHole )
 {
+    invalidateEdgeIndex();
+
     if( aOutline < 0 )
         aOutline += m_polys.size();
 
@@ -305,6 +320,8 @@ const VECTOR2I& SHAPE_POLY_SET::CVertex( int aIndex, int aOutline, int aHole ) c
 
 VECTOR2I& SHAPE_POLY_SET::Vertex( int aGlobalIndex )
 {
+    invalidateEdgeIndex();
+
     SHAPE_POLY_SET::VERTEX_INDEX index;
 
     // Assure the passed index references a legal position; abort otherwise
@@ -427,6 +444,8 @@ bool SHAPE_POLY_SET::IsSelfIntersecting()
 
 int SHAPE_POLY_SET::AddOutline( const SHAPE_LINE_CHAIN& aOutline )
 {
+    invalidateEdgeIndex();
+
     assert( aOutline.IsClosed() );
 
     POLYGON poly;
@@ -441,6 +460,8 @@ int SHAPE_POLY_SET::AddOutline( const SHAPE_LINE_CHAIN& aOutline )
 
 int SHAPE_POLY_SET::AddHole( const SHAPE_LINE_CHAIN& aHole, int aOutline )
 {
+    invalidateEdgeIndex();
+
     assert( m_polys.size() );
 
     if( aOutline < 0 )
@@ -456,34 +477,62 @@ int SHAPE_POLY_SET::AddHole( const SHAPE_LINE_CHAIN& aHole, int aOutline )
 }
 
 
-const Path SHAPE_POLY_SET::convertToClipper( const SHAPE_LINE_CHAIN& aPath,
-        bool aRequiredOrientation )
+/**
+ * Buffers reused by the polygon operations running on a thread, so converting the
+ * polygons to and from Clipper does not allocate memory at each operation.
+ */
+struct CLIPPER_SCRATCH
+{
+    Path                                    m_path;     // a contour being given to Clipper
+    std::vector<SHAPE_POLY_SET::POLYGON>    m_spare;    // polygons of a previous result,
+                                                        // whose storage is reused
+};
+
+static thread_local CLIPPER_SCRATCH s_scratch;
+
+// Spare polygons having more vertices are released, to not keep too much memory per thread
+static const size_t s_maxSpareVertexCount = 1 << 20;
+
+
+void SHAPE_POLY_SET::convertToClipper( const SHAPE_LINE_CHAIN& aPath, bool aRequiredOrientation,
+                                       Path& aResult )
 {
-    Path c_path;
+    aResult.resize( aPath.PointCount() );
 
     for( int i = 0; i < aPath.PointCount(); i++ )
     {
         const VECTOR2I& vertex = aPath.CPoint( i );
-        c_path.push_back( IntPoint( vertex.x, vertex.y ) );
+        aResult[i] = IntPoint( vertex.x, vertex.y );
     }
 
-    if( Orientation( c_path ) != aRequiredOrientation )
-        ReversePath( c_path );
-
-    return c_path;
+    if( Orientation( aResult ) != aRequiredOrientation )
+        ReversePath( aResult );
 }
 
 
-const SHAPE_LINE_CHAIN SHAPE_POLY_SET::convertFromClipper( const Path& aPath )
+void SHAPE_POLY_SET::convertFromClipper( const Path& aPath, SHAPE_LINE_CHAIN& aResult )
 {
-    SHAPE_LINE_CHAIN lc;
+    aResult.Clear();
 
     for( unsigned int i = 0; i < aPath.size(); i++ )
-        lc.Append( aPath[i].X, aPath[i].Y );
+        aResult.Append( aPath[i].X, aPath[i].Y );
+
+    aResult.SetClosed( true );
+}
+
 
-    lc.SetClosed( true );
+void SHAPE_POLY_SET::addPaths( Clipper& aClipper, const SHAPE_POLY_SET& aShape, PolyType aType )
+{
+    Path& path = s_scratch.m_path;
 
-    return lc;
+    for( const POLYGON& poly : aShape.m_polys )
+    {
+        for( unsigned int i = 0; i < poly.size(); i++ )
+        {
+            convertToClipper( poly[i], i > 0 ? false : true, path );
+            aClipper.AddPath( path, aType, true );
+        }
+    }
 }
 
 
@@ -495,17 +544,8 @@ void SHAPE_POLY_SET::booleanOp( ClipperLib::ClipType aType, const SHAPE_POLY_SET
     if( aFastMode == PM_STRICTLY_SIMPLE )
         c.StrictlySimple( true );
 
-    for( const POLYGON& poly : m_polys )
-    {
-        for( unsigned int i = 0; i < poly.size(); i++ )
-            c.AddPath( convertToClipper( poly[i], i > 0 ? false : true ), ptSubject, true );
-    }
-
-    for( const POLYGON& poly : aOtherShape.m_polys )
-    {
-        for( unsigned int i = 0; i < poly.size(); i++ )
-            c.AddPath( convertToClipper( poly[i], i > 0 ? false : true ), ptClip, true );
-    }
+    addPaths( c, *this, ptSubject );
+    addPaths( c, aOtherShape, ptClip );
 
     PolyTree solution;
 
@@ -525,17 +565,8 @@ void SHAPE_POLY_SET::booleanOp( ClipperLib::ClipType aType,
     if( aFastMode == PM_STRICTLY_SIMPLE )
         c.StrictlySimple( true );
 
-    for( const POLYGON& poly : aShape.m_polys )
-    {
-        for( unsigned int i = 0; i < poly.size(); i++ )
-            c.AddPath( convertToClipper( poly[i], i > 0 ? false : true ), ptSubject, true );
-    }
-
-    for( const POLYGON& poly : aOtherShape.m_polys )
-    {
-        for( unsigned int i = 0; i < poly.size(); i++ )
-            c.AddPath( convertToClipper( poly[i], i > 0 ? false : true ), ptClip, true );
-    }
+    addPaths( c, aShape, ptSubject );
+    addPaths( c, aOtherShape, ptClip );
 
     PolyTree solution;
 
@@ -597,11 +628,15 @@ void SHAPE_POLY_SET::Inflate( int aFactor, int aCircleSegmentsCount )
 
     ClipperOffset c;
 
+    Path& path = s_scratch.m_path;
+
     for( const POLYGON& poly : m_polys )
     {
         for( unsigned int i = 0; i < poly.size(); i++ )
-            c.AddPath( convertToClipper( poly[i], i > 0 ? false : true ), jtRound,
-                    etClosedPolygon );
+        {
+            convertToClipper( poly[i], i > 0 ? false : true, path );
+            c.AddPath( path, jtRound, etClosedPolygon );
+        }
     }
 
     PolyTree solution;
@@ -636,22 +671,42 @@ void SHAPE_POLY_SET::Inflate( int aFactor, int aCircleSegmentsCount )
 
 void SHAPE_POLY_SET::importTree( PolyTree* tree )
 {
-    m_polys.clear();
+    invalidateEdgeIndex();
+
+    // Build the result in the storage of previous results, reusing their point buffers
+    POLYSET& result = s_scratch.m_spare;
+    size_t count = 0;
 
     for( PolyNode* n = tree->GetFirst(); n; n = n->GetNext() )
     {
         if( !n->IsHole() )
         {
-            POLYGON paths;
-            paths.reserve( n->Childs.size() + 1 );
-            paths.push_back( convertFromClipper( n->Contour ) );
+            if( count == result.size() )
+                result.emplace_back();
 
-            for( unsigned int i = 0; i < n->Childs.size(); i++ )
-                paths.push_back( convertFromClipper( n->Childs[i]->Contour ) );
+            POLYGON& paths = result[count++];
+            paths.resize( n->Childs.size() + 1 );
+            convertFromClipper( n->Contour, paths[0] );
 
-            m_polys.push_back( paths );
+            for( unsigned int i = 0; i < n->Childs.size(); i++ )
+                convertFromClipper( n->Childs[i]->Contour, paths[i + 1] );
         }
     }
+
+    result.resize( count );
+    std::swap( m_polys, result );
+
+    // The previous polygons of this set become the spare storage
+    size_t spareVertexCount = 0;
+
+    for( const POLYGON& poly : result )
+    {
+        for( const SHAPE_LINE_CHAIN& path : poly )
+            spareVertexCount += path.PointCount();
+    }
+
+    if( spareVertexCount > s_maxSpareVertexCount )
+        POLYSET().swap( result );
 }
 
 
@@ -874,6 +929,8 @@ void SHAPE_POLY_SET::fractureSingle( POLYGON& paths )
 
 void SHAPE_POLY_SET::Fracture( POLYGON_MODE aFastMode )
 {
+    invalidateEdgeIndex();
+
     Simplify( aFastMode );    // remove overlapping holes/degeneracy
 
     for( POLYGON& paths : m_polys )
@@ -1061,6 +1118,8 @@ bool SHAPE_POLY_SET::HasHoles() const
 
 void SHAPE_POLY_SET::Unfracture( POLYGON_MODE aFastMode )
 {
+    invalidateEdgeIndex();
+
     for( POLYGON& path : m_polys )
     {
         unfractureSingle( path );
@@ -1138,6 +1197,8 @@ const std::string SHAPE_POLY_SET::Format() const
 
 bool SHAPE_POLY_SET::Parse( std::stringstream& aStream )
 {
+    invalidateEdgeIndex();
+
     std::string tmp;
 
     aStream >> tmp;
@@ -1195,6 +1256,441 @@ bool SHAPE_POLY_SET::Parse( std::stringstream& aStream )
 }
 
 
+/**
+ * Function crossEdge
+ * is one step of the point in polygon test: toggles aInside if the horizontal ray going
+ * from aP to the right crosses the edge going from ip to ipNext.
+ * @return true if aP is on the edge (the test can stop there).
+ */
+static inline bool crossEdge( const VECTOR2I& aP, const VECTOR2I& ip, const VECTOR2I& ipNext,
+                              int& aInside )
+{
+    if( ipNext.y == aP.y )
+    {
+        if( ( ipNext.x == aP.x ) || ( ip.y == aP.y
+                                      && ( ( ipNext.x > aP.x ) == ( ip.x < aP.x ) ) ) )
+            return true;
+    }
+
+    if( ( ip.y < aP.y ) != ( ipNext.y < aP.y ) )
+    {
+        if( ip.x >= aP.x )
+        {
+            if( ipNext.x > aP.x )
+                aInside = 1 - aInside;
+            else
+            {
+                int64_t d = (int64_t) ( ip.x - aP.x ) * (int64_t) ( ipNext.y - aP.y ) -
+                            (int64_t) ( ipNext.x - aP.x ) * (int64_t) ( ip.y - aP.y );
+
+                if( !d )
+                    return true;
+
+                if( ( d > 0 ) == ( ipNext.y > ip.y ) )
+                    aInside = 1 - aInside;
+            }
+        }
+        else
+        {
+            if( ipNext.x > aP.x )
+            {
+                int64_t d = (int64_t) ( ip.x - aP.x ) * (int64_t) ( ipNext.y - aP.y ) -
+                            (int64_t) ( ipNext.x - aP.x ) * (int64_t) ( ip.y - aP.y );
+
+                if( !d )
+                    return true;
+
+                if( ( d > 0 ) == ( ipNext.y > ip.y ) )
+                    aInside = 1 - aInside;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * Class EDGE_INDEX
+ * sorts the edges of the polygons of a set in horizontal bands, so the point queries only
+ * look at the edges of the bands near the query point instead of at all the edges.
+ *
+ * An edge is stored in each band its vertical extent overlaps, and the edges of a band are
+ * sorted by contour, the outline first.  The index is immutable once built.
+ */
+class SHAPE_POLY_SET::EDGE_INDEX
+{
+public:
+    EDGE_INDEX( const POLYSET& aPolys );
+
+    ///> False if the set has open or degenerated contours: they are tested differently by
+    ///> the queries, which then have to scan the contours.
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+    ///> @copydoc SHAPE_POLY_SET::containsSingle()
+    bool Contains( const VECTOR2I& aP, int aPoly, bool aIgnoreHoles,
+                   const POLYGON& aSource ) const;
+
+    ///> @copydoc SHAPE_POLY_SET::PointOnEdge()
+    bool PointOnEdge( const VECTOR2I& aP ) const;
+
+    ///> Returns the distance between aP and the nearest edge of the aPoly-th polygon.
+    int EdgeDistance( const VECTOR2I& aP, int aPoly ) const;
+
+    ///> Returns the distance between aSeg and the nearest edge of the aPoly-th polygon.
+    int EdgeDistance( const SEG& aSeg, int aPoly ) const;
+
+    ///> Returns a lower bound of the distance between aBox and the aPoly-th polygon.
+    int64_t DistanceLowerBound( const BOX2I& aBox, int aPoly ) const;
+
+private:
+    struct EDGE
+    {
+        VECTOR2I    m_a;
+        VECTOR2I    m_b;
+        int         m_contour;
+    };
+
+    struct POLY
+    {
+        BOX2I               m_outlineBox;   // the bounding box of the outline
+        BOX2I               m_box;          // the bounding box of all the contours
+        int64_t             m_bandHeight;
+        int                 m_bandCount;
+        std::vector<int>    m_bandStart;    // the first edge of each band, and the end
+        std::vector<EDGE>   m_edges;
+
+        int band( int64_t aY ) const
+        {
+            int64_t band = ( aY - m_box.GetY() ) / m_bandHeight;
+
+            return (int) std::max<int64_t>( 0, std::min<int64_t>( band, m_bandCount - 1 ) );
+        }
+
+        ///> Returns the vertical distance between the band and the [aYMin, aYMax] range.
+        int64_t bandDistance( int aBand, int64_t aYMin, int64_t aYMax ) const
+        {
+            int64_t top = m_box.GetY() + aBand * m_bandHeight;
+            int64_t bottom = top + m_bandHeight - 1;
+
+            if( aYMax < top )
+                return top - aYMax;
+            else if( aYMin > bottom )
+                return aYMin - bottom;
+
+            return 0;
+        }
+    };
+
+    /**
+     * Function nearestEdge
+     * @return the smallest aDistance( edge ) for the edges of aPoly, aDistance being a
+     * distance to an object whose vertical extent is [aYMin, aYMax].  The bands are
+     * visited from this range outwards, until they are farther than the nearest edge.
+     */
+    template <typename DISTANCE>
+    static int nearestEdge( const POLY& aPoly, int64_t aYMin, int64_t aYMax,
+                            DISTANCE aDistance );
+
+    std::vector<POLY>   m_polys;
+    bool                m_valid;
+};
+
+
+// Polygons having less edges are not worth indexing
+static const int s_edgeIndexMinVertices = 64;
+
+// The number of queries after which a set which has not been modified meanwhile is indexed
+static const int s_edgeIndexMinQueries = 4;
+
+static const int s_edgeIndexMaxBands = 4096;
+
+
+SHAPE_POLY_SET::EDGE_INDEX::EDGE_INDEX( const POLYSET& aPolys ) :
+    m_polys( aPolys.size() ),
+    m_valid( true )
+{
+    for( size_t ii = 0; ii < aPolys.size(); ii++ )
+    {
+        const POLYGON& source = aPolys[ii];
+        POLY& poly = m_polys[ii];
+        int vertexCount = 0;
+
+        for( const SHAPE_LINE_CHAIN& contour : source )
+        {
+            if( !contour.IsClosed() || contour.PointCount() < 3 )
+                m_valid = false;
+
+            vertexCount += contour.PointCount();
+        }
+
+        if( source.empty() || !m_valid )
+        {
+            m_valid = false;
+            return;
+        }
+
+        poly.m_outlineBox = source[0].BBox();
+        poly.m_box = poly.m_outlineBox;
+
+        for( size_t jj = 1; jj < source.size(); jj++ )
+            poly.m_box.Merge( source[jj].BBox() );
+
+        int64_t height = (int64_t) poly.m_box.GetHeight() + 1;
+        int bandCount = (int) std::min<int64_t>( height, s_edgeIndexMaxBands );
+        bandCount = std::max( 1, std::min( bandCount, (int) ( 2 * sqrt( vertexCount ) ) ) );
+
+        // An edge is stored once per band it overlaps: use less bands if the long edges
+        // would make the index too large
+        std::vector<int> counts;
+        size_t total;
+
+        while( true )
+        {
+            poly.m_bandCount = bandCount;
+            poly.m_bandHeight = ( height + bandCount - 1 ) / bandCount;
+            counts.assign( bandCount, 0 );
+            total = 0;
+
+            for( const SHAPE_LINE_CHAIN& contour : source )
+            {
+                for( int jj = 0; jj < contour.PointCount(); jj++ )
+                {
+                    const VECTOR2I& a = contour.CPoint( jj );
+                    const VECTOR2I& b = contour.CPoint( ( jj + 1 ) % contour.PointCount() );
+                    int first = poly.band( std::min( a.y, b.y ) );
+                    int last = poly.band( std::max( a.y, b.y ) );
+
+                    for( int band = first; band <= last; band++ )
+                        counts[band]++;
+
+                    total += last - first + 1;
+                }
+            }
+
+            if( bandCount == 1 || total <= 8 * (size_t) vertexCount )
+                break;
+
+            bandCount /= 2;
+        }
+
+        poly.m_bandStart.resize( bandCount + 1 );
+        poly.m_bandStart[0] = 0;
+
+        for( int band = 0; band < bandCount; band++ )
+            poly.m_bandStart[band + 1] = poly.m_bandStart[band] + counts[band];
+
+        poly.m_edges.resize( total );
+
+        std::vector<int> next( poly.m_bandStart.begin(), poly.m_bandStart.end() - 1 );
+
+        for( size_t contourIdx = 0; contourIdx < source.size(); contourIdx++ )
+        {
+            const SHAPE_LINE_CHAIN& contour = source[contourIdx];
+
+            for( int jj = 0; jj < contour.PointCount(); jj++ )
+            {
+                EDGE edge;
+                edge.m_a = contour.CPoint( jj );
+                edge.m_b = contour.CPoint( ( jj + 1 ) % contour.PointCount() );
+                edge.m_contour = contourIdx;
+
+                int last = poly.band( std::max( edge.m_a.y, edge.m_b.y ) );
+
+                for( int band = poly.band( std::min( edge.m_a.y, edge.m_b.y ) ); band <= last;
+                     band++ )
+                {
+                    poly.m_edges[next[band]++] = edge;
+                }
+            }
+        }
+    }
+}
+
+
+bool SHAPE_POLY_SET::EDGE_INDEX::Contains( const VECTOR2I& aP, int aPoly, bool aIgnoreHoles,
+                                           const POLYGON& aSource ) const
+{
+    const POLY& poly = m_polys[aPoly];
+
+    if( !poly.m_outlineBox.Contains( aP ) )
+        return false;
+
+    // Only the edges of the band of aP can cross the ray going from aP to the right.
+    // They are tested contour by contour, as pointInPolygon() does.
+    int band = poly.band( aP.y );
+    int end = poly.m_bandStart[band + 1];
+    int contour = 0;
+    int inside = 0;
+    bool onEdge = false;
+
+    for( int ii = poly.m_bandStart[band]; ; ii++ )
+    {
+        if( ii == end || poly.m_edges[ii].m_contour != contour )
+        {
+            if( contour == 0 )
+            {
+                if( !onEdge && !inside )
+                    return false;
+
+                if( aIgnoreHoles )
+                    return true;
+            }
+            else if( inside && !onEdge && !aSource[contour].PointOnEdge( aP ) )
+            {
+                // The point is inside a hole (and not on its edge)
+                return false;
+            }
+
+            if( ii == end )
+                return true;
+
+            contour = poly.m_edges[ii].m_contour;
+            inside = 0;
+            onEdge = false;
+        }
+
+        if( !onEdge )
+            onEdge = crossEdge( aP, poly.m_edges[ii].m_a, poly.m_edges[ii].m_b, inside );
+    }
+}
+
+
+bool SHAPE_POLY_SET::EDGE_INDEX::PointOnEdge( const VECTOR2I& aP ) const
+{
+    // SEG::Distance() is rounded, so look a bit farther than the 1 unit tolerance
+    const int margin = 2;
+
+    for( const POLY& poly : m_polys )
+    {
+        BOX2I box = poly.m_box;
+        box.Inflate( margin );
+
+        if( !box.Contains( aP ) )
+            continue;
+
+        int first = poly.m_bandStart[poly.band( (int64_t) aP.y - margin )];
+        int end = poly.m_bandStart[poly.band( (int64_t) aP.y + margin ) + 1];
+
+        for( int ii = first; ii < end; ii++ )
+        {
+            const EDGE& edge = poly.m_edges[ii];
+
+            if( edge.m_a == aP || edge.m_b == aP || SEG( edge.m_a, edge.m_b ).Distance( aP ) <= 1 )
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+template <typename DISTANCE>
+int SHAPE_POLY_SET::EDGE_INDEX::nearestEdge( const POLY& aPoly, int64_t aYMin, int64_t aYMax,
+                                             DISTANCE aDistance )
+{
+    int minDistance = std::numeric_limits<int>::max();
+
+    auto scanBand = [&]( int aBand )
+    {
+        for( int ii = aPoly.m_bandStart[aBand]; ii < aPoly.m_bandStart[aBand + 1]; ii++ )
+            minDistance = std::min( minDistance, aDistance( aPoly.m_edges[ii] ) );
+    };
+
+    int first = aPoly.band( aYMin );
+    int last = aPoly.band( aYMax );
+
+    for( int band = first; band <= last && minDistance > 0; band++ )
+        scanBand( band );
+
+    // The distances are rounded, hence the 1 unit margin
+    for( int ii = 1; minDistance > 0; ii++ )
+    {
+        bool above = first - ii >= 0
+                     && aPoly.bandDistance( first - ii, aYMin, aYMax ) <= (int64_t) minDistance + 1;
+        bool below = last + ii < aPoly.m_bandCount
+                     && aPoly.bandDistance( last + ii, aYMin, aYMax ) <= (int64_t) minDistance + 1;
+
+        if( !above && !below )
+            break;
+
+        if( above )
+            scanBand( first - ii );
+
+        if( below )
+            scanBand( last + ii );
+    }
+
+    return minDistance;
+}
+
+
+int SHAPE_POLY_SET::EDGE_INDEX::EdgeDistance( const VECTOR2I& aP, int aPoly ) const
+{
+    return nearestEdge( m_polys[aPoly], aP.y, aP.y,
+                        [&]( const EDGE& aEdge )
+                        {
+                            return SEG( aEdge.m_a, aEdge.m_b ).Distance( aP );
+                        } );
+}
+
+
+int SHAPE_POLY_SET::EDGE_INDEX::EdgeDistance( const SEG& aSeg, int aPoly ) const
+{
+    return nearestEdge( m_polys[aPoly], std::min( aSeg.A.y, aSeg.B.y ),
+                        std::max( aSeg.A.y, aSeg.B.y ),
+                        [&]( const EDGE& aEdge )
+                        {
+                            return SEG( aEdge.m_a, aEdge.m_b ).Distance( aSeg );
+                        } );
+}
+
+
+int64_t SHAPE_POLY_SET::EDGE_INDEX::DistanceLowerBound( const BOX2I& aBox, int aPoly ) const
+{
+    // The distances are rounded, hence the 1 unit margin
+    return (int64_t) sqrt( m_polys[aPoly].m_box.SquaredDistance( aBox ) ) - 1;
+}
+
+
+std::shared_ptr<const SHAPE_POLY_SET::EDGE_INDEX> SHAPE_POLY_SET::edgeIndex() const
+{
+    std::lock_guard<std::mutex> lock( m_edgeIndexMutex );
+
+    // Start again after a modification
+    if( !isEdgeIndexCurrent() )
+    {
+        m_edgeIndex.reset();
+        m_edgeIndexQueries = 0;
+        m_edgeIndexModification = m_modificationCount.load( std::memory_order_relaxed );
+    }
+
+    if( m_edgeIndex || m_edgeIndexQueries < 0 )
+        return m_edgeIndex;
+
+    // Do not index a set which is being modified between the queries
+    if( ++m_edgeIndexQueries < s_edgeIndexMinQueries )
+        return nullptr;
+
+    if( TotalVertices() >= s_edgeIndexMinVertices )
+    {
+        auto index = std::make_shared<const EDGE_INDEX>( m_polys );
+
+        if( index->IsValid() )
+            m_edgeIndex = index;
+    }
+
+    // Do not try again until the set is modified
+    if( !m_edgeIndex )
+        m_edgeIndexQueries = -1;
+
+    return m_edgeIndex;
+}
+
+
 const BOX2I SHAPE_POLY_SET::BBox( int aClearance ) const
 {
     BOX2I bb;
@@ -1214,6 +1710,9 @@ const BOX2I SHAPE_POLY_SET::BBox( int aClearance ) const
 
 bool SHAPE_POLY_SET::PointOnEdge( const VECTOR2I& aP ) const
 {
+    if( std::shared_ptr<const EDGE_INDEX> index = edgeIndex() )
+        return index->PointOnEdge( aP );
+
     // Iterate through all the polygons in the set
     for( const POLYGON& polygon : m_polys )
     {
@@ -1231,28 +1730,27 @@ bool SHAPE_POLY_SET::PointOnEdge( const VECTOR2I& aP ) const
 
 bool SHAPE_POLY_SET::Collide( const VECTOR2I& aP, int aClearance ) const
 {
-    SHAPE_POLY_SET polySet = SHAPE_POLY_SET( *this );
-
-    // Inflate the polygon if necessary.
-    if( aClearance > 0 )
-    {
-        // fixme: the number of arc segments should not be hardcoded
-        polySet.Inflate( aClearance, 8 );
-    }
+    if( Contains( aP ) )
+        return true;
 
-    // There is a collision if and only if the point is inside of the polygon.
-    return polySet.Contains( aP );
+    // Outside of the polygons, there is a collision if the point is closer than aClearance
+    // to an edge (which is what inflating the polygons by aClearance would test)
+    return aClearance > 0 && !m_polys.empty() && Distance( aP ) <= aClearance;
 }
 
 
 void SHAPE_POLY_SET::RemoveAllContours()
 {
+    invalidateEdgeIndex();
+
     m_polys.clear();
 }
 
 
 void SHAPE_POLY_SET::RemoveContour( int aContourIdx, int aPolygonIdx )
 {
+    invalidateEdgeIndex();
+
     // Default polygon is the last one
     if( aPolygonIdx < 0 )
         aPolygonIdx += m_polys.size();
@@ -1316,12 +1814,16 @@ int SHAPE_POLY_SET::RemoveNullSegments()
 
 void SHAPE_POLY_SET::DeletePolygon( int aIdx )
 {
+    invalidateEdgeIndex();
+
     m_polys.erase( m_polys.begin() + aIdx );
 }
 
 
 void SHAPE_POLY_SET::Append( const SHAPE_POLY_SET& aSet )
 {
+    invalidateEdgeIndex();
+
     m_polys.insert( m_polys.end(), aSet.m_polys.begin(), aSet.m_polys.end() );
 }
 
@@ -1405,14 +1907,16 @@ bool SHAPE_POLY_SET::Contains( const VECTOR2I& aP, int aSubpolyIndex, bool aIgno
     if( m_polys.size() == 0 ) // empty set?
         return false;
 
+    std::shared_ptr<const EDGE_INDEX> index = edgeIndex();
+
     // If there is a polygon specified, check the condition against that polygon
     if( aSubpolyIndex >= 0 )
-        return containsSingle( aP, aSubpolyIndex, aIgnoreHoles );
+        return containsSingle( aP, aSubpolyIndex, aIgnoreHoles, index.get() );
 
     // In any other case, check it against all polygons in the set
     for( int polygonIdx = 0; polygonIdx < OutlineCount(); polygonIdx++ )
     {
-        if( containsSingle( aP, polygonIdx, aIgnoreHoles ) )
+        if( containsSingle( aP, polygonIdx, aIgnoreHoles, index.get() ) )
             return true;
     }
 
@@ -1434,12 +1938,24 @@ void SHAPE_POLY_SET::RemoveVertex( int aGlobalIndex )
 
 void SHAPE_POLY_SET::RemoveVertex( VERTEX_INDEX aIndex )
 {
+    invalidateEdgeIndex();
+
     m_polys[aIndex.m_polygon][aIndex.m_contour].Remove( aIndex.m_vertex );
 }
 
 
 bool SHAPE_POLY_SET::containsSingle( const VECTOR2I& aP, int aSubpolyIndex, bool aIgnoreHoles ) const
 {
+    return containsSingle( aP, aSubpolyIndex, aIgnoreHoles, edgeIndex().get() );
+}
+
+
+bool SHAPE_POLY_SET::containsSingle( const VECTOR2I& aP, int aSubpolyIndex, bool aIgnoreHoles,
+                                     const EDGE_INDEX* aIndex ) const
+{
+    if( aIndex )
+        return aIndex->Contains( aP, aSubpolyIndex, aIgnoreHoles, m_polys[aSubpolyIndex] );
+
     // Check that the point is inside the outline
     if( pointInPolygon( aP, m_polys[aSubpolyIndex][0] ) )
     {
@@ -1481,46 +1997,8 @@ bool SHAPE_POLY_SET::pointInPolygon( const VECTOR2I& aP, const SHAPE_LINE_CHAIN&
     {
         VECTOR2I ipNext = ( i == cnt ? aPath.CPoint( 0 ) : aPath.CPoint( i ) );
 
-        if( ipNext.y == aP.y )
-        {
-            if( ( ipNext.x == aP.x ) || ( ip.y == aP.y
-                                          && ( ( ipNext.x > aP.x ) == ( ip.x < aP.x ) ) ) )
-                return true;
-        }
-
-        if( ( ip.y < aP.y ) != ( ipNext.y < aP.y ) )
-        {
-            if( ip.x >= aP.x )
-            {
-                if( ipNext.x > aP.x )
-                    result = 1 - result;
-                else
-                {
-                    int64_t d = (int64_t) ( ip.x - aP.x ) * (int64_t) ( ipNext.y - aP.y ) -
-                                (int64_t) ( ipNext.x - aP.x ) * (int64_t) ( ip.y - aP.y );
-
-                    if( !d )
-                        return true;
-
-                    if( ( d > 0 ) == ( ipNext.y > ip.y ) )
-                        result = 1 - result;
-                }
-            }
-            else
-            {
-                if( ipNext.x > aP.x )
-                {
-                    int64_t d = (int64_t) ( ip.x - aP.x ) * (int64_t) ( ipNext.y - aP.y ) -
-                                (int64_t) ( ipNext.x - aP.x ) * (int64_t) ( ip.y - aP.y );
-
-                    if( !d )
-                        return true;
-
-                    if( ( d > 0 ) == ( ipNext.y > ip.y ) )
-                        result = 1 - result;
-                }
-            }
-        }
+        if( crossEdge( aP, ip, ipNext, result ) )
+            return true;
 
         ip = ipNext;
     }
@@ -1531,6 +2009,8 @@ bool SHAPE_POLY_SET::pointInPolygon( const VECTOR2I& aP, const SHAPE_LINE_CHAIN&
 
 void SHAPE_POLY_SET::Move( const VECTOR2I& aVector )
 {
+    invalidateEdgeIndex();
+
     for( POLYGON& poly : m_polys )
     {
         for( SHAPE_LINE_CHAIN& path : poly )
@@ -1543,6 +2023,8 @@ void SHAPE_POLY_SET::Move( const VECTOR2I& aVector )
 
 void SHAPE_POLY_SET::Rotate( double aAngle, const VECTOR2I& aCenter )
 {
+    invalidateEdgeIndex();
+
     for( POLYGON& poly : m_polys )
     {
         for( SHAPE_LINE_CHAIN& path : poly )
@@ -1583,16 +2065,21 @@ SHAPE_POLY_SET::POLYGON SHAPE_POLY_SET::FilletPolygon( unsigned int aRadius,
 }
 
 
-int SHAPE_POLY_SET::DistanceToPolygon( VECTOR2I aPoint, int aPolygonIndex )
+int SHAPE_POLY_SET::DistanceToPolygon( VECTOR2I aPoint, int aPolygonIndex ) const
 {
+    std::shared_ptr<const EDGE_INDEX> index = edgeIndex();
+
     // We calculate the min dist between the segment and each outline segment
     // However, if the segment to test is inside the outline, and does not cross
     // any edge, it can be seen outside the polygon.
     // Therefore test if a segment end is inside ( testing only one end is enough )
-    if( containsSingle( aPoint, aPolygonIndex ) )
+    if( containsSingle( aPoint, aPolygonIndex, false, index.get() ) )
         return 0;
 
-    SEGMENT_ITERATOR iterator = IterateSegmentsWithHoles( aPolygonIndex );
+    if( index )
+        return index->EdgeDistance( aPoint, aPolygonIndex );
+
+    CONST_SEGMENT_ITERATOR iterator = CIterateSegmentsWithHoles( aPolygonIndex );
 
     SEG polygonEdge = *iterator;
     int minDistance = polygonEdge.Distance( aPoint );
@@ -1611,28 +2098,40 @@ int SHAPE_POLY_SET::DistanceToPolygon( VECTOR2I aPoint, int aPolygonIndex )
 }
 
 
-int SHAPE_POLY_SET::DistanceToPolygon( SEG aSegment, int aPolygonIndex, int aSegmentWidth )
+int SHAPE_POLY_SET::DistanceToPolygon( SEG aSegment, int aPolygonIndex,
+                                       int aSegmentWidth ) const
 {
+    std::shared_ptr<const EDGE_INDEX> index = edgeIndex();
+
     // We calculate the min dist between the segment and each outline segment
     // However, if the segment to test is inside the outline, and does not cross
     // any edge, it can be seen outside the polygon.
     // Therefore test if a segment end is inside ( testing only one end is enough )
-    if( containsSingle( aSegment.A, aPolygonIndex ) )
+    if( containsSingle( aSegment.A, aPolygonIndex, false, index.get() ) )
         return 0;
 
-    SEGMENT_ITERATOR iterator = IterateSegmentsWithHoles( aPolygonIndex );
-
-    SEG polygonEdge = *iterator;
-    int minDistance = polygonEdge.Distance( aSegment );
+    int minDistance;
 
-    for( iterator++; iterator && minDistance > 0; iterator++ )
+    if( index )
     {
-        polygonEdge = *iterator;
+        minDistance = index->EdgeDistance( aSegment, aPolygonIndex );
+    }
+    else
+    {
+        CONST_SEGMENT_ITERATOR iterator = CIterateSegmentsWithHoles( aPolygonIndex );
 
-        int currentDistance = polygonEdge.Distance( aSegment );
+        SEG polygonEdge = *iterator;
+        minDistance = polygonEdge.Distance( aSegment );
 
-        if( currentDistance < minDistance )
-            minDistance = currentDistance;
+        for( iterator++; iterator && minDistance > 0; iterator++ )
+        {
+            polygonEdge = *iterator;
+
+            int currentDistance = polygonEdge.Distance( aSegment );
+
+            if( currentDistance < minDistance )
+                minDistance = currentDistance;
+        }
     }
 
     // Take into account the width of the segment
@@ -1644,14 +2143,20 @@ int SHAPE_POLY_SET::DistanceToPolygon( SEG aSegment, int aPolygonIndex, int aSeg
 }
 
 
-int SHAPE_POLY_SET::Distance( VECTOR2I aPoint )
+int SHAPE_POLY_SET::Distance( VECTOR2I aPoint ) const
 {
+    std::shared_ptr<const EDGE_INDEX> index = edgeIndex();
+    BOX2I pointBox( aPoint, VECTOR2I( 0, 0 ) );
     int currentDistance;
     int minDistance = DistanceToPolygon( aPoint, 0 );
 
     // Iterate through all the polygons and get the minimum distance.
     for( unsigned int polygonIdx = 1; polygonIdx < m_polys.size(); polygonIdx++ )
     {
+        // Skip the polygons which are too far to be the nearest one
+        if( index && index->DistanceLowerBound( pointBox, polygonIdx ) > minDistance )
+            continue;
+
         currentDistance = DistanceToPolygon( aPoint, polygonIdx );
 
         if( currentDistance < minDistance )
@@ -1662,14 +2167,23 @@ int SHAPE_POLY_SET::Distance( VECTOR2I aPoint )
 }
 
 
-int SHAPE_POLY_SET::Distance( const SEG& aSegment, int aSegmentWidth )
+int SHAPE_POLY_SET::Distance( const SEG& aSegment, int aSegmentWidth ) const
 {
+    std::shared_ptr<const EDGE_INDEX> index = edgeIndex();
+    BOX2I segmentBox( aSegment.A, aSegment.B - aSegment.A );
     int currentDistance;
     int minDistance = DistanceToPolygon( aSegment, 0 );
 
+    segmentBox.Normalize();
+
     // Iterate through all the polygons and get the minimum distance.
     for( unsigned int polygonIdx = 1; polygonIdx < m_polys.size(); polygonIdx++ )
     {
+        // Skip the polygons which are too far to be the nearest one
+        if( index && index->DistanceLowerBound( segmentBox, polygonIdx ) - aSegmentWidth / 2
+                     > minDistance )
+            continue;
+
         currentDistance = DistanceToPolygon( aSegment, polygonIdx, aSegmentWidth );
 
         if( currentDistance < minDistance )
@@ -1883,10 +2397,25 @@ SHAPE_POLY_SET &SHAPE_POLY_SET::operator=( const SHAPE_POLY_SET& aOther )
     static_cast<SHAPE&>(*this) = aOther;
     m_polys = aOther.m_polys;
 
-    // reset poly cache:
-    m_hash = MD5_HASH{};
+    std::shared_ptr<const EDGE_INDEX> index;
+
+    {
+        std::lock_guard<std::mutex> lock( aOther.m_edgeIndexMutex );
+
+        if( aOther.isEdgeIndexCurrent() )
+            index = aOther.m_edgeIndex;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_edgeIndexMutex );
+
+        m_edgeIndex = index;
+        m_edgeIndexQueries = 0;
+        m_edgeIndexModification = m_modificationCount.load( std::memory_order_relaxed );
+    }
+
+    // the triangulations are kept, to be reused for the polygons which do not change
     m_triangulationValid = false;
-    m_triangulatedPolys.clear();
     return *this;
 }
 
@@ -2019,6 +2548,35 @@ void SHAPE_POLY_SET::TRIANGULATED_POLYGON::AllocateTriangles( int aSize )
 }
 
 
+void SHAPE_POLY_SET::TRIANGULATED_POLYGON::Append( const TRIANGULATED_POLYGON& aOther )
+{
+    VECTOR2I* vertices = new VECTOR2I[m_vertexCount + aOther.m_vertexCount];
+    TRI* triangles = new TRI[m_triangleCount + aOther.m_triangleCount];
+
+    std::copy( m_vertices, m_vertices + m_vertexCount, vertices );
+    std::copy( aOther.m_vertices, aOther.m_vertices + aOther.m_vertexCount,
+               vertices + m_vertexCount );
+
+    std::copy( m_triangles, m_triangles + m_triangleCount, triangles );
+
+    for( int i = 0; i < aOther.m_triangleCount; i++ )
+    {
+        TRI& tri = triangles[m_triangleCount + i];
+
+        tri.a = aOther.m_triangles[i].a + m_vertexCount;
+        tri.b = aOther.m_triangles[i].b + m_vertexCount;
+        tri.c = aOther.m_triangles[i].c + m_vertexCount;
+    }
+
+    Clear();
+
+    m_vertices = vertices;
+    m_triangles = triangles;
+    m_vertexCount += aOther.m_vertexCount;
+    m_triangleCount += aOther.m_triangleCount;
+}
+
+
 static int totalVertexCount( const SHAPE_POLY_SET::POLYGON& aPoly )
 {
     int cnt = 0;
@@ -2056,86 +2614,128 @@ bool SHAPE_POLY_SET::IsTriangulationUpToDate() const
     if( !m_triangulationValid )
         return false;
 
-    if( !m_hash.IsValid() )
+    if( m_triangulatedHashes.size() != m_polys.size() )
         return false;
 
-    auto hash = checksum();
+    bool unfracture = !HasHoles();
+
+    for( unsigned int i = 0; i < m_polys.size(); i++ )
+    {
+        if( polygonHash( m_polys[i], unfracture ) != m_triangulatedHashes[i] )
+            return false;
+    }
 
-    return hash == m_hash;
+    return true;
 }
 
 
 void SHAPE_POLY_SET::CacheTriangulation()
 {
-    bool recalculate = !m_hash.IsValid();
-    MD5_HASH hash;
+    // Fractured polygons (a set without holes) are unfractured before the triangulation
+    bool unfracture = !HasHoles();
+    std::vector<uint64_t> hashes;
 
-    if( !m_triangulationValid )
-        recalculate = true;
+    hashes.reserve( m_polys.size() );
+
+    for( const POLYGON& poly : m_polys )
+        hashes.push_back( polygonHash( poly, unfracture ) );
+
+    if( m_triangulationValid && hashes == m_triangulatedHashes )
+        return;
+
+    // The current triangulations, by the hash of their polygon, to be reused for the
+    // polygons which did not change
+    std::unordered_multimap<uint64_t, std::unique_ptr<TRIANGULATED_POLYGON>> previous;
+
+    for( unsigned int i = 0; i < m_triangulatedPolys.size(); i++ )
+    {
+        if( m_triangulatedPolys[i] && i < m_triangulatedHashes.size() )
+            previous.emplace( m_triangulatedHashes[i], std::move( m_triangulatedPolys[i] ) );
+    }
+
+    m_triangulatedPolys.clear();
+    m_triangulatedHashes.clear();
+    m_triangulationValid = false;
+
+    std::vector<std::unique_ptr<TRIANGULATED_POLYGON>> triangulated( m_polys.size() );
 
-    if( !recalculate )
+    for( unsigned int i = 0; i < m_polys.size(); i++ )
     {
-        hash = checksum();
+        auto it = previous.find( hashes[i] );
 
-        if( m_hash != hash )
+        if( it != previous.end() )
         {
-            m_hash = hash;
-            recalculate = true;
+            triangulated[i] = std::move( it->second );
+            previous.erase( it );
+        }
+        else if( !triangulatePolygon( m_polys[i], unfracture, triangulated[i] ) )
+        {
+            // temporary workaround for overlapping hole vertices that poly2tri doesn't handle
+            return;
         }
     }
 
-    if( !recalculate )
-        return;
+    m_triangulatedPolys = std::move( triangulated );
+    m_triangulatedHashes = std::move( hashes );
+    m_triangulationValid = true;
+}
 
-    SHAPE_POLY_SET tmpSet = *this;
 
-    if( !tmpSet.HasHoles() )
-        tmpSet.Unfracture( PM_FAST );
+bool SHAPE_POLY_SET::triangulatePolygon( const POLYGON& aPoly, bool aUnfracture,
+                                         std::unique_ptr<TRIANGULATED_POLYGON>& aResult )
+{
+    SHAPE_POLY_SET tmpSet;
+    tmpSet.m_polys.push_back( aPoly );
 
-    m_triangulatedPolys.clear();
+    if( aUnfracture )
+        tmpSet.Unfracture( PM_FAST );
 
     if( tmpSet.HasTouchingHoles() )
-    {
-        // temporary workaround for overlapping hole vertices that poly2tri doesn't handle
-        m_triangulationValid = false;
-        return;
-    }
+        return false;
+
+    aResult = std::make_unique<TRIANGULATED_POLYGON>();
 
+    // Unfracturing can split a polygon: all the parts are kept in one triangulation,
+    // so there is always one triangulation per polygon of the set
     for( int i = 0; i < tmpSet.OutlineCount(); i++ )
     {
-        m_triangulatedPolys.push_back( std::make_unique<TRIANGULATED_POLYGON>() );
-        triangulateSingle( tmpSet.Polygon( i ), *m_triangulatedPolys.back() );
+        if( i == 0 )
+        {
+            triangulateSingle( tmpSet.Polygon( i ), *aResult );
+        }
+        else
+        {
+            TRIANGULATED_POLYGON part;
+            triangulateSingle( tmpSet.Polygon( i ), part );
+            aResult->Append( part );
+        }
     }
 
-    m_triangulationValid = true;
-    m_hash = checksum();
+    return true;
 }
 
 
-MD5_HASH SHAPE_POLY_SET::checksum() const
+uint64_t SHAPE_POLY_SET::polygonHash( const POLYGON& aPoly, bool aUnfracture )
 {
-    MD5_HASH hash;
+    // Polynomial rolling hash, modulo 2^64
+    const uint64_t base = 0x100000001B3ULL;
+    uint64_t hash = aUnfracture ? 1 : 2;
 
-    hash.Hash( m_polys.size() );
+    hash = hash * base + aPoly.size();
 
-    for( const auto& outline : m_polys )
+    for( const SHAPE_LINE_CHAIN& lc : aPoly )
     {
-        hash.Hash( outline.size() );
+        hash = hash * base + lc.PointCount();
 
-        for( const auto& lc : outline )
+        for( int i = 0; i < lc.PointCount(); i++ )
         {
-            hash.Hash( lc.PointCount() );
+            const VECTOR2I& p = lc.CPoint( i );
 
-            for( int i = 0; i < lc.PointCount(); i++ )
-            {
-                hash.Hash( lc.CPoint( i ).x );
-                hash.Hash( lc.CPoint( i ).y );
-            }
+            hash = hash * base + (uint32_t) p.x;
+            hash = hash * base + (uint32_t) p.y;
         }
     }
 
-    hash.Finalize();
-
     return hash;
 }
 
@@ -92,6 +92,60 @@ bool MD5_HASH::operator!=( const MD5_HASH& aOther ) const
 }
 
 
+std::string MD5_HASH::Format() const
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    std::string text;
+
+    for( int ii = 0; ii < 16; ++ii )
+    {
+        text += hexDigits[m_hash[ii] >> 4];
+        text += hexDigits[m_hash[ii] & 0x0F];
+    }
+
+    return text;
+}
+
+
+static int hexDigitValue( char c )
+{
+    if( c >= '0' && c <= '9' )
+        return c - '0';
+    else if( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    else if( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+    else
+        return -1;
+}
+
+
+bool MD5_HASH::Parse( const std::string& aText )
+{
+    uint8_t hash[16];
+
+    if( aText.size() != 2 * sizeof( hash ) )
+        return false;
+
+    for( int ii = 0; ii < 16; ++ii )
+    {
+        int high = hexDigitValue( aText[2 * ii] );
+        int low = hexDigitValue( aText[2 * ii + 1] );
+
+        if( high < 0 || low < 0 )
+            return false;
+
+        hash[ii] = (uint8_t) ( ( high << 4 ) | low );
+    }
+
+    memcpy( m_hash, hash, 16 );
+    m_valid = true;
+
+    return true;
+}
+
+
 void MD5_HASH::md5_transform(MD5_CTX *ctx, uint8_t data[])
 {
    uint32_t a,b,c,d,m[16],i,j;
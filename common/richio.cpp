@@ -23,7 +23,9 @@
  */
 
 
+#include <algorithm>
 #include <cstdarg>
+#include <cstring>
 #include <config.h> // HAVE_FGETC_NOLOCK
 
 #include <richio.h>
@@ -225,13 +227,123 @@ char* FILE_LINE_READER::ReadLine()
 }
 
 
-STRING_LINE_READER::STRING_LINE_READER( const std::string& aString, const wxString& aSource ):
+WHOLE_FILE_LINE_READER::WHOLE_FILE_LINE_READER( const wxString& aFileName,
+            unsigned aStartingLineNumber ) :
+    FILE_LINE_READER( aFileName, aStartingLineNumber, 0 )
+{
+    readFile();
+}
+
+
+WHOLE_FILE_LINE_READER::WHOLE_FILE_LINE_READER( FILE* aFile, const wxString& aFileName,
+            bool doOwn, unsigned aStartingLineNumber ) :
+    FILE_LINE_READER( aFile, aFileName, doOwn, aStartingLineNumber, 0 )
+{
+    readFile();
+}
+
+
+WHOLE_FILE_LINE_READER::~WHOLE_FILE_LINE_READER()
+{
+    // m_line points into m_buffer, LINE_READER must not free it
+    m_line = NULL;
+}
+
+
+void WHOLE_FILE_LINE_READER::readFile()
+{
+    // Reserve the remaining size of the file when it is known, but read until the end of
+    // file anyway: the text mode can make the file shorter than its size on disk.
+    long start = ftell( m_fp );
+
+    if( start >= 0 && fseek( m_fp, 0, SEEK_END ) == 0 )
+    {
+        long end = ftell( m_fp );
+
+        if( end > start )
+            m_buffer.reserve( end - start + 1 );
+
+        fseek( m_fp, start, SEEK_SET );
+    }
+
+    const size_t chunkSize = 1 << 16;
+    size_t size = 0;
+
+    for(;;)
+    {
+        if( m_buffer.size() < size + chunkSize )
+            m_buffer.resize( std::max( m_buffer.capacity(), size + chunkSize ) );
+
+        size_t request = m_buffer.size() - size;
+        size_t count = fread( &m_buffer[size], 1, request, m_fp );
+        size += count;
+
+        // a short count means the end of file (or an error)
+        if( count < request )
+            break;
+    }
+
+    if( ferror( m_fp ) )
+    {
+        wxString msg = wxString::Format(
+            _( "Unable to read file \"%s\"" ), m_source.GetData() );
+        THROW_IO_ERROR( msg );
+    }
+
+    m_buffer.resize( size + 1 );
+    m_buffer[size] = 0;
+
+    m_ndx = 0;
+    m_saved = m_buffer[0];
+    m_line = &m_buffer.back();
+}
+
+
+char* WHOLE_FILE_LINE_READER::ReadLine()
+{
+    // Put back the first character of this line, replaced by the nul of the last one
+    m_buffer[m_ndx] = m_saved;
+
+    size_t      size = m_buffer.size() - 1;
+    char*       begin = &m_buffer[m_ndx];
+    const char* newline = (const char*) memchr( begin, '\n', size - m_ndx );
+
+    m_length = newline ? newline - begin + 1 : size - m_ndx;   // include the newline
+    m_ndx += m_length;
+
+    m_saved = m_buffer[m_ndx];
+    m_buffer[m_ndx] = 0;
+    m_line = begin;
+
+    // m_lineNum is incremented even if there was no line read, because this
+    // leads to better error reporting when we hit an end of file.
+    ++m_lineNum;
+
+    return m_length ? m_line : NULL;
+}
+
+
+void WHOLE_FILE_LINE_READER::Rewind()
+{
+    m_buffer[m_ndx] = m_saved;
+
+    m_ndx = 0;
+    m_saved = m_buffer[0];
+    m_line = &m_buffer.back();
+    m_length = 0;
+    m_lineNum = 0;
+}
+
+
+STRING_LINE_READER::STRING_LINE_READER( const std::string& aString, const wxString& aSource,
+                                        unsigned aStartingLineNumber ):
     LINE_READER( LINE_READER_LINE_DEFAULT_MAX ),
     m_lines( aString ), m_ndx( 0 )
 {
     // Clipboard text should be nice and _use multiple lines_ so that
     // we can report _line number_ oriented error messages when parsing.
     m_source = aSource;
+    m_lineNum = aStartingLineNumber;
 }
 
 
@@ -363,8 +475,152 @@ const char* OUTPUTFORMATTER::GetQuoteChar( const char* wrapee )
     return GetQuoteChar( wrapee, quoteChar );
 }
 
+/**
+ * Function isSimpleFormat
+ * @return true if the format \a aFormat can be output by OUTPUTFORMATTER::vprintSimple().
+ */
+static bool isSimpleFormat( const char* aFormat )
+{
+    for( const char* fmt = strchr( aFormat, '%' );  fmt;  fmt = strchr( fmt + 1, '%' ) )
+    {
+        ++fmt;
+
+        if( *fmt == 'l' )
+        {
+            ++fmt;
+
+            if( *fmt != 'd' && *fmt != 'u' && *fmt != 'x' && *fmt != 'X' )
+                return false;
+        }
+        else if( *fmt != 's' && *fmt != 'c' && *fmt != 'd' && *fmt != 'u'
+                 && *fmt != 'x' && *fmt != 'X' && *fmt != '%' )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Function formatUnsigned
+ * formats \a aValue in base \a aBase, ending at \a aEnd.
+ * @return the start of the formatted digits.
+ */
+static char* formatUnsigned( char* aEnd, unsigned long aValue, unsigned aBase, bool aUpperCase )
+{
+    const char* digits = aUpperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    do
+    {
+        *--aEnd = digits[aValue % aBase];
+        aValue /= aBase;
+    } while( aValue );
+
+    return aEnd;
+}
+
+
+int OUTPUTFORMATTER::vprintSimple( const char* fmt,  va_list ap )
+{
+    size_t count = 0;
+
+    while( *fmt )
+    {
+        const char* text = fmt;
+        size_t      length = 1;
+        char        number[24];
+        char*       numberEnd = number + sizeof( number );
+
+        if( *fmt != '%' )
+        {
+            const char* next = strchr( fmt, '%' );
+
+            length = next ? next - fmt : strlen( fmt );
+            fmt += length;
+        }
+        else
+        {
+            bool isLong = fmt[1] == 'l';
+            char conversion = fmt[isLong ? 2 : 1];
+
+            fmt += isLong ? 3 : 2;
+
+            switch( conversion )
+            {
+            case 's':
+                text = va_arg( ap, const char* );
+
+                if( !text )
+                    text = "(null)";
+
+                length = strlen( text );
+                break;
+
+            case 'c':
+                number[0] = (char) va_arg( ap, int );
+                text = number;
+                break;
+
+            case 'd':
+            {
+                long value = isLong ? va_arg( ap, long ) : va_arg( ap, int );
+                char* start;
+
+                if( value < 0 )
+                {
+                    start = formatUnsigned( numberEnd, 0UL - (unsigned long) value, 10, false );
+                    *--start = '-';
+                }
+                else
+                {
+                    start = formatUnsigned( numberEnd, value, 10, false );
+                }
+
+                text = start;
+                length = numberEnd - start;
+                break;
+            }
+
+            case 'u':
+            case 'x':
+            case 'X':
+            {
+                unsigned long value = isLong ? va_arg( ap, unsigned long )
+                                             : va_arg( ap, unsigned );
+
+                text = formatUnsigned( numberEnd, value, conversion == 'u' ? 10 : 16,
+                                       conversion == 'X' );
+                length = numberEnd - text;
+                break;
+            }
+
+            default:    // "%%"
+                text = "%";
+                break;
+            }
+        }
+
+        if( count + length > m_buffer.size() )
+            m_buffer.resize( ( count + length ) * 2 );
+
+        memcpy( &m_buffer[count], text, length );
+        count += length;
+    }
+
+    if( count > 0 )
+        write( &m_buffer[0], count );
+
+    return count;
+}
+
+
 int OUTPUTFORMATTER::vprint( const char* fmt,  va_list ap )
 {
+    if( isSimpleFormat( fmt ) )
+        return vprintSimple( fmt, ap );
+
     // This function can call vsnprintf twice.
     // But internally, vsnprintf retrieves arguments from the va_list identified by arg as if
     // va_arg was used on it, and thus the state of the va_list is likely to be altered by the call.
@@ -389,43 +645,33 @@ int OUTPUTFORMATTER::vprint( const char* fmt,  va_list ap )
 }
 
 
-int OUTPUTFORMATTER::sprint( const char* fmt, ... )
-{
-    va_list     args;
-
-    va_start( args, fmt );
-    int ret = vprint( fmt, args);
-    va_end( args );
-
-    return ret;
-}
-
-
 int OUTPUTFORMATTER::Print( int nestLevel, const char* fmt, ... )
 {
 #define NESTWIDTH           2   ///< how many spaces per nestLevel
 
+    static const char spaces[] = "                                ";
+    const int         maxSpaces = sizeof( spaces ) - 1;
+
     va_list     args;
 
     va_start( args, fmt );
 
-    int result = 0;
-    int total  = 0;
+    int total = 0;
 
-    for( int i=0; i<nestLevel;  ++i )
+    // no error checking needed, an exception indicates an error.
+    for( int indent = nestLevel * NESTWIDTH;  indent > 0;  indent -= maxSpaces )
     {
-        // no error checking needed, an exception indicates an error.
-        result = sprint( "%*c", NESTWIDTH, ' ' );
+        int count = std::min( indent, maxSpaces );
 
-        total += result;
+        write( spaces, count );
+        total += count;
     }
 
     // no error checking needed, an exception indicates an error.
-    result = vprint( fmt, args );
+    total += vprint( fmt, args );
 
     va_end( args );
 
-    total += result;
     return total;
 }
 
@@ -486,7 +732,16 @@ std::string OUTPUTFORMATTER::Quotew( const wxString& aWrapee )
     // a different quoting or escaping strategy is desired from the standard,
     // a derived class can overload Quotes() above, but
     // should never be a reason to overload this Quotew() here.
-    return Quotes( (const char*) aWrapee.utf8_str() );
+    const std::string* cached = m_quoteCache.Find( aWrapee );
+
+    if( cached )
+        return *cached;
+
+    std::string quoted = Quotes( (const char*) aWrapee.utf8_str() );
+
+    m_quoteCache.Insert( aWrapee, quoted );
+
+    return quoted;
 }
 
 
@@ -550,6 +805,78 @@ void FILE_OUTPUTFORMATTER::write( const char* aOutBuf, int aCount )
 }
 
 
+//-----<BUFFERED_FILE_OUTPUTFORMATTER>--------------------------------
+
+BUFFERED_FILE_OUTPUTFORMATTER::BUFFERED_FILE_OUTPUTFORMATTER( const wxString& aFileName,
+        const wxChar* aMode,  char aQuoteChar ):
+    FILE_OUTPUTFORMATTER( aFileName, aMode, aQuoteChar ),
+    m_outBuffer( FILEOUTBUFZ ),
+    m_outCount( 0 )
+{
+}
+
+
+BUFFERED_FILE_OUTPUTFORMATTER::~BUFFERED_FILE_OUTPUTFORMATTER()
+{
+    try
+    {
+        flush();
+    }
+    catch( const IO_ERROR& )
+    {
+        // a destructor cannot report it, see Finish()
+    }
+}
+
+
+void BUFFERED_FILE_OUTPUTFORMATTER::Finish()
+{
+    flush();
+
+    if( fflush( m_fp ) != 0 )
+    {
+        wxString msg = wxString::Format(
+                            _( "error writing to file \"%s\"" ),
+                            m_filename.GetData() );
+        THROW_IO_ERROR( msg );
+    }
+}
+
+
+void BUFFERED_FILE_OUTPUTFORMATTER::flush()
+{
+    size_t count = m_outCount;
+
+    // the buffer is empty even if the write fails, so it is not written again
+    m_outCount = 0;
+
+    if( count && 1 != fwrite( &m_outBuffer[0], count, 1, m_fp ) )
+    {
+        wxString msg = wxString::Format(
+                            _( "error writing to file \"%s\"" ),
+                            m_filename.GetData() );
+        THROW_IO_ERROR( msg );
+    }
+}
+
+
+void BUFFERED_FILE_OUTPUTFORMATTER::write( const char* aOutBuf, int aCount )
+{
+    // Few large writes are much faster than many fwrite() calls of a few bytes.
+    if( m_outCount + aCount > m_outBuffer.size() )
+        flush();
+
+    if( (size_t) aCount > m_outBuffer.size() )
+    {
+        FILE_OUTPUTFORMATTER::write( aOutBuf, aCount );
+        return;
+    }
+
+    memcpy( &m_outBuffer[m_outCount], aOutBuf, aCount );
+    m_outCount += aCount;
+}
+
+
 //-----<STREAM_OUTPUTFORMATTER>--------------------------------------
 
 void STREAM_OUTPUTFORMATTER::write( const char* aOutBuf, int aCount )
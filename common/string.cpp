@@ -26,6 +26,13 @@
  * @brief Some useful functions to handle strings.
  */
 
+#include <cerrno>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
 #include <fctsys.h>
 #include <macros.h>
 #include <richio.h>                        // StrPrintf
@@ -538,3 +545,270 @@ bool ReplaceIllegalFileNameChars( wxString& aName, int aReplaceChar )
 
     return changed;
 }
+
+
+// The powers of ten exactly representable by a double
+static const double s_pow10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const int s_maxExactPow10 = 22;
+
+// The integers up to 2^53 are exactly representable by a double
+static const double s_maxExactInt = 9007199254740992.0;
+
+
+static inline bool isDigit( char aChar )
+{
+    return aChar >= '0' && aChar <= '9';
+}
+
+
+double StrToDouble( const char* aText, char** aEndPtr )
+{
+    const char* p = aText;
+
+    while( *p == ' ' || ( *p >= '\t' && *p <= '\r' ) )
+        ++p;
+
+    const char* start = p;
+    bool negative = false;
+
+    if( *p == '-' || *p == '+' )
+        negative = *p++ == '-';
+
+    // The first 19 significant digits fit in the mantissa
+    unsigned long long mantissa = 0;
+    int  digitCount = 0;
+    int  exponent = 0;
+    bool truncated = false;
+    bool hasDigits = false;
+
+    for( ; isDigit( *p ); ++p )
+    {
+        hasDigits = true;
+
+        if( digitCount < 19 )
+        {
+            mantissa = mantissa * 10 + ( *p - '0' );
+
+            if( mantissa )
+                ++digitCount;
+        }
+        else
+        {
+            ++exponent;
+            truncated |= *p != '0';
+        }
+    }
+
+    if( *p == '.' )
+    {
+        for( ++p; isDigit( *p ); ++p )
+        {
+            hasDigits = true;
+
+            if( digitCount < 19 )
+            {
+                mantissa = mantissa * 10 + ( *p - '0' );
+                --exponent;
+
+                if( mantissa )
+                    ++digitCount;
+            }
+            else
+            {
+                truncated |= *p != '0';
+            }
+        }
+    }
+
+    if( !hasDigits )
+    {
+        if( aEndPtr )
+            *aEndPtr = const_cast<char*>( aText );
+
+        return 0.0;
+    }
+
+    // The exponent is a part of the number only if it has digits
+    if( *p == 'e' || *p == 'E' )
+    {
+        const char* q = p + 1;
+        bool negativeExp = false;
+
+        if( *q == '-' || *q == '+' )
+            negativeExp = *q++ == '-';
+
+        if( isDigit( *q ) )
+        {
+            int exp = 0;
+
+            for( ; isDigit( *q ); ++q )
+            {
+                if( exp < 100000 )
+                    exp = exp * 10 + ( *q - '0' );
+            }
+
+            exponent += negativeExp ? -exp : exp;
+            p = q;
+        }
+    }
+
+    if( aEndPtr )
+        *aEndPtr = const_cast<char*>( p );
+
+    double value;
+
+    if( !truncated && mantissa <= (unsigned long long) s_maxExactInt
+            && exponent >= -s_maxExactPow10 && exponent <= s_maxExactPow10 )
+    {
+        // Both the mantissa and the power of ten are exact, so a single multiplication
+        // or division gives the correctly rounded result
+        value = (double) mantissa;
+
+        if( exponent < 0 )
+            value /= s_pow10[-exponent];
+        else
+            value *= s_pow10[exponent];
+
+        return negative ? -value : value;
+    }
+
+    // Long or huge numbers are rare enough to be converted by the (slow) stream
+    std::istringstream in( std::string( start, p ) );
+    in.imbue( std::locale::classic() );
+    in >> value;
+
+    if( in.fail() )
+    {
+        errno = ERANGE;
+        value = exponent < 0 ? 0.0 : HUGE_VAL;
+
+        if( negative )
+            value = -value;
+    }
+
+    return value;
+}
+
+
+std::string FormatDecimal( long long aValue, int aDecimals )
+{
+    char  buf[64];
+    char* end = buf + sizeof( buf );
+    char* p = end;
+
+    wxASSERT( aDecimals >= 0 && aDecimals < 40 );
+
+    unsigned long long value = aValue < 0 ? 0ULL - (unsigned long long) aValue : aValue;
+    bool hasDecimals = false;
+
+    for( int ii = 0; ii < aDecimals; ++ii )
+    {
+        int digit = value % 10;
+        value /= 10;
+
+        if( digit || hasDecimals )
+        {
+            *--p = '0' + digit;
+            hasDecimals = true;
+        }
+    }
+
+    if( hasDecimals )
+        *--p = '.';
+
+    do
+    {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while( value );
+
+    if( aValue < 0 )
+        *--p = '-';
+
+    return std::string( p, end );
+}
+
+
+/**
+ * Function formatExactDecimal
+ * formats aValue if it is the double nearest to a decimal number having few enough
+ * digits to be printed exactly: printf would print the same digits.
+ * @return false if aValue has to be formatted by printf.
+ */
+static bool formatExactDecimal( double aValue, int aPrecision, bool aFixed,
+                                std::string& aResult )
+{
+    for( int k = 0; k <= s_maxExactPow10; ++k )
+    {
+        double scaled = aValue * s_pow10[k];
+
+        if( std::fabs( scaled ) >= s_maxExactInt )
+            return false;
+
+        if( scaled != std::floor( scaled ) || scaled / s_pow10[k] != aValue )
+            continue;
+
+        long long digits = (long long) scaled;
+        int       digitCount = 0;
+
+        for( long long ii = digits; ii; ii /= 10 )
+            ++digitCount;
+
+        int exponent = digitCount - 1 - k;
+
+        // A double holds DBL_DIG significant digits: the digits printf prints after
+        // them are the ones of the binary value, not zeros
+        int printedDigits = aFixed ? exponent + 1 + aPrecision : aPrecision;
+        int decimals = aFixed ? aPrecision : aPrecision - 1 - exponent;
+
+        if( printedDigits > DBL_DIG || k > decimals )
+            return false;
+
+        // %g switches to the exponent notation
+        if( !aFixed && ( exponent < -4 || exponent >= aPrecision ) )
+            return false;
+
+        aResult = FormatDecimal( digits, k );
+        return true;
+    }
+
+    return false;
+}
+
+
+std::string FormatDouble( double aValue, int aPrecision, bool aFixed )
+{
+    std::string result;
+
+    if( aValue == 0.0 )
+        return std::signbit( aValue ) ? "-0" : "0";
+
+    if( formatExactDecimal( aValue, aPrecision, aFixed, result ) )
+        return result;
+
+    std::ostringstream out;
+    out.imbue( std::locale::classic() );
+
+    if( aFixed )
+        out << std::fixed;
+
+    out << std::setprecision( aPrecision ) << aValue;
+    result = out.str();
+
+    if( aFixed && result.find( '.' ) != std::string::npos )
+    {
+        size_t len = result.find_last_not_of( '0' );
+
+        if( result[len] == '.' )
+            --len;
+
+        result.resize( len + 1 );
+    }
+
+    return result;
+}
@@ -0,0 +1,276 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <algorithm>
+
+#include <thread_pool.h>
+#include <widgets/progress_reporter.h>
+
+
+// The pool and the index of the worker running on the current thread, if any
+static thread_local THREAD_POOL* s_currentPool = nullptr;
+static thread_local size_t s_workerIndex = 0;
+
+
+THREAD_POOL& THREAD_POOL::Instance()
+{
+    static THREAD_POOL pool( std::max( (int) std::thread::hardware_concurrency(), 2 ) );
+
+    return pool;
+}
+
+
+THREAD_POOL::THREAD_POOL( size_t aThreadCount ) :
+    m_pendingCount( 0 ),
+    m_nextQueue( 0 ),
+    m_stop( false )
+{
+    aThreadCount = std::max( aThreadCount, (size_t) 1 );
+
+    for( size_t ii = 0; ii < aThreadCount; ++ii )
+        m_queues.emplace_back( new QUEUE );
+
+    for( size_t ii = 0; ii < aThreadCount; ++ii )
+        m_workers.emplace_back( &THREAD_POOL::workerLoop, this, ii );
+}
+
+
+THREAD_POOL::~THREAD_POOL()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_sleepMutex );
+        m_stop = true;
+    }
+
+    m_wakeUp.notify_all();
+
+    for( auto& worker : m_workers )
+        worker.join();
+}
+
+
+void THREAD_POOL::workerLoop( size_t aIndex )
+{
+    s_currentPool = this;
+    s_workerIndex = aIndex;
+
+    while( true )
+    {
+        if( runPendingTask() )
+            continue;
+
+        std::unique_lock<std::mutex> lock( m_sleepMutex );
+
+        m_wakeUp.wait( lock, [this]() { return m_stop || m_pendingCount > 0; } );
+
+        if( m_stop && m_pendingCount == 0 )
+            break;
+    }
+}
+
+
+void THREAD_POOL::push( TASK&& aTask )
+{
+    size_t index;
+
+    if( s_currentPool == this )
+        index = s_workerIndex;
+    else
+        index = m_nextQueue++ % m_queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock( m_queues[index]->m_mutex );
+        m_queues[index]->m_tasks.push_back( std::move( aTask ) );
+    }
+
+    // Count the task under the sleep mutex, so a worker cannot miss the wake up
+    {
+        std::lock_guard<std::mutex> lock( m_sleepMutex );
+        ++m_pendingCount;
+    }
+
+    m_wakeUp.notify_one();
+}
+
+
+bool THREAD_POOL::popTask( TASK& aTask )
+{
+    if( m_pendingCount == 0 )
+        return false;
+
+    size_t first = 0;
+
+    // A worker runs its own tasks first, the most recent one first (it is the most
+    // likely to still have its data in the cache)
+    if( s_currentPool == this )
+    {
+        QUEUE& own = *m_queues[s_workerIndex];
+        std::lock_guard<std::mutex> lock( own.m_mutex );
+
+        if( !own.m_tasks.empty() )
+        {
+            aTask = std::move( own.m_tasks.back() );
+            own.m_tasks.pop_back();
+            --m_pendingCount;
+            return true;
+        }
+
+        first = s_workerIndex + 1;
+    }
+
+    // Steal the oldest task of another queue
+    for( size_t ii = 0; ii < m_queues.size(); ++ii )
+    {
+        QUEUE& victim = *m_queues[( first + ii ) % m_queues.size()];
+        std::lock_guard<std::mutex> lock( victim.m_mutex );
+
+        if( !victim.m_tasks.empty() )
+        {
+            aTask = std::move( victim.m_tasks.front() );
+            victim.m_tasks.pop_front();
+            --m_pendingCount;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool THREAD_POOL::runPendingTask()
+{
+    TASK task;
+
+    if( !popTask( task ) )
+        return false;
+
+    task();
+    return true;
+}
+
+
+bool THREAD_POOL::ParallelFor( size_t aCount, const std::function<void( size_t )>& aFunc,
+                               const std::function<bool()>& aRefresh, std::atomic_bool* aCancel )
+{
+    // The state shared with the helper tasks.  Helpers still queued when the loop ends
+    // only find that there is nothing left to do, so it has to outlive this call.
+    struct LOOP
+    {
+        const std::function<void( size_t )>* m_func;
+        std::atomic_bool*       m_cancel;
+        size_t                  m_count;
+        std::atomic_size_t      m_next;
+        std::atomic_size_t      m_done;
+        std::atomic_bool        m_cancelled;
+        std::exception_ptr      m_exception;
+        std::mutex              m_mutex;
+        std::condition_variable m_finished;
+    };
+
+    if( aCount == 0 )
+        return !( aCancel && *aCancel );
+
+    auto loop = std::make_shared<LOOP>();
+    loop->m_func = &aFunc;
+    loop->m_cancel = aCancel;
+    loop->m_count = aCount;
+    loop->m_next = 0;
+    loop->m_done = 0;
+    loop->m_cancelled = false;
+
+    auto runIterations = [loop]()
+    {
+        for( size_t i = loop->m_next++; i < loop->m_count; i = loop->m_next++ )
+        {
+            if( loop->m_cancel && *loop->m_cancel )
+                loop->m_cancelled = true;
+
+            if( !loop->m_cancelled )
+            {
+                try
+                {
+                    ( *loop->m_func )( i );
+                }
+                catch( ... )
+                {
+                    std::lock_guard<std::mutex> lock( loop->m_mutex );
+
+                    if( !loop->m_exception )
+                        loop->m_exception = std::current_exception();
+
+                    loop->m_cancelled = true;
+                }
+            }
+
+            // Skipped iterations are counted too: the caller waits for all of them
+            if( ++loop->m_done == loop->m_count )
+            {
+                std::lock_guard<std::mutex> lock( loop->m_mutex );
+                loop->m_finished.notify_all();
+            }
+        }
+    };
+
+    // The calling thread runs iterations too, unless it has to keep refreshing the UI
+    size_t helperCount = std::min( GetThreadCount(), aRefresh ? aCount : aCount - 1 );
+
+    for( size_t ii = 0; ii < helperCount; ++ii )
+        push( runIterations );
+
+    if( !aRefresh )
+        runIterations();
+
+    std::unique_lock<std::mutex> lock( loop->m_mutex );
+
+    while( loop->m_done < aCount )
+    {
+        if( aRefresh )
+        {
+            lock.unlock();
+
+            if( !aRefresh() )
+                loop->m_cancelled = true;
+
+            lock.lock();
+        }
+
+        loop->m_finished.wait_for( lock, std::chrono::milliseconds( 20 ),
+                                   [&]() { return loop->m_done == aCount; } );
+    }
+
+    if( loop->m_exception )
+        std::rethrow_exception( loop->m_exception );
+
+    return !loop->m_cancelled && !( aCancel && *aCancel );
+}
+
+
+bool THREAD_POOL::ParallelFor( size_t aCount, const std::function<void( size_t )>& aFunc,
+                               PROGRESS_REPORTER* aReporter, std::atomic_bool* aCancel )
+{
+    if( !aReporter )
+        return ParallelFor( aCount, aFunc, std::function<bool()>(), aCancel );
+
+    return ParallelFor( aCount, aFunc, [aReporter]() { return aReporter->KeepRefreshing(); },
+                        aCancel );
+}
@@ -0,0 +1,521 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+#include <wx/stdpaths.h>
+#include <wx/utils.h>
+
+#include <common.h>
+#include <dsnlexer.h>
+#include <md5_hash.h>
+#include <thread_pool.h>
+#include <token_snapshot.h>
+
+
+// The start of the snapshot files, followed by their format version
+static const char   snapshotMagic[] = "KiCad token snapshot";
+static const int    snapshotVersion = 2;
+
+// The default total size of the snapshots, see removeOldSnapshots()
+static const long long defaultMaxSnapshotsSize = 256LL * 1024 * 1024;
+
+// The longest modification time resolution of the file systems (FAT has 2 seconds)
+static const long long fileTimeResolution = 2000;       // ms
+
+static std::atomic<unsigned long long> s_hitCount( 0 );
+
+
+/**
+ * Function snapshotDirectory
+ * @return the directory of the snapshots, under the user's cache directory, as the
+ * 3D cache does:
+ * 1. OSX: ~/Library/Caches/kicad/snapshots/
+ * 2. Linux: ${XDG_CACHE_HOME}/kicad/snapshots ~/.cache/kicad/snapshots/
+ * 3. MSWin: AppData\Local\kicad\snapshots
+ */
+static wxString snapshotDirectory()
+{
+    wxString cacheDir;
+
+#if defined(_WIN32)
+    wxStandardPaths::Get().UseAppInfo( wxStandardPaths::AppInfo_None );
+    cacheDir = wxStandardPaths::Get().GetUserLocalDataDir();
+    cacheDir.append( "\\kicad\\snapshots" );
+#elif defined(__APPLE__)
+    cacheDir = "${HOME}/Library/Caches/kicad/snapshots";
+#else   // assume Linux
+    cacheDir = ExpandEnvVarSubstitutions( "${XDG_CACHE_HOME}" );
+
+    if( cacheDir.empty() || cacheDir == "${XDG_CACHE_HOME}" )
+        cacheDir = "${HOME}/.cache";
+
+    cacheDir.append( "/kicad/snapshots" );
+#endif
+
+    return ExpandEnvVarSubstitutions( cacheDir );
+}
+
+
+static std::string hashText( const char* aText, size_t aLength )
+{
+    MD5_HASH hash;
+
+    hash.Init();
+
+    // MD5_HASH takes 32 bit lengths
+    for( size_t done = 0; done < aLength; )
+    {
+        uint32_t chunk = (uint32_t) std::min( aLength - done, (size_t) 0x40000000 );
+
+        hash.Hash( (uint8_t*) const_cast<char*>( aText + done ), chunk );
+        done += chunk;
+    }
+
+    hash.Finalize();
+
+    return hash.Format();
+}
+
+
+static long long fileTimestamp( const wxString& aFileName )
+{
+    wxFileName fn( aFileName );
+
+    if( !fn.FileExists() )
+        return 0;
+
+    return fn.GetModificationTime().GetValue().GetValue();
+}
+
+
+/**
+ * Function removeOldSnapshots
+ * removes the least recently used snapshots (the snapshots are touched when loaded) until
+ * their total size is below the limit.  aKeptFile, the snapshot just written, is kept.
+ */
+static void removeOldSnapshots( const wxString& aKeptFile )
+{
+    long long   maxSize = defaultMaxSnapshotsSize;
+    wxString    maxSizeVar;
+
+    if( wxGetEnv( wxT( "KICAD_SNAPSHOTS_MAX_SIZE" ), &maxSizeVar ) )
+        maxSizeVar.ToLongLong( &maxSize );
+
+    wxLogNull   doNotLog;
+    wxString    dirName = wxFileName( aKeptFile ).GetPath();
+    wxDir       dir( dirName );
+    wxString    name;
+
+    if( !dir.IsOpened() )
+        return;
+
+    // The modification time, the size and the name of each snapshot
+    std::vector<std::tuple<long long, long long, wxString>> snapshots;
+    long long totalSize = 0;
+
+    for( bool found = dir.GetFirst( &name, wxT( "*.snapshot" ), wxDIR_FILES ); found;
+         found = dir.GetNext( &name ) )
+    {
+        wxFileName fn( dirName, name );
+        long long  size = fn.GetSize().GetValue();
+
+        totalSize += size;
+        snapshots.emplace_back( fn.GetModificationTime().GetValue().GetValue(), size,
+                                fn.GetFullPath() );
+    }
+
+    if( totalSize <= maxSize )
+        return;
+
+    std::sort( snapshots.begin(), snapshots.end() );
+
+    for( const auto& snapshot : snapshots )
+    {
+        if( totalSize <= maxSize )
+            break;
+
+        // Another save can remove the same file at the same time: that is harmless
+        if( std::get<2>( snapshot ) != aKeptFile && wxRemoveFile( std::get<2>( snapshot ) ) )
+            totalSize -= std::get<1>( snapshot );
+    }
+}
+
+
+static void putNumber( std::string& aData, long long aValue )
+{
+    aData.append( (const char*) &aValue, sizeof( aValue ) );
+}
+
+
+static void putString( std::string& aData, const std::string& aString )
+{
+    putNumber( aData, aString.size() );
+    aData += aString;
+}
+
+
+/**
+ * The reading of the data of a snapshot file, which fails on the first value not
+ * fitting in the data.
+ */
+struct SNAPSHOT_DATA_READER
+{
+    const char* m_next;
+    const char* m_end;
+    bool        m_ok;
+
+    long long GetNumber()
+    {
+        long long value = 0;
+
+        if( m_ok && (size_t) ( m_end - m_next ) >= sizeof( value ) )
+        {
+            memcpy( &value, m_next, sizeof( value ) );
+            m_next += sizeof( value );
+        }
+        else
+        {
+            m_ok = false;
+        }
+
+        return value;
+    }
+
+    std::string GetString()
+    {
+        long long len = GetNumber();
+
+        if( !m_ok || len < 0 || len > m_end - m_next )
+        {
+            m_ok = false;
+            return std::string();
+        }
+
+        m_next += len;
+
+        return std::string( m_next - len, len );
+    }
+};
+
+
+TOKEN_SNAPSHOT_FILE::TOKEN_SNAPSHOT_FILE( const wxString& aSourcePath, DSNLEXER& aLexer )
+{
+    if( wxGetEnv( wxT( "KICAD_NO_SNAPSHOTS" ), NULL ) )
+        return;
+
+    wxFileName dir( snapshotDirectory(), wxEmptyString );
+
+    if( !dir.DirExists() )
+    {
+        wxLogNull doNotLog;
+
+        if( !dir.Mkdir( wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL ) )
+            return;
+    }
+
+    wxFileName source( aSourcePath );
+    source.Normalize();
+
+    std::string path = source.GetFullPath().ToUTF8().data();
+
+    m_fileName = wxFileName( dir.GetPath(), hashText( path.data(), path.size() ),
+                             wxT( "snapshot" ) ).GetFullPath();
+
+    std::string keywords;
+
+    for( unsigned tok = 0; tok < aLexer.GetKeywordCount(); ++tok )
+    {
+        keywords += aLexer.GetTokenText( tok );
+        keywords += '\0';
+    }
+
+    m_keywordsHash = hashText( keywords.data(), keywords.size() );
+}
+
+
+bool TOKEN_SNAPSHOT_FILE::Load()
+{
+    m_entries.clear();
+
+    if( !IsEnabled() || !wxFileName::FileExists( m_fileName ) )
+        return false;
+
+    wxLogNull   doNotLog;
+    wxFFile     file( m_fileName, wxT( "rb" ) );
+    std::string data;
+
+    if( !file.IsOpened() || file.Length() <= 0 )
+        return false;
+
+    data.resize( (size_t) file.Length() );
+
+    if( file.Read( &data[0], data.size() ) != data.size() )
+        return false;
+
+    // The snapshot ends with the hash of the rest of it, to detect corrupt files
+    const size_t hashLength = 32;
+
+    if( data.size() < sizeof( snapshotMagic ) + hashLength
+            || memcmp( data.data(), snapshotMagic, sizeof( snapshotMagic ) )
+            || hashText( data.data(), data.size() - hashLength )
+                    != data.substr( data.size() - hashLength ) )
+        return false;
+
+    SNAPSHOT_DATA_READER reader = { data.data() + sizeof( snapshotMagic ),
+                                    data.data() + data.size() - hashLength, true };
+
+    if( reader.GetNumber() != snapshotVersion || reader.GetString() != m_keywordsHash )
+        return false;
+
+    long long count = reader.GetNumber();
+
+    for( long long ii = 0; reader.m_ok && ii < count; ++ii )
+    {
+        std::string name = reader.GetString();
+        ENTRY       entry;
+
+        entry.m_size = reader.GetNumber();
+        entry.m_timestamp = reader.GetNumber();
+        entry.m_hash = reader.GetString();
+        entry.m_tokens = reader.GetString();
+
+        m_entries[name] = std::move( entry );
+    }
+
+    if( !reader.m_ok || reader.m_next != reader.m_end )
+    {
+        m_entries.clear();
+        return false;
+    }
+
+    // The snapshot is now the most recently used one, see removeOldSnapshots()
+    wxFileName( m_fileName ).Touch();
+
+    return true;
+}
+
+
+bool TOKEN_SNAPSHOT_FILE::Save() const
+{
+    if( !IsEnabled() )
+        return false;
+
+    std::string data( snapshotMagic, sizeof( snapshotMagic ) );
+
+    putNumber( data, snapshotVersion );
+    putString( data, m_keywordsHash );
+    putNumber( data, m_entries.size() );
+
+    for( const auto& entry : m_entries )
+    {
+        putString( data, entry.first );
+        putNumber( data, entry.second.m_size );
+        putNumber( data, entry.second.m_timestamp );
+        putString( data, entry.second.m_hash );
+        putString( data, entry.second.m_tokens );
+    }
+
+    data += hashText( data.data(), data.size() );
+
+    // The snapshot is written to a temporary file, renamed once complete, so a reader
+    // never sees a partial snapshot
+    wxLogNull   doNotLog;
+    wxString    tempFileName = wxFileName::CreateTempFileName( m_fileName );
+
+    if( tempFileName.IsEmpty() )
+        return false;
+
+    bool ok;
+
+    {
+        wxFFile file( tempFileName, wxT( "wb" ) );
+
+        ok = file.IsOpened() && file.Write( data.data(), data.size() ) == data.size()
+             && file.Close();
+    }
+
+    if( !ok || !wxRenameFile( tempFileName, m_fileName, true ) )
+    {
+        wxRemoveFile( tempFileName );
+        return false;
+    }
+
+    removeOldSnapshots( m_fileName );
+
+    return true;
+}
+
+
+const std::string* TOKEN_SNAPSHOT_FILE::Find( const wxString& aFileName, const char* aText,
+                                              size_t aLength ) const
+{
+    auto it = m_entries.find( std::string( aFileName.ToUTF8() ) );
+
+    if( it == m_entries.end() )
+        return NULL;
+
+    const ENTRY& entry = it->second;
+
+    if( entry.m_size != (long long) aLength )
+        return NULL;
+
+    // An unchanged time tells the file is unchanged, which spares hashing its contents.
+    // They are only hashed when the time cannot be trusted, or to confirm that a touched
+    // file is unchanged.
+    if( ( entry.m_timestamp == 0 || entry.m_timestamp != fileTimestamp( aFileName ) )
+            && entry.m_hash != hashText( aText, aLength ) )
+        return NULL;
+
+    ++s_hitCount;
+
+    return &entry.m_tokens;
+}
+
+
+long long TOKEN_SNAPSHOT_FILE::GetFileTime( const wxString& aFileName )
+{
+    long long timestamp = fileTimestamp( aFileName );
+
+    if( timestamp > wxDateTime::UNow().GetValue().GetValue() - fileTimeResolution )
+        return 0;
+
+    return timestamp;
+}
+
+
+void TOKEN_SNAPSHOT_FILE::Add( const wxString& aFileName, long long aFileTime, const char* aText,
+                               size_t aLength, std::string aTokens )
+{
+    ENTRY& entry = m_entries[std::string( aFileName.ToUTF8() )];
+
+    entry.m_size = aLength;
+    entry.m_timestamp = aFileTime;
+    entry.m_hash = hashText( aText, aLength );
+    entry.m_tokens = std::move( aTokens );
+}
+
+
+unsigned long long TOKEN_SNAPSHOT_FILE::GetHitCount()
+{
+    return s_hitCount;
+}
+
+
+/**
+ * The functions given to TOKEN_SNAPSHOT_FILE::SaveInBackground() not waited for yet.
+ */
+struct BACKGROUND_SAVES
+{
+    std::mutex                                  m_mutex;
+    std::list<THREAD_POOL::TASK_HANDLE<void>>   m_tasks;
+
+    ~BACKGROUND_SAVES()
+    {
+        Wait();
+    }
+
+    void Wait()
+    {
+        std::list<THREAD_POOL::TASK_HANDLE<void>> tasks;
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            tasks.swap( m_tasks );
+        }
+
+        // A save not started yet is run by the calling thread
+        for( auto& task : tasks )
+        {
+            try
+            {
+                THREAD_POOL::Instance().Wait( task );
+            }
+            catch( ... )
+            {
+            }
+        }
+    }
+};
+
+
+static BACKGROUND_SAVES& backgroundSaves()
+{
+    // The pool is created first, so it is destroyed after the saves are waited for
+    THREAD_POOL::Instance();
+
+    static BACKGROUND_SAVES saves;
+
+    return saves;
+}
+
+
+void TOKEN_SNAPSHOT_FILE::SaveInBackground( const std::function<void()>& aRecordAndSave )
+{
+    BACKGROUND_SAVES& saves = backgroundSaves();
+    std::lock_guard<std::mutex> lock( saves.m_mutex );
+
+    saves.m_tasks.remove_if( []( const THREAD_POOL::TASK_HANDLE<void>& aTask )
+                             {
+                                 return aTask.IsReady();
+                             } );
+
+    saves.m_tasks.push_back( THREAD_POOL::Instance().Submit( aRecordAndSave ) );
+}
+
+
+void TOKEN_SNAPSHOT_FILE::WaitForBackgroundSaves()
+{
+    backgroundSaves().Wait();
+}
+
+
+bool TOKEN_SNAPSHOT_FILE::Prune( const std::vector<wxString>& aFileNames )
+{
+    std::set<std::string> names;
+
+    for( const wxString& fileName : aFileNames )
+        names.insert( std::string( fileName.ToUTF8() ) );
+
+    size_t count = m_entries.size();
+
+    for( auto it = m_entries.begin(); it != m_entries.end(); )
+    {
+        if( names.count( it->first ) )
+            ++it;
+        else
+            it = m_entries.erase( it );
+    }
+
+    return m_entries.size() != count;
+}
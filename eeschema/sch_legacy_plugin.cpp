@@ -241,16 +241,16 @@ static double parseDouble( FILE_LINE_READER& aReader, const char* aLine,
     if( !*aLine )
         SCH_PARSE_ERROR( _( "unexpected end of line" ), aReader, aLine );
 
-    // Clear errno before calling strtod() in case some other crt call set it.
+    // Clear errno before calling StrToDouble() in case some other crt call set it.
     errno = 0;
 
-    double retv = strtod( aLine, (char**) aOutput );
+    double retv = StrToDouble( aLine, (char**) aOutput );
 
-    // Make sure no error occurred when calling strtod().
+    // Make sure no error occurred when calling StrToDouble().
     if( errno == ERANGE )
         SCH_PARSE_ERROR( "invalid floating point number", aReader, aLine );
 
-    // strtod does not strip off whitespace before the next token.
+    // StrToDouble() does not strip off whitespace before the next token.
     if( aOutput )
     {
         const char* next = *aOutput;
@@ -738,7 +738,7 @@ void SCH_LEGACY_PLUGIN::loadHierarchy( SCH_SHEET* aSheet )
 
 void SCH_LEGACY_PLUGIN::loadFile( const wxString& aFileName, SCH_SCREEN* aScreen )
 {
-    FILE_LINE_READER reader( aFileName );
+    WHOLE_FILE_LINE_READER reader( aFileName );
 
     loadHeader( reader, aScreen );
 
@@ -2314,7 +2314,7 @@ void SCH_LEGACY_PLUGIN_CACHE::Load()
     wxLogTrace( traceSchLegacyPlugin, "Loading legacy symbol file \"%s\"",
                 m_libFileName.GetFullPath() );
 
-    FILE_LINE_READER reader( m_libFileName.GetFullPath() );
+    WHOLE_FILE_LINE_READER reader( m_libFileName.GetFullPath() );
 
     if( !reader.ReadLine() )
         THROW_IO_ERROR( _( "unexpected end of file" ) );
@@ -2403,7 +2403,7 @@ void SCH_LEGACY_PLUGIN_CACHE::loadDocs()
         THROW_IO_ERROR( wxString::Format( _( "user does not have permission to read library "
                                              "document file \"%s\"" ), fn.GetFullPath() ) );
 
-    FILE_LINE_READER reader( fn.GetFullPath() );
+    WHOLE_FILE_LINE_READER reader( fn.GetFullPath() );
 
     line = reader.ReadLine();
 
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <stdint.h>
 #include <vector>
 #include <hashtables.h>
 
@@ -42,6 +43,41 @@ struct KEYWORD
     const char* name;       ///< unique keyword.
     int         token;      ///< a zero based index into an array of KEYWORDs
 };
+
+
+/**
+ * Struct KEYWORD_HASH
+ * is a perfect hash of a KEYWORD table, generated with the table by
+ * TokenList2DsnLexer.cmake.  A text can only be the keyword of its slot, so the keyword
+ * of a token is found with a hash of its text and a single comparison.
+ *
+ * The text has a FNV-1a hash, starting from the seed.  The lower half of the hash
+ * chooses a bucket of keywords, and its upper half, moved by the displacement found for
+ * the bucket, the slot of the keyword.
+ */
+struct KEYWORD_HASH
+{
+    unsigned        mask;           ///< the size of the tables minus 1, a power of 2 minus 1
+    uint32_t        seed;           ///< the offset basis of the hash
+    const uint16_t* displacements;  ///< the displacement of each bucket
+    const int16_t*  slots;          ///< the keyword token of each slot, or -1
+
+    /**
+     * Function Find
+     * @return the only keyword token which aText can be, or -1 if none.
+     */
+    int Find( const char* aText, size_t aLength ) const
+    {
+        uint32_t hash = seed;
+
+        for( const char* end = aText + aLength; aText < end; ++aText )
+            hash = ( hash ^ (unsigned char) *aText ) * 16777619u;
+
+        unsigned displacement = displacements[hash & mask];
+
+        return slots[( ( hash >> 16 ) + displacement ) & mask];
+    }
+};
 #endif
 
 // something like this macro can be used to help initialize a KEYWORD table.
@@ -70,6 +106,69 @@ enum DSN_SYNTAX_T {
 };
 
 
+/**
+ * Class TOKEN_READER
+ * is a LINE_READER holding the tokens of a text already lexed by a DSNLEXER, as recorded
+ * by DSNLEXER::RecordTokens().  A DSNLEXER reading from it returns these tokens without
+ * lexing the text again.  It has no lines: the line numbers and offsets reported in the
+ * error messages are 0.
+ *
+ * Each token is recorded as its number, and for the tokens which are neither keywords nor
+ * parentheses, the length and the bytes of its text.  The numbers are variable length
+ * integers, so most tokens take a single byte.  The keyword numbers being recorded, the
+ * tokens are only valid for a lexer having the same keywords table.
+ */
+class TOKEN_READER : public LINE_READER
+{
+protected:
+    std::string     m_tokens;
+    size_t          m_ndx;
+
+public:
+
+    /**
+     * Constructor TOKEN_READER
+     * @param aTokens is the tokens recorded by DSNLEXER::RecordTokens(), or a part of them
+     *  made of whole tokens.
+     * @param aSource describes the source of the tokens for error reporting purposes.
+     */
+    TOKEN_READER( const std::string& aTokens, const wxString& aSource );
+
+    /**
+     * Function ReadLine
+     * @return NULL: the text lines are not recorded.
+     */
+    char* ReadLine() override
+    {
+        return NULL;
+    }
+
+    /**
+     * Function ReadToken
+     * reads the next token into aTok and, if it is not a keyword, its text into aText.
+     * @return false at the end of the tokens.
+     * @throw IO_ERROR if the tokens are corrupt.
+     */
+    bool ReadToken( int* aTok, std::string* aText );
+
+    /**
+     * Function AppendToken
+     * records the token aTok whose text is aText at the end of aTokens.
+     */
+    static void AppendToken( std::string& aTokens, int aTok, const std::string& aText );
+
+    /**
+     * Function DecodeToken
+     * decodes the recorded token starting at aData into aTok, and if aText is not NULL and
+     * the token is not a keyword, its text into aText.
+     * @return the start of the next token, or NULL if the token at aData is corrupt or
+     *  does not end before aEnd.
+     */
+    static const char* DecodeToken( const char* aData, const char* aEnd, int* aTok,
+                                    std::string* aText = NULL );
+};
+
+
 /**
  * Class DSNLEXER
  * implements a lexical analyzer for the SPECCTRA DSN file format.  It
@@ -90,6 +189,7 @@ protected:
 
     READER_STACK        readerStack;            ///< all the LINE_READERs by pointer.
     LINE_READER*        reader;                 ///< no ownership. ownership is via readerStack, maybe, if iOwnReaders
+    TOKEN_READER*       tokenReader;            ///< reader, if it holds recorded tokens, else NULL
 
     bool                specctraMode;           ///< if true, then:
                                                 ///< 1) stringDelimiter can be changed
@@ -110,7 +210,9 @@ protected:
 
     const KEYWORD*      keywords;               ///< table sorted by CMake for bsearch()
     unsigned            keywordCount;           ///< count of keywords table
-    KEYWORD_MAP         keyword_hash;           ///< fast, specialized "C string" hashtable
+    const KEYWORD_HASH* keywordsHash;           ///< perfect hash of keywords, if generated
+    KEYWORD_MAP         keyword_hash;           ///< fast, specialized "C string" hashtable,
+                                                ///< if there is no keywordsHash
 
     void init();
 
@@ -144,6 +246,12 @@ protected:
      */
     int findToken( const std::string& aToken );
 
+    /**
+     * Function nextRecordedTok
+     * is NextTok() when reading from a TOKEN_READER.
+     */
+    int nextRecordedTok();
+
     bool isStringTerminator( char cc )
     {
         if( !space_in_quoted_tokens && cc==' ' )
@@ -169,9 +277,11 @@ public:
      * @param aKeywordCount is the count of tokens in aKeywordTable.
      * @param aFile is an open file, which will be closed when this is destructed.
      * @param aFileName is the name of the file
+     * @param aKeywordsHash is the perfect hash of aKeywordTable generated with it, if any.
      */
     DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-              FILE* aFile, const wxString& aFileName );
+              FILE* aFile, const wxString& aFileName,
+              const KEYWORD_HASH* aKeywordsHash = NULL );
 
     /**
      * Constructor ( const KEYWORD*, unsigned, const std::string&, const wxString& )
@@ -182,9 +292,11 @@ public:
      * @param aKeywordCount is the count of tokens in aKeywordTable.
      * @param aSExpression is text to feed through a STRING_LINE_READER
      * @param aSource is a description of aSExpression, used for error reporting.
+     * @param aKeywordsHash is the perfect hash of aKeywordTable generated with it, if any.
      */
     DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-              const std::string& aSExpression, const wxString& aSource = wxEmptyString );
+              const std::string& aSExpression, const wxString& aSource = wxEmptyString,
+              const KEYWORD_HASH* aKeywordsHash = NULL );
 
     /**
      * Constructor ( const std::string&, const wxString& )
@@ -209,9 +321,11 @@ public:
      *
      * @param aLineReader is any subclassed instance of LINE_READER, such as
      *  STRING_LINE_READER or FILE_LINE_READER.  No ownership is taken.
+     *
+     * @param aKeywordsHash is the perfect hash of aKeywordTable generated with it, if any.
      */
     DSNLEXER( const KEYWORD* aKeywordTable, unsigned aKeywordCount,
-              LINE_READER* aLineReader = NULL );
+              LINE_READER* aLineReader = NULL, const KEYWORD_HASH* aKeywordsHash = NULL );
 
     virtual ~DSNLEXER();
 
@@ -389,6 +503,26 @@ public:
      */
     wxArrayString* ReadCommentLines();
 
+    /**
+     * Function RecordTokens
+     * reads all the tokens up to the end of the input, comments included, and records
+     * them for a TOKEN_READER.  A lexer with the same keywords reading the recorded tokens
+     * returns the same tokens and texts as this lexer would have.
+     *
+     * @return std::string - the recorded tokens.
+     * @throw IO_ERROR if the input cannot be read or lexed.
+     */
+    std::string RecordTokens();
+
+    /**
+     * Function GetKeywordCount
+     * returns the count of keywords of the lexer, whose tokens are 0 to count - 1.
+     */
+    unsigned GetKeywordCount() const
+    {
+        return keywordCount;
+    }
+
     /**
      * Function IsSymbol
      * tests a token to see if it is a symbol.  This means it cannot be a
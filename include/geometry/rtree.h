@@ -102,6 +102,10 @@ public:
 public:
 
     RTree();
+
+    /// Copy the tree, node by node (no reinsertion of the entries)
+    RTree( const RTree& a_other );
+
     virtual ~RTree();
 
     /// Insert entry
@@ -513,6 +517,7 @@ protected:
     }
 
     void    RemoveAllRec( Node* a_node );
+    Node*   CopyRec( const Node* a_node );
     void    Reset();
     void    CountRec( Node* a_node, int& a_count );
 
@@ -633,6 +638,14 @@ RTREE_TEMPLATE RTREE_QUAL::RTree()
 }
 
 
+RTREE_TEMPLATE
+RTREE_QUAL::RTree( const RTree& a_other )
+{
+    m_root = CopyRec( a_other.m_root );
+    m_unitSphereVolume = a_other.m_unitSphereVolume;
+}
+
+
 RTREE_TEMPLATE
 RTREE_QUAL::~RTree() {
     Reset(); // Free, or reset node memory
@@ -1030,6 +1043,27 @@ void RTREE_QUAL::RemoveAllRec( Node* a_node )
 }
 
 
+RTREE_TEMPLATE
+typename RTREE_QUAL::Node* RTREE_QUAL::CopyRec( const Node* a_node )
+{
+    ASSERT( a_node );
+
+    Node* newNode = AllocNode();
+
+    *newNode = *a_node;
+
+    if( newNode->IsInternalNode() )
+    {
+        for( int index = 0; index < newNode->m_count; ++index )
+        {
+            newNode->m_branch[index].m_child = CopyRec( a_node->m_branch[index].m_child );
+        }
+    }
+
+    return newNode;
+}
+
+
 RTREE_TEMPLATE
 typename RTREE_QUAL::Node* RTREE_QUAL::AllocNode()
 {
@@ -206,6 +206,11 @@ class SHAPE_INDEX
 
         SHAPE_INDEX();
 
+        /**
+         * Copies the index: the tree is cloned as it is, without reinserting the shapes.
+         */
+        SHAPE_INDEX( const SHAPE_INDEX& aOther );
+
         ~SHAPE_INDEX();
 
         /**
@@ -300,6 +305,12 @@ SHAPE_INDEX<T>::SHAPE_INDEX()
     this->m_tree = new RTree<T, int, 2, float>();
 }
 
+template <class T>
+SHAPE_INDEX<T>::SHAPE_INDEX( const SHAPE_INDEX& aOther )
+{
+    this->m_tree = new RTree<T, int, 2, float>( *aOther.m_tree );
+}
+
 template <class T>
 SHAPE_INDEX<T>::~SHAPE_INDEX()
 {
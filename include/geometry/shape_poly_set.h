@@ -28,14 +28,15 @@
 
 #include <vector>
 #include <cstdio>
+#include <cstdint>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <geometry/shape.h>
 #include <geometry/shape_line_chain.h>
 
 #include "clipper.hpp"
 
-#include <md5_hash.h>
-
 
 /**
  * Class SHAPE_POLY_SET
@@ -61,6 +62,7 @@ class SHAPE_POLY_SET : public SHAPE
         typedef std::vector<SHAPE_LINE_CHAIN> POLYGON;
 
         class TRIANGULATION_CONTEXT;
+        class EDGE_INDEX;
 
         class TRIANGULATED_POLYGON
         {
@@ -110,6 +112,12 @@ class SHAPE_POLY_SET : public SHAPE
                 return m_vertexCount;
             }
 
+            /**
+             * Function Append
+             * adds the vertices and the triangles of aOther to this triangulation.
+             */
+            void Append( const TRIANGULATED_POLYGON& aOther );
+
         private:
 
             TRI* m_triangles = nullptr;
@@ -568,6 +576,7 @@ class SHAPE_POLY_SET : public SHAPE
         ///> Returns the reference to aIndex-th outline in the set
         SHAPE_LINE_CHAIN& Outline( int aIndex )
         {
+            invalidateEdgeIndex();
             return m_polys[aIndex][0];
         }
 
@@ -590,12 +599,14 @@ class SHAPE_POLY_SET : public SHAPE
         ///> Returns the reference to aHole-th hole in the aIndex-th outline
         SHAPE_LINE_CHAIN& Hole( int aOutline, int aHole )
         {
+            invalidateEdgeIndex();
             return m_polys[aOutline][aHole + 1];
         }
 
         ///> Returns the aIndex-th subpolygon in the set
         POLYGON& Polygon( int aIndex )
         {
+            invalidateEdgeIndex();
             return m_polys[aIndex];
         }
 
@@ -639,6 +650,9 @@ class SHAPE_POLY_SET : public SHAPE
         {
             ITERATOR iter;
 
+            // the vertices can be modified through the iterator
+            invalidateEdgeIndex();
+
             iter.m_poly = this;
             iter.m_currentPolygon = aFirst;
             iter.m_lastPolygon = aLast < 0 ? OutlineCount() - 1 : aLast;
@@ -785,6 +799,26 @@ class SHAPE_POLY_SET : public SHAPE
             return IterateSegments( aOutline, aOutline, true );
         }
 
+        CONST_SEGMENT_ITERATOR CIterateSegments( int aFirst, int aLast,
+                                                 bool aIterateHoles = false ) const
+        {
+            CONST_SEGMENT_ITERATOR iter;
+
+            iter.m_poly = const_cast<SHAPE_POLY_SET*>( this );
+            iter.m_currentPolygon = aFirst;
+            iter.m_lastPolygon = aLast < 0 ? OutlineCount() - 1 : aLast;
+            iter.m_currentContour = 0;
+            iter.m_currentSegment = 0;
+            iter.m_iterateHoles = aIterateHoles;
+
+            return iter;
+        }
+
+        CONST_SEGMENT_ITERATOR CIterateSegmentsWithHoles( int aOutline ) const
+        {
+            return CIterateSegments( aOutline, aOutline, true );
+        }
+
         /** operations on polygons use a aFastMode param
          * if aFastMode is PM_FAST (true) the result can be a weak polygon
          * if aFastMode is PM_STRICTLY_SIMPLE (false) (default) the result is (theorically) a strictly
@@ -1033,7 +1067,7 @@ class SHAPE_POLY_SET : public SHAPE
          * @return int -  The minimum distance between aPoint and all the segments of the aIndex-th
          *                polygon. If the point is contained in the polygon, the distance is zero.
          */
-        int DistanceToPolygon( VECTOR2I aPoint, int aIndex );
+        int DistanceToPolygon( VECTOR2I aPoint, int aIndex ) const;
 
         /**
          * Function DistanceToPolygon
@@ -1047,7 +1081,7 @@ class SHAPE_POLY_SET : public SHAPE
          *                  aIndex-th polygon. If the point is contained in the polygon, the
          *                  distance is zero.
          */
-        int DistanceToPolygon( SEG aSegment, int aIndex, int aSegmentWidth = 0 );
+        int DistanceToPolygon( SEG aSegment, int aIndex, int aSegmentWidth = 0 ) const;
 
         /**
          * Function DistanceToPolygon
@@ -1056,7 +1090,7 @@ class SHAPE_POLY_SET : public SHAPE
          * @return int -  The minimum distance between aPoint and all the polygons in the set. If
          *                the point is contained in any of the polygons, the distance is zero.
          */
-        int Distance( VECTOR2I aPoint );
+        int Distance( VECTOR2I aPoint ) const;
 
         /**
          * Function DistanceToPolygon
@@ -1066,7 +1100,7 @@ class SHAPE_POLY_SET : public SHAPE
          * @return int -    The minimum distance between aSegment and all the polygons in the set.
          *                  If the point is contained in the polygon, the distance is zero.
          */
-        int Distance( const SEG& aSegment, int aSegmentWidth = 0 );
+        int Distance( const SEG& aSegment, int aSegmentWidth = 0 ) const;
 
         /**
          * Function IsVertexInHole.
@@ -1107,8 +1141,26 @@ class SHAPE_POLY_SET : public SHAPE
 
         bool pointInPolygon( const VECTOR2I& aP, const SHAPE_LINE_CHAIN& aPath ) const;
 
-        const ClipperLib::Path convertToClipper( const SHAPE_LINE_CHAIN& aPath, bool aRequiredOrientation );
-        const SHAPE_LINE_CHAIN convertFromClipper( const ClipperLib::Path& aPath );
+        /**
+         * Function convertToClipper
+         * stores in aResult the points of aPath, in the aRequiredOrientation order.
+         * aResult is overwritten, but its buffer is reused.
+         */
+        void convertToClipper( const SHAPE_LINE_CHAIN& aPath, bool aRequiredOrientation,
+                               ClipperLib::Path& aResult );
+
+        /**
+         * Function convertFromClipper
+         * stores aPath in the closed line chain aResult, reusing its buffer.
+         */
+        void convertFromClipper( const ClipperLib::Path& aPath, SHAPE_LINE_CHAIN& aResult );
+
+        /**
+         * Function addPaths
+         * gives all the outlines and holes of aShape to aClipper, as paths of aType.
+         */
+        void addPaths( ClipperLib::Clipper& aClipper, const SHAPE_POLY_SET& aShape,
+                       ClipperLib::PolyType aType );
 
         /**
          * containsSingle function
@@ -1124,6 +1176,10 @@ class SHAPE_POLY_SET : public SHAPE
          */
         bool containsSingle( const VECTOR2I& aP, int aSubpolyIndex, bool aIgnoreHoles = false ) const;
 
+        ///> Same as above, using aIndex to find the edges near aP if it is not null.
+        bool containsSingle( const VECTOR2I& aP, int aSubpolyIndex, bool aIgnoreHoles,
+                             const EDGE_INDEX* aIndex ) const;
+
         /**
          * Operations ChamferPolygon and FilletPolygon are computed under the private chamferFillet
          * method; this enum is defined to make the necessary distinction when calling this method
@@ -1171,11 +1227,71 @@ class SHAPE_POLY_SET : public SHAPE
     private:
         void triangulateSingle( const POLYGON& aPoly, SHAPE_POLY_SET::TRIANGULATED_POLYGON& aResult );
 
-        MD5_HASH checksum() const;
+        /**
+         * Function triangulatePolygon
+         * triangulates aPoly, unfractured first if aUnfracture is true.
+         * @return false if aPoly cannot be triangulated (it has touching holes).
+         */
+        bool triangulatePolygon( const POLYGON& aPoly, bool aUnfracture,
+                                 std::unique_ptr<TRIANGULATED_POLYGON>& aResult );
+
+        /**
+         * Function polygonHash
+         * @return a rolling hash of the vertices of aPoly, used to find out whether the
+         * triangulation of aPoly is up to date.  It is much cheaper than a MD5 checksum.
+         */
+        static uint64_t polygonHash( const POLYGON& aPoly, bool aUnfracture );
 
+        ///> The triangulation of each polygon, and the hash of the polygon it was built from.
+        ///> They are kept when the polygons are modified or assigned, so CacheTriangulation()
+        ///> only triangulates again the polygons which have changed.
         std::vector<std::unique_ptr<TRIANGULATED_POLYGON>> m_triangulatedPolys;
+        std::vector<uint64_t> m_triangulatedHashes;
         bool m_triangulationValid = false;
-        MD5_HASH m_hash;
+
+        /**
+         * Function edgeIndex
+         * @return the edge index used by the point queries (Contains(), Collide(), Distance(),
+         * PointOnEdge()), or nullptr if they have to scan all the edges.  The index is built
+         * on demand, once the set has been queried a few times since its last modification,
+         * and only if the set is large enough for it to be worth it.
+         */
+        std::shared_ptr<const EDGE_INDEX> edgeIndex() const;
+
+        /**
+         * Function invalidateEdgeIndex
+         * marks the edge index as out of date: edgeIndex() drops it on the next query.  It
+         * must be called by every method modifying the contours or giving a non-const access
+         * to them: keeping a non-const reference to a contour and modifying it after a query
+         * is not supported.  It only bumps a counter, so it is cheap and can race with the
+         * queries of other threads.
+         */
+        void invalidateEdgeIndex()
+        {
+            m_modificationCount.fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        /**
+         * Function isEdgeIndexCurrent
+         * @return true if the edge index state was updated after the last modification.
+         * m_edgeIndexMutex must be locked.
+         */
+        bool isEdgeIndexCurrent() const
+        {
+            return m_edgeIndexModification == m_modificationCount.load( std::memory_order_relaxed );
+        }
+
+        ///> The edge index is immutable once built, so copies of the set can share it.
+        ///> m_edgeIndex, m_edgeIndexQueries and m_edgeIndexModification are protected by
+        ///> m_edgeIndexMutex.
+        mutable std::mutex m_edgeIndexMutex;
+        mutable std::shared_ptr<const EDGE_INDEX> m_edgeIndex;
+        mutable int m_edgeIndexQueries = 0;     // -1 when the set is not worth indexing
+
+        ///> The count of invalidateEdgeIndex() calls, and its value when the edge index state
+        ///> was last updated.
+        std::atomic<unsigned> m_modificationCount { 0 };
+        mutable unsigned m_edgeIndexModification = 0;
 
 };
 
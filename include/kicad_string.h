@@ -174,6 +174,40 @@ wxString GetIllegalFileNameWxChars();
 bool ReplaceIllegalFileNameChars( std::string* aName, int aReplaceChar = 0 );
 bool ReplaceIllegalFileNameChars( wxString& aName, int aReplaceChar = 0 );
 
+/**
+ * Function StrToDouble
+ * converts the decimal number at the beginning of \a aText like strtod() does in the
+ * "C" locale, whatever the current locale is: the decimal separator is always '.'.
+ * Hexadecimal numbers, "inf" and "nan" are not recognized.
+ *
+ * Unlike strtod(), it does not depend on the global locale, so the file parsers can use
+ * it without a LOCALE_IO and from several threads at once.
+ *
+ * @param aText is the text to convert.  Leading white space is skipped.
+ * @param aEndPtr (if not NULL) receives the end of the converted text, or \a aText if
+ *                no number was found.
+ * @return the converted value.  errno is set to ERANGE if the value is out of range.
+ */
+double StrToDouble( const char* aText, char** aEndPtr = NULL );
+
+/**
+ * Function FormatDecimal
+ * formats the fixed point number aValue / 10^aDecimals exactly, without trailing zeros
+ * after the decimal point, i.e. FormatDecimal( 1500, 3 ) returns "1.5".
+ */
+std::string FormatDecimal( long long aValue, int aDecimals );
+
+/**
+ * Function FormatDouble
+ * formats \a aValue like printf( "%.*g", aPrecision, aValue ) does in the "C" locale,
+ * or if \a aFixed is true, like printf( "%.*f", aPrecision, aValue ) with the trailing
+ * zeros (and the decimal point if nothing follows it) removed.
+ *
+ * The values having a short exact decimal representation, i.e. almost everything a
+ * board file holds, are formatted without going through printf.
+ */
+std::string FormatDouble( double aValue, int aPrecision, bool aFixed = false );
+
 #ifndef HAVE_STRTOKR
 // common/strtok_r.c optionally:
 extern "C" char* strtok_r( char* str, const char* delim, char** nextp );
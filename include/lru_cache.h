@@ -186,6 +186,25 @@ public:
     }
 
 
+    /**
+     * Function Find
+     * Returns the value of the given key, and makes it the most recently used one.
+     * @param aKey = the key to look for
+     * @return a pointer to the value, or NULL if the key is not cached
+     */
+    const t_value* Find( const wxString &aKey )
+    {
+        MAP_ITERATOR map_it = m_map_iterators.find( aKey );
+
+        if( map_it == m_map_iterators.end() )
+            return NULL;
+
+        m_cached_list.splice( m_cached_list.begin(), m_cached_list, map_it->second );
+
+        return &map_it->second->second;
+    }
+
+
     /**
      * Function Exists
      * @param aKey key to look for
@@ -6,6 +6,7 @@
 #define __MD5_HASH_H
 
 #include <cstdint>
+#include <string>
 
 class MD5_HASH
 {
@@ -24,6 +25,19 @@ public:
 
     void SetValid( bool aValid ) { m_valid = aValid; }
 
+    /**
+     * Function Format
+     * @return the hash (of a finalized MD5_HASH) as 32 lowercase hexadecimal digits.
+     */
+    std::string Format() const;
+
+    /**
+     * Function Parse
+     * sets the hash from aText, holding 32 hexadecimal digits as returned by Format().
+     * @return false (and the hash is left unchanged) if aText is not a hash.
+     */
+    bool Parse( const std::string& aText );
+
     MD5_HASH& operator=( const MD5_HASH& aOther );
 
     bool operator==( const MD5_HASH& aOther ) const;
@@ -45,6 +45,7 @@
 
 /* Forward declarations of classes. */
 class BOARD;
+class BOARD_ITEM;
 class BOARD_CONNECTED_ITEM;
 class MODULE;
 class TRACK;
@@ -307,6 +308,17 @@ public:
      */
     virtual void OnModify();
 
+    /**
+     * Function OnBoardItemsChanged
+     * is called by BOARD_COMMIT::Push() once the changes of a commit are applied
+     * to the board.  Does nothing here; the board editor re-tests the changed areas
+     * with its DRC.
+     * @param aDirtyAreas = the bounding boxes of the changed items, before and after the change
+     * @param aRemovedItems = the items removed from the board by the commit
+     */
+    virtual void OnBoardItemsChanged( const std::vector<EDA_RECT>& aDirtyAreas,
+                                      const std::vector<const BOARD_ITEM*>& aRemovedItems );
+
     // Modules (footprints)
 
     /**
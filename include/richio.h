@@ -29,8 +29,10 @@
 // "richio" after its author, Richard Hollenbeck, aka Dick Hollenbeck.
 
 
+#include <map>
 #include <vector>
 #include <utf8.h>
+#include <lru_cache.h>
 
 // I really did not want to be dependent on wxWidgets in richio
 // but the errorText needs to be wide char so wxString rules.
@@ -239,7 +241,7 @@ public:
      * rewinds the file and resets the line number back to zero.  Line number
      * will go to 1 on first ReadLine().
      */
-    void Rewind()
+    virtual void Rewind()
     {
         rewind( m_fp );
         m_lineNum = 0;
@@ -247,6 +249,62 @@ public:
 };
 
 
+/**
+ * Class WHOLE_FILE_LINE_READER
+ * is a FILE_LINE_READER which reads the whole file in memory at once, and then
+ * returns the lines in place, without copying them: the line returned by ReadLine()
+ * points into the file buffer, and is nul terminated by temporarily replacing the
+ * first character of the next line.  This is the reader of choice for big local
+ * files, such as boards and libraries.
+ */
+class WHOLE_FILE_LINE_READER : public FILE_LINE_READER
+{
+protected:
+    std::vector<char>   m_buffer;   ///< the file contents, plus a trailing nul
+    size_t              m_ndx;      ///< offset of the next line in m_buffer
+    char                m_saved;    ///< the character replaced by the nul of the last line
+
+    void readFile();
+
+public:
+
+    /**
+     * Constructor WHOLE_FILE_LINE_READER
+     * opens and reads @a aFileName, see FILE_LINE_READER.
+     * @throw IO_ERROR if @a aFileName cannot be opened or read.
+     */
+    WHOLE_FILE_LINE_READER( const wxString& aFileName, unsigned aStartingLineNumber = 0 );
+
+    /**
+     * Constructor WHOLE_FILE_LINE_READER
+     * reads the open file @a aFile from its current position, see FILE_LINE_READER.
+     * @throw IO_ERROR if @a aFile cannot be read.
+     */
+    WHOLE_FILE_LINE_READER( FILE* aFile, const wxString& aFileName, bool doOwn = true,
+            unsigned aStartingLineNumber = 0 );
+
+    ~WHOLE_FILE_LINE_READER();
+
+    char* ReadLine() override;
+
+    void Rewind() override;
+
+    /**
+     * Function GetText
+     * returns the whole file contents, nul terminated, to parse it without going through
+     * ReadLine().  The text is intact only before the first ReadLine() or after Rewind(),
+     * because ReadLine() terminates the lines in place.
+     */
+    const char* GetText() const             { return &m_buffer[0]; }
+
+    /**
+     * Function GetTextLength
+     * returns the length of the file contents, without the trailing nul.
+     */
+    size_t GetTextLength() const            { return m_buffer.size() - 1; }
+};
+
+
 /**
  * Class STRING_LINE_READER
  * is a LINE_READER that reads from a multiline 8 bit wide std::string
@@ -268,8 +326,12 @@ public:
      *
      * @param aSource describes the source of aString for error reporting purposes
      *  can be anything meaninful, such as wxT( "clipboard" ).
+     *
+     * @param aStartingLineNumber is the number of lines preceding aString in its
+     *  source, when aString is a part of a bigger text.
      */
-    STRING_LINE_READER( const std::string& aString, const wxString& aSource );
+    STRING_LINE_READER( const std::string& aString, const wxString& aSource,
+                        unsigned aStartingLineNumber = 0 );
 
     /**
      * Constructor STRING_LINE_READER( const STRING_LINE_READER& )
@@ -307,6 +369,8 @@ public:
 
 
 #define OUTPUTFMTBUFZ    500        ///< default buffer size for any OUTPUT_FORMATTER
+#define QUOTECACHEZ      1000       ///< default max count of strings kept quoted by Quotew()
+#define FILEOUTBUFZ      262144     ///< output buffer size of a BUFFERED_FILE_OUTPUTFORMATTER
 
 /**
  * Class OUTPUTFORMATTER
@@ -329,13 +393,25 @@ class OUTPUTFORMATTER
     std::vector<char>   m_buffer;
     char                quoteChar[2];
 
-    int sprint( const char* fmt, ... );
+    /// The Quotew() results of the most recently output strings, the net and layer names
+    /// being quoted again and again.
+    LRU_WXSTR_CACHE<std::string> m_quoteCache;
+
     int vprint( const char* fmt,  va_list ap );
 
+    /**
+     * Function vprintSimple
+     * is vprint() for the formats whose only conversions are %s, %c, %d, %u, %x, %X,
+     * their long versions, and %%, without flags, width or precision: this covers
+     * nearly every format of the file writers, and formats them without vsnprintf().
+     */
+    int vprintSimple( const char* fmt,  va_list ap );
+
 
 protected:
     OUTPUTFORMATTER( int aReserve = OUTPUTFMTBUFZ, char aQuoteChar = '"' ) :
-            m_buffer( aReserve, '\0' )
+            m_buffer( aReserve, '\0' ),
+            m_quoteCache( QUOTECACHEZ )
     {
         quoteChar[0] = aQuoteChar;
         quoteChar[1] = '\0';
@@ -431,8 +507,21 @@ public:
      */
      virtual std::string Quotes( const std::string& aWrapee );
 
+    /**
+     * Function Quotew
+     * is Quotes() for a wxString, output as UTF8.  The results are cached, so the
+     * strings output many times, such as the net names, are converted only once.
+     */
      std::string Quotew( const wxString& aWrapee );
 
+    /**
+     * Function SetQuoteCacheSize
+     * sets the max count of strings whose Quotew() result is kept, QUOTECACHEZ by default.
+     * The least recently used ones are dropped.  A writer quoting many names over and over,
+     * such as the net names of a large board, should keep them all.
+     */
+    void SetQuoteCacheSize( size_t aSize ) { m_quoteCache.Resize( aSize ); }
+
     //-----</interface functions>-----------------------------------------
 };
 
@@ -518,6 +607,56 @@ protected:
 };
 
 
+/**
+ * Class BUFFERED_FILE_OUTPUTFORMATTER
+ * is a FILE_OUTPUTFORMATTER collecting its output in a large buffer, written with a few
+ * large fwrite() calls instead of one per Print().  The last part of the output is only
+ * written by Finish(), which the writer must call to get the write errors reported.
+ */
+class BUFFERED_FILE_OUTPUTFORMATTER : public FILE_OUTPUTFORMATTER
+{
+public:
+
+    /**
+     * Constructor
+     * @see FILE_OUTPUTFORMATTER::FILE_OUTPUTFORMATTER()
+     * @throw IO_ERROR if the file cannot be opened.
+     */
+    BUFFERED_FILE_OUTPUTFORMATTER( const wxString& aFileName,
+                                   const wxChar* aMode = wxT( "wt" ),
+                                   char aQuoteChar = '"' );
+
+    /**
+     * Destructor
+     * writes the buffered output, ignoring any error: call Finish() before when errors
+     * must be reported.
+     */
+    ~BUFFERED_FILE_OUTPUTFORMATTER();
+
+    /**
+     * Function Finish
+     * writes the buffered output to the file.
+     * @throw IO_ERROR, if there is a problem outputting, such as a full disk.
+     */
+    void Finish();
+
+protected:
+    //-----<OUTPUTFORMATTER>------------------------------------------------
+    void write( const char* aOutBuf, int aCount ) override;
+    //-----</OUTPUTFORMATTER>-----------------------------------------------
+
+    /**
+     * Function flush
+     * writes the content of m_outBuffer to the file.
+     * @throw IO_ERROR, if there is a problem outputting, such as a full disk.
+     */
+    void flush();
+
+    std::vector<char>   m_outBuffer;    ///< the output not written yet to m_fp
+    size_t              m_outCount;     ///< the byte count used in m_outBuffer
+};
+
+
 /**
  * Class STREAM_OUTPUTFORMATTER
  * implements OUTPUTFORMATTER to a wxWidgets wxOutputStream.  The stream is
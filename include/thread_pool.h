@@ -0,0 +1,209 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PROGRESS_REPORTER;
+
+/**
+ * Class THREAD_POOL
+ * A set of persistent worker threads running tasks, shared by the parallel stages of the
+ * applications (zone filling, DRC, connectivity, footprint loading, 3D rendering...), so
+ * these stages do not pay the thread creation cost on each call and do not oversubscribe
+ * the cores when they run at the same time or are nested.
+ *
+ * Each worker has its own task queue: tasks submitted from a worker go to its queue and
+ * are run last in, first out, and idle workers steal tasks from the other queues.
+ * A thread waiting for a result only helps with the work it waits for: Wait() runs the
+ * awaited task itself if no worker has started it yet, and the caller of ParallelFor()
+ * runs iterations of its own loop.  A task can therefore submit and wait for sub-tasks
+ * without deadlocking the pool, and a thread waiting for a short task (e.g. the GUI
+ * thread) never ends up running unrelated long tasks.
+ */
+class THREAD_POOL
+{
+public:
+    typedef std::function<void()> TASK;
+
+    /**
+     * Class TASK_HANDLE
+     * the result of a task given to Submit(), to be passed to Wait().  Moveable only.
+     */
+    template <typename T>
+    class TASK_HANDLE
+    {
+    public:
+        TASK_HANDLE()
+        {
+        }
+
+        TASK_HANDLE( std::future<T>&& aFuture, const TASK& aRun ) :
+            m_future( std::move( aFuture ) ),
+            m_run( aRun )
+        {
+        }
+
+        /**
+         * Function IsReady
+         * @return true if the task is done.
+         */
+        bool IsReady() const
+        {
+            return m_future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+        }
+
+    private:
+        friend class THREAD_POOL;
+
+        std::future<T> m_future;
+        TASK           m_run;       ///< runs the task, unless it has already been started
+    };
+
+    /**
+     * Function Instance
+     * @return the pool shared by the whole process, having one worker per core.
+     */
+    static THREAD_POOL& Instance();
+
+    explicit THREAD_POOL( size_t aThreadCount );
+    ~THREAD_POOL();
+
+    THREAD_POOL( const THREAD_POOL& ) = delete;
+    THREAD_POOL& operator=( const THREAD_POOL& ) = delete;
+
+    size_t GetThreadCount() const
+    {
+        return m_workers.size();
+    }
+
+    /**
+     * Function Submit
+     * queues aFunc to be run by one of the workers.
+     * @return the handle of the task, holding the result of aFunc (or the exception it
+     * has thrown).
+     */
+    template <typename FUNC>
+    auto Submit( FUNC&& aFunc ) -> TASK_HANDLE<decltype( aFunc() )>
+    {
+        typedef decltype( aFunc() ) RESULT;
+
+        auto task = std::make_shared<std::packaged_task<RESULT()>>( std::forward<FUNC>( aFunc ) );
+        auto started = std::make_shared<std::atomic_bool>( false );
+
+        // The task is run once, by whichever of the worker popping it and Wait() comes first
+        TASK run = [task, started]()
+        {
+            if( !started->exchange( true ) )
+                (*task)();
+        };
+
+        push( TASK( run ) );
+
+        return TASK_HANDLE<RESULT>( task->get_future(), run );
+    }
+
+    /**
+     * Function Wait
+     * waits for the end of the task of aHandle.  The task is run by the calling thread if
+     * no worker has started it yet, otherwise the calling thread blocks until the worker
+     * is done: it does not run other tasks of the pool meanwhile.
+     * @return the result of the task (or rethrows its exception).
+     */
+    template <typename T>
+    T Wait( TASK_HANDLE<T>& aHandle )
+    {
+        if( aHandle.m_run )
+            aHandle.m_run();
+
+        return aHandle.m_future.get();
+    }
+
+    /**
+     * Function ParallelFor
+     * runs aFunc( i ) for each i in [0, aCount) on the workers, and waits for the end.
+     * The calling thread runs iterations of this loop too, but no other task of the pool.
+     *
+     * If aRefresh is given, the calling thread does not run iterations itself but calls
+     * aRefresh about every 20 ms while waiting, which is what a thread owning a progress
+     * dialog needs.  The loop is cancelled when aRefresh returns false, or when *aCancel
+     * becomes true: the iterations not started yet are skipped.
+     * If an iteration throws, the loop is cancelled and the first exception is rethrown.
+     *
+     * @return false if the loop was cancelled.
+     */
+    bool ParallelFor( size_t aCount, const std::function<void( size_t )>& aFunc,
+                      const std::function<bool()>& aRefresh = nullptr,
+                      std::atomic_bool* aCancel = nullptr );
+
+    /**
+     * Function ParallelFor
+     * same as above, keeping aReporter refreshed while waiting.  The loop is cancelled
+     * if the user aborts the progress dialog.
+     */
+    bool ParallelFor( size_t aCount, const std::function<void( size_t )>& aFunc,
+                      PROGRESS_REPORTER* aReporter, std::atomic_bool* aCancel = nullptr );
+
+private:
+    struct QUEUE
+    {
+        std::mutex        m_mutex;
+        std::deque<TASK>  m_tasks;
+    };
+
+    void workerLoop( size_t aIndex );
+
+    void push( TASK&& aTask );
+
+    bool popTask( TASK& aTask );
+
+    /**
+     * Function runPendingTask
+     * runs one queued task, if any.
+     * @return false if there was no task to run.
+     */
+    bool runPendingTask();
+
+    std::vector<std::thread>                m_workers;
+    std::vector<std::unique_ptr<QUEUE>>     m_queues;
+
+    std::atomic_size_t                      m_pendingCount;
+    std::atomic_size_t                      m_nextQueue;    // round robin for non-worker pushes
+    bool                                    m_stop;
+
+    std::mutex                              m_sleepMutex;
+    std::condition_variable                 m_wakeUp;
+};
+
+#endif  // __THREAD_POOL_H
@@ -0,0 +1,159 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef TOKEN_SNAPSHOT_H_
+#define TOKEN_SNAPSHOT_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <wx/string.h>
+
+class DSNLEXER;
+
+
+/**
+ * Class TOKEN_SNAPSHOT_FILE
+ * is a cache of the tokens of the files read by a DSNLEXER, recorded by
+ * DSNLEXER::RecordTokens(), to spare the lexing of their text when they are read again
+ * unchanged (see #TOKEN_READER).
+ *
+ * The snapshot of a file, or of the files of a directory such as a footprint library,
+ * is kept in the user's cache directory, in a file named after the hash of the path of
+ * the file or directory.  The tokens of each file are recorded with its size and
+ * modification time, and are used if both match.  The content hash of the file is only
+ * compared to confirm a match when the time cannot be trusted: the file was touched
+ * since, or modified too shortly before being read.  The snapshots written by
+ * another version, for other keywords, or corrupt, are ignored: they are simply written
+ * again.
+ *
+ * The least recently used snapshots are removed when all of them take more than 256 MB,
+ * or the size in bytes given by the KICAD_SNAPSHOTS_MAX_SIZE environment variable.
+ * The snapshots are disabled if the KICAD_NO_SNAPSHOTS environment variable is set.
+ */
+class TOKEN_SNAPSHOT_FILE
+{
+public:
+
+    /**
+     * Constructor TOKEN_SNAPSHOT_FILE
+     * creates an empty snapshot.
+     * @param aSourcePath is the file or the directory whose files are recorded.
+     * @param aLexer is a lexer having the keywords of the files.
+     */
+    TOKEN_SNAPSHOT_FILE( const wxString& aSourcePath, DSNLEXER& aLexer );
+
+    /**
+     * Function IsEnabled
+     * @return false if the snapshots are disabled, or cannot be stored.
+     */
+    bool IsEnabled() const
+    {
+        return !m_fileName.IsEmpty();
+    }
+
+    /**
+     * Function Load
+     * reads the snapshot saved by a previous Save(), if any.
+     * @return false if there is no usable snapshot: it is then empty.
+     */
+    bool Load();
+
+    /**
+     * Function Save
+     * writes the snapshot, replacing the previous one at once.
+     * @return false if it cannot be written.
+     */
+    bool Save() const;
+
+    /**
+     * Function Find
+     * @return the tokens recorded for the file aFileName, whose contents are aText, or
+     *  NULL if the file is not recorded or was modified since.
+     */
+    const std::string* Find( const wxString& aFileName, const char* aText,
+                             size_t aLength ) const;
+
+    /**
+     * Function GetFileTime
+     * @return the modification time of the file aFileName, to be read before its contents
+     * and given to Add() with them.  It is 0 if the file was modified too recently for
+     * its time to tell a later modification (the time resolution is up to 2 seconds).
+     */
+    static long long GetFileTime( const wxString& aFileName );
+
+    /**
+     * Function Add
+     * records aTokens, the tokens of the file aFileName, whose contents are aText.
+     * @param aFileTime is the time returned by GetFileTime() before aText was read.
+     */
+    void Add( const wxString& aFileName, long long aFileTime, const char* aText,
+              size_t aLength, std::string aTokens );
+
+    /**
+     * Function GetHitCount
+     * @return the number of files whose recorded tokens were found by Find(), in all
+     * the snapshots.
+     */
+    static unsigned long long GetHitCount();
+
+    /**
+     * Function SaveInBackground
+     * runs aRecordAndSave, a function recording tokens in a snapshot and saving it, on
+     * the THREAD_POOL.  It must only use data it owns.
+     */
+    static void SaveInBackground( const std::function<void()>& aRecordAndSave );
+
+    /**
+     * Function WaitForBackgroundSaves
+     * waits for the end of the functions given to SaveInBackground().  This is done
+     * before the application exits, and before the pool is destroyed anyway.
+     */
+    static void WaitForBackgroundSaves();
+
+    /**
+     * Function Prune
+     * forgets the recorded files which are not in aFileNames, e.g. the footprints removed
+     * from a library.
+     * @return true if some files were forgotten.
+     */
+    bool Prune( const std::vector<wxString>& aFileNames );
+
+private:
+
+    struct ENTRY
+    {
+        long long       m_size;
+        long long       m_timestamp;    ///< 0 if the time could not be trusted
+        std::string     m_hash;         ///< the MD5 hash of the contents of the file
+        std::string     m_tokens;
+    };
+
+    wxString                        m_fileName;         ///< the snapshot file, if enabled
+    std::string                     m_keywordsHash;     ///< the MD5 hash of the keywords
+    std::map<std::string, ENTRY>    m_entries;          ///< by UTF8 file name
+};
+
+#endif  // TOKEN_SNAPSHOT_H_
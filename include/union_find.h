@@ -0,0 +1,108 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include <numeric>
+#include <utility>
+#include <vector>
+
+/**
+ * Class UNION_FIND
+ * A disjoint-set forest over the integers [0, size): it keeps track of a partition of the
+ * integers into sets, which can only be merged.  Union by rank and path compression make
+ * merging two sets and finding the set of an integer cost an amortized constant time.
+ */
+class UNION_FIND
+{
+public:
+    UNION_FIND( int aSize = 0 )
+    {
+        Reset( aSize );
+    }
+
+    ///> Puts each of the integers [0, aSize) in its own set.
+    void Reset( int aSize )
+    {
+        m_parent.resize( aSize );
+        std::iota( m_parent.begin(), m_parent.end(), 0 );
+        m_rank.assign( aSize, 0 );
+    }
+
+    int Size() const
+    {
+        return m_parent.size();
+    }
+
+    ///> Adds a new integer, in its own set, and returns it.
+    int Add()
+    {
+        m_parent.push_back( m_parent.size() );
+        m_rank.push_back( 0 );
+
+        return m_parent.size() - 1;
+    }
+
+    ///> Returns the representative of the set of aElem.
+    int Find( int aElem )
+    {
+        // Path halving: each visited node is linked to its grandparent
+        while( m_parent[aElem] != aElem )
+        {
+            m_parent[aElem] = m_parent[m_parent[aElem]];
+            aElem = m_parent[aElem];
+        }
+
+        return aElem;
+    }
+
+    /**
+     * Function Union
+     * merges the sets of aA and aB.
+     * @return false if they were already in the same set.
+     */
+    bool Union( int aA, int aB )
+    {
+        int rootA = Find( aA );
+        int rootB = Find( aB );
+
+        if( rootA == rootB )
+            return false;
+
+        if( m_rank[rootA] < m_rank[rootB] )
+            std::swap( rootA, rootB );
+        else if( m_rank[rootA] == m_rank[rootB] )
+            m_rank[rootA]++;
+
+        m_parent[rootB] = rootA;
+
+        return true;
+    }
+
+private:
+    std::vector<int>            m_parent;
+    std::vector<unsigned char>  m_rank;     // an upper bound of the height of the tree
+};
+
+#endif /* UNION_FIND_H */
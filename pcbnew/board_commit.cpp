@@ -65,6 +65,8 @@ void BOARD_COMMIT::Push( const wxString& aMessage, bool aCreateUndoEntry )
     PCB_BASE_FRAME* frame = (PCB_BASE_FRAME*) m_toolMgr->GetEditFrame();
     auto connectivity = board->GetConnectivity();
     std::set<EDA_ITEM*> savedModules;
+    std::vector<EDA_RECT> dirtyAreas;                   // for the incremental DRC
+    std::vector<const BOARD_ITEM*> removedItems;
 
     if( Empty() )
         return;
@@ -75,6 +77,26 @@ void BOARD_COMMIT::Push( const wxString& aMessage, bool aCreateUndoEntry )
         int changeFlags = ent.m_type & CHT_FLAGS;
         BOARD_ITEM* boardItem = static_cast<BOARD_ITEM*>( ent.m_item );
 
+        if( !m_editModules && boardItem->Type() != PCB_MARKER_T )
+        {
+            dirtyAreas.push_back( boardItem->GetBoundingBox() );
+
+            if( changeType == CHT_MODIFY && ent.m_copy )
+                dirtyAreas.push_back( static_cast<BOARD_ITEM*>( ent.m_copy )->GetBoundingBox() );
+
+            if( changeType == CHT_REMOVE )
+            {
+                removedItems.push_back( boardItem );
+
+                if( boardItem->Type() == PCB_MODULE_T )
+                {
+                    for( D_PAD* pad = static_cast<MODULE*>( boardItem )->PadsList(); pad;
+                         pad = pad->Next() )
+                        removedItems.push_back( pad );
+                }
+            }
+        }
+
         // Module items need to be saved in the undo buffer before modification
         if( m_editModules )
         {
@@ -286,6 +308,10 @@ void BOARD_COMMIT::Push( const wxString& aMessage, bool aCreateUndoEntry )
     frame->OnModify();
     frame->UpdateMsgPanel();
 
+    // Markers are not tested, so the commit of the DRC results does not trigger another test
+    if( !m_editModules && !dirtyAreas.empty() )
+        frame->OnBoardItemsChanged( dirtyAreas, removedItems );
+
     clear();
 }
 
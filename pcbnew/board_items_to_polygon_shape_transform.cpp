@@ -1285,6 +1285,6 @@ void ZONE_CONTAINER::TransformShapeWithClearanceToPolygon( SHAPE_POLY_SET& aCorn
                                                         int             aCircleToSegmentsCount,
                                                         double          aCorrectionFactor ) const
 {
-    aCornerBuffer = m_FilledPolysList;
+    aCornerBuffer = GetFilledPolysList();
     aCornerBuffer.Simplify( SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
 }
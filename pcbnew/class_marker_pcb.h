@@ -98,6 +98,19 @@ public:
         return m_item;
     }
 
+    /**
+     * Set the other BOARD_ITEM involved in the DRC error, for errors between two items.
+     */
+    void SetAuxItem( const BOARD_ITEM* aItem )
+    {
+        m_auxItem = aItem;
+    }
+
+    const BOARD_ITEM* GetAuxItem() const
+    {
+        return m_auxItem;
+    }
+
     bool HitTest( const wxPoint& aPosition ) const override
     {
         return HitTestMarker( aPosition );
@@ -136,6 +149,9 @@ public:
 protected:
     ///> Pointer to BOARD_ITEM that causes DRC error.
     const BOARD_ITEM* m_item;
+
+    ///> Pointer to the other BOARD_ITEM involved in the DRC error, if any.
+    const BOARD_ITEM* m_auxItem;
 };
 
 #endif      //  CLASS_MARKER_PCB_H
@@ -42,6 +42,11 @@
 #include <convert_to_biu.h>
 #include <class_board.h>
 #include <class_zone.h>
+#include <class_module.h>
+#include <class_edge_mod.h>
+#include <class_drawsegment.h>
+#include <class_track.h>
+#include <class_pcb_text.h>
 
 #include <pcbnew.h>
 #include <zones.h>
@@ -67,6 +72,7 @@ ZONE_CONTAINER::ZONE_CONTAINER( BOARD* aBoard ) :
     m_cornerRadius = 0;
     SetLocalFlags( 0 );                         // flags tempoarry used in zone calculations
     m_Poly = new SHAPE_POLY_SET();              // Outlines
+    m_hasLazyFill = false;
     aBoard->GetZoneSettings().ExportSetting( *this );
 }
 
@@ -81,6 +87,7 @@ ZONE_CONTAINER::ZONE_CONTAINER( const ZONE_CONTAINER& aZone ) :
     // For corner moving, corner index to drag, or nullptr if no selection
     m_CornerSelection = nullptr;
     m_IsFilled = aZone.m_IsFilled;
+    m_fillFingerprint = aZone.m_fillFingerprint;
     m_ZoneClearance = aZone.m_ZoneClearance;     // clearance value
     m_ZoneMinThickness = aZone.m_ZoneMinThickness;
     m_FillMode = aZone.m_FillMode;               // Filling mode (segments/polygons)
@@ -90,8 +97,16 @@ ZONE_CONTAINER::ZONE_CONTAINER( const ZONE_CONTAINER& aZone ) :
     m_PadConnection = aZone.m_PadConnection;
     m_ThermalReliefGap = aZone.m_ThermalReliefGap;
     m_ThermalReliefCopperBridge = aZone.m_ThermalReliefCopperBridge;
-    m_FilledPolysList.Append( aZone.m_FilledPolysList );
-    m_FillSegmList = aZone.m_FillSegmList;      // vector <> copy
+
+    // A fill not loaded yet is shared by the copy
+    {
+        std::lock_guard<std::mutex> lock( aZone.m_lazyFillMutex );
+
+        m_lazyFill = aZone.m_lazyFill;
+        m_hasLazyFill = (bool) m_lazyFill;
+        m_FilledPolysList.Append( aZone.m_FilledPolysList );
+        m_FillSegmList = aZone.m_FillSegmList;      // vector <> copy
+    }
 
     m_isKeepout = aZone.m_isKeepout;
     m_doNotAllowCopperPour = aZone.m_doNotAllowCopperPour;
@@ -129,10 +144,18 @@ ZONE_CONTAINER& ZONE_CONTAINER::operator=( const ZONE_CONTAINER& aOther )
     SetHatchStyle( aOther.GetHatchStyle() );
     SetHatchPitch( aOther.GetHatchPitch() );
     m_HatchLines = aOther.m_HatchLines;     // copy vector <SEG>
-    m_FilledPolysList.RemoveAllContours();
-    m_FilledPolysList.Append( aOther.m_FilledPolysList );
-    m_FillSegmList.clear();
-    m_FillSegmList = aOther.m_FillSegmList;
+
+    {
+        std::lock_guard<std::mutex> lock( aOther.m_lazyFillMutex );
+
+        m_lazyFill = aOther.m_lazyFill;
+        m_hasLazyFill = (bool) m_lazyFill;
+        m_FilledPolysList.RemoveAllContours();
+        m_FilledPolysList.Append( aOther.m_FilledPolysList );
+        m_FillSegmList = aOther.m_FillSegmList;
+    }
+
+    m_fillFingerprint = aOther.m_fillFingerprint;
 
     SetLayerSet( aOther.GetLayerSet() );
 
@@ -155,17 +178,69 @@ EDA_ITEM* ZONE_CONTAINER::Clone() const
 
 bool ZONE_CONTAINER::UnFill()
 {
-    bool change = ( !m_FilledPolysList.IsEmpty() ) ||
+    bool change = m_hasLazyFill || ( !m_FilledPolysList.IsEmpty() ) ||
                   ( m_FillSegmList.size() > 0 );
 
+    dropLazyFill();
     m_FilledPolysList.RemoveAllContours();
     m_FillSegmList.clear();
     m_IsFilled = false;
+    m_fillFingerprint = MD5_HASH();
 
     return change;
 }
 
 
+void ZONE_CONTAINER::SetLazyFill( const std::shared_ptr<ZONE_LAZY_FILL>& aFill )
+{
+    std::lock_guard<std::mutex> lock( m_lazyFillMutex );
+
+    m_FilledPolysList.RemoveAllContours();
+    m_FillSegmList.clear();
+    m_lazyFill = aFill;
+    m_hasLazyFill = (bool) m_lazyFill;
+}
+
+
+void ZONE_CONTAINER::loadFill() const
+{
+    if( !m_hasLazyFill )
+        return;
+
+    std::lock_guard<std::mutex> lock( m_lazyFillMutex );
+
+    // Another thread may have loaded it meanwhile
+    if( !m_lazyFill )
+        return;
+
+    try
+    {
+        m_lazyFill->Load( m_FilledPolysList, m_FillSegmList );
+    }
+    catch( const IO_ERROR& ioe )
+    {
+        m_FilledPolysList.RemoveAllContours();
+        m_FillSegmList.clear();
+        wxLogError( _( "Cannot read the filled areas of a zone:\n%s" ), ioe.What() );
+    }
+
+    m_lazyFill.reset();
+    m_hasLazyFill = false;
+}
+
+
+void ZONE_CONTAINER::dropLazyFill()
+{
+    if( !m_hasLazyFill )
+        return;
+
+    std::lock_guard<std::mutex> lock( m_lazyFillMutex );
+
+    m_lazyFill.reset();
+    m_hasLazyFill = false;
+}
+
+
 const wxPoint ZONE_CONTAINER::GetPosition() const
 {
     return (wxPoint) GetCornerPosition( 0 );
@@ -420,7 +495,7 @@ void ZONE_CONTAINER::DrawFilledArea( EDA_DRAW_PANEL* panel,
     if( displ_opts->m_DisplayZonesMode == 1 )     // Do not show filled areas
         return;
 
-    if( m_FilledPolysList.IsEmpty() )  // Nothing to draw
+    if( GetFilledPolysList().IsEmpty() )  // Nothing to draw
         return;
 
     BOARD*      brd = GetBoard();
@@ -565,7 +640,7 @@ void ZONE_CONTAINER::DrawWhileCreateOutline( EDA_DRAW_PANEL* panel, wxDC* DC,
     }
 
     // Object to iterate through the corners of the outlines
-    SHAPE_POLY_SET::ITERATOR iterator = m_Poly->Iterate();
+    SHAPE_POLY_SET::CONST_ITERATOR iterator = m_Poly->CIterate();
 
     // Segment start and end
     VECTOR2I seg_start, seg_end;
@@ -587,7 +662,7 @@ void ZONE_CONTAINER::DrawWhileCreateOutline( EDA_DRAW_PANEL* panel, wxDC* DC,
             // Set GR mode to default
             current_gr_mode = draw_mode;
 
-            SHAPE_POLY_SET::ITERATOR iterator_copy = iterator;
+            SHAPE_POLY_SET::CONST_ITERATOR iterator_copy = iterator;
             iterator_copy++;
             if( iterator_copy.IsEndContour() )
                 current_gr_mode = GR_XOR;
@@ -806,7 +881,7 @@ int ZONE_CONTAINER::GetClearance( BOARD_CONNECTED_ITEM* aItem ) const
 
 bool ZONE_CONTAINER::HitTestFilledArea( const wxPoint& aRefPos ) const
 {
-    return m_FilledPolysList.Contains( VECTOR2I( aRefPos.x, aRefPos.y ) );
+    return GetFilledPolysList().Contains( VECTOR2I( aRefPos.x, aRefPos.y ) );
 }
 
 
@@ -884,7 +959,7 @@ void ZONE_CONTAINER::GetMsgPanelInfo( std::vector< MSG_PANEL_ITEM >& aList )
     msg.Printf( wxT( "%d" ), (int) m_HatchLines.size() );
     aList.push_back( MSG_PANEL_ITEM( _( "Hatch Lines" ), msg, BLUE ) );
 
-    if( !m_FilledPolysList.IsEmpty() )
+    if( !GetFilledPolysList().IsEmpty() )
     {
         msg.Printf( wxT( "%d" ), m_FilledPolysList.TotalVertices() );
         aList.push_back( MSG_PANEL_ITEM( _( "Corner Count" ), msg, BLUE ) );
@@ -901,6 +976,7 @@ void ZONE_CONTAINER::Move( const wxPoint& offset )
 
     Hatch();
 
+    loadFill();
     m_FilledPolysList.Move( VECTOR2I( offset.x, offset.y ) );
 
     for( unsigned ic = 0; ic < m_FillSegmList.size(); ic++ )
@@ -939,6 +1015,8 @@ void ZONE_CONTAINER::Rotate( const wxPoint& centre, double angle )
     Hatch();
 
     /* rotate filled areas: */
+    loadFill();
+
     for( auto ic = m_FilledPolysList.Iterate(); ic; ++ic )
         RotatePoint( &ic->x, &ic->y, centre.x, centre.y, angle );
 
@@ -980,6 +1058,8 @@ void ZONE_CONTAINER::Mirror( const wxPoint& mirror_ref )
 
     Hatch();
 
+    loadFill();
+
     for( auto ic = m_FilledPolysList.Iterate(); ic; ++ic )
     {
         int py = mirror_ref.y - ic->y;
@@ -1312,9 +1392,222 @@ void ZONE_CONTAINER::SwapData( BOARD_ITEM* aImage )
 
 void ZONE_CONTAINER::CacheTriangulation()
 {
+    loadFill();
     m_FilledPolysList.CacheTriangulation();
 }
 
+
+MD5_HASH ZONE_CONTAINER::ComputeFillFingerprint() const
+{
+    MD5_HASH hash;
+    BOARD*   board = GetBoard();
+
+    if( !board )
+        return hash;
+
+    auto hashPoint = [&hash]( const wxPoint& aPoint )
+    {
+        hash.Hash( aPoint.x );
+        hash.Hash( aPoint.y );
+    };
+
+    auto hashPolySet = [&hash]( const SHAPE_POLY_SET& aPolySet )
+    {
+        hash.Hash( aPolySet.OutlineCount() );
+
+        if( aPolySet.OutlineCount() == 0 )
+            return;
+
+        hash.Hash( aPolySet.TotalVertices() );
+
+        for( auto it = aPolySet.CIterateWithHoles(); it; it++ )
+        {
+            hash.Hash( it->x );
+            hash.Hash( it->y );
+        }
+    };
+
+    // The net names rather than the net codes, which are renumbered when saving the board
+    auto hashNet = [&hash]( const BOARD_CONNECTED_ITEM* aItem )
+    {
+        std::string netname = TO_UTF8( aItem->GetNetname() );
+
+        hash.Hash( (uint8_t*) netname.c_str(), netname.length() + 1 );
+    };
+
+    auto hashDrawSegment = [&]( const DRAWSEGMENT* aSegment )
+    {
+        hash.Hash( aSegment->Type() );
+        hash.Hash( aSegment->GetLayer() );
+        hash.Hash( aSegment->GetShape() );
+        hash.Hash( aSegment->GetWidth() );
+        hash.Hash( KiROUND( aSegment->GetAngle() ) );
+        hashPoint( aSegment->GetStart() );
+        hashPoint( aSegment->GetEnd() );
+
+        if( aSegment->GetShape() == S_POLYGON )
+            hashPolySet( aSegment->GetPolyShape() );
+    };
+
+    PCB_LAYER_ID layer = GetLayer();
+
+    // The zone itself
+    hash.Hash( layer );
+    hashNet( this );
+    hash.Hash( GetPriority() );
+    hash.Hash( GetClearance() );
+    hash.Hash( GetZoneClearance() );
+    hash.Hash( GetMinThickness() );
+    hash.Hash( GetFillMode() );
+    hash.Hash( GetArcSegmentCount() );
+    hash.Hash( GetPadConnection() );
+    hash.Hash( GetThermalReliefGap() );
+    hash.Hash( GetThermalReliefCopperBridge() );
+    hash.Hash( GetCornerSmoothingType() );
+    hash.Hash( GetCornerRadius() );
+    hashPolySet( *m_Poly );
+
+    // Items which can be close enough to the zone to change its filled areas.  The area
+    // is larger than the one used by the ZONE_FILLER, so no item is forgotten.
+    // Items of the zone net are also hashed, because they change the insulated islands.
+    int biggest_clearance = board->GetDesignSettings().GetBiggestClearanceValue();
+    hash.Hash( biggest_clearance );
+
+    EDA_RECT zone_boundingbox = GetBoundingBox();
+    zone_boundingbox.Inflate( std::max( biggest_clearance, GetClearance() )
+                              + GetMinThickness() + GetThermalReliefGap() );
+
+    for( auto module : board->Modules() )
+    {
+        for( auto pad : module->Pads() )
+        {
+            bool onLayer = pad->IsOnLayer( layer );
+
+            if( !onLayer && pad->GetDrillSize().x == 0 && pad->GetDrillSize().y == 0 )
+                continue;
+
+            EDA_RECT item_boundingbox = pad->GetBoundingBox();
+            item_boundingbox.Inflate( pad->GetClearance() + GetThermalReliefGap( pad ) );
+
+            if( !item_boundingbox.Intersects( zone_boundingbox ) )
+                continue;
+
+            hash.Hash( onLayer );
+            hashNet( pad );
+            hash.Hash( pad->GetShape() );
+            hash.Hash( pad->GetAttribute() );
+            hash.Hash( KiROUND( pad->GetOrientation() ) );
+            hashPoint( pad->GetPosition() );
+            hashPoint( pad->ShapePos() );
+            hash.Hash( pad->GetSize().x );
+            hash.Hash( pad->GetSize().y );
+            hash.Hash( pad->GetDelta().x );
+            hash.Hash( pad->GetDelta().y );
+            hash.Hash( KiROUND( pad->GetRoundRectRadiusRatio() * 1e6 ) );
+            hash.Hash( pad->GetDrillShape() );
+            hash.Hash( pad->GetDrillSize().x );
+            hash.Hash( pad->GetDrillSize().y );
+            hash.Hash( pad->GetClearance() );
+            hash.Hash( GetPadConnection( pad ) );
+            hash.Hash( GetThermalReliefGap( pad ) );
+            hash.Hash( GetThermalReliefCopperBridge( pad ) );
+
+            if( pad->GetShape() == PAD_SHAPE_CUSTOM )
+            {
+                hash.Hash( pad->GetCustomShapeInZoneOpt() );
+                hashPolySet( pad->GetCustomShapeAsPolygon() );
+            }
+        }
+
+        for( auto item : module->GraphicalItems() )
+        {
+            if( item->Type() != PCB_MODULE_EDGE_T )
+                continue;
+
+            if( !item->IsOnLayer( layer ) && !item->IsOnLayer( Edge_Cuts ) )
+                continue;
+
+            if( item->GetBoundingBox().Intersects( zone_boundingbox ) )
+                hashDrawSegment( static_cast<EDGE_MODULE*>( item ) );
+        }
+    }
+
+    for( auto track : board->Tracks() )
+    {
+        if( !track->IsOnLayer( layer ) )
+            continue;
+
+        if( !track->GetBoundingBox().Intersects( zone_boundingbox ) )
+            continue;
+
+        hash.Hash( track->Type() );
+        hashNet( track );
+        hash.Hash( track->GetWidth() );
+        hash.Hash( track->GetClearance() );
+        hashPoint( track->GetStart() );
+        hashPoint( track->GetEnd() );
+
+        if( track->Type() == PCB_VIA_T )
+            hash.Hash( static_cast<VIA*>( track )->GetDrillValue() );
+    }
+
+    for( auto item : board->Drawings() )
+    {
+        if( item->GetLayer() != layer && item->GetLayer() != Edge_Cuts )
+            continue;
+
+        if( !item->GetBoundingBox().Intersects( zone_boundingbox ) )
+            continue;
+
+        switch( item->Type() )
+        {
+        case PCB_LINE_T:
+            hashDrawSegment( static_cast<DRAWSEGMENT*>( item ) );
+            break;
+
+        case PCB_TEXT_T:
+        {
+            TEXTE_PCB* text = static_cast<TEXTE_PCB*>( item );
+            EDA_RECT   bbox = text->GetTextBox();
+
+            hash.Hash( item->GetLayer() );
+            hash.Hash( KiROUND( text->GetTextAngle() ) );
+            hashPoint( bbox.GetOrigin() );
+            hashPoint( bbox.GetEnd() );
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    for( int ii = 0; ii < board->GetAreaCount(); ii++ )
+    {
+        ZONE_CONTAINER* zone = board->GetArea( ii );
+
+        if( zone == this || !CommonLayerExists( zone->GetLayerSet() ) )
+            continue;
+
+        if( !zone->GetBoundingBox().Intersects( zone_boundingbox ) )
+            continue;
+
+        hashNet( zone );
+        hash.Hash( zone->GetPriority() );
+        hash.Hash( zone->GetClearance() );
+        hash.Hash( zone->GetIsKeepout() );
+        hash.Hash( zone->GetDoNotAllowCopperPour() );
+        hash.Hash( zone->GetCornerSmoothingType() );
+        hash.Hash( zone->GetCornerRadius() );
+        hashPolySet( *zone->Outline() );
+    }
+
+    hash.Finalize();
+
+    return hash;
+}
+
+
 bool ZONE_CONTAINER::BuildSmoothedPoly( SHAPE_POLY_SET& aSmoothedPoly ) const
 {
     if( GetNumCorners() <= 2 )  // malformed zone. polygon calculations do not like it ...
@@ -31,6 +31,9 @@
 #define CLASS_ZONE_H_
 
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <gr_basic.h>
 #include <class_board_item.h>
@@ -39,6 +42,7 @@
 #include <PolyLine.h>
 #include <geometry/shape_poly_set.h>
 #include <zone_settings.h>
+#include <md5_hash.h>
 
 
 class EDA_RECT;
@@ -51,6 +55,27 @@ class MSG_PANEL_ITEM;
 
 typedef std::vector<SEG> ZONE_SEGMENT_FILL;
 
+/**
+ * Class ZONE_LAZY_FILL
+ * holds the filled polygons and fill segments of a zone in the form they were read from
+ * a file, so a board loader can skip their parsing: the zone loads them the first time
+ * they are needed.
+ */
+class ZONE_LAZY_FILL
+{
+public:
+    virtual ~ZONE_LAZY_FILL() {}
+
+    /**
+     * Function Load
+     * converts the polygons into aFill and the segments into aSegments.  It is called at
+     * most once per zone, but possibly from several threads for zones sharing the same
+     * ZONE_LAZY_FILL.
+     * @throw IO_ERROR if the polygons or the segments cannot be read.
+     */
+    virtual void Load( SHAPE_POLY_SET& aFill, ZONE_SEGMENT_FILL& aSegments ) const = 0;
+};
+
 /**
  * Class ZONE_CONTAINER
  * handles a list of polygons defining a copper zone.
@@ -189,6 +214,21 @@ public:
     bool IsFilled() const { return m_IsFilled; }
     void SetIsFilled( bool isFilled ) { m_IsFilled = isFilled; }
 
+    /**
+     * The fill fingerprint is a hash of everything the filled areas depend on: the outline,
+     * the zone settings and the items near the zone.  It is set by the ZONE_FILLER, which
+     * skips the zones whose fingerprint has not changed since the last fill, and it is
+     * saved with the filled areas, so a stale fill can be detected when loading a board.
+     */
+    const MD5_HASH& GetFillFingerprint() const { return m_fillFingerprint; }
+    void SetFillFingerprint( const MD5_HASH& aFingerprint ) { m_fillFingerprint = aFingerprint; }
+
+    /**
+     * Function ComputeFillFingerprint
+     * @return the fill fingerprint matching the current state of the zone and its board.
+     */
+    MD5_HASH ComputeFillFingerprint() const;
+
     int GetZoneClearance() const { return m_ZoneClearance; }
     void SetZoneClearance( int aZoneClearance ) { m_ZoneClearance = aZoneClearance; }
 
@@ -230,8 +270,8 @@ public:
     int GetLocalFlags() const { return m_localFlgs; }
     void SetLocalFlags( int aFlags ) { m_localFlgs = aFlags; }
 
-    ZONE_SEGMENT_FILL& FillSegments() { return m_FillSegmList; }
-    const ZONE_SEGMENT_FILL& FillSegments() const { return m_FillSegmList; }
+    ZONE_SEGMENT_FILL& FillSegments() { loadFill(); return m_FillSegmList; }
+    const ZONE_SEGMENT_FILL& FillSegments() const { loadFill(); return m_FillSegmList; }
 
     SHAPE_POLY_SET* Outline() { return m_Poly; }
     const SHAPE_POLY_SET* Outline() const { return const_cast< SHAPE_POLY_SET* >( m_Poly ); }
@@ -520,6 +560,7 @@ public:
      */
     void ClearFilledPolysList()
     {
+        dropLazyFill();
         m_FilledPolysList.RemoveAllContours();
     }
 
@@ -533,6 +574,7 @@ public:
 
     const SHAPE_POLY_SET& GetFilledPolysList() const
     {
+        loadFill();
         return m_FilledPolysList;
     }
 
@@ -540,13 +582,33 @@ public:
 
    /**
      * Function SetFilledPolysList
-     * sets the list of filled polygons.
+     * sets the list of filled polygons.  The fill segments not loaded yet are kept
+     * only for a zone filled by segments, since they are not used by the other zones.
      */
     void SetFilledPolysList( SHAPE_POLY_SET& aPolysList )
     {
+        if( m_FillMode == ZFM_SEGMENTS )
+            loadFill();
+        else
+            dropLazyFill();
+
         m_FilledPolysList = aPolysList;
     }
 
+    /**
+     * Function SetLazyFill
+     * sets filled polygons and fill segments which are not loaded yet: aFill is loaded the
+     * first time either of them is needed.  If it cannot be loaded, the zone has no filled
+     * polygons nor segments and an error is logged.
+     */
+    void SetLazyFill( const std::shared_ptr<ZONE_LAZY_FILL>& aFill );
+
+    /**
+     * Function IsFillLoaded
+     * @return false if the zone has a lazy fill (see SetLazyFill()) not loaded yet.
+     */
+    bool IsFillLoaded() const { return !m_hasLazyFill; }
+
     /**
       * Function SetFilledPolysList
       * sets the list of filled polygons.
@@ -582,6 +644,7 @@ public:
 
     void SetFillSegments( const ZONE_SEGMENT_FILL& aSegments )
     {
+        loadFill();
         m_FillSegmList = aSegments;
     }
 
@@ -668,6 +731,17 @@ public:
     virtual void SwapData( BOARD_ITEM* aImage ) override;
 
 private:
+    /**
+     * Function loadFill
+     * loads the lazy fill, if any, into m_FilledPolysList and m_FillSegmList.
+     */
+    void loadFill() const;
+
+    /**
+     * Function dropLazyFill
+     * forgets the lazy fill, if any, without loading it.
+     */
+    void dropLazyFill();
 
     SHAPE_POLY_SET*       m_Poly;                ///< Outline of the zone.
     int                   m_cornerSmoothingType;
@@ -704,6 +778,9 @@ private:
     /** True when a zone was filled, false after deleting the filled areas. */
     bool                  m_IsFilled;
 
+    /// Hash of the inputs of the last fill (invalid if the zone was never filled).
+    MD5_HASH              m_fillFingerprint;
+
     ///< Width of the gap in thermal reliefs.
     int                   m_ThermalReliefGap;
 
@@ -723,7 +800,7 @@ private:
     /** Segments used to fill the zone (#m_FillMode ==1 ), when fill zone by segment is used.
      *  In this case the segments have #m_ZoneMinThickness width.
      */
-    ZONE_SEGMENT_FILL          m_FillSegmList;
+    mutable ZONE_SEGMENT_FILL  m_FillSegmList;
 
     /* set of filled polygons used to draw a zone as a filled area.
      * from outlines (m_Poly) but unlike m_Poly these filled polygons have no hole
@@ -733,9 +810,15 @@ private:
      * connecting "holes" with external main outline.  In complex cases an outline
      * described by m_Poly can have many filled areas
      */
-    SHAPE_POLY_SET        m_FilledPolysList;
+    mutable SHAPE_POLY_SET m_FilledPolysList;
     SHAPE_POLY_SET        m_RawPolysList;
 
+    /// The filled polygons and segments not loaded yet, if any, m_hasLazyFill being true meanwhile.
+    /// m_lazyFillMutex protects the loading, as the readers of a zone can be concurrent.
+    mutable std::shared_ptr<ZONE_LAZY_FILL> m_lazyFill;
+    mutable std::atomic_bool m_hasLazyFill;
+    mutable std::mutex    m_lazyFillMutex;
+
     HATCH_STYLE           m_hatchStyle;     // hatch style, see enum above
     int                   m_hatchPitch;     // for DIAGONAL_EDGE, distance between 2 hatch lines
     std::vector<SEG>      m_HatchLines;     // hatch lines
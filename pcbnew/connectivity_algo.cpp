@@ -24,20 +24,22 @@
 
 #include <connectivity_algo.h>
 #include <widgets/progress_reporter.h>
+#include <thread_pool.h>
 
-#include <thread>
+#include <atomic>
 #include <mutex>
+#include <set>
 
 #ifdef PROFILE
 #include <profile.h>
 #endif
 
-#ifdef USE_OPENMP
-#include <omp.h>
-#endif /* USE_OPENMP */
-
 using namespace std::placeholders;
 
+/// The kinds of items searched for clusters
+static const KICAD_T clusterTypes[] = { PCB_TRACE_T, PCB_PAD_T, PCB_VIA_T, PCB_ZONE_AREA_T,
+                                        PCB_MODULE_T, EOT };
+
 bool operator<( const CN_ANCHOR_PTR& a, const CN_ANCHOR_PTR& b )
 {
     if( a->Pos().x == b->Pos().x )
@@ -163,37 +165,30 @@ bool CN_CONNECTIVITY_ALGO::Remove( BOARD_ITEM* aItem )
     {
     case PCB_MODULE_T:
         for( auto pad : static_cast<MODULE*>( aItem ) -> Pads() )
-        {
-            m_itemMap[ static_cast<BOARD_CONNECTED_ITEM*>( pad ) ].MarkItemsAsInvalid();
-            m_itemMap.erase( static_cast<BOARD_CONNECTED_ITEM*>( pad ) );
-        }
+            removeItem( pad );
 
         m_padList.SetDirty( true );
         break;
 
     case PCB_PAD_T:
-        m_itemMap[ static_cast<BOARD_CONNECTED_ITEM*>( aItem ) ].MarkItemsAsInvalid();
-        m_itemMap.erase( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
+        removeItem( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
         m_padList.SetDirty( true );
         break;
 
     case PCB_TRACE_T:
-        m_itemMap[ static_cast<BOARD_CONNECTED_ITEM*>( aItem ) ].MarkItemsAsInvalid();
-        m_itemMap.erase( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
+        removeItem( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
         m_trackList.SetDirty( true );
         break;
 
     case PCB_VIA_T:
-        m_itemMap[ static_cast<BOARD_CONNECTED_ITEM*>( aItem ) ].MarkItemsAsInvalid();
-        m_itemMap.erase( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
+        removeItem( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
         m_viaList.SetDirty( true );
         break;
 
     case PCB_ZONE_AREA_T:
     case PCB_ZONE_T:
     {
-        m_itemMap[ static_cast<BOARD_CONNECTED_ITEM*>( aItem ) ].MarkItemsAsInvalid();
-        m_itemMap.erase ( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
+        removeItem( static_cast<BOARD_CONNECTED_ITEM*>( aItem ) );
         m_zoneList.SetDirty( true );
         break;
     }
@@ -206,6 +201,23 @@ bool CN_CONNECTIVITY_ALGO::Remove( BOARD_ITEM* aItem )
 }
 
 
+void CN_CONNECTIVITY_ALGO::removeItem( const BOARD_CONNECTED_ITEM* aItem )
+{
+    auto it = m_itemMap.find( aItem );
+
+    if( it == m_itemMap.end() )
+        return;
+
+    // The ratsnest clusters of the nets the items were in are kept until their nets are
+    // dirty: the item may have changed its net since
+    for( auto item : it->second.m_items )
+        MarkNetAsDirty( item->ClusterNet() );
+
+    it->second.MarkItemsAsInvalid();
+    m_itemMap.erase( it );
+}
+
+
 void CN_CONNECTIVITY_ALGO::markItemNetAsDirty( const BOARD_ITEM* aItem )
 {
     if( aItem->IsConnected() )
@@ -302,17 +314,7 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
 {
     std::mutex cnListLock;
 
-    int totalDirtyCount = 0;
-
-    if( m_lastSearchWithZones != aIncludeZones )
-    {
-        m_padList.MarkAllAsDirty();
-        m_viaList.MarkAllAsDirty();
-        m_trackList.MarkAllAsDirty();
-        m_zoneList.MarkAllAsDirty();
-    }
-
-    m_lastSearchWithZones = aIncludeZones;
+    std::atomic_int totalDirtyCount( 0 );
 
     auto checkForConnection = [ &cnListLock ] ( const CN_ANCHOR_PTR point, CN_ITEM* aRefItem, int aMaxDist = 0 )
     {
@@ -451,6 +453,16 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
     m_trackList.RemoveInvalidItems( garbage );
     m_zoneList.RemoveInvalidItems( garbage );
 
+    // Only the items connected to the removed ones can refer to them
+    for( auto item : garbage )
+    {
+        for( auto connected : item->ConnectedItems() )
+        {
+            if( connected->Valid() )
+                connected->RemoveInvalidRefs();
+        }
+    }
+
     for( auto item : garbage )
         delete item;
 
@@ -475,6 +487,8 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
     PROF_COUNTER search_basic( "search-basic" );
 #endif
 
+    // The connections between items which have not changed since the last search are
+    // already known: these items are only checked against the items added meanwhile.
     if( m_padList.IsDirty() || m_trackList.IsDirty() || m_viaList.IsDirty() )
     {
         totalDirtyCount++;
@@ -483,10 +497,14 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
         {
             auto pad = static_cast<D_PAD*> ( padItem->Parent() );
             auto searchPads = std::bind( checkForConnection, _1, padItem );
-
-            m_padList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads );
-            m_trackList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads );
-            m_viaList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads );
+            bool dirtyOnly = !padItem->Dirty();
+
+            m_padList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads,
+                                  dirtyOnly );
+            m_trackList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads,
+                                    dirtyOnly );
+            m_viaList.FindNearby( pad->ShapePos(), pad->GetBoundingRadius(), searchPads,
+                                  dirtyOnly );
         }
 
         for( auto& trackItem : m_trackList )
@@ -494,9 +512,10 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
             auto track = static_cast<TRACK*> ( trackItem->Parent() );
             int dist_max = track->GetWidth() / 2;
             auto searchTracks = std::bind( checkForConnection, _1, trackItem, dist_max );
+            bool dirtyOnly = !trackItem->Dirty();
 
-            m_trackList.FindNearby( track->GetStart(), dist_max, searchTracks );
-            m_trackList.FindNearby( track->GetEnd(), dist_max, searchTracks );
+            m_trackList.FindNearby( track->GetStart(), dist_max, searchTracks, dirtyOnly );
+            m_trackList.FindNearby( track->GetEnd(), dist_max, searchTracks, dirtyOnly );
         }
 
         for( auto& viaItem : m_viaList )
@@ -504,10 +523,11 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
             auto via = static_cast<VIA*> ( viaItem->Parent() );
             int dist_max = via->GetWidth() / 2;
             auto searchVias = std::bind( checkForConnection, _1, viaItem, dist_max );
+            bool dirtyOnly = !viaItem->Dirty();
 
             totalDirtyCount++;
-            m_viaList.FindNearby( via->GetStart(), dist_max, searchVias );
-            m_trackList.FindNearby( via->GetStart(), dist_max, searchVias );
+            m_viaList.FindNearby( via->GetStart(), dist_max, searchVias, dirtyOnly );
+            m_trackList.FindNearby( via->GetStart(), dist_max, searchVias, dirtyOnly );
         }
     }
 
@@ -515,59 +535,50 @@ void CN_CONNECTIVITY_ALGO::searchConnections( bool aIncludeZones )
     search_basic.Show();
 #endif
 
+    // The zones are searched on their own: the items added since the last search of the
+    // zone connections are still to be checked, even if they were searched without zones
     if( aIncludeZones )
     {
-        int cnt = 0;
+        bool anchorsAdded = m_padList.IsZoneDirty() || m_trackList.IsZoneDirty()
+                            || m_viaList.IsZoneDirty();
 
         if( m_progressReporter )
         {
             m_progressReporter->SetMaxProgress( m_zoneList.Size() );
         }
 
-        #ifdef USE_OPENMP
-            // launch at least two threads, one to compute, second to update UI
-            #pragma omp parallel num_threads( std::max( omp_get_num_procs(), 2 ) )
-        #endif
-        {
-            #ifdef USE_OPENMP
-                #pragma omp master
-                if (m_progressReporter)
-                {
-                    m_progressReporter->KeepRefreshing( true );
-                }
-            #endif
-
-            #ifdef USE_OPENMP
-                #pragma omp for schedule(dynamic)
-            #endif
-            for(int i = 0; i < m_zoneList.Size(); i++ )
-            {
-                auto item = m_zoneList[i];
-                auto zoneItem = static_cast<CN_ZONE *> (item);
-                auto searchZones = std::bind( checkForConnection, _1, zoneItem );
+        // The search must not be cancelled: it would leave the connectivity incomplete
+        std::function<bool()> refresh;
 
-                if( zoneItem->Dirty() || m_padList.IsDirty() || m_trackList.IsDirty() || m_viaList.IsDirty() )
-                {
-                    totalDirtyCount++;
-                    m_viaList.FindNearby( zoneItem->BBox(), searchZones );
-                    m_trackList.FindNearby( zoneItem->BBox(), searchZones );
-                    m_padList.FindNearby( zoneItem->BBox(), searchZones );
-                    m_zoneList.FindNearbyZones( zoneItem->BBox(), std::bind( checkInterZoneConnection, _1, zoneItem ) );
-                }
+        if( m_progressReporter )
+            refresh = [this]() { m_progressReporter->KeepRefreshing(); return true; };
 
-                {
-                    std::lock_guard<std::mutex> lock( cnListLock );
-                    cnt++;
+        THREAD_POOL::Instance().ParallelFor( m_zoneList.Size(), [&]( size_t i )
+        {
+            auto item = m_zoneList[i];
+            auto zoneItem = static_cast<CN_ZONE *> (item);
+            auto searchZones = std::bind( checkForConnection, _1, zoneItem );
+            bool dirtyOnly = !zoneItem->Dirty();
 
-                    if (m_progressReporter)
-                    {
-                        m_progressReporter->AdvanceProgress();
-                    }
-                }
+            if( zoneItem->Dirty() || anchorsAdded || m_zoneList.IsDirty() )
+            {
+                totalDirtyCount++;
+                m_viaList.FindNearby( zoneItem->BBox(), searchZones, dirtyOnly );
+                m_trackList.FindNearby( zoneItem->BBox(), searchZones, dirtyOnly );
+                m_padList.FindNearby( zoneItem->BBox(), searchZones, dirtyOnly );
+                m_zoneList.FindNearbyZones( zoneItem->BBox(),
+                                            std::bind( checkInterZoneConnection, _1, zoneItem ),
+                                            dirtyOnly );
             }
-        }
+
+            if( m_progressReporter )
+                m_progressReporter->AdvanceProgress();
+        }, refresh );
 
         m_zoneList.ClearDirtyFlags();
+        m_padList.ClearZoneDirtyFlags();
+        m_viaList.ClearZoneDirtyFlags();
+        m_trackList.ClearZoneDirtyFlags();
     }
 
     m_padList.ClearDirtyFlags();
@@ -615,40 +626,52 @@ void CN_LIST::RemoveInvalidItems( std::vector<CN_ITEM*>& aGarbage )
 
     m_items.resize( lastItem - m_items.begin() );
 
-    // fixme: mem leaks
+    auto isInvalid = [] ( const CN_ANCHOR_PTR& anchor ) { return !anchor->Valid(); };
 
-    for( auto item : m_items )
-        item->RemoveInvalidRefs();
+    m_dirtyAnchors.erase( std::remove_if( m_dirtyAnchors.begin(), m_dirtyAnchors.end(),
+                                          isInvalid ), m_dirtyAnchors.end() );
+    m_zoneDirtyAnchors.erase( std::remove_if( m_zoneDirtyAnchors.begin(),
+                                              m_zoneDirtyAnchors.end(), isInvalid ),
+                              m_zoneDirtyAnchors.end() );
 }
 
 
-bool CN_CONNECTIVITY_ALGO::isDirty() const
+bool CN_CONNECTIVITY_ALGO::isDirty( bool aIncludeZones ) const
 {
-    return m_viaList.IsDirty() || m_trackList.IsDirty() || m_zoneList.IsDirty() || m_padList.IsDirty();
+    if( m_viaList.IsDirty() || m_trackList.IsDirty() || m_zoneList.IsDirty() || m_padList.IsDirty() )
+        return true;
+
+    return aIncludeZones && ( m_viaList.IsZoneDirty() || m_trackList.IsZoneDirty()
+                              || m_padList.IsZoneDirty() );
 }
 
 
 const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::SearchClusters( CLUSTER_SEARCH_MODE aMode )
 {
-    constexpr KICAD_T types[] = { PCB_TRACE_T, PCB_PAD_T, PCB_VIA_T, PCB_ZONE_AREA_T, PCB_MODULE_T, EOT };
-    return SearchClusters( aMode, types, -1 );
+    return SearchClusters( aMode, clusterTypes, -1 );
 }
 
 
 const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::SearchClusters( CLUSTER_SEARCH_MODE aMode,
         const KICAD_T aTypes[], int aSingleNet )
+{
+    return searchClusters( aMode, aTypes, aSingleNet, false );
+}
+
+
+const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::searchClusters( CLUSTER_SEARCH_MODE aMode,
+        const KICAD_T aTypes[], int aSingleNet, bool aDirtyNetsOnly )
 {
     bool includeZones = ( aMode != CSM_PROPAGATE );
     bool withinAnyNet = ( aMode != CSM_PROPAGATE );
 
-    std::deque<CN_ITEM*> Q;
-    CN_ITEM* head = nullptr;
+    std::vector<CN_ITEM*> items;
     CLUSTERS clusters;
 
-    if( isDirty() )
+    if( isDirty( includeZones ) )
         searchConnections( includeZones );
 
-    auto addToSearchList = [&head, withinAnyNet, aSingleNet, aTypes] ( CN_ITEM *aItem )
+    auto addToSearchList = [&] ( CN_ITEM *aItem )
     {
         if( withinAnyNet && aItem->Net() <= 0 )
             return;
@@ -659,6 +682,9 @@ const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::SearchClusters( CLUST
         if( aSingleNet >=0 && aItem->Net() != aSingleNet )
             return;
 
+        if( aDirtyNetsOnly && !IsNetDirty( aItem->Net() ) )
+            return;
+
         bool found = false;
 
         for( int i = 0; aTypes[i] != EOT; i++ )
@@ -673,13 +699,8 @@ const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::SearchClusters( CLUST
         if( !found )
             return;
 
-        aItem->ListClear();
-        aItem->SetVisited( false );
-
-        if( !head )
-            head = aItem;
-        else
-            head->ListInsert( aItem );
+        aItem->SetSearchIndex( items.size() );
+        items.push_back( aItem );
     };
 
     std::for_each( m_padList.begin(), m_padList.end(), addToSearchList );
@@ -691,44 +712,44 @@ const CN_CONNECTIVITY_ALGO::CLUSTERS CN_CONNECTIVITY_ALGO::SearchClusters( CLUST
         std::for_each( m_zoneList.begin(), m_zoneList.end(), addToSearchList );
     }
 
+    // Merge the sets of connected items.  The search index of an item left out of this
+    // search may be stale, hence the check of the item found at this index.
+    UNION_FIND sets( items.size() );
 
-    while( head )
+    for( int i = 0; i < (int) items.size(); i++ )
     {
-        CN_CLUSTER_PTR cluster ( new CN_CLUSTER() );
+        CN_ITEM* item = items[i];
 
-        Q.clear();
-        CN_ITEM* root = head;
-        root->SetVisited ( true );
+        for( auto n : item->ConnectedItems() )
+        {
+            int j = n->SearchIndex();
 
-        head = root->ListRemove();
+            if( j < 0 || j >= (int) items.size() || items[j] != n )
+                continue;
 
-        Q.push_back( root );
+            if( withinAnyNet && n->Net() != item->Net() )
+                continue;
 
-        while( Q.size() )
-        {
-            CN_ITEM* current = Q.front();
+            sets.Union( i, j );
+        }
+    }
 
-            Q.pop_front();
-            cluster->Add( current );
+    // One cluster per set, keeping the items in the order of the lists
+    std::vector<int> clusterIndex( items.size(), -1 );
 
-            for( auto n : current->ConnectedItems() )
-            {
-                if( withinAnyNet && n->Net() != root->Net() )
-                    continue;
+    for( int i = 0; i < (int) items.size(); i++ )
+    {
+        int root = sets.Find( i );
 
-                if( !n->Visited() && n->Valid() )
-                {
-                    n->SetVisited( true );
-                    Q.push_back( n );
-                    head = n->ListRemove();
-                }
-            }
+        if( clusterIndex[root] < 0 )
+        {
+            clusterIndex[root] = clusters.size();
+            clusters.push_back( CN_CLUSTER_PTR( new CN_CLUSTER() ) );
         }
 
-        clusters.push_back( cluster );
+        clusters[ clusterIndex[root] ]->Add( items[i] );
     }
 
-
     std::sort( clusters.begin(), clusters.end(), []( CN_CLUSTER_PTR a, CN_CLUSTER_PTR b ) {
         return a->OriginNet() < b->OriginNet();
     } );
@@ -865,7 +886,8 @@ void CN_CONNECTIVITY_ALGO::FindIsolatedCopperIslands( ZONE_CONTAINER* aZone, std
     Remove( aZone );
     Add( aZone );
 
-    m_connClusters = SearchClusters( CSM_CONNECTIVITY_CHECK );
+    // The islands of a zone only depend on the items of its net
+    m_connClusters = SearchClusters( CSM_CONNECTIVITY_CHECK, clusterTypes, aZone->GetNetCode() );
 
     for( const auto& cluster : m_connClusters )
     {
@@ -895,7 +917,23 @@ void CN_CONNECTIVITY_ALGO::FindIsolatedCopperIslands( std::vector<CN_ZONE_ISOLAT
         Add( z.m_zone );
     }
 
-    m_connClusters = SearchClusters( CSM_CONNECTIVITY_CHECK );
+    // The islands of a zone only depend on the items of its net: search the nets of the
+    // zones instead of the whole board
+    std::set<int> nets;
+
+    for( auto& zone : aZones )
+    {
+        if( !zone.m_zone->GetFilledPolysList().IsEmpty() )
+            nets.insert( zone.m_zone->GetNetCode() );
+    }
+
+    m_connClusters.clear();
+
+    for( int net : nets )
+    {
+        CLUSTERS netClusters = SearchClusters( CSM_CONNECTIVITY_CHECK, clusterTypes, net );
+        m_connClusters.insert( m_connClusters.end(), netClusters.begin(), netClusters.end() );
+    }
 
     for ( auto& zone : aZones )
     {
@@ -921,7 +959,27 @@ void CN_CONNECTIVITY_ALGO::FindIsolatedCopperIslands( std::vector<CN_ZONE_ISOLAT
 
 const CN_CONNECTIVITY_ALGO::CLUSTERS& CN_CONNECTIVITY_ALGO::GetClusters()
 {
-    m_ratsnestClusters = SearchClusters( CSM_RATSNEST );
+    // Only the clusters of the dirty nets can have been split or merged since the last
+    // call: the other ones are kept as they are.
+    CLUSTERS clusters = searchClusters( CSM_RATSNEST, clusterTypes, -1, true );
+
+    for( const auto& cluster : clusters )
+    {
+        for( auto item : *cluster )
+            item->SetClusterNet( cluster->OriginNet() );
+    }
+
+    for( const auto& cluster : m_ratsnestClusters )
+    {
+        if( !IsNetDirty( cluster->OriginNet() ) )
+            clusters.push_back( cluster );
+    }
+
+    std::stable_sort( clusters.begin(), clusters.end(), []( CN_CLUSTER_PTR a, CN_CLUSTER_PTR b ) {
+        return a->OriginNet() < b->OriginNet();
+    } );
+
+    m_ratsnestClusters = std::move( clusters );
     return m_ratsnestClusters;
 }
 
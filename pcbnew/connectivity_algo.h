@@ -41,7 +41,7 @@
 #include <functional>
 #include <vector>
 #include <deque>
-#include <intrusive_list.h>
+#include <union_find.h>
 
 #include <connectivity_data.h>
 
@@ -262,7 +262,7 @@ typedef std::shared_ptr<CN_CLUSTER> CN_CLUSTER_PTR;
 
 
 // basic connectivity item
-class CN_ITEM : public INTRUSIVE_LIST<CN_ITEM>
+class CN_ITEM
 {
 private:
     BOARD_CONNECTED_ITEM* m_parent;
@@ -274,8 +274,11 @@ private:
 
     CN_ANCHORS m_anchors;
 
-    ///> visited flag for the BFS scan
-    bool m_visited;
+    ///> index of the item in the last cluster search it took part in
+    int m_searchIndex;
+
+    ///> net of the last ratsnest cluster the item was put in (-1 if none)
+    int m_clusterNet;
 
     ///> can the net propagator modify the netcode?
     bool m_canChangeNet;
@@ -293,7 +296,8 @@ public:
     {
         m_parent = aParent;
         m_canChangeNet = aCanChangeNet;
-        m_visited = false;
+        m_searchIndex = -1;
+        m_clusterNet = -1;
         m_valid = true;
         m_dirty = true;
         m_anchors.reserve( 2 );
@@ -348,14 +352,24 @@ public:
         m_connected.clear();
     }
 
-    void SetVisited( bool aVisited )
+    void SetSearchIndex( int aIndex )
+    {
+        m_searchIndex = aIndex;
+    }
+
+    int SearchIndex() const
     {
-        m_visited = aVisited;
+        return m_searchIndex;
     }
 
-    bool Visited() const
+    void SetClusterNet( int aNet )
     {
-        return m_visited;
+        m_clusterNet = aNet;
+    }
+
+    int ClusterNet() const
+    {
+        return m_clusterNet;
     }
 
     bool CanChangeNet() const
@@ -409,12 +423,20 @@ private:
     bool m_dirty;
     std::vector<CN_ANCHOR_PTR> m_anchors;
 
+    ///> anchors added since the last search of connections between pads, tracks and vias
+    std::vector<CN_ANCHOR_PTR> m_dirtyAnchors;
+
+    ///> anchors added since the last search of connections with the zones
+    std::vector<CN_ANCHOR_PTR> m_zoneDirtyAnchors;
+
 protected:
     std::vector<CN_ITEM*> m_items;
 
     void addAnchor( VECTOR2I pos, CN_ITEM* item )
     {
         m_anchors.push_back( item->AddAnchor( pos ) );
+        m_dirtyAnchors.push_back( m_anchors.back() );
+        m_zoneDirtyAnchors.push_back( m_anchors.back() );
     }
 
 private:
@@ -424,6 +446,7 @@ private:
         if( m_dirty )
         {
             std::sort( m_anchors.begin(), m_anchors.end() );
+            std::sort( m_dirtyAnchors.begin(), m_dirtyAnchors.end() );
 
             m_dirty = false;
         }
@@ -441,6 +464,9 @@ public:
             delete item;
 
         m_items.clear();
+        m_anchors.clear();
+        m_dirtyAnchors.clear();
+        m_zoneDirtyAnchors.clear();
     }
 
     using ITER = decltype(m_items)::iterator;
@@ -452,9 +478,20 @@ public:
 
     std::vector<CN_ANCHOR_PTR>& Anchors() { return m_anchors; }
 
+    /**
+     * Function FindNearby
+     * calls aFunc for the anchors closer than aDistMax to aPosition.  If aDirtyOnly is
+     * true, only the anchors added since the last search of connections between pads,
+     * tracks and vias are visited.
+     */
     template <class T>
     void FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirtyOnly = false );
 
+    /**
+     * Function FindNearby
+     * calls aFunc for the anchors inside aBBox.  If aDirtyOnly is true, only the anchors
+     * added since the last search of connections with the zones are visited.
+     */
     template <class T>
     void FindNearby( BOX2I aBBox, T aFunc, bool aDirtyOnly = false );
 
@@ -481,14 +518,27 @@ public:
         for( auto item : m_items )
             item->SetDirty( false );
 
+        m_dirtyAnchors.clear();
         SetDirty( false );
     }
 
+    bool IsZoneDirty() const
+    {
+        return !m_zoneDirtyAnchors.empty();
+    }
+
+    void ClearZoneDirtyFlags()
+    {
+        m_zoneDirtyAnchors.clear();
+    }
+
     void MarkAllAsDirty()
     {
         for( auto item : m_items )
             item->SetDirty( true );
 
+        m_dirtyAnchors = m_anchors;
+        m_zoneDirtyAnchors = m_anchors;
         SetDirty( true );
     }
 
@@ -630,13 +680,10 @@ public:
 template <class T>
 void CN_LIST::FindNearby( BOX2I aBBox, T aFunc, bool aDirtyOnly )
 {
-    for( auto p : m_anchors )
+    for( const auto& p : aDirtyOnly ? m_zoneDirtyAnchors : m_anchors )
     {
         if( p->Valid() && aBBox.Contains( p->Pos() ) )
-        {
-            if( !aDirtyOnly || p->IsDirty() )
-                aFunc( p );
-        }
+            aFunc( p );
     }
 }
 
@@ -673,7 +720,9 @@ void CN_LIST::FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirty
 
     sort();
 
-    int idxmax = m_anchors.size() - 1;
+    const std::vector<CN_ANCHOR_PTR>& anchors = aDirtyOnly ? m_dirtyAnchors : m_anchors;
+
+    int idxmax = anchors.size() - 1;
 
     int delta = idxmax + 1;
     int idx = 0;        // Starting index is the beginning of list
@@ -687,7 +736,7 @@ void CN_LIST::FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirty
 
         delta /= 2;
 
-        auto p = m_anchors[idx];
+        auto p = anchors[idx];
 
         int dist = p->Pos().x - aPosition.x;
 
@@ -721,7 +770,7 @@ void CN_LIST::FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirty
 
     for( int ii = idx; ii <= idxmax; ii++ )
     {
-        auto& p = m_anchors[ii];
+        auto& p = anchors[ii];
         diff = p->Pos() - aPosition;;
 
         if( std::abs( diff.x ) > aDistMax )
@@ -732,14 +781,13 @@ void CN_LIST::FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirty
 
         // We have here a good candidate: add it
         if( p->Valid() )
-            if( !aDirtyOnly || p->IsDirty() )
-                aFunc( p );
+            aFunc( p );
     }
 
     // search previous candidates in list
     for( int ii = idx - 1; ii >=0; ii-- )
     {
-        auto& p = m_anchors[ii];
+        auto& p = anchors[ii];
         diff = p->Pos() - aPosition;
 
         if( abs( diff.x ) > aDistMax )
@@ -750,10 +798,7 @@ void CN_LIST::FindNearby( VECTOR2I aPosition, int aDistMax, T aFunc, bool aDirty
 
         // We have here a good candidate:add it
         if( p->Valid() )
-        {
-            if( !aDirtyOnly || p->IsDirty() )
-                aFunc( p );
-        }
+            aFunc( p );
     }
 }
 
@@ -772,8 +817,6 @@ public:
 
 private:
 
-    bool m_lastSearchWithZones = false;
-
     class ITEM_MAP_ENTRY
     {
 public:
@@ -821,6 +864,15 @@ public:
 
     void    searchConnections( bool aIncludeZones = false );
 
+    /**
+     * Function searchClusters
+     * groups the items of the types aTypes in clusters of connected items.
+     * @param aSingleNet if not negative, only the items of this net are searched.
+     * @param aDirtyNetsOnly if true, only the items of the dirty nets are searched.
+     */
+    const CLUSTERS searchClusters( CLUSTER_SEARCH_MODE aMode, const KICAD_T aTypes[],
+                                   int aSingleNet, bool aDirtyNetsOnly );
+
     void    update();
     void    propagateConnections();
 
@@ -833,7 +885,10 @@ public:
     }
 
     bool addConnectedItem( BOARD_CONNECTED_ITEM* aItem );
-    bool isDirty() const;
+    bool isDirty( bool aIncludeZones ) const;
+
+    ///> Invalidates the connectivity items of aItem, and marks their nets as dirty.
+    void removeItem( const BOARD_CONNECTED_ITEM* aItem );
 
     void markItemNetAsDirty( const BOARD_ITEM* aItem );
 
@@ -854,7 +909,7 @@ public:
 
     bool IsNetDirty( int aNet ) const
     {
-        if( aNet < 0 )
+        if( aNet < 0 || aNet >= (int) m_dirtyNets.size() )
             return false;
 
         return m_dirtyNets[ aNet ];
@@ -21,17 +21,15 @@
  * or you may write to the Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
-#ifdef PROFILE
 #include <profile.h>
-#endif
 
 #include <connectivity_data.h>
 #include <connectivity_algo.h>
 #include <ratsnest_data.h>
+#include <thread_pool.h>
 
-#ifdef USE_OPENMP
-#include <omp.h>
-#endif /* USE_OPENMP */
+#include <algorithm>
+#include <atomic>
 
 CONNECTIVITY_DATA::CONNECTIVITY_DATA()
 {
@@ -93,28 +91,26 @@ void CONNECTIVITY_DATA::updateRatsnest()
     PROF_COUNTER rnUpdate( "update-ratsnest" );
     #endif
 
-    int nDirty = 0;
+    // Start with net number 1, as 0 stands for not connected
+    std::vector<RN_NET*> dirtyNets;
 
-    int i;
-
-    #ifdef USE_OPENMP
-        #pragma omp parallel shared(lastNet) private(i)
+    for( int net = 1; net < lastNet; net++ )
     {
-        #pragma omp for schedule(guided, 1)
-    #else /* USE_OPENMP */
+        if( m_nets[net]->IsDirty() )
+            dirtyNets.push_back( m_nets[net] );
+    }
+
+    // Each dirty net is an independent task: the biggest ones are started first, so they
+    // do not end up running alone on the last busy core
+    std::sort( dirtyNets.begin(), dirtyNets.end(), []( const RN_NET* aNet1, const RN_NET* aNet2 )
     {
-    #endif
+        return aNet1->GetNodeCount() > aNet2->GetNodeCount();
+    } );
 
-        // Start with net number 1, as 0 stands for not connected
-        for( i = 1; i < lastNet; ++i )
-        {
-            if( m_nets[i]->IsDirty() )
-            {
-                m_nets[i]->Update();
-                nDirty++;
-            }
-        }
-    }          /* end of parallel section */
+    THREAD_POOL::Instance().ParallelFor( dirtyNets.size(), [&]( size_t aIndex )
+    {
+        dirtyNets[aIndex]->Update();
+    } );
 
     #ifdef PROFILE
     rnUpdate.Show();
@@ -224,8 +220,11 @@ void CONNECTIVITY_DATA::FindIsolatedCopperIslands( std::vector<CN_ZONE_ISOLATED_
     m_connAlgo->FindIsolatedCopperIslands( aZones );
 }
 
-void CONNECTIVITY_DATA::ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>& aItems )
+bool CONNECTIVITY_DATA::ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>& aItems,
+                                                int aTimeBudget )
 {
+    PROF_COUNTER counter;
+
     m_dynamicConnectivity.reset( new CONNECTIVITY_DATA );
     m_dynamicConnectivity->Build( aItems );
 
@@ -233,25 +232,64 @@ void CONNECTIVITY_DATA::ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>&
 
     BlockRatsnestItems( aItems );
 
-    for( unsigned int nc = 1; nc < m_dynamicConnectivity->m_nets.size(); nc++ )
+    unsigned int netCount = std::min( m_dynamicConnectivity->m_nets.size(), m_nets.size() );
+
+    if( m_dynamicNetLines.size() < netCount )
     {
-        auto dynNet = m_dynamicConnectivity->m_nets[nc];
+        m_dynamicNetLines.resize( netCount, RN_DYNAMIC_LINE{ -1, VECTOR2I(), VECTOR2I() } );
+        m_dynamicPendingNets.resize( netCount, false );
+    }
+
+    // The nets which missed the budget of the previous call are computed first
+    std::vector<int> nets;
+
+    for( unsigned int nc = 1; nc < netCount; nc++ )
+    {
+        if( m_dynamicConnectivity->m_nets[nc]->GetNodeCount() != 0 )
+            nets.push_back( nc );
+    }
+
+    std::stable_partition( nets.begin(), nets.end(),
+                           [this]( int aNet ) { return m_dynamicPendingNets[aNet]; } );
+
+    std::atomic_bool complete( true );
+    THREAD_POOL& pool = THREAD_POOL::Instance();
+
+    pool.ParallelFor( nets.size(), [&]( size_t aIndex )
+    {
+        int nc = nets[aIndex];
 
-        if( dynNet->GetNodeCount() != 0 )
+        // Past the budget, the net keeps its previous line.  The first nets are always
+        // computed, so the pending nets are finished after a few calls anyway.
+        if( aTimeBudget >= 0 && aIndex >= pool.GetThreadCount()
+                && counter.msecs() > aTimeBudget )
         {
-            auto ourNet = m_nets[nc];
-            CN_ANCHOR_PTR nodeA, nodeB;
+            m_dynamicPendingNets[nc] = true;
+            complete = false;
+            return;
+        }
 
-            if( ourNet->NearestBicoloredPair( *dynNet, nodeA, nodeB ) )
-            {
-                RN_DYNAMIC_LINE l;
-                l.a = nodeA->Pos();
-                l.b = nodeB->Pos();
-                l.netCode = nc;
+        auto dynNet = m_dynamicConnectivity->m_nets[nc];
+        auto ourNet = m_nets[nc];
+        CN_ANCHOR_PTR nodeA, nodeB;
+        RN_DYNAMIC_LINE& l = m_dynamicNetLines[nc];
 
-                m_dynamicRatsnest.push_back( l );
-            }
+        l.netCode = -1;
+
+        if( ourNet->NearestBicoloredPair( *dynNet, nodeA, nodeB ) )
+        {
+            l.a = nodeA->Pos();
+            l.b = nodeB->Pos();
+            l.netCode = nc;
         }
+
+        m_dynamicPendingNets[nc] = false;
+    } );
+
+    for( int nc : nets )
+    {
+        if( m_dynamicNetLines[nc].netCode >= 0 )
+            m_dynamicRatsnest.push_back( m_dynamicNetLines[nc] );
     }
 
     for( auto net : m_dynamicConnectivity->m_nets )
@@ -276,6 +314,8 @@ void CONNECTIVITY_DATA::ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>&
             m_dynamicRatsnest.push_back( l );
         }
     }
+
+    return complete;
 }
 
 
@@ -290,6 +330,8 @@ void CONNECTIVITY_DATA::HideDynamicRatsnest()
 {
     m_dynamicConnectivity.reset();
     m_dynamicRatsnest.clear();
+    m_dynamicNetLines.clear();
+    m_dynamicPendingNets.clear();
 }
 
 
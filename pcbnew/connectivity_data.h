@@ -186,8 +186,12 @@ public:
      * Function ComputeDynamicRatsnest()
      * Calculates the temporary dynamic ratsnest (i.e. the ratsnest lines that)
      * for the set of items aItems.
+     * @param aTimeBudget is the time (in ms) after which the nets not computed yet keep
+     * their lines of the previous call, -1 for no limit.  These nets are computed first
+     * on the next call.
+     * @return false if some nets were not computed within the time budget.
      */
-    void ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>& aItems );
+    bool ComputeDynamicRatsnest( const std::vector<BOARD_ITEM*>& aItems, int aTimeBudget = -1 );
 
     const std::vector<RN_DYNAMIC_LINE>& GetDynamicRatsnest() const
     {
@@ -238,6 +242,12 @@ private:
     std::vector<RN_DYNAMIC_LINE> m_dynamicRatsnest;
     std::vector<RN_NET*> m_nets;
 
+    ///> Dynamic ratsnest line of each net (netCode < 0 if none), kept between the calls
+    std::vector<RN_DYNAMIC_LINE> m_dynamicNetLines;
+
+    ///> Nets whose dynamic ratsnest line missed the time budget of the last call
+    std::vector<char> m_dynamicPendingNets;
+
     PROGRESS_REPORTER* m_progressReporter;
 };
 
@@ -70,6 +70,7 @@ DIALOG_DRC_CONTROL::~DIALOG_DRC_CONTROL()
     m_config->Write( TestMissingCourtyardKey, m_cbCourtyardMissing->GetValue() );
     m_config->Write( TestFootprintCourtyardKey,  m_cbCourtyardOverlap->GetValue() );
     m_config->Write( RefillZonesBeforeDrc, m_cbRefillZones->GetValue() );
+    m_brdEditor->Settings().m_incrementalDrc = m_cbIncrementalDrc->GetValue();
 
     // Disonnect events
     m_ClearanceListBox->Disconnect( ID_CLEARANCE_LIST, wxEVT_LEFT_DCLICK,
@@ -153,6 +154,7 @@ void DIALOG_DRC_CONTROL::InitValues()
     m_cbCourtyardOverlap->SetValue( value );
     m_config->Read( RefillZonesBeforeDrc, &value, false );
     m_cbRefillZones->SetValue( value );
+    m_cbIncrementalDrc->SetValue( m_brdEditor->Settings().m_incrementalDrc );
 
     // Set the initial "enabled" status of the browse button and the text
     // field for report name
@@ -113,6 +113,11 @@ DIALOG_DRC_CONTROL_BASE::DIALOG_DRC_CONTROL_BASE( wxWindow* parent, wxWindowID i
 	
 	bSizerOptSettings->Add( m_cbReportAllTrackErrors, 0, wxRIGHT|wxLEFT, 5 );
 	
+	m_cbIncrementalDrc = new wxCheckBox( this, wxID_ANY, _("Test edited areas after each change"), wxDefaultPosition, wxDefaultSize, 0 );
+	m_cbIncrementalDrc->SetToolTip( _("If selected, the track and pad clearances are tested again around the modified items after each board edit.") );
+	
+	bSizerOptSettings->Add( m_cbIncrementalDrc, 0, wxRIGHT|wxLEFT, 5 );
+	
 	m_cbCourtyardOverlap = new wxCheckBox( this, wxID_ANY, _("Check footprint courtyard overlap"), wxDefaultPosition, wxDefaultSize, 0 );
 	bSizerOptSettings->Add( m_cbCourtyardOverlap, 0, wxLEFT|wxRIGHT, 5 );
 	
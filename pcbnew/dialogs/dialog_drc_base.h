@@ -65,6 +65,7 @@ class DIALOG_DRC_CONTROL_BASE : public DIALOG_SHIM
 		wxStaticText* m_MicroViaMinUnit;
 		wxCheckBox* m_cbRefillZones;
 		wxCheckBox* m_cbReportAllTrackErrors;
+		wxCheckBox* m_cbIncrementalDrc;
 		wxCheckBox* m_cbCourtyardOverlap;
 		wxCheckBox* m_cbCourtyardMissing;
 		wxStaticText* m_staticTextRpt;
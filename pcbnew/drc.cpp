@@ -51,10 +51,22 @@
 
 #include <pcbnew.h>
 #include <drc.h>
+#include <drc_rtree.h>
 
 #include <dialog_drc.h>
 #include <wx/progdlg.h>
 #include <board_commit.h>
+#include <zone_filler.h>
+#include <profile.h>
+#include <thread_pool.h>
+
+#include <thread>
+#include <atomic>
+#include <climits>
+#include <unordered_set>
+
+// Average number of tracks in a tile of the parallel track test.
+static const int s_drcTileItemCount = 256;
 
 void DRC::ShowDRCDialog( wxWindow* aParent )
 {
@@ -97,8 +109,26 @@ void DRC::ShowDRCDialog( wxWindow* aParent )
 
 void DRC::addMarkerToPcb( MARKER_PCB* aMarker )
 {
+    addMarkersToPcb( { aMarker } );
+}
+
+
+void DRC::addMarkersToPcb( const std::vector<MARKER_PCB*>& aMarkers )
+{
+    if( aMarkers.empty() )
+        return;
+
+    if( !m_pcbEditorFrame )
+    {
+        m_batchMarkers.insert( m_batchMarkers.end(), aMarkers.begin(), aMarkers.end() );
+        return;
+    }
+
     BOARD_COMMIT commit( m_pcbEditorFrame );
-    commit.Add( aMarker );
+
+    for( auto marker : aMarkers )
+        commit.Add( marker );
+
     commit.Push( wxEmptyString, false );
 }
 
@@ -119,10 +149,17 @@ void DRC::DestroyDRCDialog( int aReason )
 }
 
 
-DRC::DRC( PCB_EDIT_FRAME* aPcbWindow )
+DRC::DRC( PCB_EDIT_FRAME* aPcbWindow ) :
+    DRC( aPcbWindow->GetBoard() )
 {
     m_pcbEditorFrame = aPcbWindow;
-    m_pcb = aPcbWindow->GetBoard();
+}
+
+
+DRC::DRC( BOARD* aBoard )
+{
+    m_pcbEditorFrame = NULL;
+    m_pcb = aBoard;
     m_drcDialog  = NULL;
 
     // establish initial values for everything:
@@ -152,11 +189,44 @@ DRC::DRC( PCB_EDIT_FRAME* aPcbWindow )
 }
 
 
+DRC::DRC( const DRC& aParent )
+{
+    m_pcbEditorFrame = aParent.m_pcbEditorFrame;
+    m_pcb = aParent.m_pcb;
+    m_drcDialog = NULL;
+
+    m_doPad2PadTest = aParent.m_doPad2PadTest;
+    m_doUnconnectedTest = aParent.m_doUnconnectedTest;
+    m_doZonesTest = aParent.m_doZonesTest;
+    m_doKeepoutTest = aParent.m_doKeepoutTest;
+    m_doFootprintOverlapping = aParent.m_doFootprintOverlapping;
+    m_doNoCourtyardDefined = aParent.m_doNoCourtyardDefined;
+    m_abortDRC = false;
+    m_drcInProgress = false;
+    m_refillZones = aParent.m_refillZones;
+    m_reportAllTrackErrors = aParent.m_reportAllTrackErrors;
+    m_doCreateRptFile = false;
+
+    m_currentMarker = NULL;
+
+    m_segmAngle  = 0;
+    m_segmLength = 0;
+
+    m_xcliplo = 0;
+    m_ycliplo = 0;
+    m_xcliphi = 0;
+    m_ycliphi = 0;
+}
+
+
 DRC::~DRC()
 {
     // maybe someday look at pointainer.h  <- google for "pointainer.h"
     for( unsigned i = 0; i<m_unconnected.size();  ++i )
         delete m_unconnected[i];
+
+    for( auto marker : m_batchMarkers )
+        delete marker;
 }
 
 
@@ -186,8 +256,8 @@ int DRC::Drc( TRACK* aRefSegm, TRACK* aList )
 
 int DRC::TestZoneToZoneOutline( ZONE_CONTAINER* aZone, bool aCreateMarkers )
 {
-    BOARD* board = m_pcbEditorFrame->GetBoard();
-    BOARD_COMMIT commit( m_pcbEditorFrame );
+    BOARD* board = m_pcbEditorFrame ? m_pcbEditorFrame->GetBoard() : m_pcb;
+    std::vector<MARKER_PCB*> markers;
     int nerrors = 0;
 
     // iterate through all areas
@@ -328,7 +398,7 @@ int DRC::TestZoneToZoneOutline( ZONE_CONTAINER* aZone, bool aCreateMarkers )
                             wxString msg2 = zoneToTest->GetSelectMenuText();
                             MARKER_PCB* marker = new MARKER_PCB( COPPERAREA_CLOSE_TO_COPPERAREA,
                                                                  pt, msg1, pt, msg2, pt );
-                            commit.Add( marker );
+                            markers.push_back( marker );
                         }
 
                         nerrors++;
@@ -338,8 +408,7 @@ int DRC::TestZoneToZoneOutline( ZONE_CONTAINER* aZone, bool aCreateMarkers )
         }
     }
 
-    if( aCreateMarkers )
-        commit.Push( wxEmptyString, false );
+    addMarkersToPcb( markers );
 
     return nerrors;
 }
@@ -364,11 +433,25 @@ void DRC::RunTests( wxTextCtrl* aMessages )
 {
     // be sure m_pcb is the current board, not a old one
     // ( the board can be reloaded )
-    m_pcb = m_pcbEditorFrame->GetBoard();
+    if( m_pcbEditorFrame )
+        m_pcb = m_pcbEditorFrame->GetBoard();
 
     // someone should have cleared the two lists before calling this.
 
-    if( !testNetClasses() )
+    // each phase is timed, for the machine-readable reports
+    PROF_COUNTER timer;
+    m_phaseTimes.clear();
+
+    auto endPhase = [&]( const char* aPhase )
+    {
+        m_phaseTimes.emplace_back( aPhase, timer.msecs() );
+        timer.Start();
+    };
+
+    bool netclassesOk = testNetClasses();
+    endPhase( "netclasses" );
+
+    if( !netclassesOk )
     {
         // testing the netclasses is a special case because if the netclasses
         // do not pass the BOARD_DESIGN_SETTINGS checks, then every member of a net
@@ -393,6 +476,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
         }
 
         testPad2Pad();
+        endPhase( "pad_clearances" );
     }
 
     // test track and via clearances to other tracks, pads, and vias
@@ -403,6 +487,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
     }
 
     testTracks( aMessages ? aMessages->GetParent() : m_pcbEditorFrame, true );
+    endPhase( "track_clearances" );
 
     // Before testing segments and unconnected, refill all zones:
     // this is a good caution, because filled areas can be outdated.
@@ -417,8 +502,25 @@ void DRC::RunTests( wxTextCtrl* aMessages )
 
     if( m_refillZones )
     {
-        aMessages->AppendText( _( "Refilling all zones...\n" ) );
-        m_pcbEditorFrame->Fill_All_Zones( caller );
+        if( aMessages )
+            aMessages->AppendText( _( "Refilling all zones...\n" ) );
+
+        if( m_pcbEditorFrame )
+        {
+            m_pcbEditorFrame->Fill_All_Zones( caller );
+        }
+        else
+        {
+            std::vector<ZONE_CONTAINER*> zones;
+
+            for( int ii = 0; ii < m_pcb->GetAreaCount(); ii++ )
+                zones.push_back( m_pcb->GetArea( ii ) );
+
+            ZONE_FILLER filler( m_pcb );
+            filler.Fill( zones );
+        }
+
+        endPhase( "zone_fill" );
     }
 
     // test zone clearances to other zones
@@ -429,6 +531,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
     }
 
     testZones();
+    endPhase( "zones" );
 
     // find and gather unconnected pads.
     if( m_doUnconnectedTest )
@@ -440,6 +543,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
         }
 
         testUnconnected();
+        endPhase( "unconnected" );
     }
 
     // find and gather vias, tracks, pads inside keepout areas.
@@ -452,6 +556,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
         }
 
         testKeepoutAreas();
+        endPhase( "keepouts" );
     }
 
     // find and gather vias, tracks, pads inside text boxes.
@@ -462,6 +567,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
     }
 
     testTexts();
+    endPhase( "texts" );
 
     // find overlapping courtyard ares.
     if( m_doFootprintOverlapping || m_doNoCourtyardDefined )
@@ -473,6 +579,7 @@ void DRC::RunTests( wxTextCtrl* aMessages )
         }
 
         doFootprintOverlappingDrc();
+        endPhase( "courtyards" );
     }
 
     // update the m_drcDialog listboxes
@@ -496,10 +603,291 @@ void DRC::ListUnconnectedPads()
 }
 
 
+/**
+ * @return true if aErrorCode is reported by the tests run by DRC::TestChangedAreas()
+ */
+static bool isLocalTestErrorCode( int aErrorCode )
+{
+    switch( aErrorCode )
+    {
+    case DRCE_TRACK_NEAR_THROUGH_HOLE:
+    case DRCE_TRACK_NEAR_PAD:
+    case DRCE_TRACK_NEAR_VIA:
+    case DRCE_VIA_NEAR_VIA:
+    case DRCE_VIA_NEAR_TRACK:
+    case DRCE_TRACK_ENDS1:
+    case DRCE_TRACK_ENDS2:
+    case DRCE_TRACK_ENDS3:
+    case DRCE_TRACK_ENDS4:
+    case DRCE_TRACK_SEGMENTS_TOO_CLOSE:
+    case DRCE_TRACKS_CROSSING:
+    case DRCE_ENDS_PROBLEM1:
+    case DRCE_ENDS_PROBLEM2:
+    case DRCE_ENDS_PROBLEM3:
+    case DRCE_ENDS_PROBLEM4:
+    case DRCE_ENDS_PROBLEM5:
+    case DRCE_PAD_NEAR_PAD1:
+    case DRCE_VIA_HOLE_BIGGER:
+    case DRCE_MICRO_VIA_INCORRECT_LAYER_PAIR:
+    case DRCE_HOLE_NEAR_PAD:
+    case DRCE_TOO_SMALL_TRACK_WIDTH:
+    case DRCE_TOO_SMALL_VIA:
+    case DRCE_TOO_SMALL_MICROVIA:
+    case DRCE_TOO_SMALL_VIA_DRILL:
+    case DRCE_TOO_SMALL_MICROVIA_DRILL:
+    case DRCE_VIA_INSIDE_KEEPOUT:
+    case DRCE_TRACK_INSIDE_KEEPOUT:
+    case DRCE_MICRO_VIA_NOT_ALLOWED:
+    case DRCE_BURIED_VIA_NOT_ALLOWED:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+void DRC::collectRetestedItems( const std::vector<EDA_RECT>& aAreas, DRC_RTREE& aIndex,
+                                std::vector<TRACK*>& aTracks, std::vector<D_PAD*>& aPads,
+                                std::unordered_set<const BOARD_ITEM*>& aRetested )
+{
+    int              maxClearance = m_pcb->GetDesignSettings().GetBiggestClearanceValue();
+    LSET             allCu = LSET::AllCuMask();
+    std::vector<int> candidates;
+    std::vector<int> padCandidates;
+
+    // Keep the board order, so the tests are run in the same order as in RunTests()
+    aTracks.clear();
+    aPads.clear();
+
+    for( TRACK* segm = m_pcb->m_Track; segm; segm = segm->Next() )
+        aTracks.push_back( segm );
+
+    m_pcb->GetSortedPadListByXthenYCoord( aPads );
+    aIndex.Build( aTracks, aPads );
+
+    for( const EDA_RECT& area : aAreas )
+    {
+        aIndex.QueryTracks( area, allCu, candidates );
+
+        for( int ii : candidates )
+            aRetested.insert( aTracks[ii] );
+
+        aIndex.QueryPads( area, padCandidates );
+
+        for( int ii : padCandidates )
+        {
+            if( !aRetested.insert( aPads[ii] ).second )
+                continue;
+
+            // The pad tests only check the pads against each other, so the tracks close to a
+            // re-tested pad are also tested again to replace the track to pad markers of the pad
+            EDA_RECT padArea = DRC_RTREE::PadBoundingBox( aPads[ii] );
+            padArea.Inflate( maxClearance + 1 );
+
+            aIndex.QueryTracks( padArea, allCu, candidates );
+
+            for( int jj : candidates )
+                aRetested.insert( aTracks[jj] );
+        }
+    }
+}
+
+
+void DRC::GetRetestedItems( const std::vector<EDA_RECT>& aDirtyAreas,
+                            std::vector<TRACK*>& aTracks, std::vector<D_PAD*>& aPads )
+{
+    std::vector<EDA_RECT> areas = aDirtyAreas;
+    int maxClearance = m_pcb->GetDesignSettings().GetBiggestClearanceValue();
+
+    for( auto& area : areas )
+        area.Inflate( maxClearance + 1 );
+
+    std::unordered_set<const BOARD_ITEM*> retested;
+    std::vector<TRACK*> tracks;
+    std::vector<D_PAD*> pads;
+    DRC_RTREE index;
+
+    collectRetestedItems( areas, index, tracks, pads, retested );
+
+    aTracks.clear();
+    aPads.clear();
+
+    for( TRACK* segm : tracks )
+    {
+        if( retested.count( segm ) )
+            aTracks.push_back( segm );
+    }
+
+    for( D_PAD* pad : pads )
+    {
+        if( retested.count( pad ) )
+            aPads.push_back( pad );
+    }
+}
+
+
+void DRC::TestChangedAreas( const std::vector<EDA_RECT>& aDirtyAreas,
+                            const std::vector<const BOARD_ITEM*>& aRemovedItems )
+{
+    m_pcb = m_pcbEditorFrame->GetBoard();
+
+    if( aDirtyAreas.empty() && aRemovedItems.empty() )
+        return;
+
+    // Any item closer than the biggest clearance to a changed item has to be tested again
+    std::vector<EDA_RECT> areas = aDirtyAreas;
+    int maxClearance = m_pcb->GetDesignSettings().GetBiggestClearanceValue();
+
+    for( auto& area : areas )
+        area.Inflate( maxClearance + 1 );
+
+    auto isDirty = [&areas]( const EDA_RECT& aBBox ) -> bool
+    {
+        for( const auto& area : areas )
+        {
+            if( area.Intersects( aBBox ) )
+                return true;
+        }
+
+        return false;
+    };
+
+    // The index of the whole board is built once, and queried for each changed area
+    std::unordered_set<const BOARD_ITEM*> retested( aRemovedItems.begin(), aRemovedItems.end() );
+    std::vector<TRACK*> tracks;
+    std::vector<D_PAD*> pads;
+    DRC_RTREE index;
+
+    collectRetestedItems( areas, index, tracks, pads, retested );
+
+    std::vector<int> units;     // >= 0 for a track index, < 0 for -(pad index + 1)
+
+    for( int ii = 0; ii < (int) tracks.size(); ++ii )
+    {
+        if( retested.count( tracks[ii] ) )
+            units.push_back( ii );
+    }
+
+    for( int ii = 0; ii < (int) pads.size(); ++ii )
+    {
+        if( retested.count( pads[ii] ) )
+            units.push_back( -( ii + 1 ) );
+    }
+
+    // Pairs of re-tested items are tested once, from the first item of the pair.  Other
+    // pairs including one re-tested item are tested from the re-tested item.
+    auto mustTest = [&retested]( int aRef, int aOther, const BOARD_ITEM* aOtherItem ) -> bool
+    {
+        return aOther > aRef || ( aOther < aRef && !retested.count( aOtherItem ) );
+    };
+
+    std::vector<std::vector<MARKER_PCB*>> results( units.size() );
+
+    runWorkers( units.size(), [&]( DRC& aWorker, size_t aUnit )
+    {
+        std::vector<int> candidates;
+        int ref = units[aUnit];
+
+        if( ref >= 0 )
+        {
+            TRACK*              segm = tracks[ref];
+            EDA_RECT            bbox = segm->GetBoundingBox();
+            std::vector<TRACK*> trackList;
+            std::vector<D_PAD*> padList;
+
+            index.QueryTracks( bbox, segm->GetLayerSet(), candidates );
+
+            for( int jj : candidates )
+            {
+                if( mustTest( ref, jj, tracks[jj] ) )
+                    trackList.push_back( tracks[jj] );
+            }
+
+            index.QueryPads( bbox, candidates );
+
+            for( int jj : candidates )
+                padList.push_back( pads[jj] );
+
+            aWorker.doTrackDrc( segm, trackList, padList, results[aUnit] );
+
+            if( m_doKeepoutTest && !aWorker.doTrackKeepoutDrc( segm ) )
+            {
+                results[aUnit].push_back( aWorker.m_currentMarker );
+                aWorker.m_currentMarker = nullptr;
+            }
+        }
+        else if( m_doPad2PadTest )
+        {
+            ref = -ref - 1;
+            D_PAD*              pad = pads[ref];
+            std::vector<D_PAD*> padList;
+
+            index.QueryPads( DRC_RTREE::PadBoundingBox( pad ), candidates );
+
+            for( int jj : candidates )
+            {
+                if( mustTest( ref, jj, pads[jj] ) )
+                    padList.push_back( pads[jj] );
+            }
+
+            if( !padList.empty()
+                && !aWorker.doPadToPadsDrc( pad, &padList[0], &padList[0] + padList.size(),
+                                            INT_MAX ) )
+            {
+                results[aUnit].push_back( aWorker.m_currentMarker );
+                aWorker.m_currentMarker = nullptr;
+            }
+        }
+    } );
+
+    // Replace the markers of the re-tested items.  Markers without items (i.e. read from
+    // a file) are replaced if they are in a changed area.
+    BOARD_COMMIT commit( m_pcbEditorFrame );
+    std::vector<MARKER_PCB*> staleMarkers;
+
+    for( int ii = 0; ii < m_pcb->GetMARKERCount(); ++ii )
+    {
+        MARKER_PCB* marker = m_pcb->GetMARKER( ii );
+
+        if( !isLocalTestErrorCode( marker->GetReporter().GetErrorCode() ) )
+            continue;
+
+        bool stale;
+
+        if( marker->GetItem() || marker->GetAuxItem() )
+            stale = retested.count( marker->GetItem() ) || retested.count( marker->GetAuxItem() );
+        else
+            stale = isDirty( EDA_RECT( marker->GetPosition(), wxSize( 0, 0 ) ) );
+
+        if( stale )
+        {
+            staleMarkers.push_back( marker );
+            commit.Remove( marker );
+        }
+    }
+
+    for( auto& markers : results )
+    {
+        for( auto marker : markers )
+            commit.Add( marker );
+    }
+
+    commit.Push( wxEmptyString, false );
+
+    for( auto marker : staleMarkers )
+        delete marker;
+
+    // update the m_drcDialog listboxes
+    updatePointers();
+}
+
+
 void DRC::updatePointers()
 {
     // update my pointers, m_pcbEditorFrame is the only unchangeable one
-    m_pcb = m_pcbEditorFrame->GetBoard();
+    if( m_pcbEditorFrame )
+        m_pcb = m_pcbEditorFrame->GetBoard();
 
     if( m_drcDialog )  // Use diag list boxes only in DRC dialog
     {
@@ -626,43 +1014,96 @@ bool DRC::testNetClasses()
 }
 
 
-void DRC::testPad2Pad()
+void DRC::runWorkers( size_t aUnitCount,
+                      const std::function<void( DRC& aWorker, size_t aUnit )>& aUnitFunc,
+                      const std::function<bool( size_t aUnitsDone )>& aReportProgress )
 {
-    std::vector<D_PAD*> sortedPads;
+    if( aUnitCount == 0 )
+        return;
 
-    m_pcb->GetSortedPadListByXthenYCoord( sortedPads );
+    THREAD_POOL& pool = THREAD_POOL::Instance();
+    size_t workerCount = std::min( pool.GetThreadCount(), aUnitCount );
 
-    // find the max size of the pads (used to stop the test)
-    int max_size = 0;
+    std::atomic_size_t  next( 0 );
+    std::atomic_size_t  unitsDone( 0 );
+    std::atomic_bool    cancelled( false );
 
-    for( unsigned i = 0; i < sortedPads.size(); ++i )
+    // One worker DRC per pool slot, each one claiming units until none are left
+    auto runWorker = [&]( size_t aSlot )
     {
-        D_PAD* pad = sortedPads[i];
+        DRC worker( *this );
 
-        // GetBoundingRadius() is the radius of the minimum sized circle fully containing the pad
-        int radius = pad->GetBoundingRadius();
+        for( size_t i = next.fetch_add( 1 ); i < aUnitCount && !cancelled; i = next.fetch_add( 1 ) )
+        {
+            aUnitFunc( worker, i );
+            unitsDone.fetch_add( 1 );
+        }
+    };
 
-        if( radius > max_size )
-            max_size = radius;
+    std::function<bool()> refresh;
+
+    if( aReportProgress )
+    {
+        refresh = [&]() -> bool
+        {
+            if( !cancelled && !aReportProgress( unitsDone.load() ) )
+                cancelled = true;
+
+            return !cancelled;
+        };
     }
 
-    // Test the pads
-    D_PAD** listEnd = &sortedPads[ sortedPads.size() ];
+    pool.ParallelFor( workerCount, runWorker, refresh, &cancelled );
+}
+
+
+void DRC::testPad2Pad()
+{
+    std::vector<D_PAD*> sortedPads;
+
+    m_pcb->GetSortedPadListByXthenYCoord( sortedPads );
+
+    // The index gives the pads near each pad, in sortedPads order.  Each pair of pads is
+    // tested once, from the first pad of the pair in this order.
+    DRC_RTREE index;
+    index.Build( std::vector<TRACK*>(), sortedPads );
 
-    for( unsigned i = 0; i< sortedPads.size(); ++i )
+    std::vector<MARKER_PCB*> results( sortedPads.size(), nullptr );
+
+    runWorkers( sortedPads.size(), [&]( DRC& aWorker, size_t aUnit )
     {
-        D_PAD* pad = sortedPads[i];
+        D_PAD* pad = sortedPads[aUnit];
+        std::vector<int> candidates;
+        std::vector<D_PAD*> pads;
 
-        int    x_limit = max_size + pad->GetClearance() +
-                         pad->GetBoundingRadius() + pad->GetPosition().x;
+        index.QueryPads( DRC_RTREE::PadBoundingBox( pad ), candidates );
 
-        if( !doPadToPadsDrc( pad, &sortedPads[i], listEnd, x_limit ) )
+        for( int ii : candidates )
         {
-            wxASSERT( m_currentMarker );
-            addMarkerToPcb ( m_currentMarker );
-            m_currentMarker = nullptr;
+            if( ii > (int) aUnit )
+                pads.push_back( sortedPads[ii] );
         }
+
+        if( pads.empty() )
+            return;
+
+        if( !aWorker.doPadToPadsDrc( pad, &pads[0], &pads[0] + pads.size(), INT_MAX ) )
+        {
+            wxASSERT( aWorker.m_currentMarker );
+            results[aUnit] = aWorker.m_currentMarker;
+            aWorker.m_currentMarker = nullptr;
+        }
+    } );
+
+    std::vector<MARKER_PCB*> markers;
+
+    for( auto marker : results )
+    {
+        if( marker )
+            markers.push_back( marker );
     }
+
+    addMarkersToPcb( markers );
 }
 
 
@@ -671,14 +1112,52 @@ void DRC::testTracks( wxWindow *aActiveWindow, bool aShowProgressBar )
     wxProgressDialog * progressDialog = NULL;
     const int delta = 500;  // This is the number of tests between 2 calls to the
                             // progress bar
-    int count = 0;
 
-    for( TRACK* segm = m_pcb->m_Track; segm && segm->Next(); segm = segm->Next() )
-        count++;
+    std::vector<TRACK*> tracks;
+    EDA_RECT            bounds;
+
+    for( TRACK* segm = m_pcb->m_Track; segm; segm = segm->Next() )
+    {
+        if( tracks.empty() )
+            bounds = EDA_RECT( segm->GetStart(), wxSize( 0, 0 ) );
+        else
+            bounds.Merge( segm->GetStart() );
+
+        tracks.push_back( segm );
+    }
+
+    if( tracks.empty() )
+        return;
+
+    std::vector<D_PAD*> pads = m_pcb->GetPads();
+
+    DRC_RTREE index;
+    index.Build( tracks, pads );
+
+    // Split the board in tiles holding s_drcTileItemCount tracks on average.  The
+    // tracks are assigned to a tile from their start point, and each tile is a work unit
+    // for runWorkers(), so nearby segments are tested by the same thread.
+    int tileCountPerAxis = KiROUND( sqrt( (double) tracks.size() / s_drcTileItemCount ) );
+    tileCountPerAxis = std::max( tileCountPerAxis, 1 );
+
+    int tileSizeX = std::max( bounds.GetWidth() / tileCountPerAxis + 1, 1 );
+    int tileSizeY = std::max( bounds.GetHeight() / tileCountPerAxis + 1, 1 );
 
-    int deltamax = count/delta;
+    std::vector<std::vector<int>> tiles( tileCountPerAxis * tileCountPerAxis );
 
-    if( aShowProgressBar && deltamax > 3 )
+    for( int ii = 0; ii < (int) tracks.size(); ++ii )
+    {
+        wxPoint pos = tracks[ii]->GetStart() - bounds.GetOrigin();
+        int tx = std::min( pos.x / tileSizeX, tileCountPerAxis - 1 );
+        int ty = std::min( pos.y / tileSizeY, tileCountPerAxis - 1 );
+
+        tiles[ ty * tileCountPerAxis + tx ].push_back( ii );
+    }
+
+    int deltamax = tracks.size() / delta;
+
+    // No progress bar in batch mode
+    if( aShowProgressBar && aActiveWindow && deltamax > 3 )
     {
         // Do not use wxPD_APP_MODAL style here: it is not necessary and create issues
         // on OSX
@@ -688,37 +1167,70 @@ void DRC::testTracks( wxWindow *aActiveWindow, bool aShowProgressBar )
         progressDialog->Update( 0, wxEmptyString );
     }
 
-    int ii = 0;
-    count = 0;
+    std::vector<std::vector<MARKER_PCB*>> results( tracks.size() );
+    std::atomic_size_t tracksDone( 0 );
 
-    for( TRACK* segm = m_pcb->m_Track; segm; segm = segm->Next() )
+    auto testTile = [&]( DRC& aWorker, size_t aTile )
     {
-        if( ii++ > delta )
+        std::vector<int>    candidates;
+        std::vector<TRACK*> trackList;
+        std::vector<D_PAD*> padList;
+
+        for( int ii : tiles[aTile] )
         {
-            ii = 0;
-            count++;
+            TRACK*   segm = tracks[ii];
+            EDA_RECT bbox = segm->GetBoundingBox();
 
-            if( progressDialog )
-            {
-                if( !progressDialog->Update( count, wxEmptyString ) )
-                    break;  // Aborted by user
-#ifdef __WXMAC__
-                // Work around a dialog z-order issue on OS X
-                if( count == deltamax )
-                    aActiveWindow->Raise();
-#endif
-            }
-        }
+            // Each pair of tracks is tested once, from the first track of the pair
+            // in the board track list
+            index.QueryTracks( bbox, segm->GetLayerSet(), candidates );
+            trackList.clear();
 
-        if( !doTrackDrc( segm, segm->Next(), true ) )
-        {
-            if( m_currentMarker )
+            for( int jj : candidates )
             {
-                addMarkerToPcb ( m_currentMarker );
-                m_currentMarker = nullptr;
+                if( jj > ii )
+                    trackList.push_back( tracks[jj] );
             }
+
+            index.QueryPads( bbox, candidates );
+            padList.clear();
+
+            for( int jj : candidates )
+                padList.push_back( pads[jj] );
+
+            aWorker.doTrackDrc( segm, trackList, padList, results[ii] );
+            tracksDone.fetch_add( 1 );
         }
-    }
+    };
+
+    auto reportProgress = [&]( size_t aTilesDone ) -> bool
+    {
+        int count = tracksDone.load() / delta;
+
+        if( !progressDialog->Update( std::min( count, deltamax ), wxEmptyString ) )
+            return false;   // Aborted by user
+
+#ifdef __WXMAC__
+        // Work around a dialog z-order issue on OS X
+        if( count == deltamax )
+            aActiveWindow->Raise();
+#endif
+        return true;
+    };
+
+    if( progressDialog )
+        runWorkers( tiles.size(), testTile, reportProgress );
+    else
+        runWorkers( tiles.size(), testTile );
+
+    // Add the markers in the order of the track list, so the result does not depend on
+    // the tiling or on the thread scheduling
+    std::vector<MARKER_PCB*> markers;
+
+    for( auto& trackMarkers : results )
+        markers.insert( markers.end(), trackMarkers.begin(), trackMarkers.end() );
+
+    addMarkersToPcb( markers );
 
     if( progressDialog )
         progressDialog->Destroy();
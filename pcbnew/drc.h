@@ -31,6 +31,9 @@
 
 #include <vector>
 #include <memory>
+#include <unordered_set>
+#include <functional>
+#include <string>
 
 #define OK_DRC  0
 #define BAD_DRC 1
@@ -103,6 +106,8 @@ class TRACK;
 class MARKER_PCB;
 class DRC_ITEM;
 class NETCLASS;
+class DRC_RTREE;
+class EDA_RECT;
 
 
 /**
@@ -151,6 +156,14 @@ public:
 typedef std::vector<DRC_ITEM*> DRC_LIST;
 
 
+/// Formats of the machine-readable reports written by DRC::WriteReport()
+enum DRC_REPORT_FORMAT
+{
+    DRC_REPORT_SEXPR,
+    DRC_REPORT_JSON
+};
+
+
 /**
  * Design Rule Checker object that performs all the DRC tests.  The output of
  * the checking goes to the BOARD file in the form of two MARKER lists.  Those
@@ -212,12 +225,54 @@ private:
 
     DRC_LIST            m_unconnected;      ///< list of unconnected pads, as DRC_ITEMs
 
+    ///< In batch mode (no editor frame), the markers are kept here instead of the board
+    std::vector<MARKER_PCB*> m_batchMarkers;
+
+    ///< Name and duration (in ms) of each phase of the last RunTests()
+    std::vector<std::pair<std::string, double>> m_phaseTimes;
+
+
+    /**
+     * Create a worker DRC for the parallel tests: it shares the board, the editor frame
+     * and the test settings of aParent, but has its own per-segment working variables
+     * and starts with no marker and no unconnected item.
+     */
+    DRC( const DRC& aParent );
 
     /**
      * Update needed pointers from the one pointer which is known not to change.
      */
     void updatePointers();
 
+    /**
+     * Run aUnitFunc for each work unit in [0, aUnitCount) on a set of worker threads.
+     * Each thread owns a worker DRC (see the copy constructor), passed to aUnitFunc,
+     * so the tests can use the per-segment working variables safely.
+     * aUnitFunc must only store its results in per-unit slots; merging them in unit
+     * order keeps the DRC output independent of the thread scheduling.
+     *
+     * @param aUnitCount is the number of work units.
+     * @param aUnitFunc is the function testing one unit.
+     * @param aReportProgress, if not null, is called periodically from the calling thread
+     *                        with the number of finished units.  It returns false to abort.
+     */
+    void runWorkers( size_t aUnitCount,
+                     const std::function<void( DRC& aWorker, size_t aUnit )>& aUnitFunc,
+                     const std::function<bool( size_t aUnitsDone )>& aReportProgress = nullptr );
+
+    /**
+     * Index all the tracks and pads of the board, and add to aRetested the ones which
+     * TestChangedAreas() tests again for aAreas (already inflated by the biggest clearance).
+     * The index is queried once per area and once per re-tested pad.
+     *
+     * @param aIndex receives the index of aTracks and aPads.
+     * @param aTracks receives the tracks of the board, in board order.
+     * @param aPads receives the pads of the board, sorted by position.
+     */
+    void collectRetestedItems( const std::vector<EDA_RECT>& aAreas, DRC_RTREE& aIndex,
+                               std::vector<TRACK*>& aTracks, std::vector<D_PAD*>& aPads,
+                               std::unordered_set<const BOARD_ITEM*>& aRetested );
+
 
     /**
      * Creates a marker and fills it in with information but does not add it to the BOARD.
@@ -269,6 +324,12 @@ private:
      */
     void addMarkerToPcb( MARKER_PCB* aMarker );
 
+    /**
+     * Adds DRC markers to the PCB through a single COMMIT.
+     * In batch mode, the markers are stored in m_batchMarkers and the board is not modified.
+     */
+    void addMarkersToPcb( const std::vector<MARKER_PCB*>& aMarkers );
+
     //-----<categorical group tests>-----------------------------------------
 
     /**
@@ -285,6 +346,9 @@ private:
     /**
      * Perform the DRC on all tracks.
      *
+     * The tracks and pads are stored in a DRC_RTREE, and the board is split in tiles
+     * tested in parallel.  Markers are added to the board in the track list order.
+     *
      * This test can take a while, a progress bar can be displayed
      * @param aActiveWindow = the active window ued as parent for the progress bar
      * @param aShowProgressBar = true to show a progress bar
@@ -309,7 +373,7 @@ private:
     /**
      * Test the clearance between aRefPad and other pads.
      *
-     * The pad list must be sorted by x coordinate.
+     * The pad list must be sorted by x coordinate, or x_limit must be INT_MAX.
      *
      * @param aRefPad The pad to test
      * @param aStart The start of the pad list to test against
@@ -324,11 +388,24 @@ private:
      * @param aRefSeg The segment to test
      * @param aStart The head of a list of tracks to test against (usually BOARD::m_Track)
      * @param doPads true if should do pads test
-     * @return bool - true if no problems, else false and m_currentMarker is
-     *          filled in with the problem information.
+     * @return bool - true if no problems, else false and the markers describing
+     *          the problems are added to the board.
      */
     bool doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool doPads = true );
 
+    /**
+     * Test the current segment against a list of candidate tracks and pads.
+     * Does not modify the board, and can therefore be run from a worker thread.
+     *
+     * @param aRefSeg The segment to test
+     * @param aTracks The tracks to test against
+     * @param aPads The pads to test against (pads and pad holes)
+     * @param aMarkers The markers describing the problems found are appended to this list
+     * @return bool - true if no problems, else false
+     */
+    bool doTrackDrc( TRACK* aRefSeg, const std::vector<TRACK*>& aTracks,
+                     const std::vector<D_PAD*>& aPads, std::vector<MARKER_PCB*>& aMarkers );
+
     /**
      * Test the current segment or via.
      *
@@ -414,6 +491,13 @@ private:
 public:
     DRC( PCB_EDIT_FRAME* aPcbWindow );
 
+    /**
+     * Create a DRC for aBoard without any editor frame (batch mode), for instance to run
+     * the tests from a script.  In this mode the markers are not added to the board: they
+     * are only available through WriteReport().
+     */
+    DRC( BOARD* aBoard );
+
     ~DRC();
 
     /**
@@ -538,6 +622,49 @@ public:
      */
     void ListUnconnectedPads();
 
+    /**
+     * Run the track, via, pad and keepout tests again on the items close to some changed
+     * areas of the board, typically after a BOARD_COMMIT.
+     *
+     * The markers created by these tests for the re-tested items or for the removed items
+     * are replaced by the new results.  All other markers are kept.
+     *
+     * @param aDirtyAreas are the bounding boxes (before and after the change) of the
+     *                    changed items.
+     * @param aRemovedItems are the items which have been removed from the board.
+     */
+    void TestChangedAreas( const std::vector<EDA_RECT>& aDirtyAreas,
+                           const std::vector<const BOARD_ITEM*>& aRemovedItems );
+
+    /**
+     * Find the tracks and pads which TestChangedAreas() tests again for aDirtyAreas: the
+     * items closer than the biggest clearance to one of the areas, and the tracks close to
+     * one of these pads.
+     *
+     * @param aTracks receives the tracks, in board order.
+     * @param aPads receives the pads, in the order of BOARD::GetSortedPadListByXthenYCoord().
+     */
+    void GetRetestedItems( const std::vector<EDA_RECT>& aDirtyAreas,
+                           std::vector<TRACK*>& aTracks, std::vector<D_PAD*>& aPads );
+
+    /**
+     * Write the markers and the unconnected items found by the last tests, with the
+     * duration of each test phase, to a machine-readable file.
+     *
+     * @param aFullFileName is the name of the report file.
+     * @param aFormat is the file format.
+     * @return true if the file was written.
+     */
+    bool WriteReport( const wxString& aFullFileName, DRC_REPORT_FORMAT aFormat ) const;
+
+    /**
+     * @return the name and duration (in ms) of each phase of the last RunTests()
+     */
+    const std::vector<std::pair<std::string, double>>& GetPhaseTimes() const
+    {
+        return m_phaseTimes;
+    }
+
     /**
      * @return a pointer to the current marker (last created marker
      */
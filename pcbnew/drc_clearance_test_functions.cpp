@@ -137,36 +137,39 @@ bool convex2pointDRC( wxPoint* aTref, int aTrefCount, wxPoint aPcompare, int aDi
 
 bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 {
-    TRACK*    track;
+    std::vector<TRACK*>      tracks;
+    std::vector<D_PAD*>      pads;
+    std::vector<MARKER_PCB*> markers;
+
+    for( TRACK* track = aStart; track; track = track->Next() )
+        tracks.push_back( track );
+
+    if( testPads )
+        pads = m_pcb->GetPads();
+
+    if( doTrackDrc( aRefSeg, tracks, pads, markers ) )
+        return true;
+
+    addMarkersToPcb( markers );
+
+    return false;
+}
+
+
+bool DRC::doTrackDrc( TRACK* aRefSeg, const std::vector<TRACK*>& aTracks,
+                      const std::vector<D_PAD*>& aPads, std::vector<MARKER_PCB*>& aMarkers )
+{
     wxPoint   delta;           // length on X and Y axis of segments
     LSET layerMask;
     int       net_code_ref;
     wxPoint   shape_pos;
 
-    std::vector<MARKER_PCB*> markers;
-
-    auto commitMarkers = [&]()
-    {
-        BOARD_COMMIT commit( m_pcbEditorFrame );
-
-        for( auto marker : markers )
-            commit.Add( marker );
-
-        commit.Push( wxEmptyString, false );
-    };
+    const size_t initialMarkerCount = aMarkers.size();
 
     // Returns false if we should return false from call site, or true to continue
     auto handleNewMarker = [&]() -> bool
     {
-        if( !m_reportAllTrackErrors )
-        {
-            if( markers.size() > 0 )
-                commitMarkers();
-
-            return false;
-        }
-        else
-            return true;
+        return m_reportAllTrackErrors;
     };
 
     NETCLASSPTR netclass = aRefSeg->GetNetClass();
@@ -192,16 +195,16 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         {
             if( refvia->GetWidth() < dsnSettings.m_MicroViasMinSize )
             {
-                markers.push_back( fillMarker( refvia, nullptr,
-                                               DRCE_TOO_SMALL_MICROVIA, nullptr ) );
+                aMarkers.push_back( fillMarker( refvia, nullptr,
+                                                DRCE_TOO_SMALL_MICROVIA, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
 
             if( refvia->GetDrillValue() < dsnSettings.m_MicroViasMinDrill )
             {
-                markers.push_back( fillMarker( refvia, nullptr,
-                                               DRCE_TOO_SMALL_MICROVIA_DRILL, nullptr ) );
+                aMarkers.push_back( fillMarker( refvia, nullptr,
+                                                DRCE_TOO_SMALL_MICROVIA_DRILL, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -210,16 +213,16 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         {
             if( refvia->GetWidth() < dsnSettings.m_ViasMinSize )
             {
-                markers.push_back( fillMarker( refvia, nullptr,
-                                               DRCE_TOO_SMALL_VIA, nullptr ) );
+                aMarkers.push_back( fillMarker( refvia, nullptr,
+                                                DRCE_TOO_SMALL_VIA, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
 
             if( refvia->GetDrillValue() < dsnSettings.m_ViasMinDrill )
             {
-                markers.push_back( fillMarker( refvia, nullptr,
-                                               DRCE_TOO_SMALL_VIA_DRILL, nullptr ) );
+                aMarkers.push_back( fillMarker( refvia, nullptr,
+                                                DRCE_TOO_SMALL_VIA_DRILL, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -230,8 +233,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         // and a default via hole can be bigger than some vias sizes
         if( refvia->GetDrillValue() > refvia->GetWidth() )
         {
-            markers.push_back( fillMarker( refvia, nullptr,
-                                           DRCE_VIA_HOLE_BIGGER, nullptr ) );
+            aMarkers.push_back( fillMarker( refvia, nullptr,
+                                            DRCE_VIA_HOLE_BIGGER, nullptr ) );
             if( !handleNewMarker() )
                 return false;
         }
@@ -240,8 +243,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         if( ( refvia->GetViaType() == VIA_MICROVIA ) &&
             ( m_pcb->GetDesignSettings().m_MicroViasAllowed == false ) )
         {
-            markers.push_back( fillMarker( refvia, nullptr,
-                                           DRCE_MICRO_VIA_NOT_ALLOWED, nullptr ) );
+            aMarkers.push_back( fillMarker( refvia, nullptr,
+                                            DRCE_MICRO_VIA_NOT_ALLOWED, nullptr ) );
             if( !handleNewMarker() )
                 return false;
         }
@@ -250,8 +253,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         if( ( refvia->GetViaType() == VIA_BLIND_BURIED ) &&
             ( m_pcb->GetDesignSettings().m_BlindBuriedViaAllowed == false ) )
         {
-            markers.push_back( fillMarker( refvia, nullptr,
-                                           DRCE_BURIED_VIA_NOT_ALLOWED, nullptr ) );
+            aMarkers.push_back( fillMarker( refvia, nullptr,
+                                            DRCE_BURIED_VIA_NOT_ALLOWED, nullptr ) );
             if( !handleNewMarker() )
                 return false;
         }
@@ -276,8 +279,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 
             if( err )
             {
-                markers.push_back( fillMarker( refvia, nullptr,
-                                               DRCE_MICRO_VIA_INCORRECT_LAYER_PAIR, nullptr ) );
+                aMarkers.push_back( fillMarker( refvia, nullptr,
+                                                DRCE_MICRO_VIA_INCORRECT_LAYER_PAIR, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -288,8 +291,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
     {
         if( aRefSeg->GetWidth() < dsnSettings.m_TrackMinWidth )
         {
-            markers.push_back( fillMarker( aRefSeg, nullptr,
-                                           DRCE_TOO_SMALL_TRACK_WIDTH, nullptr ) );
+            aMarkers.push_back( fillMarker( aRefSeg, nullptr,
+                                            DRCE_TOO_SMALL_TRACK_WIDTH, nullptr ) );
             if( !handleNewMarker() )
                 return false;
         }
@@ -327,67 +330,58 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
     dummypad.SetLayerSet( LSET::AllCuMask() );     // Ensure the hole is on all layers
 
     // Compute the min distance to pads
-    if( testPads )
+    for( D_PAD* pad : aPads )
     {
-        unsigned pad_count = m_pcb->GetPadCount();
-
-        auto pads = m_pcb->GetPads();
-
-        for( unsigned ii = 0; ii < pad_count; ++ii )
+        /* No problem if pads are on an other layer,
+         * But if a drill hole exists	(a pad on a single layer can have a hole!)
+         * we must test the hole
+         */
+        if( !( pad->GetLayerSet() & layerMask ).any() )
         {
-            D_PAD* pad = pads[ii];
-
-            /* No problem if pads are on an other layer,
-             * But if a drill hole exists	(a pad on a single layer can have a hole!)
-             * we must test the hole
+            /* We must test the pad hole. In order to use the function
+             * checkClearanceSegmToPad(),a pseudo pad is used, with a shape and a
+             * size like the hole
              */
-            if( !( pad->GetLayerSet() & layerMask ).any() )
-            {
-                /* We must test the pad hole. In order to use the function
-                 * checkClearanceSegmToPad(),a pseudo pad is used, with a shape and a
-                 * size like the hole
-                 */
-                if( pad->GetDrillSize().x == 0 )
-                    continue;
-
-                dummypad.SetSize( pad->GetDrillSize() );
-                dummypad.SetPosition( pad->GetPosition() );
-                dummypad.SetShape( pad->GetDrillShape() == PAD_DRILL_SHAPE_OBLONG ?
-                                   PAD_SHAPE_OVAL : PAD_SHAPE_CIRCLE );
-                dummypad.SetOrientation( pad->GetOrientation() );
-
-                m_padToTestPos = dummypad.GetPosition() - origin;
-
-                if( !checkClearanceSegmToPad( &dummypad, aRefSeg->GetWidth(),
-                                              netclass->GetClearance() ) )
-                {
-                    markers.push_back( fillMarker( aRefSeg, pad,
-                                                   DRCE_TRACK_NEAR_THROUGH_HOLE, nullptr ) );
-                    if( !handleNewMarker() )
-                        return false;
-                }
-
+            if( pad->GetDrillSize().x == 0 )
                 continue;
-            }
 
-            // The pad must be in a net (i.e pt_pad->GetNet() != 0 )
-            // but no problem if the pad netcode is the current netcode (same net)
-            if( pad->GetNetCode()                       // the pad must be connected
-               && net_code_ref == pad->GetNetCode() )   // the pad net is the same as current net -> Ok
-                continue;
+            dummypad.SetSize( pad->GetDrillSize() );
+            dummypad.SetPosition( pad->GetPosition() );
+            dummypad.SetShape( pad->GetDrillShape() == PAD_DRILL_SHAPE_OBLONG ?
+                               PAD_SHAPE_OVAL : PAD_SHAPE_CIRCLE );
+            dummypad.SetOrientation( pad->GetOrientation() );
 
-            // DRC for the pad
-            shape_pos = pad->ShapePos();
-            m_padToTestPos = shape_pos - origin;
+            m_padToTestPos = dummypad.GetPosition() - origin;
 
-            if( !checkClearanceSegmToPad( pad, aRefSeg->GetWidth(),
-                                          aRefSeg->GetClearance( pad ) ) )
+            if( !checkClearanceSegmToPad( &dummypad, aRefSeg->GetWidth(),
+                                          netclass->GetClearance() ) )
             {
-                markers.push_back( fillMarker( aRefSeg, pad,
-                                               DRCE_TRACK_NEAR_PAD, nullptr ) );
+                aMarkers.push_back( fillMarker( aRefSeg, pad,
+                                                DRCE_TRACK_NEAR_THROUGH_HOLE, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
+
+            continue;
+        }
+
+        // The pad must be in a net (i.e pt_pad->GetNet() != 0 )
+        // but no problem if the pad netcode is the current netcode (same net)
+        if( pad->GetNetCode()                       // the pad must be connected
+           && net_code_ref == pad->GetNetCode() )   // the pad net is the same as current net -> Ok
+            continue;
+
+        // DRC for the pad
+        shape_pos = pad->ShapePos();
+        m_padToTestPos = shape_pos - origin;
+
+        if( !checkClearanceSegmToPad( pad, aRefSeg->GetWidth(),
+                                      aRefSeg->GetClearance( pad ) ) )
+        {
+            aMarkers.push_back( fillMarker( aRefSeg, pad,
+                                            DRCE_TRACK_NEAR_PAD, nullptr ) );
+            if( !handleNewMarker() )
+                return false;
         }
     }
 
@@ -401,7 +395,7 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
     wxPoint segStartPoint;
     wxPoint segEndPoint;
 
-    for( track = aStart; track; track = track->Next() )
+    for( TRACK* track : aTracks )
     {
         // No problem if segments have the same net code:
         if( net_code_ref == track->GetNetCode() )
@@ -434,8 +428,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
                 // Test distance between two vias, i.e. two circles, trivial case
                 if( EuclideanNorm( segStartPoint ) < w_dist )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_VIA_NEAR_VIA, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_VIA_NEAR_VIA, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
@@ -451,8 +445,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 
                 if( !checkMarginToCircle( segStartPoint, w_dist, delta.x ) )
                 {
-                    markers.push_back( fillMarker( track, aRefSeg,
-                                                   DRCE_VIA_NEAR_TRACK, nullptr ) );
+                    aMarkers.push_back( fillMarker( track, aRefSeg,
+                                                    DRCE_VIA_NEAR_TRACK, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
@@ -475,8 +469,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
             if( checkMarginToCircle( segStartPoint, w_dist, m_segmLength ) )
                 continue;
 
-            markers.push_back( fillMarker( aRefSeg, track,
-                                           DRCE_TRACK_NEAR_VIA, nullptr ) );
+            aMarkers.push_back( fillMarker( aRefSeg, track,
+                                            DRCE_TRACK_NEAR_VIA, nullptr ) );
             if( !handleNewMarker() )
                 return false;
         }
@@ -503,16 +497,16 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
                 // Fine test : we consider the rounded shape of each end of the track segment:
                 if( segStartPoint.x >= 0 && segStartPoint.x <= m_segmLength )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_TRACK_ENDS1, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_TRACK_ENDS1, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
 
                 if( !checkMarginToCircle( segStartPoint, w_dist, m_segmLength ) )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_TRACK_ENDS2, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_TRACK_ENDS2, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
@@ -526,16 +520,16 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
                 // Fine test : we consider the rounded shape of the ends
                 if( segEndPoint.x >= 0 && segEndPoint.x <= m_segmLength )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_TRACK_ENDS3, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_TRACK_ENDS3, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
 
                 if( !checkMarginToCircle( segEndPoint, w_dist, m_segmLength ) )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_TRACK_ENDS4, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_TRACK_ENDS4, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
@@ -548,8 +542,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
             // handled)
             //  X.............X
             //    O--REF--+
-                markers.push_back( fillMarker( aRefSeg, track,
-                                               DRCE_TRACK_SEGMENTS_TOO_CLOSE, nullptr ) );
+                aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                DRCE_TRACK_SEGMENTS_TOO_CLOSE, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -565,8 +559,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 
             if( ( segStartPoint.y < 0 ) && ( segEndPoint.y > 0 ) )
             {
-                markers.push_back( fillMarker( aRefSeg, track,
-                                               DRCE_TRACKS_CROSSING, nullptr ) );
+                aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                DRCE_TRACKS_CROSSING, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -574,15 +568,15 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
             // At this point the drc error is due to an end near a reference segm end
             if( !checkMarginToCircle( segStartPoint, w_dist, m_segmLength ) )
             {
-                markers.push_back( fillMarker( aRefSeg, track,
-                                               DRCE_ENDS_PROBLEM1, nullptr ) );
+                aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                DRCE_ENDS_PROBLEM1, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
             if( !checkMarginToCircle( segEndPoint, w_dist, m_segmLength ) )
             {
-                markers.push_back( fillMarker( aRefSeg, track,
-                                               DRCE_ENDS_PROBLEM2, nullptr ) );
+                aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                DRCE_ENDS_PROBLEM2, nullptr ) );
                 if( !handleNewMarker() )
                     return false;
             }
@@ -610,8 +604,8 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 
                 if( !checkLine( segStartPoint, segEndPoint ) )
                 {
-                    markers.push_back( fillMarker( aRefSeg, track,
-                                                   DRCE_ENDS_PROBLEM3, nullptr ) );
+                    aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                    DRCE_ENDS_PROBLEM3, nullptr ) );
                     if( !handleNewMarker() )
                         return false;
                 }
@@ -639,16 +633,16 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
 
                     if( !checkMarginToCircle( relStartPos, w_dist, delta.x ) )
                     {
-                        markers.push_back( fillMarker( aRefSeg, track,
-                                                       DRCE_ENDS_PROBLEM4, nullptr ) );
+                        aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                        DRCE_ENDS_PROBLEM4, nullptr ) );
                         if( !handleNewMarker() )
                             return false;
                     }
 
                     if( !checkMarginToCircle( relEndPos, w_dist, delta.x ) )
                     {
-                        markers.push_back( fillMarker( aRefSeg, track,
-                                                       DRCE_ENDS_PROBLEM5, nullptr ) );
+                        aMarkers.push_back( fillMarker( aRefSeg, track,
+                                                        DRCE_ENDS_PROBLEM5, nullptr ) );
                         if( !handleNewMarker() )
                             return false;
                     }
@@ -657,13 +651,7 @@ bool DRC::doTrackDrc( TRACK* aRefSeg, TRACK* aStart, bool testPads )
         }
     }
 
-    if( markers.size() > 0 )
-    {
-        commitMarkers();
-        return false;
-    }
-    else
-        return true;
+    return aMarkers.size() == initialMarkerCount;
 }
 
 
@@ -680,7 +668,7 @@ bool DRC::doEdgeZoneDrc( ZONE_CONTAINER* aArea, int aCornerIndex )
 
     // Retrieve the selected contour
     SHAPE_LINE_CHAIN contour;
-    contour = aArea->Outline()->Polygon( index.m_polygon )[index.m_contour];
+    contour = aArea->Outline()->CPolygon( index.m_polygon )[index.m_contour];
 
     // Retrieve the segment that starts at aCornerIndex-th corner.
     SEG selectedSegment = contour.Segment( index.m_vertex );
@@ -0,0 +1,225 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * @file drc_report.cpp
+ * Machine-readable (s-expression or JSON) DRC reports, for the batch mode DRC.
+ */
+
+#include <fctsys.h>
+#include <common.h>
+#include <richio.h>
+#include <convert_to_biu.h>
+#include <class_board.h>
+#include <class_marker_pcb.h>
+#include <drc.h>
+#include <drc_item.h>
+
+#include <wx/datetime.h>
+
+
+/**
+ * @return aText as a quoted JSON string.
+ */
+static std::string jsonQuoted( const wxString& aText )
+{
+    std::string utf8 = TO_UTF8( aText );
+    std::string ret = "\"";
+
+    for( char c : utf8 )
+    {
+        switch( c )
+        {
+        case '"':  ret += "\\\"";  break;
+        case '\\': ret += "\\\\";  break;
+        case '\n': ret += "\\n";   break;
+        case '\r': ret += "\\r";   break;
+        case '\t': ret += "\\t";   break;
+
+        default:
+            if( (unsigned char) c < 0x20 )
+            {
+                char buf[8];
+                snprintf( buf, sizeof( buf ), "\\u%04x", c );
+                ret += buf;
+            }
+            else
+            {
+                ret += c;
+            }
+        }
+    }
+
+    ret += '"';
+
+    return ret;
+}
+
+
+static void formatSexprItems( OUTPUTFORMATTER& aOut, int aNestLevel, const char* aListName,
+                              const char* aItemName, const std::vector<const DRC_ITEM*>& aItems )
+{
+    aOut.Print( aNestLevel, "(%s (count %d)\n", aListName, (int) aItems.size() );
+
+    for( const DRC_ITEM* item : aItems )
+    {
+        aOut.Print( aNestLevel + 1, "(%s (code %d) (description %s)\n", aItemName,
+                    item->GetErrorCode(), aOut.Quotew( item->GetErrorText() ).c_str() );
+
+        aOut.Print( aNestLevel + 2, "(item (pos %.6f %.6f) (text %s))",
+                    Iu2Millimeter( item->GetPointA().x ), Iu2Millimeter( item->GetPointA().y ),
+                    aOut.Quotew( item->GetTextA() ).c_str() );
+
+        if( item->HasSecondItem() )
+        {
+            aOut.Print( 0, "\n" );
+            aOut.Print( aNestLevel + 2, "(item (pos %.6f %.6f) (text %s))",
+                        Iu2Millimeter( item->GetPointB().x ), Iu2Millimeter( item->GetPointB().y ),
+                        aOut.Quotew( item->GetTextB() ).c_str() );
+        }
+
+        aOut.Print( 0, ")\n" );
+    }
+
+    aOut.Print( aNestLevel, ")\n" );
+}
+
+
+static void formatJsonItems( OUTPUTFORMATTER& aOut, int aNestLevel, const char* aListName,
+                             const std::vector<const DRC_ITEM*>& aItems, bool aLast )
+{
+    aOut.Print( aNestLevel, "\"%s\": [", aListName );
+
+    for( size_t ii = 0; ii < aItems.size(); ++ii )
+    {
+        const DRC_ITEM* item = aItems[ii];
+
+        aOut.Print( 0, ii ? ",\n" : "\n" );
+        aOut.Print( aNestLevel + 1, "{ \"code\": %d, \"description\": %s, \"items\": [ ",
+                    item->GetErrorCode(), jsonQuoted( item->GetErrorText() ).c_str() );
+
+        aOut.Print( 0, "{ \"x\": %.6f, \"y\": %.6f, \"text\": %s }",
+                    Iu2Millimeter( item->GetPointA().x ), Iu2Millimeter( item->GetPointA().y ),
+                    jsonQuoted( item->GetTextA() ).c_str() );
+
+        if( item->HasSecondItem() )
+        {
+            aOut.Print( 0, ", { \"x\": %.6f, \"y\": %.6f, \"text\": %s }",
+                        Iu2Millimeter( item->GetPointB().x ), Iu2Millimeter( item->GetPointB().y ),
+                        jsonQuoted( item->GetTextB() ).c_str() );
+        }
+
+        aOut.Print( 0, " ] }" );
+    }
+
+    if( aItems.empty() )
+    {
+        aOut.Print( 0, "]%s\n", aLast ? "" : "," );
+    }
+    else
+    {
+        aOut.Print( 0, "\n" );
+        aOut.Print( aNestLevel, "]%s\n", aLast ? "" : "," );
+    }
+}
+
+
+bool DRC::WriteReport( const wxString& aFullFileName, DRC_REPORT_FORMAT aFormat ) const
+{
+    std::vector<const DRC_ITEM*> markers;
+    std::vector<const DRC_ITEM*> unconnected( m_unconnected.begin(), m_unconnected.end() );
+
+    if( m_pcbEditorFrame )
+    {
+        for( int ii = 0; ii < m_pcb->GetMARKERCount(); ++ii )
+            markers.push_back( &m_pcb->GetMARKER( ii )->GetReporter() );
+    }
+    else
+    {
+        for( const MARKER_PCB* marker : m_batchMarkers )
+            markers.push_back( &marker->GetReporter() );
+    }
+
+    // Numbers are always written with a '.' as decimal separator
+    LOCALE_IO   toggle;
+    wxString    date = wxDateTime::Now().Format( wxT( "%F %T" ) );
+
+    try
+    {
+        FILE_OUTPUTFORMATTER out( aFullFileName );
+
+        if( aFormat == DRC_REPORT_JSON )
+        {
+            out.Print( 0, "{\n" );
+            out.Print( 1, "\"version\": 1,\n" );
+            out.Print( 1, "\"board\": %s,\n", jsonQuoted( m_pcb->GetFileName() ).c_str() );
+            out.Print( 1, "\"date\": %s,\n", jsonQuoted( date ).c_str() );
+            out.Print( 1, "\"units\": \"mm\",\n" );
+            out.Print( 1, "\"phases\": [" );
+
+            for( size_t ii = 0; ii < m_phaseTimes.size(); ++ii )
+            {
+                out.Print( 0, ii ? ",\n" : "\n" );
+                out.Print( 2, "{ \"name\": \"%s\", \"ms\": %.3f }",
+                           m_phaseTimes[ii].first.c_str(), m_phaseTimes[ii].second );
+            }
+
+            if( m_phaseTimes.empty() )
+            {
+                out.Print( 0, "],\n" );
+            }
+            else
+            {
+                out.Print( 0, "\n" );
+                out.Print( 1, "],\n" );
+            }
+
+            formatJsonItems( out, 1, "markers", markers, false );
+            formatJsonItems( out, 1, "unconnected_items", unconnected, true );
+            out.Print( 0, "}\n" );
+        }
+        else
+        {
+            out.Print( 0, "(drc_report (version 1)\n" );
+            out.Print( 1, "(board %s)\n", out.Quotew( m_pcb->GetFileName() ).c_str() );
+            out.Print( 1, "(date %s)\n", out.Quotew( date ).c_str() );
+            out.Print( 1, "(units mm)\n" );
+            out.Print( 1, "(phases\n" );
+
+            for( const auto& phase : m_phaseTimes )
+                out.Print( 2, "(phase %s %.3f)\n", phase.first.c_str(), phase.second );
+
+            out.Print( 1, ")\n" );
+
+            formatSexprItems( out, 1, "markers", "marker", markers );
+            formatSexprItems( out, 1, "unconnected_items", "unconnected", unconnected );
+            out.Print( 0, ")\n" );
+        }
+    }
+    catch( const IO_ERROR& )
+    {
+        return false;
+    }
+
+    return true;
+}
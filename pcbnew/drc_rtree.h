@@ -0,0 +1,177 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#ifndef __DRC_RTREE_H
+#define __DRC_RTREE_H
+
+#include <vector>
+#include <algorithm>
+
+#include <eda_rect.h>
+#include <layers_id_colors_and_visibility.h>
+#include <class_track.h>
+#include <class_pad.h>
+
+#include <geometry/rtree.h>
+
+/**
+ * Class DRC_RTREE
+ * Spatial index of the copper items tested by the DRC: one R-tree per copper layer for
+ * the tracks and vias, and a single R-tree for the pads (pad holes have to be tested on
+ * every layer).
+ *
+ * Items are stored by their index in the track and pad lists given to Build(), and the
+ * queries return these indices sorted, so the items are always tested in the order of
+ * the lists and the reported DRC errors do not depend on the tree layout.
+ *
+ * The bounding box of each item is inflated by its own clearance, so two items closer
+ * than the largest of their clearances always have overlapping boxes.
+ * Non-owning.  Once built, the index can be queried from several threads.
+ */
+class DRC_RTREE
+{
+public:
+    typedef RTree<int, int, 2, float> TREE;
+
+    DRC_RTREE()
+    {
+    }
+
+    /**
+     * Function Build
+     * (re)creates the index from aTracks and aPads.  The lists must outlive the index.
+     */
+    void Build( const std::vector<TRACK*>& aTracks, const std::vector<D_PAD*>& aPads )
+    {
+        Clear();
+
+        for( int ii = 0; ii < (int) aTracks.size(); ++ii )
+        {
+            const TRACK* track = aTracks[ii];
+            const EDA_RECT bbox = track->GetBoundingBox();
+            const int mmin[2] = { bbox.GetX(), bbox.GetY() };
+            const int mmax[2] = { bbox.GetRight(), bbox.GetBottom() };
+
+            for( LSEQ cu = track->GetLayerSet().CuStack(); cu; ++cu )
+                m_tracks[ *cu ].Insert( mmin, mmax, ii );
+        }
+
+        for( int ii = 0; ii < (int) aPads.size(); ++ii )
+        {
+            const EDA_RECT bbox = PadBoundingBox( aPads[ii] );
+            const int mmin[2] = { bbox.GetX(), bbox.GetY() };
+            const int mmax[2] = { bbox.GetRight(), bbox.GetBottom() };
+
+            m_pads.Insert( mmin, mmax, ii );
+        }
+    }
+
+    /**
+     * Function PadBoundingBox
+     * @return the box used to index aPad: its shape inflated by its clearance, merged
+     * with its hole (the clearance of a hole is the one of the other item).
+     */
+    static EDA_RECT PadBoundingBox( const D_PAD* aPad )
+    {
+        EDA_RECT bbox( aPad->ShapePos(), wxSize( 0, 0 ) );
+        bbox.Inflate( aPad->GetBoundingRadius() + aPad->GetClearance() + 1 );
+
+        if( aPad->GetDrillSize().x )
+        {
+            EDA_RECT hole( aPad->GetPosition(), wxSize( 0, 0 ) );
+            hole.Inflate( std::max( aPad->GetDrillSize().x, aPad->GetDrillSize().y ) / 2 + 1 );
+            bbox.Merge( hole );
+        }
+
+        return bbox;
+    }
+
+    void Clear()
+    {
+        for( auto& tree : m_tracks )
+            tree.RemoveAll();
+
+        m_pads.RemoveAll();
+    }
+
+    /**
+     * Function QueryTracks
+     * returns (in ascending order) the indices of the tracks which are on one of the
+     * copper layers of aLayers and whose inflated bounding box intersects aBox.
+     */
+    void QueryTracks( const EDA_RECT& aBox, LSET aLayers, std::vector<int>& aResult )
+    {
+        aResult.clear();
+
+        const int mmin[2] = { aBox.GetX(), aBox.GetY() };
+        const int mmax[2] = { aBox.GetRight(), aBox.GetBottom() };
+
+        auto visitor = [&aResult]( int aIndex ) -> bool
+        {
+            aResult.push_back( aIndex );
+            return true;
+        };
+
+        LSEQ cu = aLayers.CuStack();
+        bool multiLayer = cu.size() > 1;
+
+        for( ; cu; ++cu )
+            m_tracks[ *cu ].Search( mmin, mmax, visitor );
+
+        std::sort( aResult.begin(), aResult.end() );
+
+        // vias are stored in the tree of each of their layers
+        if( multiLayer )
+            aResult.erase( std::unique( aResult.begin(), aResult.end() ), aResult.end() );
+    }
+
+    /**
+     * Function QueryPads
+     * returns (in ascending order) the indices of the pads whose inflated bounding box
+     * intersects aBox.  Pads on any layer are reported, because their holes go through
+     * the whole board.
+     */
+    void QueryPads( const EDA_RECT& aBox, std::vector<int>& aResult )
+    {
+        aResult.clear();
+
+        const int mmin[2] = { aBox.GetX(), aBox.GetY() };
+        const int mmax[2] = { aBox.GetRight(), aBox.GetBottom() };
+
+        auto visitor = [&aResult]( int aIndex ) -> bool
+        {
+            aResult.push_back( aIndex );
+            return true;
+        };
+
+        m_pads.Search( mmin, mmax, visitor );
+
+        std::sort( aResult.begin(), aResult.end() );
+    }
+
+private:
+    TREE m_tracks[MAX_CU_LAYERS];
+    TREE m_pads;
+};
+
+#endif // __DRC_RTREE_H
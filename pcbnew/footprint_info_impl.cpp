@@ -37,8 +37,7 @@
 #include <pgm_base.h>
 #include <wildcards_and_files_ext.h>
 #include <widgets/progress_reporter.h>
-
-#include <thread>
+#include <thread_pool.h>
 
 
 void FOOTPRINT_INFO_IMPL::load()
@@ -47,7 +46,18 @@ void FOOTPRINT_INFO_IMPL::load()
 
     wxASSERT( fptable );
 
-    std::unique_ptr<MODULE> footprint( fptable->LoadEnumeratedFootprint( m_nickname, m_fpname ) );
+    std::unique_ptr<MODULE> footprint;
+
+    try
+    {
+        footprint.reset( fptable->LoadEnumeratedFootprint( m_nickname, m_fpname ) );
+    }
+    catch( const IO_ERROR& )
+    {
+        // The footprints are parsed when first loaded, so a malformed footprint file
+        // is found here
+    }
+
     if( footprint.get() == NULL ) // Should happen only with malformed/broken libraries
     {
         m_pad_count = 0;
@@ -184,7 +194,7 @@ void FOOTPRINT_LIST_IMPL::StartWorkers( FP_LIB_TABLE* aTable, wxString const* aN
     m_count_finished.store( 0 );
     m_errors.clear();
     m_list.clear();
-    m_threads.clear();
+    m_loaders.clear();
     m_queue_in.clear();
     m_queue_out.clear();
 
@@ -200,89 +210,106 @@ void FOOTPRINT_LIST_IMPL::StartWorkers( FP_LIB_TABLE* aTable, wxString const* aN
 
     for( unsigned i = 0; i < aNThreads; ++i )
     {
-        m_threads.push_back( std::thread( &FOOTPRINT_LIST_IMPL::loader_job, this ) );
+        m_loaders.push_back( THREAD_POOL::Instance().Submit( [this]() { loader_job(); } ) );
     }
 }
 
 bool FOOTPRINT_LIST_IMPL::JoinWorkers()
 {
-    for( auto& i : m_threads )
-        i.join();
+    for( auto& loader : m_loaders )
+        THREAD_POOL::Instance().Wait( loader );
 
-    m_threads.clear();
+    m_loaders.clear();
     m_queue_in.clear();
     m_count_finished.store( 0 );
 
-    size_t total_count = m_queue_out.size();
+    std::vector<wxString> nicknames;
+    wxString              nickname;
+
+    while( m_queue_out.pop( nickname ) )
+        nicknames.push_back( nickname );
 
-    LOCALE_IO toggle_locale;
+    // Parse the footprints in parallel.  The KiCad footprint libraries are parsed without
+    // depending on the locale, but the other plugins still require changing the locale,
+    // which is GLOBAL. It is only threadsafe to construct the LOCALE_IO before the threads
+    // are created, destroy it after they finish, and block the main (GUI) thread while they
+    // work. Any deviation from this will cause nasal demons.
+    std::unique_ptr<LOCALE_IO> toggle_locale;
 
-    // Parse the footprints in parallel. WARNING! This requires changing the locale, which is
-    // GLOBAL. It is only threadsafe to construct the LOCALE_IO before the threads are created,
-    // destroy it after they finish, and block the main (GUI) thread while they work. Any deviation
-    // from this will cause nasal demons.
-    //
-    // TODO: blast LOCALE_IO into the sun
+    for( const wxString& libNickname : nicknames )
+    {
+        try
+        {
+            const FP_LIB_TABLE_ROW* row = m_lib_table->FindRow( libNickname );
+
+            if( row->GetType() == IO_MGR::ShowType( IO_MGR::KICAD_SEXP ) )
+                continue;
+        }
+        catch( const IO_ERROR& )
+        {
+            // The error is reported by the enumeration of the library
+        }
+
+        toggle_locale.reset( new LOCALE_IO );
+        break;
+    }
 
     SYNC_QUEUE<std::unique_ptr<FOOTPRINT_INFO>> queue_parsed;
-    std::vector<std::thread>                    threads;
 
-    for( size_t ii = 0; ii < std::thread::hardware_concurrency() + 1; ++ii )
+    auto parseLib = [this, &nicknames, &queue_parsed]( size_t aIndex )
     {
-        threads.push_back( std::thread( [this, &queue_parsed]() {
-            wxString nickname;
+        const wxString& libNickname = nicknames[aIndex];
+        wxArrayString   fpnames;
 
-            while( this->m_queue_out.pop( nickname ) && !m_cancelled )
+        try
+        {
+            m_lib_table->FootprintEnumerate( fpnames, libNickname );
+        }
+        catch( const IO_ERROR& ioe )
+        {
+            m_errors.move_push( std::make_unique<IO_ERROR>( ioe ) );
+        }
+        catch( const std::exception& se )
+        {
+            // This is a round about way to do this, but who knows what THROW_IO_ERROR()
+            // may be tricked out to do someday, keep it in the game.
+            try
             {
-                wxArrayString fpnames;
-
-                try
-                {
-                    m_lib_table->FootprintEnumerate( fpnames, nickname );
-                }
-                catch( const IO_ERROR& ioe )
-                {
-                    m_errors.move_push( std::make_unique<IO_ERROR>( ioe ) );
-                }
-                catch( const std::exception& se )
-                {
-                    // This is a round about way to do this, but who knows what THROW_IO_ERROR()
-                    // may be tricked out to do someday, keep it in the game.
-                    try
-                    {
-                        THROW_IO_ERROR( se.what() );
-                    }
-                    catch( const IO_ERROR& ioe )
-                    {
-                        m_errors.move_push( std::make_unique<IO_ERROR>( ioe ) );
-                    }
-                }
-
-                for( unsigned jj = 0; jj < fpnames.size() && !m_cancelled; ++jj )
-                {
-                    wxString fpname = fpnames[jj];
-                    FOOTPRINT_INFO* fpinfo = new FOOTPRINT_INFO_IMPL( this, nickname, fpname );
-                    queue_parsed.move_push( std::unique_ptr<FOOTPRINT_INFO>( fpinfo ) );
-                }
-
-                if( m_progress_reporter )
-                    m_progress_reporter->AdvanceProgress();
-
-                m_count_finished.fetch_add( 1 );
+                THROW_IO_ERROR( se.what() );
             }
-        } ) );
-    }
+            catch( const IO_ERROR& ioe )
+            {
+                m_errors.move_push( std::make_unique<IO_ERROR>( ioe ) );
+            }
+        }
+
+        for( unsigned jj = 0; jj < fpnames.size() && !m_cancelled; ++jj )
+        {
+            wxString fpname = fpnames[jj];
+            FOOTPRINT_INFO* fpinfo = new FOOTPRINT_INFO_IMPL( this, libNickname, fpname );
+            queue_parsed.move_push( std::unique_ptr<FOOTPRINT_INFO>( fpinfo ) );
+        }
 
-    while( !m_cancelled && m_count_finished.load() < total_count )
-    {
         if( m_progress_reporter )
-            m_cancelled = !m_progress_reporter->KeepRefreshing();
-        else
-            wxMilliSleep( 20 );
+            m_progress_reporter->AdvanceProgress();
+
+        m_count_finished.fetch_add( 1 );
+    };
+
+    std::function<bool()> refresh;
+
+    if( m_progress_reporter )
+    {
+        refresh = [this]() -> bool
+        {
+            if( !m_progress_reporter->KeepRefreshing() )
+                m_cancelled = true;
+
+            return !m_cancelled;
+        };
     }
 
-    for( auto& thr : threads )
-        thr.join();
+    THREAD_POOL::Instance().ParallelFor( nicknames.size(), parseLib, refresh, &m_cancelled );
 
     std::unique_ptr<FOOTPRINT_INFO> fpi;
 
@@ -315,6 +342,6 @@ FOOTPRINT_LIST_IMPL::FOOTPRINT_LIST_IMPL() :
 
 FOOTPRINT_LIST_IMPL::~FOOTPRINT_LIST_IMPL()
 {
-    for( auto& i : m_threads )
-        i.join();
+    for( auto& loader : m_loaders )
+        THREAD_POOL::Instance().Wait( loader );
 }
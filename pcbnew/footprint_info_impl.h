@@ -23,11 +23,11 @@
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <thread>
 #include <vector>
 
 #include <footprint_info.h>
 #include <sync_queue.h>
+#include <thread_pool.h>
 #include <widgets/progress_reporter.h>
 
 class LOCALE_IO;
@@ -57,14 +57,14 @@ protected:
 
 class FOOTPRINT_LIST_IMPL : public FOOTPRINT_LIST
 {
-    FOOTPRINT_ASYNC_LOADER*  m_loader;
-    std::vector<std::thread> m_threads;
-    SYNC_QUEUE<wxString>     m_queue_in;
-    SYNC_QUEUE<wxString>     m_queue_out;
-    std::atomic_size_t       m_count_finished;
-    long long                m_list_timestamp;
-    WX_PROGRESS_REPORTER*    m_progress_reporter;
-    std::atomic_bool         m_cancelled;
+    FOOTPRINT_ASYNC_LOADER*                     m_loader;
+    std::vector<THREAD_POOL::TASK_HANDLE<void>> m_loaders;      // the loader_job() tasks
+    SYNC_QUEUE<wxString>                        m_queue_in;
+    SYNC_QUEUE<wxString>                        m_queue_out;
+    std::atomic_size_t                          m_count_finished;
+    long long                                   m_list_timestamp;
+    WX_PROGRESS_REPORTER*                       m_progress_reporter;
+    std::atomic_bool                            m_cancelled;
 
     /**
      * Call aFunc, pushing any IO_ERRORs and std::exceptions it throws onto m_errors.
@@ -300,7 +300,7 @@ void GPCB_FPL_CACHE::Load()
         try
         {
             // reader now owns fp, will close on exception or return
-            FILE_LINE_READER reader( fn.GetFullPath() );
+            WHOLE_FILE_LINE_READER reader( fn.GetFullPath() );
 
             std::string      name = TO_UTF8( fn.GetName() );
             MODULE*          footprint = parseMODULE( &reader );
@@ -43,11 +43,14 @@
 #include <zones.h>
 #include <kicad_plugin.h>
 #include <pcb_parser.h>
+#include <token_snapshot.h>
 
 #include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/wfstream.h>
 #include <boost/ptr_container/ptr_map.hpp>
+#include <algorithm>
+#include <memory>
 #include <memory.h>
 #include <connectivity_data.h>
 
@@ -63,6 +66,12 @@ using namespace PCB_KEYS_T;
  */
 static const wxString traceFootprintLibrary = wxT( "KICAD_TRACE_FP_PLUGIN" );
 
+/// The library option giving the max total size, in megabytes, of the footprint files
+/// kept parsed in the cache of a library.
+static const char* FOOTPRINT_CACHE_SIZE = "footprint_cache_size";
+
+#define DEFAULT_FOOTPRINT_CACHE_SIZE    64      ///< in megabytes
+
 
 ///> Removes empty nets (i.e. with node count equal zero) from net classes
 void filterNetClass( const BOARD& aBoard, NETCLASS& aNetClass )
@@ -92,20 +101,43 @@ void filterNetClass( const BOARD& aBoard, NETCLASS& aNetClass )
 class FP_CACHE_ITEM
 {
     wxFileName              m_file_name; ///< The the full file name and path of the footprint to cache.
-    std::unique_ptr<MODULE> m_module;
+    std::unique_ptr<MODULE> m_module;    ///< The footprint, NULL until it is needed.
+    long long               m_timestamp; ///< The modification time of the file when last seen.
+    size_t                  m_size;      ///< The file size of the parsed footprint.
+    unsigned long long      m_last_use;  ///< When the footprint was last used by the cache.
 
 public:
-    FP_CACHE_ITEM( MODULE* aModule, const wxFileName& aFileName );
+    FP_CACHE_ITEM( MODULE* aModule, const wxFileName& aFileName, long long aTimestamp = 0 );
 
     wxString    GetName() const { return m_file_name.GetDirs().Last(); }
     wxFileName  GetFileName() const { return m_file_name; }
 
     MODULE*     GetModule() const { return m_module.get(); }
+
+    /// Replace the footprint, parsed from a file of \a aSize bytes, NULL to forget it.
+    void SetModule( MODULE* aModule, size_t aSize )
+    {
+        m_module.reset( aModule );
+        m_size = aSize;
+    }
+
+    long long   GetTimestamp() const { return m_timestamp; }
+    void        SetTimestamp( long long aTimestamp ) { m_timestamp = aTimestamp; }
+
+    size_t      GetSize() const { return m_size; }
+    void        SetSize( size_t aSize ) { m_size = aSize; }
+
+    unsigned long long GetLastUse() const { return m_last_use; }
+    void        SetLastUse( unsigned long long aLastUse ) { m_last_use = aLastUse; }
 };
 
 
-FP_CACHE_ITEM::FP_CACHE_ITEM( MODULE* aModule, const wxFileName& aFileName ) :
-    m_module( aModule )
+FP_CACHE_ITEM::FP_CACHE_ITEM( MODULE* aModule, const wxFileName& aFileName,
+                              long long aTimestamp ) :
+    m_module( aModule ),
+    m_timestamp( aTimestamp ),
+    m_size( 0 ),
+    m_last_use( 0 )
 {
     m_file_name = aFileName;
 }
@@ -116,6 +148,17 @@ typedef MODULE_MAP::iterator                        MODULE_ITER;
 typedef MODULE_MAP::const_iterator                  MODULE_CITER;
 
 
+/**
+ * A footprint file parsed without the library snapshot, to be recorded in it.
+ */
+struct UNRECORDED_FILE
+{
+    wxString    m_fileName;
+    long long   m_fileTime;     ///< see TOKEN_SNAPSHOT_FILE::GetFileTime()
+    std::string m_text;
+};
+
+
 class FP_CACHE
 {
     PCB_IO*         m_owner;        /// Plugin object that owns the cache.
@@ -126,9 +169,36 @@ class FP_CACHE
                                         // m_cache_timestamp against all the files.
     long long       m_cache_timestamp;  // A hash of the timestamps for all the footprint
                                         // files.
+    long long       m_dir_timestamp;    // The timestamp of the library directory.
+
+    size_t          m_cache_size;       // The max total file size of the parsed footprints.
+    size_t          m_parsed_size;      // The total file size of the parsed footprints.
+    unsigned long long m_use_count;     // The count of footprints got from the cache.
+
+    /// The tokens recorded when the footprints were last parsed, loaded when first needed.
+    std::shared_ptr<TOKEN_SNAPSHOT_FILE>            m_snapshot;
+
+    /// The footprints parsed without m_snapshot.
+    std::vector<UNRECORDED_FILE>                    m_unrecorded;
+
+    /**
+     * Function parseModule
+     * parses the footprint file \a aFileName, with the recorded tokens if \a aUseSnapshot.
+     * @param aSize is set to the size of the file.
+     * @throw IO_ERROR if the file cannot be read or parsed.
+     */
+    MODULE* parseModule( const wxFileName& aFileName, bool aUseSnapshot, size_t* aSize );
+
+    /**
+     * Function evict
+     * forgets the least recently used footprints, until the parsed footprints are well
+     * below the cache size.
+     */
+    void evict();
 
 public:
     FP_CACHE( PCB_IO* aOwner, const wxString& aLibraryPath );
+    ~FP_CACHE();
 
     wxString    GetPath() const { return m_lib_path.GetPath(); }
     bool        IsWritable() const { return m_lib_path.IsOk() && m_lib_path.IsDirWritable(); }
@@ -141,8 +211,30 @@ public:
     /// save the entire legacy library to m_lib_name;
     void Save();
 
+    /**
+     * Function Load
+     * indexes the footprint files of the library by name, without parsing them.
+     */
     void Load();
 
+    /**
+     * Function GetModule
+     * returns the footprint \a aFootprintName, parsed if not done yet or if its file
+     * changed since.  The least recently used footprints are forgotten when the parsed
+     * ones exceed the cache size.
+     *
+     * @param aEnumerated is true when the footprints of the library are loaded one after
+     *  the other after an enumeration, which checked the files: the file is then not
+     *  checked again, and the footprint is parsed from the tokens recorded for the library
+     *  if they are up to date.
+     * @return the footprint, owned by the cache, or NULL if the library has no such footprint.
+     * @throw IO_ERROR if the footprint file cannot be read or parsed.
+     */
+    const MODULE* GetModule( const wxString& aFootprintName, bool aEnumerated );
+
+    /// Set the max total size, in bytes, of the files of the footprints kept parsed.
+    void SetCacheSize( size_t aCacheSize ) { m_cache_size = aCacheSize; }
+
     void Remove( const wxString& aFootprintName );
 
     /**
@@ -159,6 +251,13 @@ public:
      */
     bool IsModified();
 
+    /**
+     * Function IsDirModified
+     * Return true if footprints may have been added to or removed from the library since
+     * it was loaded.  It is much cheaper than IsModified(), which checks every file.
+     */
+    bool IsDirModified();
+
     /**
      * Function IsPath
      * checks if \a aPath is the same as the current cache path.
@@ -181,6 +280,10 @@ FP_CACHE::FP_CACHE( PCB_IO* aOwner, const wxString& aLibraryPath )
     m_lib_path.SetPath( aLibraryPath );
     m_cache_timestamp = 0;
     m_cache_dirty = true;
+    m_dir_timestamp = 0;
+    m_cache_size = (size_t) -1;
+    m_parsed_size = 0;
+    m_use_count = 0;
 }
 
 
@@ -204,6 +307,13 @@ void FP_CACHE::Save()
     {
         wxFileName fn = it->second->GetFileName();
 
+        // A footprint which was never parsed did not change since it was written.
+        if( !it->second->GetModule() )
+        {
+            m_cache_timestamp += it->second->GetTimestamp();
+            continue;
+        }
+
         wxString tempFileName =
 #ifdef USE_TMP_FILE
         fn.CreateTempFileName( fn.GetPath() );
@@ -216,10 +326,11 @@ void FP_CACHE::Save()
             wxLogTrace( traceFootprintLibrary, wxT( "Creating temporary library file %s" ),
                         GetChars( tempFileName ) );
 
-            FILE_OUTPUTFORMATTER formatter( tempFileName );
+            BUFFERED_FILE_OUTPUTFORMATTER formatter( tempFileName );
 
             m_owner->SetOutputFormatter( &formatter );
             m_owner->Format( (BOARD_ITEM*) it->second->GetModule() );
+            formatter.Finish();
         }
 
 #ifdef USE_TMP_FILE
@@ -239,14 +350,77 @@ void FP_CACHE::Save()
             THROW_IO_ERROR( msg );
         }
 #endif
-        m_cache_timestamp += fn.GetModificationTime().GetValue().GetValue();
+        it->second->SetTimestamp( fn.GetModificationTime().GetValue().GetValue() );
+        m_cache_timestamp += it->second->GetTimestamp();
+
+        // The footprint is now counted in the cache size like a parsed one
+        wxULongLong fileSize = fn.GetSize();
+        size_t      size = fileSize == wxInvalidSize ? 0 : (size_t) fileSize.GetValue();
+
+        m_parsed_size = m_parsed_size - it->second->GetSize() + size;
+        it->second->SetSize( size );
     }
 
-    m_cache_timestamp += m_lib_path.GetModificationTime().GetValue().GetValue();
+    m_dir_timestamp = m_lib_path.GetModificationTime().GetValue().GetValue();
+    m_cache_timestamp += m_dir_timestamp;
     m_cache_dirty = false;
 }
 
 
+/**
+ * Function saveLibrarySnapshot
+ * records in the background the tokens of the footprint files aUnrecorded, in aSnapshot
+ * which holds the other footprints aFileNames of the library, and saves it.
+ */
+static void saveLibrarySnapshot( const std::shared_ptr<TOKEN_SNAPSHOT_FILE>& aSnapshot,
+                                 const std::vector<wxString>& aFileNames,
+                                 std::vector<UNRECORDED_FILE> aUnrecorded )
+{
+    if( !aSnapshot->IsEnabled() )
+        return;
+
+    // The files removed from the library are forgotten
+    if( !aSnapshot->Prune( aFileNames ) && aUnrecorded.empty() )
+        return;
+
+    auto files = std::make_shared<std::vector<UNRECORDED_FILE>>( std::move( aUnrecorded ) );
+
+    // The task owns all its data, so it does not have to end before the cache
+    TOKEN_SNAPSHOT_FILE::SaveInBackground( [aSnapshot, files]()
+    {
+        for( const UNRECORDED_FILE& file : *files )
+        {
+            try
+            {
+                PCB_LEXER lexer( file.m_text, file.m_fileName );
+
+                aSnapshot->Add( file.m_fileName, file.m_fileTime, file.m_text.data(),
+                                file.m_text.size(), lexer.RecordTokens() );
+            }
+            catch( const IO_ERROR& )
+            {
+            }
+        }
+
+        aSnapshot->Save();
+    } );
+}
+
+
+FP_CACHE::~FP_CACHE()
+{
+    if( m_snapshot )
+    {
+        std::vector<wxString> fileNames;
+
+        for( MODULE_CITER it = m_modules.begin();  it != m_modules.end();  ++it )
+            fileNames.push_back( it->second->GetFileName().GetFullPath() );
+
+        saveLibrarySnapshot( m_snapshot, fileNames, std::move( m_unrecorded ) );
+    }
+}
+
+
 void FP_CACHE::Load()
 {
     wxDir dir( m_lib_path.GetPath() );
@@ -265,51 +439,171 @@ void FP_CACHE::Load()
     }
     else
     {
-        m_cache_timestamp = m_lib_path.GetModificationTime().GetValue().GetValue();
+        m_dir_timestamp = m_lib_path.GetModificationTime().GetValue().GetValue();
+        m_cache_timestamp = m_dir_timestamp;
         m_cache_dirty = false;
     }
 
     wxString fpFileName;
     wxString wildcard = wxT( "*." ) + KiCadFootprintFileExtension;
 
+    // The footprints are parsed when first needed, see GetModule()
     if( dir.GetFirst( &fpFileName, wildcard, wxDIR_FILES ) )
     {
-        wxString cacheError;
-
         do
         {
             // prepend the libpath into fullPath
-            wxFileName fullPath( m_lib_path.GetPath(), fpFileName );
+            wxFileName  fullPath( m_lib_path.GetPath(), fpFileName );
+            long long   timestamp = fullPath.GetModificationTime().GetValue().GetValue();
 
-            // Queue I/O errors so only files that fail to parse don't get loaded.
-            try
-            {
-                FILE_LINE_READER    reader( fullPath.GetFullPath() );
+            // The footprint name is the file name without the extension.
+            m_modules.insert( fullPath.GetName(), new FP_CACHE_ITEM( NULL, fullPath, timestamp ) );
 
-                m_owner->m_parser->SetLineReader( &reader );
+            m_cache_timestamp += timestamp;
+        } while( dir.GetNext( &fpFileName ) );
+    }
+}
 
-                MODULE*     footprint = (MODULE*) m_owner->m_parser->Parse();
 
-                // The footprint name is the file name without the extension.
-                wxString    fpName = fullPath.GetName();
+MODULE* FP_CACHE::parseModule( const wxFileName& aFileName, bool aUseSnapshot, size_t* aSize )
+{
+    wxString                fullPath = aFileName.GetFullPath();
+    long long               fileTime = aUseSnapshot ? TOKEN_SNAPSHOT_FILE::GetFileTime( fullPath )
+                                                    : 0;
+    WHOLE_FILE_LINE_READER  reader( fullPath );
+    MODULE*                 footprint = NULL;
 
-                footprint->SetFPID( LIB_ID( fpName ) );
-                m_modules.insert( fpName, new FP_CACHE_ITEM( footprint, fullPath ) );
+    *aSize = reader.GetTextLength();
 
-                m_cache_timestamp += fullPath.GetModificationTime().GetValue().GetValue();
-            }
-            catch( const IO_ERROR& ioe )
-            {
-                if( !cacheError.IsEmpty() )
-                    cacheError += "\n\n";
+    // The tokens recorded when the library was last loaded spare the lexing of the
+    // footprints which did not change since
+    if( aUseSnapshot && !m_snapshot )
+    {
+        m_snapshot = std::make_shared<TOKEN_SNAPSHOT_FILE>( m_lib_path.GetPath(),
+                                                            *m_owner->m_parser );
 
-                cacheError += ioe.What();
-            }
-        } while( dir.GetNext( &fpFileName ) );
+        if( m_snapshot->IsEnabled() )
+            m_snapshot->Load();
+    }
+
+    const std::string* tokens = NULL;
+
+    if( aUseSnapshot )
+        tokens = m_snapshot->Find( fullPath, reader.GetText(), reader.GetTextLength() );
+
+    if( tokens )
+    {
+        // A parser of its own, so a failure does not leave m_parser in the
+        // middle of the tokens: the text is then parsed as usual.
+        TOKEN_READER    tokenReader( *tokens, fullPath );
+        PCB_PARSER      tokenParser( &tokenReader );
+
+        try
+        {
+            footprint = dynamic_cast<MODULE*>( tokenParser.Parse() );
+        }
+        catch( const IO_ERROR& )
+        {
+        }
+    }
+
+    if( !footprint )
+    {
+        m_owner->m_parser->SetLineReader( &reader );
+
+        footprint = (MODULE*) m_owner->m_parser->Parse();
 
-        if( !cacheError.IsEmpty() )
-            THROW_IO_ERROR( cacheError );
+        if( aUseSnapshot && m_snapshot->IsEnabled() )
+        {
+            reader.Rewind();    // the text is intact again
+            m_unrecorded.push_back( { fullPath, fileTime,
+                                      std::string( reader.GetText(), reader.GetTextLength() ) } );
+        }
+    }
+
+    return footprint;
+}
+
+
+const MODULE* FP_CACHE::GetModule( const wxString& aFootprintName, bool aEnumerated )
+{
+    MODULE_ITER it = m_modules.find( aFootprintName );
+
+    if( it == m_modules.end() )
+        return NULL;
+
+    FP_CACHE_ITEM* item = it->second;
+    wxFileName     fn = item->GetFileName();
+
+    // A footprint is parsed again if its file changed since it was last seen
+    if( !aEnumerated || !item->GetModule() )
+    {
+        long long timestamp = fn.FileExists() ?
+                              fn.GetModificationTime().GetValue().GetValue() : 0;
+
+        if( timestamp != item->GetTimestamp() )
+        {
+            m_cache_timestamp += timestamp - item->GetTimestamp();
+            item->SetTimestamp( timestamp );
+            m_parsed_size -= item->GetSize();
+            item->SetModule( NULL, 0 );
+        }
+    }
+
+    if( !item->GetModule() )
+    {
+        size_t  size;
+        MODULE* footprint = parseModule( fn, aEnumerated, &size );
+
+        footprint->SetFPID( LIB_ID( aFootprintName ) );
+
+        if( m_parsed_size + size > m_cache_size )
+            evict();
+
+        item->SetModule( footprint, size );
+        m_parsed_size += size;
     }
+
+    item->SetLastUse( ++m_use_count );
+
+    return item->GetModule();
+}
+
+
+void FP_CACHE::evict()
+{
+    // Going down to 3/4 of the cache size leaves room for many footprints before the
+    // next scan of the library.
+    std::vector<FP_CACHE_ITEM*> parsed;
+
+    m_parsed_size = 0;
+
+    for( MODULE_ITER it = m_modules.begin();  it != m_modules.end();  ++it )
+    {
+        if( it->second->GetModule() )
+        {
+            parsed.push_back( it->second );
+            m_parsed_size += it->second->GetSize();
+        }
+    }
+
+    std::sort( parsed.begin(), parsed.end(),
+               []( const FP_CACHE_ITEM* aLeft, const FP_CACHE_ITEM* aRight )
+               {
+                   return aLeft->GetLastUse() < aRight->GetLastUse();
+               } );
+
+    for( FP_CACHE_ITEM* item : parsed )
+    {
+        if( m_parsed_size <= m_cache_size / 4 * 3 )
+            break;
+
+        m_parsed_size -= item->GetSize();
+        item->SetModule( NULL, 0 );
+    }
+
+    wxLogTrace( traceFootprintLibrary, wxT( "Footprint cache of %s: %u bytes of footprints kept" ),
+                GetChars( m_lib_path.GetPath() ), (unsigned) m_parsed_size );
 }
 
 
@@ -329,6 +623,7 @@ void FP_CACHE::Remove( const wxString& aFootprintName )
 
     // Remove the module from the cache and delete the module file from the library.
     wxString fullPath = it->second->GetFileName().GetFullPath();
+    m_parsed_size -= it->second->GetSize();
     m_modules.erase( aFootprintName );
     wxRemoveFile( fullPath );
 }
@@ -344,6 +639,18 @@ bool FP_CACHE::IsPath( const wxString& aPath ) const
 }
 
 
+bool FP_CACHE::IsDirModified()
+{
+    if( m_cache_dirty )
+        return true;
+
+    if( !m_lib_path.DirExists() )
+        return m_dir_timestamp != 0;
+
+    return m_lib_path.GetModificationTime().GetValue().GetValue() != m_dir_timestamp;
+}
+
+
 bool FP_CACHE::IsModified()
 {
     if( m_cache_dirty )
@@ -368,6 +675,7 @@ long long FP_CACHE::GetTimestamp()
         for( MODULE_CITER it = m_modules.begin();  it != m_modules.end();  ++it )
         {
             wxFileName moduleFile = it->second->GetFileName();
+
             if( moduleFile.FileExists() )
                 files_timestamp += moduleFile.GetModificationTime().GetValue().GetValue();
         }
@@ -393,7 +701,10 @@ void PCB_IO::Save( const wxString& aFileName, BOARD* aBoard, const PROPERTIES* a
     // Prepare net mapping that assures that net codes saved in a file are consecutive integers
     m_mapping->SetBoard( aBoard );
 
-    FILE_OUTPUTFORMATTER    formatter( aFileName );
+    BUFFERED_FILE_OUTPUTFORMATTER formatter( aFileName );
+
+    // Every net name is quoted again for each pad and zone of the net
+    formatter.SetQuoteCacheSize( QUOTECACHEZ + aBoard->GetNetCount() );
 
     m_out = &formatter;     // no ownership
 
@@ -403,6 +714,8 @@ void PCB_IO::Save( const wxString& aFileName, BOARD* aBoard, const PROPERTIES* a
     Format( aBoard, 1 );
 
     m_out->Print( 0, ")\n" );
+
+    formatter.Finish();
 }
 
 
@@ -1737,6 +2050,10 @@ void PCB_IO::format( ZONE_CONTAINER* aZone, int aNestLevel ) const
                           FMT_IU( aZone->GetCornerRadius() ).c_str() );
     }
 
+    // The fingerprint of the fill inputs, so a stale fill can be discarded when loading
+    if( aZone->IsFilled() && aZone->GetFillFingerprint().IsValid() )
+        m_out->Print( 0, " (checksum %s)", aZone->GetFillFingerprint().Format().c_str() );
+
     m_out->Print( 0, ")\n" );
 
     int newLine = 0;
@@ -1886,20 +2203,76 @@ PCB_IO::~PCB_IO()
 }
 
 
+/**
+ * Function saveBoardSnapshot
+ * records in the background the tokens of the board file aFileName, whose text is aText,
+ * in aSnapshot and saves it.
+ * @param aFileTime is the time of the file, see TOKEN_SNAPSHOT_FILE::GetFileTime().
+ */
+static void saveBoardSnapshot( const std::shared_ptr<TOKEN_SNAPSHOT_FILE>& aSnapshot,
+                               const wxString& aFileName, long long aFileTime,
+                               const char* aText, size_t aLength )
+{
+    if( !aSnapshot->IsEnabled() )
+        return;
+
+    auto     text = std::make_shared<std::string>( aText, aLength );
+    wxString fileName = aFileName;
+
+    TOKEN_SNAPSHOT_FILE::SaveInBackground( [aSnapshot, text, fileName, aFileTime]()
+    {
+        try
+        {
+            PCB_LEXER lexer( *text, fileName );
+
+            aSnapshot->Add( fileName, aFileTime, text->data(), text->size(),
+                            lexer.RecordTokens() );
+            aSnapshot->Save();
+        }
+        catch( const IO_ERROR& )
+        {
+        }
+    } );
+}
+
+
 BOARD* PCB_IO::Load( const wxString& aFileName, BOARD* aAppendToMe, const PROPERTIES* aProperties )
 {
-    FILE_LINE_READER    reader( aFileName );
+    long long              fileTime = TOKEN_SNAPSHOT_FILE::GetFileTime( aFileName );
+    WHOLE_FILE_LINE_READER reader( aFileName );
 
     init( aProperties );
 
     m_parser->SetLineReader( &reader );
     m_parser->SetBoard( aAppendToMe );
 
-    BOARD* board;
+    // The tokens recorded when the file was last loaded spare the lexing of its text.
+    // They are not used to append to a board, which could not be restored if they failed.
+    auto snapshot = std::make_shared<TOKEN_SNAPSHOT_FILE>( aFileName, *m_parser );
+    const std::string* tokens = NULL;
+
+    if( !aAppendToMe && snapshot->IsEnabled() && snapshot->Load() )
+        tokens = snapshot->Find( aFileName, reader.GetText(), reader.GetTextLength() );
+
+    BOARD* board = NULL;
 
     try
     {
-        board = dynamic_cast<BOARD*>( m_parser->Parse() );
+        if( tokens )
+            board = m_parser->ParseBoardTokens( *tokens );
+
+        if( !board )
+        {
+            // The board items are parsed in parallel, unless the file cannot be split in
+            // top level items: it is then left to the sequential parser to report the error
+            board = m_parser->ParseBoard( reader.GetText(), reader.GetTextLength() );
+
+            if( !board )
+                board = dynamic_cast<BOARD*>( m_parser->Parse() );
+            else if( !aAppendToMe )
+                saveBoardSnapshot( snapshot, aFileName, fileTime, reader.GetText(),
+                                   reader.GetTextLength() );
+        }
     }
     catch( const FUTURE_FORMAT_ERROR& )
     {
@@ -1922,6 +2295,9 @@ BOARD* PCB_IO::Load( const wxString& aFileName, BOARD* aAppendToMe, const PROPER
                 m_parser->CurLineNumber(), m_parser->CurOffset() );
     }
 
+    // The zone fills saved with a checksum are kept only if they are up to date
+    m_parser->DiscardStaleZoneFills();
+
     // Give the filename to the board if it's new
     if( !aAppendToMe )
         board->SetFileName( aFileName );
@@ -1943,19 +2319,42 @@ void PCB_IO::validateCache( const wxString& aLibraryPath, bool checkModified )
 {
     if( !m_cache || !m_cache->IsPath( aLibraryPath ) || ( checkModified && m_cache->IsModified() ) )
     {
+        UTF8    cacheSizeOption;
+        long    cacheSize = DEFAULT_FOOTPRINT_CACHE_SIZE;
+
+        if( m_props && m_props->Value( FOOTPRINT_CACHE_SIZE, &cacheSizeOption ) )
+        {
+            wxString value = cacheSizeOption;
+
+            if( !value.ToLong( &cacheSize ) || cacheSize < 0 )
+                cacheSize = DEFAULT_FOOTPRINT_CACHE_SIZE;
+        }
+
         // a spectacular episode in memory management:
         delete m_cache;
         m_cache = new FP_CACHE( this, aLibraryPath );
+        m_cache->SetCacheSize( (size_t) cacheSize * 1024 * 1024 );
         m_cache->Load();
     }
 }
 
 
+void PCB_IO::FootprintLibOptions( PROPERTIES* aListToAppendTo ) const
+{
+    // inherit options supported by all PLUGINs.
+    PLUGIN::FootprintLibOptions( aListToAppendTo );
+
+    (*aListToAppendTo)[ FOOTPRINT_CACHE_SIZE ] = UTF8( wxString::Format( _(
+        "Maximum size, in megabytes, of the footprint files kept loaded in memory for this "
+        "library.  The least recently used footprints are loaded again when needed.  "
+        "The default is %d." ), DEFAULT_FOOTPRINT_CACHE_SIZE ) );
+}
+
+
 void PCB_IO::FootprintEnumerate( wxArrayString&    aFootprintNames,
                                  const wxString&   aLibraryPath,
                                  const PROPERTIES* aProperties )
 {
-    LOCALE_IO     toggle;     // toggles on, then off, the C locale.
     wxDir         dir( aLibraryPath );
 
     init( aProperties );
@@ -1991,30 +2390,35 @@ MODULE* PCB_IO::doLoadFootprint( const wxString& aLibraryPath,
                                  const PROPERTIES* aProperties,
                                  bool checkModified )
 {
-    LOCALE_IO   toggle;     // toggles on, then off, the C locale.
-
     init( aProperties );
 
     try
     {
-        validateCache( aLibraryPath, checkModified );
+        // Only the library directory is checked, for added or removed footprints: the
+        // file of the footprint is checked by GetModule(), so the other files are not.
+        validateCache( aLibraryPath, false );
+
+        if( checkModified && m_cache->IsDirModified() )
+        {
+            delete m_cache;
+            m_cache = NULL;
+            validateCache( aLibraryPath, false );
+        }
     }
     catch( const IO_ERROR& ioe )
     {
         // do nothing with the error
     }
 
-    const MODULE_MAP& mods = m_cache->GetModules();
-
-    MODULE_CITER it = mods.find( aFootprintName );
+    const MODULE* footprint = m_cache->GetModule( aFootprintName, !checkModified );
 
-    if( it == mods.end() )
+    if( !footprint )
     {
         return NULL;
     }
 
     // copy constructor to clone the already loaded MODULE
-    return new MODULE( *it->second->GetModule() );
+    return new MODULE( *footprint );
 }
 
 
@@ -2082,8 +2486,7 @@ void PCB_IO::FootprintSave( const wxString& aLibraryPath, const MODULE* aFootpri
     {
         wxLogTrace( traceFootprintLibrary, wxT( "Removing footprint library file '%s'." ),
                     fn.GetFullPath().GetData() );
-        mods.erase( footprintName );
-        wxRemoveFile( fn.GetFullPath() );
+        m_cache->Remove( footprintName );
     }
 
     // I need my own copy for the cache
@@ -401,7 +401,7 @@ BOARD* LEGACY_PLUGIN::Load( const wxString& aFileName, BOARD* aAppendToMe,
     // delete on exception, iff I own m_board, according to aAppendToMe
     unique_ptr<BOARD> deleter( aAppendToMe ? NULL : m_board );
 
-    FILE_LINE_READER    reader( aFileName );
+    WHOLE_FILE_LINE_READER reader( aFileName );
 
     m_reader = &reader;          // member function accessibility
 
@@ -3219,7 +3219,7 @@ wxDateTime LP_CACHE::GetLibModificationTime()
 
 void LP_CACHE::Load()
 {
-    FILE_LINE_READER    reader( m_lib_path );
+    WHOLE_FILE_LINE_READER reader( m_lib_path );
 
     ReadAndVerifyHeader( &reader );
     SkipIndex( &reader );
@@ -913,6 +913,12 @@ void PCB_BASE_FRAME::OnModify()
 }
 
 
+void PCB_BASE_FRAME::OnBoardItemsChanged( const std::vector<EDA_RECT>& aDirtyAreas,
+                                          const std::vector<const BOARD_ITEM*>& aRemovedItems )
+{
+}
+
+
 const wxString PCB_BASE_FRAME::GetZoomLevelIndicator() const
 {
     return EDA_DRAW_FRAME::GetZoomLevelIndicator();
@@ -36,8 +36,10 @@
 #include <class_module.h>
 #include <class_track.h>
 #include <class_marker_pcb.h>
+#include <class_zone.h>
 #include <pcb_base_frame.h>
 #include <confirm.h>
+#include <thread_pool.h>
 
 #include <gal/graphics_abstraction_layer.h>
 
@@ -141,12 +143,17 @@ void PCB_DRAW_PANEL_GAL::DisplayBoard( BOARD* aBoard )
 {
     m_view->Clear();
 
-    // Load zones
-    for( auto zone : aBoard->Zones() )
+    // Load zones.  Their filled areas, which may not even be loaded from the board file
+    // yet, are triangulated in parallel.
+    ZONE_CONTAINERS& zones = aBoard->Zones();
+
+    THREAD_POOL::Instance().ParallelFor( zones.size(), [&]( size_t i )
     {
-        zone->CacheTriangulation();
+        zones[i]->CacheTriangulation();
+    } );
+
+    for( auto zone : zones )
         m_view->Add( zone );
-    }
 
     // Load drawings
     for( auto drawing : const_cast<BOARD*>(aBoard)->Drawings() )
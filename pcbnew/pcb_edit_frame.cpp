@@ -1094,6 +1094,14 @@ void PCB_EDIT_FRAME::OnModify( )
 }
 
 
+void PCB_EDIT_FRAME::OnBoardItemsChanged( const std::vector<EDA_RECT>& aDirtyAreas,
+                                          const std::vector<const BOARD_ITEM*>& aRemovedItems )
+{
+    if( Settings().m_incrementalDrc && !aDirtyAreas.empty() )
+        m_drc->TestChangedAreas( aDirtyAreas, aRemovedItems );
+}
+
+
 void PCB_EDIT_FRAME::SVG_Print( wxCommandEvent& event )
 {
     PCB_PLOT_PARAMS  plot_prms = GetPlotSettings();
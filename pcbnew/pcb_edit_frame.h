@@ -616,6 +616,13 @@ public:
      */
     virtual void OnModify() override;
 
+    /**
+     * Function OnBoardItemsChanged
+     * runs the incremental DRC on the areas changed by a commit, when it is enabled.
+     */
+    virtual void OnBoardItemsChanged( const std::vector<EDA_RECT>& aDirtyAreas,
+                const std::vector<const BOARD_ITEM*>& aRemovedItems ) override;
+
     /**
      * Function SetActiveLayer
      * will change the currently active layer to \a aLayer and also
@@ -62,6 +62,8 @@ public:
     static bool m_dragSelects;                  // True: Drag gesture always draws a selection box,
                                                 // False: Drag will preselect an item and move it
 
+    bool    m_incrementalDrc = false;           // True to test the areas changed by each edit
+
     MAGNETIC_PAD_OPTION_VALUES  m_magneticPads  = CAPTURE_CURSOR_IN_TRACK_TOOL;
     MAGNETIC_PAD_OPTION_VALUES  m_magneticTracks = CAPTURE_CURSOR_IN_TRACK_TOOL;
 
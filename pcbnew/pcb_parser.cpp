@@ -27,9 +27,14 @@
  * @brief Pcbnew s-expression file format parser implementation.
  */
 
+#include <algorithm>
 #include <errno.h>
+#include <exception>
+#include <iterator>
+#include <memory>
 #include <common.h>
 #include <confirm.h>
+#include <kicad_string.h>
 #include <macros.h>
 #include <trigo.h>
 #include <title_block.h>
@@ -49,6 +54,7 @@
 #include <pcb_plot_params.h>
 #include <zones.h>
 #include <pcb_parser.h>
+#include <thread_pool.h>
 
 using namespace PCB_KEYS_T;
 
@@ -59,6 +65,7 @@ void PCB_PARSER::init()
     m_requiredVersion = 0;
     m_layerIndices.clear();
     m_layerMasks.clear();
+    m_checkedZones.clear();
 
     // Add untranslated default (i.e. english) layernames.
     // Some may be overridden later if parsing a board rather than a footprint.
@@ -127,7 +134,8 @@ double PCB_PARSER::parseDouble()
 
     errno = 0;
 
-    double fval = strtod( CurText(), &tmp );
+    // Not strtod(): the parser must not depend on the locale
+    double fval = StrToDouble( CurText(), &tmp );
 
     if( errno )
     {
@@ -443,7 +451,6 @@ BOARD_ITEM* PCB_PARSER::Parse()
 {
     T               token;
     BOARD_ITEM*     item;
-    LOCALE_IO       toggle;
 
     // MODULEs can be prefixed with an initial block of single line comments and these
     // are kept for Format() so they round trip in s-expression form.  BOARDs might
@@ -478,6 +485,786 @@ BOARD_ITEM* PCB_PARSER::Parse()
 }
 
 
+// The tokens starting the board items, as opposed to the board settings sections
+static const T boardItemTokens[] =
+{
+    T_gr_arc, T_gr_circle, T_gr_curve, T_gr_line, T_gr_poly, T_gr_text,
+    T_dimension, T_module, T_segment, T_via, T_zone, T_target
+};
+
+
+/**
+ * The contents of a board file: its text, or its tokens as recorded by
+ * DSNLEXER::RecordTokens().
+ */
+struct BOARD_FILE_DATA
+{
+    const char* m_data;
+    size_t      m_length;
+    bool        m_isTokens;
+};
+
+
+/**
+ * A top level item of a board file, i.e. a list inside the kicad_pcb list.
+ */
+struct BOARD_FILE_SPAN
+{
+    size_t      m_begin;        ///< offset of the opening parenthesis in the file data
+    size_t      m_end;          ///< offset following the closing parenthesis
+    unsigned    m_line;         ///< count of lines before m_begin (0 for tokens)
+    unsigned    m_column;       ///< offset of m_begin in its line (0 for tokens)
+};
+
+
+static inline bool isSpanSpace( char c )
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+
+/**
+ * Function splitBoardFile
+ * finds the top level items of the board file held by aText.  The text is not tokenized:
+ * only the parentheses, quoted strings and comment lines are recognized, following the
+ * rules of DSNLEXER.
+ * @return false if aText cannot be split, e.g. if it is not a board file, or if its
+ *         parentheses do not match.
+ */
+static bool splitBoardFile( const char* aText, size_t aLength,
+                            std::vector<BOARD_FILE_SPAN>& aSpans )
+{
+    static const char   header[] = "kicad_pcb";
+    const size_t        headerLen = sizeof( header ) - 1;
+
+    const char* end = aText + aLength;
+    const char* lineStart = aText;
+    unsigned    line = 0;
+    int         depth = 0;
+    bool        lineHead = true;        // only white space since the start of the line
+    bool        tokenStart = true;      // the previous character is a separator
+
+    BOARD_FILE_SPAN span;
+
+    for( const char* p = aText; p < end; ++p )
+    {
+        if( isSpanSpace( *p ) )
+        {
+            if( *p == '\n' )
+            {
+                ++line;
+                lineStart = p + 1;
+                lineHead = true;
+            }
+
+            tokenStart = true;
+            continue;
+        }
+
+        // A '#' starting a line is a comment line
+        if( *p == '#' && lineHead )
+        {
+            const char* eol = (const char*) memchr( p, '\n', end - p );
+            p = ( eol ? eol : end ) - 1;
+            continue;
+        }
+
+        lineHead = false;
+
+        switch( *p )
+        {
+        case '(':
+            if( depth == 0 )
+            {
+                if( (size_t) ( end - p ) <= headerLen + 1 || memcmp( p + 1, header, headerLen )
+                        || !( isSpanSpace( p[headerLen + 1] ) || p[headerLen + 1] == '(' ) )
+                    return false;
+
+                p += headerLen;
+            }
+            else if( depth == 1 )
+            {
+                span.m_begin = p - aText;
+                span.m_line = line;
+                span.m_column = p - lineStart;
+            }
+
+            ++depth;
+            tokenStart = true;
+            break;
+
+        case ')':
+            if( depth == 0 )
+                return false;
+
+            if( --depth == 1 )
+            {
+                span.m_end = p + 1 - aText;
+                aSpans.push_back( span );
+            }
+            else if( depth == 0 )
+            {
+                return true;    // the rest of the file is ignored by the parser too
+            }
+
+            tokenStart = true;
+            break;
+
+        case '\0':
+            return false;
+
+        case '"':
+            // Only the lists are expected at the top level
+            if( depth < 2 )
+                return false;
+
+            if( tokenStart )
+            {
+                // A quoted string, which cannot span several lines
+                for( ++p; p < end && *p != '"'; ++p )
+                {
+                    if( *p == '\n' )
+                        return false;
+
+                    if( *p == '\\' && p + 1 < end && p[1] != '\n' )
+                        ++p;
+                }
+
+                if( p == end )
+                    return false;
+
+                tokenStart = true;
+                break;
+            }
+
+            tokenStart = false;
+            break;
+
+        default:
+            if( depth < 2 )
+                return false;
+
+            tokenStart = false;
+        }
+    }
+
+    // The end of the file is reached before the end of the board
+    return false;
+}
+
+
+/**
+ * Function splitBoardTokens
+ * finds the top level items of the board file whose tokens are aTokens, like
+ * splitBoardFile() does with its text.
+ * @return false if aTokens cannot be split, e.g. if they are corrupt.
+ */
+static bool splitBoardTokens( const char* aTokens, size_t aLength,
+                              std::vector<BOARD_FILE_SPAN>& aSpans )
+{
+    const char* end = aTokens + aLength;
+    int         depth = 0;
+    int         tok;
+
+    BOARD_FILE_SPAN span = { 0, 0, 0, 0 };
+
+    for( const char* p = aTokens; p < end; )
+    {
+        const char* next = TOKEN_READER::DecodeToken( p, end, &tok );
+
+        if( !next )
+            return false;
+
+        switch( tok )
+        {
+        case DSN_LEFT:
+            if( depth == 0 )
+            {
+                next = TOKEN_READER::DecodeToken( next, end, &tok );
+
+                if( !next || tok != T_kicad_pcb )
+                    return false;
+            }
+            else if( depth == 1 )
+            {
+                span.m_begin = p - aTokens;
+            }
+
+            ++depth;
+            break;
+
+        case DSN_RIGHT:
+            if( depth == 0 )
+                return false;
+
+            if( --depth == 1 )
+            {
+                span.m_end = next - aTokens;
+                aSpans.push_back( span );
+            }
+            else if( depth == 0 )
+            {
+                return true;
+            }
+
+            break;
+
+        case DSN_COMMENT:
+            break;
+
+        default:
+            // Only the lists are expected at the top level
+            if( depth < 2 )
+                return false;
+        }
+
+        p = next;
+    }
+
+    return false;
+}
+
+
+/**
+ * Function splitBoardData
+ * finds the top level items of aFile, see splitBoardFile() and splitBoardTokens().
+ */
+static bool splitBoardData( const BOARD_FILE_DATA& aFile, std::vector<BOARD_FILE_SPAN>& aSpans )
+{
+    if( aFile.m_isTokens )
+        return splitBoardTokens( aFile.m_data, aFile.m_length, aSpans );
+
+    return splitBoardFile( aFile.m_data, aFile.m_length, aSpans );
+}
+
+
+/**
+ * Function spanData
+ * @return the data of aSpan.  A text is preceded by as many spaces as characters precede
+ * it in its first line, so the lexer reports the right offsets in its error messages.
+ */
+static std::string spanData( const BOARD_FILE_DATA& aFile, const BOARD_FILE_SPAN& aSpan )
+{
+    std::string data( aSpan.m_column, ' ' );
+    data.append( aFile.m_data + aSpan.m_begin, aSpan.m_end - aSpan.m_begin );
+
+    return data;
+}
+
+
+/**
+ * Function spanKeyword
+ * @return true if the list of aSpan starts with aKeyword.
+ */
+static bool spanKeyword( const BOARD_FILE_DATA& aFile, const BOARD_FILE_SPAN& aSpan,
+                         T aKeyword )
+{
+    const char* p = aFile.m_data + aSpan.m_begin;
+    const char* end = aFile.m_data + aSpan.m_end;
+
+    if( aFile.m_isTokens )
+    {
+        int tok;
+
+        p = TOKEN_READER::DecodeToken( p, end, &tok );
+
+        return p && TOKEN_READER::DecodeToken( p, end, &tok ) && tok == aKeyword;
+    }
+
+    const char* keyword = PCB_LEXER::TokenName( aKeyword );
+    size_t      len = strlen( keyword );
+
+    for( ++p; p < end && isSpanSpace( *p ); ++p )
+        ;
+
+    return (size_t) ( end - p ) > len && !memcmp( p, keyword, len )
+            && ( isSpanSpace( p[len] ) || p[len] == '(' || p[len] == ')' );
+}
+
+
+/**
+ * Function newSpanReader
+ * @return a reader of aData, a part of aFile following aLine lines of it.
+ */
+static std::unique_ptr<LINE_READER> newSpanReader( bool aIsTokens, const std::string& aData,
+                                                   const wxString& aSource, unsigned aLine )
+{
+    if( aIsTokens )
+        return std::unique_ptr<LINE_READER>( new TOKEN_READER( aData, aSource ) );
+
+    return std::unique_ptr<LINE_READER>( new STRING_LINE_READER( aData, aSource, aLine ) );
+}
+
+
+/**
+ * Function splitZoneFill
+ * moves the (filled_polygon ...) and (fill_segments ...) lists of the zone of aSpan to
+ * aFillText, and the rest of the zone to aZoneText, padded like by spanData().  Each text
+ * keeps the line breaks of the other one, so the lexers reading them report the same line
+ * numbers and offsets as a lexer reading the file.
+ */
+static void splitZoneFill( const char* aText, const BOARD_FILE_SPAN& aSpan,
+                           std::string& aZoneText, std::string& aFillText )
+{
+    static const char* const keywords[] = { "filled_polygon", "fill_segments" };
+
+    const char* begin = aText + aSpan.m_begin;
+    const char* end = aText + aSpan.m_end;
+    const char* lineStart = begin - aSpan.m_column;
+    unsigned    line = 0;               // relative to the first line of the span
+    int         depth = 0;
+    bool        lineHead = false;
+    bool        tokenStart = true;
+
+    const char* copied = begin;         // the zone text is copied up to there
+    const char* block = NULL;           // the fill list being read, if any
+    unsigned    blockLine = 0;
+    unsigned    blockColumn = 0;
+    unsigned    fillLine = 0;           // the line at the end of aFillText
+
+    aZoneText.assign( aSpan.m_column, ' ' );
+    aFillText.clear();
+
+    // The span is known to be well formed: splitBoardFile() has checked it
+    for( const char* p = begin; p < end; ++p )
+    {
+        if( isSpanSpace( *p ) )
+        {
+            if( *p == '\n' )
+            {
+                ++line;
+                lineStart = p + 1;
+                lineHead = true;
+            }
+
+            tokenStart = true;
+            continue;
+        }
+
+        if( *p == '#' && lineHead )
+        {
+            while( p + 1 < end && p[1] != '\n' )
+                ++p;
+
+            continue;
+        }
+
+        lineHead = false;
+
+        switch( *p )
+        {
+        case '(':
+            if( depth == 1 )
+            {
+                for( const char* keyword : keywords )
+                {
+                    size_t keywordLen = strlen( keyword );
+
+                    if( (size_t) ( end - p ) > keywordLen + 1
+                            && !memcmp( p + 1, keyword, keywordLen )
+                            && ( isSpanSpace( p[keywordLen + 1] ) || p[keywordLen + 1] == '(' ) )
+                    {
+                        block = p;
+                        blockLine = line;
+                        blockColumn = p - lineStart;
+                        break;
+                    }
+                }
+            }
+
+            ++depth;
+            tokenStart = true;
+            break;
+
+        case ')':
+            if( --depth == 1 && block )
+            {
+                // The zone text keeps only the line breaks of the block
+                aZoneText.append( copied, block );
+                aZoneText.append( std::count( block, p, '\n' ), '\n' );
+                copied = p + 1;
+
+                // The fill text gets the block at its line and column
+                if( blockLine > fillLine )
+                {
+                    aFillText.append( blockLine - fillLine, '\n' );
+                    fillLine = blockLine;
+                }
+
+                size_t fillColumn = aFillText.size() - ( aFillText.rfind( '\n' ) + 1 );
+
+                if( blockColumn > fillColumn )
+                    aFillText.append( blockColumn - fillColumn, ' ' );
+
+                aFillText.append( block, p + 1 );
+                fillLine = line;
+                block = NULL;
+            }
+
+            tokenStart = true;
+            break;
+
+        case '"':
+            if( tokenStart )
+            {
+                for( ++p; p < end && *p != '"'; ++p )
+                {
+                    if( *p == '\\' && p + 1 < end && p[1] != '\n' )
+                        ++p;
+                }
+
+                tokenStart = true;
+                break;
+            }
+
+            tokenStart = false;
+            break;
+
+        default:
+            tokenStart = false;
+        }
+    }
+
+    aZoneText.append( copied, end );
+}
+
+
+/**
+ * Function splitZoneTokens
+ * moves the (filled_polygon ...) and (fill_segments ...) lists of the zone of aSpan to
+ * aFillTokens, and the rest of the zone to aZoneTokens, like splitZoneFill() does with
+ * the text of the zone.
+ */
+static void splitZoneTokens( const char* aTokens, const BOARD_FILE_SPAN& aSpan,
+                             std::string& aZoneTokens, std::string& aFillTokens )
+{
+    const char* end = aTokens + aSpan.m_end;
+    const char* copied = aTokens + aSpan.m_begin;
+    const char* block = NULL;
+    int         depth = 0;
+    int         tok;
+
+    aZoneTokens.clear();
+    aFillTokens.clear();
+
+    // The span is known to be well formed: splitBoardTokens() has checked it
+    for( const char* p = copied; p < end; )
+    {
+        const char* next = TOKEN_READER::DecodeToken( p, end, &tok );
+
+        if( tok == DSN_LEFT )
+        {
+            if( depth == 1 && TOKEN_READER::DecodeToken( next, end, &tok )
+                    && ( tok == T_filled_polygon || tok == T_fill_segments ) )
+                block = p;
+
+            ++depth;
+        }
+        else if( tok == DSN_RIGHT && --depth == 1 && block )
+        {
+            aZoneTokens.append( copied, block );
+            aFillTokens.append( block, next );
+            copied = next;
+            block = NULL;
+        }
+
+        p = next;
+    }
+
+    aZoneTokens.append( copied, end );
+}
+
+
+/**
+ * The filled polygons and fill segments of a zone of a board file, parsed by a PCB_PARSER
+ * when they are first needed.
+ */
+class PCB_LAZY_ZONE_FILL : public ZONE_LAZY_FILL
+{
+public:
+    PCB_LAZY_ZONE_FILL( std::string aData, bool aIsTokens, const wxString& aSource,
+                        unsigned aLine ) :
+        m_data( std::move( aData ) ),
+        m_isTokens( aIsTokens ),
+        m_source( aSource ),
+        m_line( aLine )
+    {
+    }
+
+    void Load( SHAPE_POLY_SET& aFill, ZONE_SEGMENT_FILL& aSegments ) const override
+    {
+        std::unique_ptr<LINE_READER> reader = newSpanReader( m_isTokens, m_data, m_source,
+                                                             m_line );
+        PCB_PARSER parser( reader.get() );
+
+        parser.ParseZoneFill( aFill, aSegments );
+    }
+
+private:
+    std::string     m_data;     ///< the fill lists, split by splitZoneFill()
+                                ///< or splitZoneTokens()
+    bool            m_isTokens; ///< m_data holds tokens, not text
+    wxString        m_source;   ///< the file name, for the error messages
+    unsigned        m_line;     ///< the count of lines preceding m_data in the file
+};
+
+
+BOARD* PCB_PARSER::ParseBoard( const char* aText, size_t aLength )
+{
+    BOARD_FILE_DATA file = { aText, aLength, false };
+
+    return parseBoardData( file );
+}
+
+
+BOARD* PCB_PARSER::ParseBoardTokens( const std::string& aTokens )
+{
+    wxASSERT( m_board == NULL );
+
+    BOARD_FILE_DATA file = { aTokens.data(), aTokens.size(), true };
+
+    try
+    {
+        return parseBoardData( file );
+    }
+    catch( const IO_ERROR& )
+    {
+        // Leave the parser ready to parse the text of the file
+        delete m_board;
+        SetBoard( NULL );
+        curTok = DSN_NONE;
+
+        return NULL;
+    }
+}
+
+
+BOARD* PCB_PARSER::parseBoardData( const BOARD_FILE_DATA& aFile )
+{
+    std::vector<BOARD_FILE_SPAN> spans;
+
+    if( !splitBoardData( aFile, spans ) || spans.empty() )
+        return NULL;
+
+    // The header is made of the version and host lists, or only the host list for the
+    // oldest files
+    size_t headerCount = spanKeyword( aFile, spans[0], T_version ) ? 2 : 1;
+
+    if( headerCount > spans.size() )
+        return NULL;
+
+    std::vector<bool> boardItems( spans.size() );
+
+    for( size_t ii = headerCount; ii < spans.size(); ++ii )
+    {
+        for( T token : boardItemTokens )
+        {
+            if( spanKeyword( aFile, spans[ii], token ) )
+            {
+                boardItems[ii] = true;
+                break;
+            }
+        }
+    }
+
+    if( m_board == NULL )
+        m_board = new BOARD();
+
+    // Each span is read by its own reader.  The file reader is given back at the end,
+    // for the error messages of the caller.
+    struct READER_RESTORER
+    {
+        PCB_PARSER*     m_parser;
+        LINE_READER*    m_reader;
+
+        ~READER_RESTORER()
+        {
+            m_parser->SetLineReader( m_reader );
+        }
+    } restorer = { this, reader };
+
+    wxString source = CurSource();
+
+    try
+    {
+        std::unique_ptr<LINE_READER> headerReader = newSpanReader( aFile.m_isTokens,
+                std::string( aFile.m_data, spans[headerCount - 1].m_end ), source, 0 );
+        SetLineReader( headerReader.get() );
+
+        NextTok();      // the "(kicad_pcb" checked by splitBoardData()
+        NextTok();
+        parseHeader();
+
+        // The settings sections are parsed in order, and the runs of board items between
+        // them in parallel: the items see the same settings as in a sequential parsing.
+        for( size_t ii = headerCount; ii < spans.size(); )
+        {
+            if( boardItems[ii] )
+            {
+                size_t first = ii;
+
+                while( ii < spans.size() && boardItems[ii] )
+                    ++ii;
+
+                parseBoardItems( aFile, &spans[first], &spans[0] + ii, source );
+            }
+            else
+            {
+                std::unique_ptr<LINE_READER> sectionReader = newSpanReader( aFile.m_isTokens,
+                        spanData( aFile, spans[ii] ), source, spans[ii].m_line );
+                SetLineReader( sectionReader.get() );
+
+                NextTok();
+                parseBoardSection( NextTok() );
+                ++ii;
+            }
+        }
+    }
+    catch( const PARSE_ERROR& parse_error )
+    {
+        if( m_tooRecent )
+            throw FUTURE_FORMAT_ERROR( parse_error, GetRequiredVersion() );
+        else
+            throw;
+    }
+
+    return m_board;
+}
+
+
+void PCB_PARSER::parseBoardItems( const BOARD_FILE_DATA& aFile, const BOARD_FILE_SPAN* aFirst,
+                                  const BOARD_FILE_SPAN* aLast, const wxString& aSource )
+{
+    THREAD_POOL& pool = THREAD_POOL::Instance();
+    size_t       count = aLast - aFirst;
+
+    // Contiguous batches of about the same size, a few per thread so a big zone does not
+    // keep a thread busy alone at the end
+    size_t              batchSize = ( aLast[-1].m_end - aFirst->m_begin )
+                                    / ( 4 * pool.GetThreadCount() ) + 1;
+    std::vector<size_t> batchStarts;
+    size_t              size = batchSize;
+
+    for( size_t ii = 0; ii < count; ++ii )
+    {
+        if( size >= batchSize )
+        {
+            batchStarts.push_back( ii );
+            size = 0;
+        }
+
+        size += aFirst[ii].m_end - aFirst[ii].m_begin;
+    }
+
+    batchStarts.push_back( count );
+
+    struct BATCH
+    {
+        std::exception_ptr  m_error;
+        int                 m_requiredVersion;
+        std::vector< std::pair<ZONE_CONTAINER*, wxString> > m_zoneNetsToFix;
+        std::vector<ZONE_CONTAINER*>                        m_checkedZones;
+    };
+
+    std::vector<BOARD_ITEM*> items( count, nullptr );
+    std::vector<BATCH>       batches( batchStarts.size() - 1 );
+
+    auto parseBatch = [&]( size_t aBatch )
+    {
+        // A parser per batch, knowing the layers and nets of the board
+        PCB_PARSER parser;
+
+        parser.m_board = m_board;
+        parser.m_layerIndices = m_layerIndices;
+        parser.m_layerMasks = m_layerMasks;
+        parser.m_netCodes = m_netCodes;
+        parser.m_requiredVersion = m_requiredVersion;
+        parser.m_tooRecent = m_tooRecent;
+        parser.m_sharedBoard = true;
+
+        try
+        {
+            for( size_t ii = batchStarts[aBatch]; ii < batchStarts[aBatch + 1]; ++ii )
+            {
+                std::string itemData;
+                std::string fillData;
+
+                // The filled areas of the zones are parsed only when they are needed
+                if( !spanKeyword( aFile, aFirst[ii], T_zone ) )
+                    itemData = spanData( aFile, aFirst[ii] );
+                else if( aFile.m_isTokens )
+                    splitZoneTokens( aFile.m_data, aFirst[ii], itemData, fillData );
+                else
+                    splitZoneFill( aFile.m_data, aFirst[ii], itemData, fillData );
+
+                std::unique_ptr<LINE_READER> spanReader = newSpanReader( aFile.m_isTokens,
+                        itemData, aSource, aFirst[ii].m_line );
+                parser.SetLineReader( spanReader.get() );
+
+                parser.NextTok();
+                items[ii] = parser.parseBoardItem( parser.NextTok() );
+
+                if( !fillData.empty() )
+                {
+                    auto fill = std::make_shared<PCB_LAZY_ZONE_FILL>( std::move( fillData ),
+                                                                      aFile.m_isTokens, aSource,
+                                                                      aFirst[ii].m_line );
+
+                    static_cast<ZONE_CONTAINER*>( items[ii] )->SetLazyFill( fill );
+                }
+            }
+        }
+        catch( ... )
+        {
+            batches[aBatch].m_error = std::current_exception();
+        }
+
+        batches[aBatch].m_requiredVersion = parser.m_requiredVersion;
+        batches[aBatch].m_zoneNetsToFix = std::move( parser.m_zoneNetsToFix );
+        batches[aBatch].m_checkedZones = std::move( parser.m_checkedZones );
+    };
+
+    pool.ParallelFor( batches.size(), parseBatch );
+
+    // The batches are in file order, so the error reported is the first one of the file,
+    // as in a sequential parsing
+    std::exception_ptr error;
+
+    for( const BATCH& batch : batches )
+    {
+        m_requiredVersion = std::max( m_requiredVersion, batch.m_requiredVersion );
+
+        if( batch.m_error )
+        {
+            error = batch.m_error;
+            break;
+        }
+    }
+
+    m_tooRecent = ( m_requiredVersion > SEXPR_BOARD_FILE_VERSION );
+
+    if( error )
+    {
+        for( BOARD_ITEM* item : items )
+            delete item;
+
+        std::rethrow_exception( error );
+    }
+
+    for( const BATCH& batch : batches )
+    {
+        for( const auto& zoneNet : batch.m_zoneNetsToFix )
+            fixZoneNet( zoneNet.first, zoneNet.second );
+
+        m_checkedZones.insert( m_checkedZones.end(), batch.m_checkedZones.begin(),
+                               batch.m_checkedZones.end() );
+    }
+
+    for( BOARD_ITEM* item : items )
+        m_board->Add( item, ADD_APPEND );
+}
+
+
 BOARD* PCB_PARSER::parseBOARD()
 {
     try
@@ -507,80 +1294,100 @@ BOARD* PCB_PARSER::parseBOARD_unchecked()
 
         token = NextTok();
 
-        switch( token )
-        {
-        case T_general:
-            parseGeneralSection();
-            break;
+        if( isBoardItem( token ) )
+            m_board->Add( parseBoardItem( token ), ADD_APPEND );
+        else
+            parseBoardSection( token );
+    }
 
-        case T_page:
-            parsePAGE_INFO();
-            break;
+    return m_board;
+}
 
-        case T_title_block:
-            parseTITLE_BLOCK();
-            break;
 
-        case T_layers:
-            parseLayers();
-            break;
+bool PCB_PARSER::isBoardItem( T aToken )
+{
+    return std::find( std::begin( boardItemTokens ), std::end( boardItemTokens ), aToken )
+            != std::end( boardItemTokens );
+}
 
-        case T_setup:
-            parseSetup();
-            break;
 
-        case T_net:
-            parseNETINFO_ITEM();
-            break;
+void PCB_PARSER::parseBoardSection( T aToken )
+{
+    switch( aToken )
+    {
+    case T_general:
+        parseGeneralSection();
+        break;
 
-        case T_net_class:
-            parseNETCLASS();
-            break;
+    case T_page:
+        parsePAGE_INFO();
+        break;
 
-        case T_gr_arc:
-        case T_gr_circle:
-        case T_gr_curve:
-        case T_gr_line:
-        case T_gr_poly:
-            m_board->Add( parseDRAWSEGMENT(), ADD_APPEND );
-            break;
+    case T_title_block:
+        parseTITLE_BLOCK();
+        break;
 
-        case T_gr_text:
-            m_board->Add( parseTEXTE_PCB(), ADD_APPEND );
-            break;
+    case T_layers:
+        parseLayers();
+        break;
 
-        case T_dimension:
-            m_board->Add( parseDIMENSION(), ADD_APPEND );
-            break;
+    case T_setup:
+        parseSetup();
+        break;
 
-        case T_module:
-            m_board->Add( parseMODULE(), ADD_APPEND );
-            break;
+    case T_net:
+        parseNETINFO_ITEM();
+        break;
 
-        case T_segment:
-            m_board->Add( parseTRACK(), ADD_APPEND );
-            break;
+    case T_net_class:
+        parseNETCLASS();
+        break;
 
-        case T_via:
-            m_board->Add( parseVIA(), ADD_APPEND );
-            break;
+    default:
+        wxString err;
+        err.Printf( _( "Unknown token \"%s\"" ), GetChars( FromUTF8() ) );
+        THROW_PARSE_ERROR( err, CurSource(), CurLine(), CurLineNumber(), CurOffset() );
+    }
+}
 
-        case T_zone:
-            m_board->Add( parseZONE_CONTAINER(), ADD_APPEND );
-            break;
 
-        case T_target:
-            m_board->Add( parsePCB_TARGET(), ADD_APPEND );
-            break;
+BOARD_ITEM* PCB_PARSER::parseBoardItem( T aToken )
+{
+    switch( aToken )
+    {
+    case T_gr_arc:
+    case T_gr_circle:
+    case T_gr_curve:
+    case T_gr_line:
+    case T_gr_poly:
+        return parseDRAWSEGMENT();
 
-        default:
-            wxString err;
-            err.Printf( _( "Unknown token \"%s\"" ), GetChars( FromUTF8() ) );
-            THROW_PARSE_ERROR( err, CurSource(), CurLine(), CurLineNumber(), CurOffset() );
-        }
-    }
+    case T_gr_text:
+        return parseTEXTE_PCB();
 
-    return m_board;
+    case T_dimension:
+        return parseDIMENSION();
+
+    case T_module:
+        return parseMODULE();
+
+    case T_segment:
+        return parseTRACK();
+
+    case T_via:
+        return parseVIA();
+
+    case T_zone:
+        return parseZONE_CONTAINER();
+
+    case T_target:
+        return parsePCB_TARGET();
+
+    default:
+        wxString err;
+        err.Printf( _( "Unknown token \"%s\"" ), GetChars( FromUTF8() ) );
+        THROW_PARSE_ERROR( err, CurSource(), CurLine(), CurLineNumber(), CurOffset() );
+    }
 }
 
 
@@ -2982,6 +3789,21 @@ ZONE_CONTAINER* PCB_PARSER::parseZONE_CONTAINER()
                     NeedRIGHT();
                     break;
 
+                case T_checksum:
+                    {
+                        MD5_HASH fingerprint;
+
+                        NeedSYMBOLorNUMBER();
+
+                        if( !fingerprint.Parse( CurText() ) )
+                            Expecting( "fill checksum" );
+
+                        zone->SetFillFingerprint( fingerprint );
+                        m_checkedZones.push_back( zone.get() );
+                        NeedRIGHT();
+                    }
+                    break;
+
                 case T_smoothing:
                     switch( NextTok() )
                     {
@@ -3086,44 +3908,14 @@ ZONE_CONTAINER* PCB_PARSER::parseZONE_CONTAINER()
             break;
 
         case T_filled_polygon:
-            {
-                // "(filled_polygon (pts"
-                NeedLEFT();
-                token = NextTok();
-
-                if( token != T_pts )
-                    Expecting( T_pts );
-
-                pts.NewOutline();
-
-                for( token = NextTok();  token != T_RIGHT;  token = NextTok() )
-                {
-                    pts.Append( parseXY() );
-                }
-
-                NeedRIGHT();
-            }
+            parseFilledPolygon( pts );
             break;
 
         case T_fill_segments:
             {
                 ZONE_SEGMENT_FILL segs;
 
-                for( token = NextTok();  token != T_RIGHT;  token = NextTok() )
-                {
-                    if( token != T_LEFT )
-                        Expecting( T_LEFT );
-
-                    token = NextTok();
-
-                    if( token != T_pts )
-                        Expecting( T_pts );
-
-                    SEG segment( parseXY(), parseXY() );
-                    NeedRIGHT();
-                    segs.push_back( segment );
-                }
-
+                parseFillSegments( segs );
                 zone->SetFillSegments( segs );
             }
             break;
@@ -3160,37 +3952,134 @@ ZONE_CONTAINER* PCB_PARSER::parseZONE_CONTAINER()
     // Ensure the zone net name is valid, and matches the net code, for copper zones
     if( zone_has_net && ( zone->GetNet()->GetNetname() != netnameFromfile ) )
     {
-        // Can happens which old boards, with nonexistent nets ...
-        // or after being edited by hand
-        // We try to fix the mismatch.
-        NETINFO_ITEM* net = m_board->FindNet( netnameFromfile );
+        // The board cannot be modified while other threads are reading it
+        if( m_sharedBoard )
+            m_zoneNetsToFix.emplace_back( zone.get(), netnameFromfile );
+        else
+            fixZoneNet( zone.get(), netnameFromfile );
+    }
+
+    return zone.release();
+}
+
+
+void PCB_PARSER::parseFilledPolygon( SHAPE_POLY_SET& aFill )
+{
+    wxCHECK_RET( CurTok() == T_filled_polygon,
+                 wxT( "Cannot parse " ) + GetTokenString( CurTok() ) + wxT( " as filled_polygon." ) );
+
+    // "(filled_polygon (pts"
+    NeedLEFT();
+
+    if( NextTok() != T_pts )
+        Expecting( T_pts );
+
+    aFill.NewOutline();
+
+    for( T token = NextTok();  token != T_RIGHT;  token = NextTok() )
+    {
+        aFill.Append( parseXY() );
+    }
+
+    NeedRIGHT();
+}
+
+
+void PCB_PARSER::parseFillSegments( ZONE_SEGMENT_FILL& aSegments )
+{
+    wxCHECK_RET( CurTok() == T_fill_segments,
+                 wxT( "Cannot parse " ) + GetTokenString( CurTok() ) + wxT( " as fill_segments." ) );
+
+    for( T token = NextTok();  token != T_RIGHT;  token = NextTok() )
+    {
+        if( token != T_LEFT )
+            Expecting( T_LEFT );
+
+        token = NextTok();
+
+        if( token != T_pts )
+            Expecting( T_pts );
+
+        SEG segment( parseXY(), parseXY() );
+        NeedRIGHT();
+        aSegments.push_back( segment );
+    }
+}
 
-        if( net )   // An existing net has the same net name. use it for the zone
-            zone->SetNetCode( net->GetNet() );
-        else    // Not existing net: add a new net to keep trace of the zone netname
+
+void PCB_PARSER::ParseZoneFill( SHAPE_POLY_SET& aFill, ZONE_SEGMENT_FILL& aSegments )
+{
+    for( T token = NextTok();  token != T_EOF;  token = NextTok() )
+    {
+        if( token != T_LEFT )
+            Expecting( T_LEFT );
+
+        switch( NextTok() )
         {
-            int newnetcode = m_board->GetNetCount();
-            net = new NETINFO_ITEM( m_board, netnameFromfile, newnetcode );
-            m_board->Add( net );
-
-            // Store the new code mapping
-            pushValueIntoMap( newnetcode, net->GetNet() );
-            // and update the zone netcode
-            zone->SetNetCode( net->GetNet() );
-
-            // FIXME: a call to any GUI item is not allowed in io plugins:
-            // Change this code to generate a warning message outside this plugin
-            // Prompt the user
-            wxString msg;
-            msg.Printf( _( "There is a zone that belongs to a not existing net\n"
-                           "\"%s\"\n"
-                           "you should verify and edit it (run DRC test)." ),
-                           GetChars( netnameFromfile ) );
-            DisplayError( NULL, msg );
+        case T_filled_polygon:
+            parseFilledPolygon( aFill );
+            break;
+
+        case T_fill_segments:
+            parseFillSegments( aSegments );
+            break;
+
+        default:
+            Expecting( "filled_polygon or fill_segments" );
         }
     }
+}
 
-    return zone.release();
+
+void PCB_PARSER::DiscardStaleZoneFills()
+{
+    if( m_checkedZones.empty() )
+        return;
+
+    // The clearances hashed in the fingerprints depend on the net classes of the nets,
+    // which are only given to the nets by the board loaders once the plugin is done
+    m_board->SynchronizeNetsAndNetClasses();
+
+    for( ZONE_CONTAINER* zone : m_checkedZones )
+    {
+        if( zone->IsFilled() && zone->ComputeFillFingerprint() != zone->GetFillFingerprint() )
+            zone->UnFill();
+    }
+
+    m_checkedZones.clear();
+}
+
+
+void PCB_PARSER::fixZoneNet( ZONE_CONTAINER* aZone, const wxString& aNetName )
+{
+    // Can happens which old boards, with nonexistent nets ...
+    // or after being edited by hand
+    // We try to fix the mismatch.
+    NETINFO_ITEM* net = m_board->FindNet( aNetName );
+
+    if( net )   // An existing net has the same net name. use it for the zone
+        aZone->SetNetCode( net->GetNet() );
+    else    // Not existing net: add a new net to keep trace of the zone netname
+    {
+        int newnetcode = m_board->GetNetCount();
+        net = new NETINFO_ITEM( m_board, aNetName, newnetcode );
+        m_board->Add( net );
+
+        // Store the new code mapping
+        pushValueIntoMap( newnetcode, net->GetNet() );
+        // and update the zone netcode
+        aZone->SetNetCode( net->GetNet() );
+
+        // FIXME: a call to any GUI item is not allowed in io plugins:
+        // Change this code to generate a warning message outside this plugin
+        // Prompt the user
+        wxString msg;
+        msg.Printf( _( "There is a zone that belongs to a not existing net\n"
+                       "\"%s\"\n"
+                       "you should verify and edit it (run DRC test)." ),
+                       GetChars( aNetName ) );
+        DisplayError( NULL, msg );
+    }
 }
 
 
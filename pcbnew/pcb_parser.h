@@ -37,6 +37,8 @@
 #include <convert_to_biu.h>                     // IU_PER_MM
 
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 
 class BOARD;
@@ -54,7 +56,11 @@ class PCB_TARGET;
 class VIA;
 class ZONE_CONTAINER;
 class MODULE_3D_SETTINGS;
+class SHAPE_POLY_SET;
+class SEG;
 struct LAYER;
+struct BOARD_FILE_DATA;
+struct BOARD_FILE_SPAN;
 
 
 /**
@@ -74,6 +80,18 @@ class PCB_PARSER : public PCB_LEXER
     bool                m_tooRecent;        ///< true if version parses as later than supported
     int                 m_requiredVersion;  ///< set to the KiCad format version this board requires
 
+    ///> true when other threads parse items of m_board at the same time: m_board is
+    ///> then read only, and the fixes of the zone nets are left to the caller
+    bool                m_sharedBoard;
+
+    ///> the zones parsed while m_sharedBoard is set, having a net name not matching
+    ///> their net code, and the net name read from the file
+    std::vector< std::pair<ZONE_CONTAINER*, wxString> > m_zoneNetsToFix;
+
+    ///> the zones whose fill fingerprint was read from the file, to be checked when the
+    ///> whole board is known
+    std::vector<ZONE_CONTAINER*> m_checkedZones;
+
     ///> Converts net code using the mapping table if available,
     ///> otherwise returns unchanged net code if < 0 or if is is out of range
     inline int getNetCode( int aNetCode )
@@ -113,6 +131,49 @@ class PCB_PARSER : public PCB_LEXER
     void parseNETINFO_ITEM();
     void parseNETCLASS();
 
+    /**
+     * Function isBoardItem
+     * @return true if aToken starts a #BOARD_ITEM of a board file (a footprint, a track,
+     *         a zone, a graphic item...), false if it starts a section of the board
+     *         settings.
+     */
+    static bool isBoardItem( T aToken );
+
+    /**
+     * Function parseBoardSection
+     * parses the board settings section started by aToken (general, layers, nets...),
+     * the current token.
+     */
+    void parseBoardSection( T aToken );
+
+    /**
+     * Function parseBoardItem
+     * parses the #BOARD_ITEM started by aToken, the current token.
+     * @return the new item, owned by the caller.
+     */
+    BOARD_ITEM* parseBoardItem( T aToken );
+
+    /**
+     * Function parseBoardData
+     * is ParseBoard() for the text or the tokens of a board file.
+     */
+    BOARD* parseBoardData( const BOARD_FILE_DATA& aFile );
+
+    /**
+     * Function parseBoardItems
+     * parses in parallel the board items held by the spans [aFirst, aLast) of aFile,
+     * and adds them to the board in file order.
+     */
+    void parseBoardItems( const BOARD_FILE_DATA& aFile, const BOARD_FILE_SPAN* aFirst,
+                          const BOARD_FILE_SPAN* aLast, const wxString& aSource );
+
+    /**
+     * Function fixZoneNet
+     * gives to aZone, whose net name does not match its net code, the net named
+     * aNetName, adding it to the board if it does not exist.
+     */
+    void fixZoneNet( ZONE_CONTAINER* aZone, const wxString& aNetName );
+
     DRAWSEGMENT*    parseDRAWSEGMENT();
     TEXTE_PCB*      parseTEXTE_PCB();
     DIMENSION*      parseDIMENSION();
@@ -130,6 +191,19 @@ class PCB_PARSER : public PCB_LEXER
     TRACK*          parseTRACK();
     VIA*            parseVIA();
     ZONE_CONTAINER* parseZONE_CONTAINER();
+
+    /**
+     * Function parseFilledPolygon
+     * parses the (pts ...) list of a filled_polygon, the current token, into a new outline
+     * of aFill.
+     */
+    void            parseFilledPolygon( SHAPE_POLY_SET& aFill );
+
+    /**
+     * Function parseFillSegments
+     * parses the (pts ...) lists of a fill_segments, the current token, into aSegments.
+     */
+    void            parseFillSegments( std::vector<SEG>& aSegments );
     PCB_TARGET*     parsePCB_TARGET();
     BOARD*          parseBOARD();
 
@@ -273,7 +347,8 @@ public:
 
     PCB_PARSER( LINE_READER* aReader = NULL ) :
         PCB_LEXER( aReader ),
-        m_board( 0 )
+        m_board( 0 ),
+        m_sharedBoard( false )
     {
         init();
     }
@@ -300,6 +375,57 @@ public:
     }
 
     BOARD_ITEM* Parse();
+
+    /**
+     * Function ParseBoard
+     * parses the board file held in memory by aText, like Parse() does, but faster.
+     *
+     * A pre-scan matching the parentheses splits the text in the top level items of
+     * the board, without tokenizing it.  The board settings are parsed in order, and
+     * the board items (footprints, tracks, zones...) are parsed in parallel, each thread
+     * having its own lexer over its share of the text.  The items are added to the board
+     * in file order, so the result is the same as the one of Parse().
+     *
+     * @param aText is the whole content of the file, whose name is CurSource().
+     * @param aLength is the length of aText.
+     * @return the board, or NULL if aText cannot be split in top level items, e.g. if
+     *         it is not a board file: it is then left to Parse() to report the error.
+     */
+    BOARD* ParseBoard( const char* aText, size_t aLength );
+
+    /**
+     * Function ParseBoardTokens
+     * parses the board file whose tokens, recorded by DSNLEXER::RecordTokens(), are
+     * aTokens, like ParseBoard() does with its text.  The parser must not have a board.
+     *
+     * @return the board, or NULL if it cannot be parsed from aTokens: the parser is then
+     *         left ready to parse the text of the file, which reports the errors.
+     */
+    BOARD* ParseBoardTokens( const std::string& aTokens );
+
+    /**
+     * Function ParseZoneFill
+     * parses the filled areas of a zone, which are the (filled_polygon ...) and
+     * (fill_segments ...) lists making the whole text of the reader, into aFill and
+     * aSegments.
+     *
+     * ParseBoard() leaves these lists to be parsed by this function when the filled areas
+     * are first needed (see #ZONE_LAZY_FILL), so the zone fills which are never looked at,
+     * or which are found stale, cost nothing.
+     */
+    void ParseZoneFill( SHAPE_POLY_SET& aFill, std::vector<SEG>& aSegments );
+
+    /**
+     * Function DiscardStaleZoneFills
+     * unfills the zones of the board just parsed whose fill fingerprint, saved with their
+     * filled areas, does not match the board any more.  The other zones saved with a
+     * fingerprint keep it, so the ZONE_FILLER does not fill them again.
+     * It is meant to be called once the board is complete, without the fills of the stale
+     * zones being ever parsed if ParseBoard() deferred them.  The nets are given their net
+     * classes first, as the fingerprints depend on them.
+     */
+    void DiscardStaleZoneFills();
+
     /**
      * Function parseMODULE
      * @param aInitialComments may be a pointer to a heap allocated initial comment block
@@ -26,6 +26,7 @@
 #include <layers_id_colors_and_visibility.h>
 #include <plotter.h>
 #include <macros.h>
+#include <kicad_string.h>
 #include <convert_to_biu.h>
 
 
@@ -557,7 +558,7 @@ double PCB_PLOT_PARAMS_PARSER::parseDouble()
     if( token != T_NUMBER )
         Expecting( T_NUMBER );
 
-    double val = strtod( CurText(), NULL );
+    double val = StrToDouble( CurText() );
 
     return val;
 }
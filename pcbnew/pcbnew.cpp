@@ -61,6 +61,7 @@
 #include <footprint_preview_panel.h>
 #include <footprint_info_impl.h>
 #include <gl_context_mgr.h>
+#include <token_snapshot.h>
 
 extern bool IsWxPythonLoaded();
 
@@ -372,6 +373,9 @@ void IFACE::OnKifaceEnd()
     // which can still be in usage. Destroying OpenGL contexts earlier may crash the application.
     GL_CONTEXT_MANAGER::Get().DeleteAll();
 
+    // The snapshots of the boards and libraries loaded last are still being written
+    TOKEN_SNAPSHOT_FILE::WaitForBackgroundSaves();
+
     end_common();
 #if defined( KICAD_SCRIPTING_WXPYTHON )
     // Restore the thread state and tell Python to cleanup after itself.
@@ -45,6 +45,7 @@ using namespace std::placeholders;
 #include <limits>
 
 #include <connectivity_algo.h>
+#include <union_find.h>
 
 static uint64_t getDistance( const CN_ANCHOR_PTR& aNode1, const CN_ANCHOR_PTR& aNode2 )
 {
@@ -55,103 +56,97 @@ static uint64_t getDistance( const CN_ANCHOR_PTR& aNode1, const CN_ANCHOR_PTR& a
 }
 
 
-static bool sortWeight( const CN_EDGE& aEdge1, const CN_EDGE& aEdge2 )
-{
-    return aEdge1.GetWeight() < aEdge2.GetWeight();
-}
-
-
-static const std::vector<CN_EDGE> kruskalMST( std::list<CN_EDGE>& aEdges,
+static const std::vector<CN_EDGE> kruskalMST( const std::vector<CN_EDGE>& aEdges,
         std::vector<CN_ANCHOR_PTR>& aNodes )
 {
-    unsigned int    nodeNumber = aNodes.size();
-    unsigned int    mstExpectedSize = nodeNumber - 1;
-    unsigned int    mstSize = 0;
+    // The edges are sorted and merged as plain node indices: the tag of each node is
+    // set to its index, so an edge finds its nodes without any lookup
+    struct MST_EDGE
+    {
+        unsigned int m_weight;
+        int m_source;
+        int m_target;
+        int m_edge;
+    };
+
+    int nodeNumber = aNodes.size();
+    int mstExpectedSize = nodeNumber - 1;
+    int mstSize = 0;
     bool ratsnestLines = false;
 
-    //printf("mst nodes : %d edges : %d\n", aNodes.size(), aEdges.size () );
     // The output
     std::vector<CN_EDGE> mst;
 
-    // Set tags for marking cycles
-    std::unordered_map<CN_ANCHOR_PTR, int> tags;
-    unsigned int tag = 0;
+    for( int i = 0; i < nodeNumber; ++i )
+        aNodes[i]->SetTag( i );
+
+    std::vector<MST_EDGE> edges;
+    edges.reserve( aEdges.size() );
 
-    for( auto& node : aNodes )
+    for( int i = 0; i < (int) aEdges.size(); ++i )
     {
-        node->SetTag( tag );
-        tags[node] = tag++;
+        const CN_EDGE& edge = aEdges[i];
+
+        edges.push_back( { (unsigned int) edge.GetWeight(), edge.GetSourceNode()->GetTag(),
+                           edge.GetTargetNode()->GetTag(), i } );
     }
 
-    // Lists of nodes connected together (subtrees) to detect cycles in the graph
-    std::vector<std::list<int> > cycles( nodeNumber );
+    // Kruskal algorithm requires edges to be sorted by their weight (the index keeps the
+    // order of the edges of equal weight stable)
+    std::sort( edges.begin(), edges.end(), [] ( const MST_EDGE& aEdge1, const MST_EDGE& aEdge2 ) {
+        if( aEdge1.m_weight != aEdge2.m_weight )
+            return aEdge1.m_weight < aEdge2.m_weight;
 
-    for( unsigned int i = 0; i < nodeNumber; ++i )
-        cycles[i].push_back( i );
+        return aEdge1.m_edge < aEdge2.m_edge;
+    } );
 
-    // Kruskal algorithm requires edges to be sorted by their weight
-    aEdges.sort( sortWeight );
+    // Subtrees of nodes connected together, to detect cycles in the graph
+    UNION_FIND subtrees( nodeNumber );
 
-    while( mstSize < mstExpectedSize && !aEdges.empty() )
+    // Once the connected items are processed, the nodes are tagged with their subtree
+    auto setTags = [&]()
     {
-        //printf("mstSize %d %d\n", mstSize, mstExpectedSize);
-        auto& dt = aEdges.front();
+        for( int i = 0; i < nodeNumber; ++i )
+            aNodes[i]->SetTag( subtrees.Find( i ) );
+    };
 
-        int srcTag  = tags[dt.GetSourceNode()];
-        int trgTag  = tags[dt.GetTargetNode()];
+    for( const MST_EDGE& dt : edges )
+    {
+        if( mstSize >= mstExpectedSize )
+            break;
 
-        // Check if by adding this edge we are going to join two different forests
-        if( srcTag != trgTag )
+        // Because edges are sorted by their weight, first we always process connected
+        // items (weight == 0). Once we stumble upon an edge with non-zero weight,
+        // it means that the rest of the lines are ratsnest.
+        if( !ratsnestLines && dt.m_weight != 0 )
         {
-            // Because edges are sorted by their weight, first we always process connected
-            // items (weight == 0). Once we stumble upon an edge with non-zero weight,
-            // it means that the rest of the lines are ratsnest.
-            if( !ratsnestLines && dt.GetWeight() != 0 )
-                ratsnestLines = true;
-
-            // Update tags
-            if( ratsnestLines )
-            {
-                for( auto it = cycles[trgTag].begin(); it != cycles[trgTag].end(); ++it )
-                {
-                    tags[aNodes[*it]] = srcTag;
-                }
-
-                // Do a copy of edge, but make it RN_EDGE_MST. In contrary to RN_EDGE,
-                // RN_EDGE_MST saves both source and target node and does not require any other
-                // edges to exist for getting source/target nodes
-                CN_EDGE newEdge ( dt.GetSourceNode(), dt.GetTargetNode(), dt.GetWeight() );
+            ratsnestLines = true;
+            setTags();
+        }
 
-                assert( newEdge.GetSourceNode()->GetTag() != newEdge.GetTargetNode()->GetTag() );
-                assert( newEdge.GetWeight() > 0 );
+        // Check if by adding this edge we are going to join two different forests
+        if( !subtrees.Union( dt.m_source, dt.m_target ) )
+            continue;
 
-                mst.push_back( newEdge );
-                ++mstSize;
-            }
-            else
-            {
-                // for( it = cycles[trgTag].begin(), itEnd = cycles[trgTag].end(); it != itEnd; ++it )
-                // for( auto it : cycles[trgTag] )
-                for( auto it = cycles[trgTag].begin(); it != cycles[trgTag].end(); ++it )
-                {
-                    tags[aNodes[*it]] = srcTag;
-                    aNodes[*it]->SetTag( srcTag );
-                }
+        if( ratsnestLines )
+        {
+            const CN_EDGE& edge = aEdges[dt.m_edge];
 
-                // Processing a connection, decrease the expected size of the ratsnest MST
-                --mstExpectedSize;
-            }
+            assert( edge.GetSourceNode()->GetTag() != edge.GetTargetNode()->GetTag() );
+            assert( edge.GetWeight() > 0 );
 
-            // Move nodes that were marked with old tag to the list marked with the new tag
-            cycles[srcTag].splice( cycles[srcTag].end(), cycles[trgTag] );
+            mst.emplace_back( edge.GetSourceNode(), edge.GetTargetNode(), edge.GetWeight() );
+            ++mstSize;
+        }
+        else
+        {
+            // Processing a connection, decrease the expected size of the ratsnest MST
+            --mstExpectedSize;
         }
-
-        // Remove the edge that was just processed
-        aEdges.erase( aEdges.begin() );
     }
 
-    // Probably we have discarded some of edges, so reduce the size
-    mst.resize( mstSize );
+    if( !ratsnestLines )
+        setTags();
 
     return mst;
 }
@@ -215,9 +210,9 @@ public:
         m_allNodes.push_back( aNode );
     }
 
-    const std::list<CN_EDGE> Triangulate()
+    const std::vector<CN_EDGE> Triangulate()
     {
-        std::list<CN_EDGE> mstEdges;
+        std::vector<CN_EDGE> mstEdges;
         std::list<hed::EDGE_PTR> triangEdges;
         std::vector<hed::NODE_PTR> triNodes;
 
@@ -298,6 +293,8 @@ public:
             triangulator.CreateDelaunay( triNodes.begin(), triNodes.end() );
             triangulator.GetEdges( triangEdges );
 
+            mstEdges.reserve( triangEdges.size() + m_allNodes.size() - triNodes.size() );
+
             for( auto e : triangEdges )
             {
                 auto    src = m_allNodes[ e->GetSourceNode()->Id() ];
@@ -386,8 +383,7 @@ void RN_NET::compute()
     cnt.Show();
     #endif
 
-    for( const auto& e : m_boardEdges )
-        triangEdges.push_back( e );
+    triangEdges.insert( triangEdges.end(), m_boardEdges.begin(), m_boardEdges.end() );
 
 // Get the minimal spanning tree
 #ifdef PROFILE
@@ -24,6 +24,7 @@
 
 #include <layers_id_colors_and_visibility.h>
 #include <map>
+#include <memory>
 #include <unordered_set>
 
 #include <boost/range/adaptor/map.hpp>
@@ -42,6 +43,10 @@ namespace PNS {
  * Custom spatial index, holding our board items and allowing for very fast searches. Items
  * are assigned to separate R-Tree subindices depending on their type and spanned layers, reducing
  * overlap and improving search time.
+ *
+ * Copies of an index share the subindices, the net lists and the item set until they are
+ * modified: only the parts changed by Add() and Remove() are then copied, so branching a
+ * node copies nothing and its first changes only copy the subindices of the changed layers.
  **/
 class INDEX
 {
@@ -51,6 +56,12 @@ public:
     typedef std::unordered_set<ITEM*>   ITEM_SET;
 
     INDEX();
+
+    /**
+     * Copies the index, sharing its contents with aOther until one of them is modified.
+     */
+    INDEX( const INDEX& aOther );
+
     ~INDEX();
 
     /**
@@ -118,7 +129,7 @@ public:
      *
      * Returns list of all items in a given net.
      */
-    NET_ITEMS_LIST* GetItemsForNet( int aNet );
+    const NET_ITEMS_LIST* GetItemsForNet( int aNet ) const;
 
     /**
      * Function Contains()
@@ -127,7 +138,7 @@ public:
      */
     bool Contains( ITEM* aItem ) const
     {
-        return m_allItems.find( aItem ) != m_allItems.end();
+        return m_allItems->find( aItem ) != m_allItems->end();
     }
 
     /**
@@ -135,12 +146,14 @@ public:
      *
      * Returns number of items stored in the index.
      */
-    int Size() const { return m_allItems.size(); }
+    int Size() const { return m_allItems->size(); }
 
-    ITEM_SET::iterator begin() { return m_allItems.begin(); }
-    ITEM_SET::iterator end() { return m_allItems.end(); }
+    ITEM_SET::const_iterator begin() const { return m_allItems->begin(); }
+    ITEM_SET::const_iterator end() const { return m_allItems->end(); }
 
 private:
+    typedef std::map<int, std::shared_ptr<NET_ITEMS_LIST>> NET_MAP;
+
     static const int    MaxSubIndices   = 128;
     static const int    SI_Multilayer   = 2;
     static const int    SI_SegDiagonal  = 0;
@@ -152,16 +165,39 @@ private:
     template <class Visitor>
     int querySingle( int index, const SHAPE* aShape, int aMinDistance, Visitor& aVisitor );
 
+    ///> returns the subindex for aItem, copied first if shared with another index
     ITEM_SHAPE_INDEX* getSubindex( const ITEM* aItem );
 
-    ITEM_SHAPE_INDEX* m_subIndices[MaxSubIndices];
-    std::map<int, NET_ITEMS_LIST> m_netMap;
-    ITEM_SET m_allItems;
+    ///> returns the list of the net aNet, copied first if shared with another index
+    NET_ITEMS_LIST& getNetList( int aNet );
+
+    ///> makes aPtr the only owner of its object, copying the object if it is shared
+    template <class T>
+    static T& detach( std::shared_ptr<T>& aPtr )
+    {
+        if( aPtr.use_count() > 1 )
+            aPtr = std::make_shared<T>( *aPtr );
+
+        return *aPtr;
+    }
+
+    std::shared_ptr<ITEM_SHAPE_INDEX> m_subIndices[MaxSubIndices];
+    std::shared_ptr<NET_MAP> m_netMap;
+    std::shared_ptr<ITEM_SET> m_allItems;
 };
 
-INDEX::INDEX()
+INDEX::INDEX() :
+    m_netMap( std::make_shared<NET_MAP>() ),
+    m_allItems( std::make_shared<ITEM_SET>() )
 {
-    memset( m_subIndices, 0, sizeof( m_subIndices ) );
+}
+
+INDEX::INDEX( const INDEX& aOther ) :
+    m_netMap( aOther.m_netMap ),
+    m_allItems( aOther.m_allItems )
+{
+    for( int i = 0; i < MaxSubIndices; ++i )
+        m_subIndices[i] = aOther.m_subIndices[i];
 }
 
 INDEX::ITEM_SHAPE_INDEX* INDEX::getSubindex( const ITEM* aItem )
@@ -206,9 +242,19 @@ INDEX::ITEM_SHAPE_INDEX* INDEX::getSubindex( const ITEM* aItem )
     }
 
     if( !m_subIndices[idx_n] )
-        m_subIndices[idx_n] = new ITEM_SHAPE_INDEX;
+        m_subIndices[idx_n] = std::make_shared<ITEM_SHAPE_INDEX>();
+
+    return &detach( m_subIndices[idx_n] );
+}
+
+INDEX::NET_ITEMS_LIST& INDEX::getNetList( int aNet )
+{
+    std::shared_ptr<NET_ITEMS_LIST>& list = detach( m_netMap )[aNet];
 
-    return m_subIndices[idx_n];
+    if( !list )
+        list = std::make_shared<NET_ITEMS_LIST>();
+
+    return detach( list );
 }
 
 void INDEX::Add( ITEM* aItem )
@@ -219,12 +265,12 @@ void INDEX::Add( ITEM* aItem )
         return;
 
     idx->Add( aItem );
-    m_allItems.insert( aItem );
+    detach( m_allItems ).insert( aItem );
     int net = aItem->Net();
 
     if( net >= 0 )
     {
-        m_netMap[net].push_back( aItem );
+        getNetList( net ).push_back( aItem );
     }
 }
 
@@ -236,11 +282,11 @@ void INDEX::Remove( ITEM* aItem )
         return;
 
     idx->Remove( aItem );
-    m_allItems.erase( aItem );
+    detach( m_allItems ).erase( aItem );
     int net = aItem->Net();
 
-    if( net >= 0 && m_netMap.find( net ) != m_netMap.end() )
-        m_netMap[net].remove( aItem );
+    if( net >= 0 && m_netMap->find( net ) != m_netMap->end() )
+        getNetList( net ).remove( aItem );
 }
 
 void INDEX::Replace( ITEM* aOldItem, ITEM* aNewItem )
@@ -305,14 +351,7 @@ int INDEX::Query( const SHAPE* aShape, int aMinDistance, Visitor& aVisitor )
 void INDEX::Clear()
 {
     for( int i = 0; i < MaxSubIndices; ++i )
-    {
-        ITEM_SHAPE_INDEX* idx = m_subIndices[i];
-
-        if( idx )
-            delete idx;
-
-        m_subIndices[i] = NULL;
-    }
+        m_subIndices[i].reset();
 }
 
 INDEX::~INDEX()
@@ -320,12 +359,14 @@ INDEX::~INDEX()
     Clear();
 }
 
-INDEX::NET_ITEMS_LIST* INDEX::GetItemsForNet( int aNet )
+const INDEX::NET_ITEMS_LIST* INDEX::GetItemsForNet( int aNet ) const
 {
-    if( m_netMap.find( aNet ) == m_netMap.end() )
+    NET_MAP::const_iterator i = m_netMap->find( aNet );
+
+    if( i == m_netMap->end() )
         return NULL;
 
-    return &m_netMap[aNet];
+    return i->second.get();
 }
 
 }
@@ -448,6 +448,9 @@ public:
 
     void AddLine( const SHAPE_LINE_CHAIN& aLine, int aType, int aWidth ) override
     {
+        if( !m_view )
+            return;
+
         ROUTER_PREVIEW_ITEM* pitem = new ROUTER_PREVIEW_ITEM( NULL, m_view );
 
         pitem->Line( aLine, aWidth, aType );
@@ -484,8 +487,10 @@ PNS_KICAD_IFACE::PNS_KICAD_IFACE()
     m_view = nullptr;
     m_previewItems = nullptr;
     m_router = nullptr;
-    m_debugDecorator = nullptr;
     m_dispOptions = nullptr;
+
+    // Without a view (e.g. when replaying a routing session) the decorator draws nothing
+    m_debugDecorator = new PNS_PCBNEW_DEBUG_DECORATOR();
 }
 
 
@@ -1025,6 +1030,9 @@ void PNS_KICAD_IFACE::DisplayItem( const PNS::ITEM* aItem, int aColor, int aClea
 {
     wxLogTrace( "PNS", "DisplayItem %p", aItem );
 
+    if( !m_previewItems )
+        return;
+
     ROUTER_PREVIEW_ITEM* pitem = new ROUTER_PREVIEW_ITEM( aItem, m_view );
 
     if( aColor >= 0 )
@@ -1053,7 +1061,7 @@ void PNS_KICAD_IFACE::HideItem( PNS::ITEM* aItem )
 {
     BOARD_CONNECTED_ITEM* parent = aItem->Parent();
 
-    if( parent )
+    if( parent && m_view )
     {
         if( m_view->IsVisible( parent ) )
             m_hiddenItems.insert( parent );
@@ -1068,7 +1076,8 @@ void PNS_KICAD_IFACE::RemoveItem( PNS::ITEM* aItem )
 {
     BOARD_CONNECTED_ITEM* parent = aItem->Parent();
 
-    if( parent )
+    // Without a host tool only the router world is modified, not the board
+    if( parent && m_commit )
     {
         m_commit->Remove( parent );
     }
@@ -1079,6 +1088,9 @@ void PNS_KICAD_IFACE::AddItem( PNS::ITEM* aItem )
 {
     BOARD_CONNECTED_ITEM* newBI = NULL;
 
+    if( !m_commit )
+        return;
+
     switch( aItem->Kind() )
     {
     case PNS::ITEM::SEGMENT_T:
@@ -1127,6 +1139,10 @@ void PNS_KICAD_IFACE::AddItem( PNS::ITEM* aItem )
 void PNS_KICAD_IFACE::Commit()
 {
     EraseView();
+
+    if( !m_commit )
+        return;
+
     m_commit->Push( wxT( "Added a track" ) );
     m_commit.reset( new BOARD_COMMIT( m_tool ) );
 }
@@ -32,6 +32,8 @@
 #include <geometry/shape_circle.h>
 #include <geometry/shape_convex.h>
 
+#include <fstream>
+
 namespace PNS {
 
 LOGGER::LOGGER( )
@@ -139,6 +141,54 @@ void LOGGER::Log( const VECTOR2I& aStart, const VECTOR2I& aEnd,
 }
 
 
+void LOGGER::LogEvent( const EVENT_ENTRY& aEvent )
+{
+    m_theLog << "event " << aEvent.m_type << " " << aEvent.m_p.x << " " << aEvent.m_p.y << " " <<
+                aEvent.m_layer << " " << aEvent.m_routerMode << " " << aEvent.m_routingMode << " " <<
+                aEvent.m_dragMode << " " << aEvent.m_trackWidth << " " << aEvent.m_viaDiameter << " " <<
+                aEvent.m_viaDrill << " " << aEvent.m_diffPairWidth << " " << aEvent.m_diffPairGap << " " <<
+                aEvent.m_layerTop << " " << aEvent.m_layerBottom << " " << aEvent.m_itemKind << " " <<
+                aEvent.m_itemNet << " " << aEvent.m_itemLayerStart << " " << aEvent.m_itemLayerEnd <<
+                std::endl;
+}
+
+
+bool LOGGER::LoadEvents( const std::string& aFilename, std::vector<EVENT_ENTRY>& aEvents )
+{
+    std::ifstream f( aFilename.c_str() );
+
+    if( !f )
+        return false;
+
+    std::string line;
+
+    while( std::getline( f, line ) )
+    {
+        std::istringstream is( line );
+        std::string tag;
+        EVENT_ENTRY evt;
+        int type;
+
+        if( !( is >> tag ) || tag != "event" )
+            continue;
+
+        is >> type >> evt.m_p.x >> evt.m_p.y >> evt.m_layer >> evt.m_routerMode >>
+              evt.m_routingMode >> evt.m_dragMode >> evt.m_trackWidth >> evt.m_viaDiameter >>
+              evt.m_viaDrill >> evt.m_diffPairWidth >> evt.m_diffPairGap >> evt.m_layerTop >>
+              evt.m_layerBottom >> evt.m_itemKind >> evt.m_itemNet >> evt.m_itemLayerStart >>
+              evt.m_itemLayerEnd;
+
+        if( !is || type < EVT_START_ROUTE || type > EVT_FLIP_POSTURE )
+            continue;
+
+        evt.m_type = (EVENT_TYPE) type;
+        aEvents.push_back( evt );
+    }
+
+    return true;
+}
+
+
 void LOGGER::dumpShape( const SHAPE* aSh )
 {
     switch( aSh->Type() )
@@ -194,12 +244,16 @@ void LOGGER::dumpShape( const SHAPE* aSh )
 }
 
 
-void LOGGER::Save( const std::string& aFilename )
+void LOGGER::Save( const std::string& aFilename, bool aAppend )
 {
     EndGroup();
 
-    FILE* f = fopen( aFilename.c_str(), "wb" );
+    FILE* f = fopen( aFilename.c_str(), aAppend ? "ab" : "wb" );
     wxLogTrace( "PNS", "Saving to '%s' [%p]", aFilename.c_str(), f );
+
+    if( !f )
+        return;
+
     const std::string s = m_theLog.str();
     fwrite( s.c_str(), 1, s.length(), f );
     fclose( f );
@@ -39,10 +39,55 @@ class ITEM;
 class LOGGER
 {
 public:
+    ///> Kinds of the router calls recorded with LogEvent()
+    enum EVENT_TYPE
+    {
+        EVT_START_ROUTE = 0,
+        EVT_START_DRAG,
+        EVT_FIX,
+        EVT_MOVE,
+        EVT_STOP,
+        EVT_TOGGLE_VIA,
+        EVT_SWITCH_LAYER,
+        EVT_FLIP_POSTURE
+    };
+
+    /**
+     * Struct EVENT_ENTRY
+     * is a single call to the ROUTER, with the settings needed to replay it: the item
+     * passed to the call is identified by its kind, net and layers (m_itemKind is 0 when
+     * there is no item), as the items are different in every router session.
+     */
+    struct EVENT_ENTRY
+    {
+        EVENT_TYPE m_type;
+        VECTOR2I   m_p;
+        int        m_layer;             ///< routing layer or layer switched to
+        int        m_routerMode;        ///< ROUTER_MODE of the router
+        int        m_routingMode;       ///< PNS_MODE of the routing settings
+        int        m_dragMode;          ///< DRAG_MODE flags of a drag
+        int        m_trackWidth;
+        int        m_viaDiameter;
+        int        m_viaDrill;
+        int        m_diffPairWidth;
+        int        m_diffPairGap;
+        int        m_layerTop;          ///< via layer pair
+        int        m_layerBottom;
+        int        m_itemKind;
+        int        m_itemNet;
+        int        m_itemLayerStart;
+        int        m_itemLayerEnd;
+    };
+
     LOGGER();
     ~LOGGER();
 
-    void Save( const std::string& aFilename );
+    /**
+     * Function Save
+     * writes the log to \a aFilename, after the existing contents of the file
+     * if \a aAppend is true.
+     */
+    void Save( const std::string& aFilename, bool aAppend = false );
     void Clear();
 
     void NewGroup( const std::string& aName, int aIter = 0 );
@@ -53,6 +98,20 @@ public:
     void Log( const VECTOR2I& aStart, const VECTOR2I& aEnd, int aKind = 0,
               const std::string& aName = std::string() );
 
+    /**
+     * Function LogEvent
+     * records a call to the ROUTER as an "event" line of the log.
+     */
+    void LogEvent( const EVENT_ENTRY& aEvent );
+
+    /**
+     * Function LoadEvents
+     * reads the events recorded with LogEvent() from the log file \a aFilename,
+     * skipping any other lines.
+     * @return false if the file cannot be read.
+     */
+    static bool LoadEvents( const std::string& aFilename, std::vector<EVENT_ENTRY>& aEvents );
+
 private:
     void dumpShape( const SHAPE* aSh );
 
@@ -21,10 +21,13 @@
 
 #include <vector>
 #include <cassert>
+#include <atomic>
+#include <algorithm>
 
 #include <math/vector2d.h>
 
 #include <geometry/seg.h>
+#include <geometry/seg_batch.h>
 #include <geometry/shape.h>
 #include <geometry/shape_line_chain.h>
 #include <geometry/shape_index.h>
@@ -37,6 +40,7 @@
 #include "pns_joint.h"
 #include "pns_index.h"
 #include "pns_router.h"
+#include "pns_optimizer.h"
 
 
 namespace PNS {
@@ -45,6 +49,10 @@ namespace PNS {
 static std::unordered_set<NODE*> allocNodes;
 #endif
 
+// the revisions of all the branches come from one counter, so that a new branch never gets
+// the revision of a former one, even when it is allocated at the same address
+static std::atomic<unsigned long long> s_lastRevision( 0 );
+
 NODE::NODE()
 {
     wxLogTrace( "PNS", "NODE::create %p", this );
@@ -52,8 +60,11 @@ NODE::NODE()
     m_root = this;
     m_parent = NULL;
     m_maxClearance = 800000;    // fixme: depends on how thick traces are.
+    m_generation = 0;
+    m_revision = ++s_lastRevision;
     m_ruleResolver = NULL;
     m_index = new INDEX;
+    m_override = std::make_shared<std::unordered_set<ITEM*>>();
 
 #ifdef DEBUG
     allocNodes.insert( this );
@@ -83,7 +94,7 @@ NODE::~NODE()
 
     m_joints.clear();
 
-    for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
+    for( INDEX::ITEM_SET::const_iterator i = m_index->begin(); i != m_index->end(); ++i )
     {
         if( (*i)->BelongsTo( this ) )
             delete *i;
@@ -104,6 +115,26 @@ int NODE::GetClearance( const ITEM* aA, const ITEM* aB ) const
 }
 
 
+unsigned long long NODE::Revision() const
+{
+    unsigned long long revision = 0;
+
+    for( const NODE* node = this; node; node = node->m_parent )
+        revision = std::max( revision, node->m_revision );
+
+    return revision;
+}
+
+
+OBSTACLE_CACHE* NODE::ObstacleCache()
+{
+    if( !m_root->m_obstacleCache )
+        m_root->m_obstacleCache.reset( new OBSTACLE_CACHE( m_root ) );
+
+    return m_root->m_obstacleCache.get();
+}
+
+
 NODE* NODE::Branch()
 {
     NODE* child = new NODE;
@@ -118,21 +149,20 @@ NODE* NODE::Branch()
     child->m_root = isRoot() ? this : m_root;
 
     // immmediate offspring of the root branch needs not copy anything.
-    // For the rest, deep-copy joints, overridden item map and pointers
-    // to stored items.
+    // For the rest, share the index of the stored items and the overridden
+    // item set (both are copied on write) and copy the joints, as the
+    // callers keep pointers to them across changes of the node.
     if( !isRoot() )
     {
-        JOINT_MAP::iterator j;
-
-        for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
-            child->m_index->Add( *i );
+        delete child->m_index;
+        child->m_index = new INDEX( *m_index );
 
         child->m_joints = m_joints;
         child->m_override = m_override;
     }
 
     wxLogTrace( "PNS", "%d items, %d joints, %d overrides",
-            child->m_index->Size(), (int) child->m_joints.size(), (int) child->m_override.size() );
+            child->m_index->Size(), (int) child->m_joints.size(), (int) child->m_override->size() );
 
     return child;
 }
@@ -198,6 +228,22 @@ struct NODE::DEFAULT_OBSTACLE_VISITOR : public OBSTACLE_VISITOR
 
     int m_forceClearance;
 
+    ///> the line the segments are tested against all at once, if any
+    const LINE* m_batchLine;
+
+    ///> segments waiting to be tested against m_batchLine
+    SEG_BATCH m_segBatch;
+
+    struct PENDING_ITEM
+    {
+        ITEM* m_item;
+        int m_clearance;
+        int m_batchIndex;   ///< index of the segment in m_segBatch, -1 for the other items
+    };
+
+    ///> candidates waiting for the test of the segments, in the order they were found
+    std::vector<PENDING_ITEM> m_pending;
+
     DEFAULT_OBSTACLE_VISITOR( NODE::OBSTACLES& aTab, const ITEM* aItem, int aKindMask, bool aDifferentNetsOnly ) :
         OBSTACLE_VISITOR( aItem ),
         m_tab( aTab ),
@@ -206,7 +252,8 @@ struct NODE::DEFAULT_OBSTACLE_VISITOR : public OBSTACLE_VISITOR
         m_matchCount( 0 ),
         m_extraClearance( 0 ),
         m_differentNetsOnly( aDifferentNetsOnly ),
-        m_forceClearance( -1 )
+        m_forceClearance( -1 ),
+        m_batchLine( NULL )
     {
         if( aItem && aItem->Kind() == ITEM::LINE_T )
         {
@@ -217,6 +264,50 @@ struct NODE::DEFAULT_OBSTACLE_VISITOR : public OBSTACLE_VISITOR
     void SetCountLimit( int aLimit )
     {
         m_limitCount = aLimit;
+
+        // without a limit, all the segments colliding with a line can be tested at once
+        // (the via at the end of a line is not a segment, leave it to ITEM::Collide())
+        m_batchLine = NULL;
+
+        if( m_limitCount <= 0 && m_item && m_item->Kind() == ITEM::LINE_T
+                && !static_cast<const LINE*>( m_item )->EndsWithVia() )
+            m_batchLine = static_cast<const LINE*>( m_item );
+    }
+
+    void addObstacle( ITEM* aCandidate )
+    {
+        OBSTACLE obs;
+
+        obs.m_item = aCandidate;
+        obs.m_head = m_item;
+        m_tab.push_back( obs );
+
+        m_matchCount++;
+    }
+
+    /**
+     * Function Flush()
+     * Tests the pending segments against the line and adds the colliding items to the
+     * obstacles, in the order they were found.
+     */
+    void Flush()
+    {
+        if( m_pending.empty() )
+            return;
+
+        std::vector<bool> hits;
+
+        m_segBatch.Collide( m_batchLine->CLine(), 0, hits );
+
+        for( const PENDING_ITEM& pending : m_pending )
+        {
+            if( pending.m_batchIndex >= 0 ? hits[pending.m_batchIndex]
+                    : pending.m_item->Collide( m_item, pending.m_clearance, m_differentNetsOnly ) )
+                addObstacle( pending.m_item );
+        }
+
+        m_pending.clear();
+        m_segBatch.Clear();
     }
 
     bool operator()( ITEM* aCandidate ) override
@@ -238,16 +329,34 @@ struct NODE::DEFAULT_OBSTACLE_VISITOR : public OBSTACLE_VISITOR
         if( m_forceClearance >= 0 )
             clearance = m_forceClearance;
 
-        if( !aCandidate->Collide( m_item, clearance, m_differentNetsOnly ) )
-            return true;
+        if( m_batchLine )
+        {
+            int index = -1;
 
-        OBSTACLE obs;
+            if( aCandidate->Kind() == ITEM::SEGMENT_T )
+            {
+                // the checks of ITEM::Collide() before the one of the shapes
+                if( m_differentNetsOnly && aCandidate->Net() == m_item->Net()
+                        && aCandidate->Net() >= 0 && m_item->Net() >= 0 )
+                    return true;
 
-        obs.m_item = aCandidate;
-        obs.m_head = m_item;
-        m_tab.push_back( obs );
+                if( !aCandidate->Layers().Overlaps( m_item->Layers() ) )
+                    return true;
 
-        m_matchCount++;
+                const SEGMENT* seg = static_cast<const SEGMENT*>( aCandidate );
+
+                index = m_segBatch.Size();
+                m_segBatch.Add( seg->Seg(), clearance + seg->Width() / 2 );
+            }
+
+            m_pending.push_back( PENDING_ITEM{ aCandidate, clearance, index } );
+            return true;
+        }
+
+        if( !aCandidate->Collide( m_item, clearance, m_differentNetsOnly ) )
+            return true;
+
+        addObstacle( aCandidate );
 
         if( m_limitCount > 0 && m_matchCount >= m_limitCount )
             return false;
@@ -295,6 +404,8 @@ int NODE::QueryColliding( const ITEM* aItem,
         m_root->m_index->Query( aItem, m_maxClearance, visitor );
     }
 
+    visitor.Flush();
+
     return aObstacles.size();
 }
 
@@ -534,6 +645,7 @@ void NODE::addSolid( SOLID* aSolid )
 {
     linkJoint( aSolid->Pos(), aSolid->Layers(), aSolid->Net(), aSolid );
     m_index->Add( aSolid );
+    m_revision = ++s_lastRevision;
 }
 
 void NODE::Add( std::unique_ptr< SOLID > aSolid )
@@ -546,6 +658,7 @@ void NODE::addVia( VIA* aVia )
 {
     linkJoint( aVia->Pos(), aVia->Layers(), aVia->Net(), aVia );
     m_index->Add( aVia );
+    m_revision = ++s_lastRevision;
 }
 
 void NODE::Add( std::unique_ptr< VIA > aVia )
@@ -589,6 +702,7 @@ void NODE::addSegment( SEGMENT* aSeg )
     linkJoint( aSeg->Seg().B, aSeg->Layers(), aSeg->Net(), aSeg );
 
     m_index->Add( aSeg );
+    m_revision = ++s_lastRevision;
 }
 
 bool NODE::Add( std::unique_ptr< SEGMENT > aSegment, bool aAllowRedundant )
@@ -636,16 +750,29 @@ void NODE::Add( std::unique_ptr< ITEM > aItem, bool aAllowRedundant )
 
 void NODE::doRemove( ITEM* aItem )
 {
+    m_revision = ++s_lastRevision;
+
     // case 1: removing an item that is stored in the root node from any branch:
     // mark it as overridden, but do not remove
     if( aItem->BelongsTo( m_root ) && !isRoot() )
-        m_override.insert( aItem );
+    {
+        if( m_override.use_count() > 1 )
+            m_override = std::make_shared<std::unordered_set<ITEM*>>( *m_override );
+
+        m_override->insert( aItem );
+    }
 
     // case 2: the item belongs to this branch or a parent, non-root branch,
     // or the root itself and we are the root: remove from the index
     else if( !aItem->BelongsTo( m_root ) || isRoot() )
+    {
         m_index->Remove( aItem );
 
+        // the obstacles cached from the root may be gone
+        if( isRoot() )
+            m_generation++;
+    }
+
     // the item belongs to this particular branch: un-reference it
     if( aItem->BelongsTo( this ) )
     {
@@ -1162,16 +1289,16 @@ void NODE::Dump( bool aLong )
 
 void NODE::GetUpdatedItems( ITEM_VECTOR& aRemoved, ITEM_VECTOR& aAdded )
 {
-    aRemoved.reserve( m_override.size() );
+    aRemoved.reserve( m_override->size() );
     aAdded.reserve( m_index->Size() );
 
     if( isRoot() )
         return;
 
-    for( ITEM* item : m_override )
+    for( ITEM* item : *m_override )
         aRemoved.push_back( item );
 
-    for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
+    for( INDEX::ITEM_SET::const_iterator i = m_index->begin(); i != m_index->end(); ++i )
         aAdded.push_back( *i );
 }
 
@@ -1208,10 +1335,10 @@ void NODE::Commit( NODE* aNode )
     if( aNode->isRoot() )
         return;
 
-    for( ITEM* item : aNode->m_override )
+    for( ITEM* item : *aNode->m_override )
     Remove( item );
 
-    for( INDEX::ITEM_SET::iterator i = aNode->m_index->begin();
+    for( INDEX::ITEM_SET::const_iterator i = aNode->m_index->begin();
          i != aNode->m_index->end(); ++i )
     {
         (*i)->SetRank( -1 );
@@ -1233,7 +1360,7 @@ void NODE::KillChildren()
 
 void NODE::AllItemsInNet( int aNet, std::set<ITEM*>& aItems )
 {
-    INDEX::NET_ITEMS_LIST* l_cur = m_index->GetItemsForNet( aNet );
+    const INDEX::NET_ITEMS_LIST* l_cur = m_index->GetItemsForNet( aNet );
 
     if( l_cur )
     {
@@ -1243,10 +1370,10 @@ void NODE::AllItemsInNet( int aNet, std::set<ITEM*>& aItems )
 
     if( !isRoot() )
     {
-        INDEX::NET_ITEMS_LIST* l_root = m_root->m_index->GetItemsForNet( aNet );
+        const INDEX::NET_ITEMS_LIST* l_root = m_root->m_index->GetItemsForNet( aNet );
 
         if( l_root )
-            for( INDEX::NET_ITEMS_LIST::iterator i = l_root->begin(); i!= l_root->end(); ++i )
+            for( INDEX::NET_ITEMS_LIST::const_iterator i = l_root->begin(); i!= l_root->end(); ++i )
                 if( !Overrides( *i ) )
                     aItems.insert( *i );
     }
@@ -1255,7 +1382,7 @@ void NODE::AllItemsInNet( int aNet, std::set<ITEM*>& aItems )
 
 void NODE::ClearRanks( int aMarkerMask )
 {
-    for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
+    for( INDEX::ITEM_SET::const_iterator i = m_index->begin(); i != m_index->end(); ++i )
     {
         (*i)->SetRank( -1 );
         (*i)->Mark( (*i)->Marker() & (~aMarkerMask) );
@@ -1265,7 +1392,7 @@ void NODE::ClearRanks( int aMarkerMask )
 
 int NODE::FindByMarker( int aMarker, ITEM_SET& aItems )
 {
-    for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
+    for( INDEX::ITEM_SET::const_iterator i = m_index->begin(); i != m_index->end(); ++i )
     {
         if( (*i)->Marker() & aMarker )
             aItems.Add( *i );
@@ -1279,7 +1406,7 @@ int NODE::RemoveByMarker( int aMarker )
 {
     std::list<ITEM*> garbage;
 
-    for( INDEX::ITEM_SET::iterator i = m_index->begin(); i != m_index->end(); ++i )
+    for( INDEX::ITEM_SET::const_iterator i = m_index->begin(); i != m_index->end(); ++i )
     {
         if( (*i)->Marker() & aMarker )
         {
@@ -1329,7 +1456,7 @@ SEGMENT* NODE::findRedundantSegment( SEGMENT* aSeg )
 
 ITEM *NODE::FindItemByParent( const BOARD_CONNECTED_ITEM* aParent )
 {
-    INDEX::NET_ITEMS_LIST* l_cur = m_index->GetItemsForNet( aParent->GetNetCode() );
+    const INDEX::NET_ITEMS_LIST* l_cur = m_index->GetItemsForNet( aParent->GetNetCode() );
 
     for( ITEM*item : *l_cur )
         if( item->Parent() == aParent )
@@ -24,6 +24,7 @@
 
 #include <vector>
 #include <list>
+#include <memory>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -45,6 +46,7 @@ class SOLID;
 class VIA;
 class INDEX;
 class ROUTER;
+class OBSTACLE_CACHE;
 class NODE;
 
 /**
@@ -416,9 +418,32 @@ public:
     ///> from the root branch.
     bool Overrides( ITEM* aItem ) const
     {
-        return m_override.find( aItem ) != m_override.end();
+        return m_override->find( aItem ) != m_override->end();
     }
 
+    ///> Returns a number that changes each time items are removed from the root branch.
+    int Generation() const
+    {
+        return m_root->m_generation;
+    }
+
+    /**
+     * Function Revision()
+     *
+     * Returns a number that changes each time items are added to or removed from this
+     * branch or one of its parents. A branch has the same items as long as it has the same
+     * revision, and a new branch allocated at its address never gets it again.
+     */
+    unsigned long long Revision() const;
+
+    /**
+     * Function ObstacleCache()
+     *
+     * Returns the cache of the obstacles found by the optimizers in the root branch. It
+     * belongs to the root and is shared by all its branches.
+     */
+    OBSTACLE_CACHE* ObstacleCache();
+
 private:
     struct DEFAULT_OBSTACLE_VISITOR;
     typedef std::unordered_multimap<JOINT::HASH_TAG, JOINT, JOINT::JOINT_TAG_HASH> JOINT_MAP;
@@ -486,12 +511,22 @@ private:
     ///> list of nodes branched from this one
     std::set<NODE*> m_children;
 
-    ///> hash of root's items that have been changed in this node
-    std::unordered_set<ITEM*> m_override;
+    ///> hash of root's items that have been changed in this node (shared with
+    ///> the parent node until either of them changes it)
+    std::shared_ptr<std::unordered_set<ITEM*>> m_override;
 
     ///> worst case item-item clearance
     int m_maxClearance;
 
+    ///> number of removals from the (root) branch
+    int m_generation;
+
+    ///> revision of the last change of this branch (see Revision())
+    unsigned long long m_revision;
+
+    ///> obstacle cache of the optimizers (root only, created on first use)
+    std::unique_ptr<OBSTACLE_CACHE> m_obstacleCache;
+
     ///> Design rules resolver
     RULE_RESOLVER* m_ruleResolver;
 
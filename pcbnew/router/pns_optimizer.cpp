@@ -26,6 +26,7 @@
 #include <cmath>
 
 #include "pns_line.h"
+#include "pns_segment.h"
 #include "pns_diff_pair.h"
 #include "pns_node.h"
 #include "pns_solid.h"
@@ -128,7 +129,9 @@ OPTIMIZER::OPTIMIZER( NODE* aWorld ) :
     m_collisionKindMask( ITEM::ANY_T ),
     m_effortLevel( MERGE_SEGMENTS ),
     m_keepPostures( false ),
-    m_restrictAreaActive( false )
+    m_restrictAreaActive( false ),
+    m_freeWorld( NULL ),
+    m_freeRevision( 0 )
 {
 }
 
@@ -138,95 +141,113 @@ OPTIMIZER::~OPTIMIZER()
 }
 
 
-struct OPTIMIZER::CACHE_VISITOR
+struct OBSTACLE_CACHE::VISITOR
 {
-    CACHE_VISITOR( const ITEM* aOurItem, NODE* aNode, int aMask ) :
-        m_ourItem( aOurItem ),
-        m_collidingItem( NULL ),
-        m_node( aNode ),
-        m_mask( aMask )
+    VISITOR( NODE* aWorld, const ITEM* aItem ) :
+        m_world( aWorld ),
+        m_item( aItem ),
+        m_collidingItem( NULL )
     {}
 
-    bool operator()( ITEM* aOtherItem )
+    // the same test as the one of NODE::CheckColliding()
+    bool operator()( ITEM* aCandidate )
     {
-        if( !( m_mask & aOtherItem->Kind() ) )
+        // replaced in the world by a newer version
+        if( m_world->Overrides( aCandidate ) )
             return true;
 
-        int clearance = m_node->GetClearance( aOtherItem, m_ourItem );
+        int clearance = m_world->GetClearance( aCandidate, m_item );
 
-        if( !aOtherItem->Collide( m_ourItem, clearance ) )
+        if( !aCandidate->Collide( m_item, clearance ) )
             return true;
 
-        m_collidingItem = aOtherItem;
+        m_collidingItem = aCandidate;
         return false;
     }
 
-    const ITEM* m_ourItem;
+    NODE* m_world;
+    const ITEM* m_item;
     ITEM* m_collidingItem;
-    NODE* m_node;
-    int m_mask;
 };
 
 
-void OPTIMIZER::cacheAdd( ITEM* aItem, bool aIsStatic = false )
+OBSTACLE_CACHE::OBSTACLE_CACHE( NODE* aRoot ) :
+    m_root( aRoot ),
+    m_generation( aRoot->Generation() )
 {
-    if( m_cacheTags.find( aItem ) != m_cacheTags.end() )
-        return;
-
-    m_cache.Add( aItem );
-    m_cacheTags[aItem].m_hits = 1;
-    m_cacheTags[aItem].m_isStatic = aIsStatic;
 }
 
 
-void OPTIMIZER::removeCachedSegments( LINE* aLine, int aStartVertex, int aEndVertex )
+void OBSTACLE_CACHE::update()
 {
-    if( !aLine->IsLinked() ) return;
+    if( m_generation == m_root->Generation() )
+        return;
 
-    LINE::SEGMENT_REFS& segs = aLine->LinkedSegments();
+    m_index.RemoveAll();
+    m_hits.clear();
+    m_generation = m_root->Generation();
+}
 
-    if( aEndVertex < 0 )
-        aEndVertex += aLine->PointCount();
 
-    for( int i = aStartVertex; i < aEndVertex - 1; i++ )
+void OBSTACLE_CACHE::evict()
+{
+    // drop the items that did not collide with anything since the last eviction,
+    // or everything if all of them did
+    for( auto i = m_hits.begin(); i != m_hits.end(); )
     {
-        SEGMENT* s = segs[i];
-        m_cacheTags.erase( s );
-        m_cache.Remove( s );
+        if( !i->second )
+        {
+            m_index.Remove( i->first );
+            i = m_hits.erase( i );
+        }
+        else
+        {
+            i->second = 0;
+            ++i;
+        }
+    }
+
+    if( (int) m_hits.size() >= MaxCachedItems )
+    {
+        m_index.RemoveAll();
+        m_hits.clear();
     }
 }
 
 
-void OPTIMIZER::CacheRemove( ITEM* aItem )
+bool OBSTACLE_CACHE::CheckColliding( NODE* aWorld, const ITEM* aItem )
 {
-    if( aItem->Kind() == ITEM::LINE_T )
-        removeCachedSegments( static_cast<LINE*>( aItem ) );
-}
+    assert( aItem->Kind() != ITEM::LINE_T );
 
+    update();
 
-void OPTIMIZER::CacheStaticItem( ITEM* aItem )
-{
-    cacheAdd( aItem, true );
+    if( m_hits.empty() )
+        return false;
+
+    VISITOR v( aWorld, aItem );
+
+    m_index.Query( aItem->Shape(), aWorld->GetMaxClearance(), v, false );
+
+    if( !v.m_collidingItem )
+        return false;
+
+    m_hits[v.m_collidingItem]++;
+    return true;
 }
 
 
-void OPTIMIZER::ClearCache( bool aStaticOnly  )
+void OBSTACLE_CACHE::Add( ITEM* aObstacle )
 {
-    if( !aStaticOnly )
-    {
-        m_cacheTags.clear();
-        m_cache.Clear();
+    update();
+
+    if( !aObstacle->BelongsTo( m_root ) || m_hits.find( aObstacle ) != m_hits.end() )
         return;
-    }
 
-    for( CachedItemTags::iterator i = m_cacheTags.begin(); i!= m_cacheTags.end(); ++i )
-    {
-        if( i->second.m_isStatic )
-        {
-            m_cache.Remove( i->first );
-            m_cacheTags.erase( i->first );
-        }
-    }
+    if( (int) m_hits.size() >= MaxCachedItems )
+        evict();
+
+    m_index.Add( aObstacle );
+    m_hits[aObstacle] = 0;
 }
 
 
@@ -382,36 +403,115 @@ bool LINE_RESTRICTIONS::Check( int aVertex1, int aVertex2, const SHAPE_LINE_CHAI
 }
 
 
-bool OPTIMIZER::checkColliding( ITEM* aItem, bool aUpdateCache )
+bool OPTIMIZER::FREE_ITEM::operator==( const FREE_ITEM& aOther ) const
 {
-    CACHE_VISITOR v( aItem, m_world, m_collisionKindMask );
+    return m_kind == aOther.m_kind && m_a == aOther.m_a && m_b == aOther.m_b
+            && m_width == aOther.m_width && m_drill == aOther.m_drill && m_net == aOther.m_net
+            && m_layerStart == aOther.m_layerStart && m_layerEnd == aOther.m_layerEnd
+            && m_parent == aOther.m_parent;
+}
 
-    return static_cast<bool>( m_world->CheckColliding( aItem ) );
 
-#if 0
-    // something is wrong with the cache, need to investigate.
-    m_cache.Query( aItem->Shape(), m_world->GetMaxClearance(), v, false );
+std::size_t OPTIMIZER::FREE_ITEM_HASH::operator()( const FREE_ITEM& aItem ) const
+{
+    using std::hash;
 
-    if( !v.m_collidingItem )
+    return ( ( hash<int>()( aItem.m_a.x ) ^ ( hash<int>()( aItem.m_a.y ) << 1 ) ) >> 1 )
+           ^ ( ( hash<int>()( aItem.m_b.x ) ^ ( hash<int>()( aItem.m_b.y ) << 1 ) ) << 1 )
+           ^ hash<int>()( aItem.m_width ) ^ ( hash<int>()( aItem.m_net ) << 2 );
+}
+
+
+bool OPTIMIZER::checkColliding( ITEM* aItem, bool aUpdateCache )
+{
+    // NODE::CheckColliding() checks the lines segment by segment (the clearance of a
+    // line does not include its width, the one of its segments does). The candidate
+    // lines share most of their segments, so the segments are remembered one by one.
+    if( aItem->Kind() == ITEM::LINE_T )
     {
-        NODE::OPT_OBSTACLE obs = m_world->CheckColliding( aItem );
+        const LINE* line = static_cast<const LINE*>( aItem );
+        const SHAPE_LINE_CHAIN& l = line->CLine();
 
-        if( obs )
+        for( int i = 0; i < l.SegmentCount(); i++ )
         {
-            if( aUpdateCache )
-                cacheAdd( obs->m_item );
+            const SEGMENT s( *line, l.CSegment( i ) );
 
-            return true;
+            if( checkCollidingSingle( &s, aUpdateCache ) )
+                return true;
         }
+
+        return line->EndsWithVia() && checkCollidingSingle( &line->Via(), aUpdateCache );
+    }
+
+    return checkCollidingSingle( aItem, aUpdateCache );
+}
+
+
+bool OPTIMIZER::checkCollidingSingle( const ITEM* aItem, bool aUpdateCache )
+{
+    FREE_ITEM key;
+    bool keyed = true;
+
+    if( const SEGMENT* seg = dyn_cast<const SEGMENT*>( aItem ) )
+    {
+        key.m_a = seg->Seg().A;
+        key.m_b = seg->Seg().B;
+        key.m_width = seg->Width();
+        key.m_drill = 0;
+    }
+    else if( const VIA* via = dyn_cast<const VIA*>( aItem ) )
+    {
+        key.m_a = key.m_b = via->Pos();
+        key.m_width = via->Diameter();
+        key.m_drill = via->Drill();
     }
     else
     {
-        m_cacheTags[v.m_collidingItem].m_hits++;
+        keyed = false;
+    }
+
+    if( keyed )
+    {
+        key.m_kind = aItem->Kind();
+        key.m_net = aItem->Net();
+        key.m_layerStart = aItem->Layers().Start();
+        key.m_layerEnd = aItem->Layers().End();
+        key.m_parent = aItem->Parent();
+
+        // the free items only hold for the world they were checked in, as it was then
+        unsigned long long revision = m_world->Revision();
+
+        if( m_freeWorld != m_world || m_freeRevision != revision )
+        {
+            m_freeItems.clear();
+            m_freeWorld = m_world;
+            m_freeRevision = revision;
+        }
+        else if( m_freeItems.find( key ) != m_freeItems.end() )
+        {
+            return false;
+        }
+    }
+
+    OBSTACLE_CACHE* cache = m_world->ObstacleCache();
+
+    if( cache->CheckColliding( m_world, aItem ) )
+        return true;
+
+    NODE::OPT_OBSTACLE obs = m_world->CheckColliding( aItem );
+
+    if( obs )
+    {
+        if( aUpdateCache )
+            cache->Add( obs->m_item );
+
         return true;
     }
 
+    if( keyed && (int) m_freeItems.size() < MaxFreeItems )
+        m_freeItems.insert( key );
+
     return false;
-#endif
 }
 
 
@@ -487,7 +587,6 @@ bool OPTIMIZER::mergeObtuse( LINE* aLine )
                     if( !checkColliding( &opt_track ) )
                     {
                         current_path.Replace( s1.Index() + 1, s2.Index(), ip );
-                        // removeCachedSegments(aLine, s1.Index(), s2.Index());
                         n_segs = current_path.SegmentCount();
                         found_anything = true;
                         break;
@@ -23,17 +23,21 @@
 #define __PNS_OPTIMIZER_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 
-#include <geometry/shape_index_list.h>
+#include <geometry/shape_index.h>
 #include <geometry/shape_line_chain.h>
 
 #include "range.h"
 
+class BOARD_CONNECTED_ITEM;
+
 namespace PNS {
 
 class NODE;
 class ROUTER;
+class ITEM;
 class LINE;
 class DIFF_PAIR;
 
@@ -76,6 +80,59 @@ private:
     int m_cornerCost;
 };
 
+/**
+ * Class OBSTACLE_CACHE
+ *
+ * Keeps the items of the root branch the optimizers have collided with, so the next
+ * collision checks can try them before querying the whole world: dragging or routing
+ * many lines, the optimizers keep running into the same pads and tracks.
+ *
+ * The cache belongs to the root branch (see NODE::ObstacleCache()) and is shared by the
+ * optimizers of all the branches. It is tagged with the generation of the root and dropped
+ * as soon as the root removes items, so it never refers to a removed item. Only the
+ * collisions are cached here: the items found not to collide with anything depend on the
+ * branch, and are remembered by each OPTIMIZER.
+ *
+ * The cache is not thread safe: the optimizers only run on the thread of the router
+ * (WALKAROUND::Route() optimizes its path once both directions have been walked).
+ **/
+class OBSTACLE_CACHE
+{
+public:
+    OBSTACLE_CACHE( NODE* aRoot );
+
+    /**
+     * Function CheckColliding()
+     *
+     * Checks aItem against the cached obstacles, the way aWorld->CheckColliding( aItem )
+     * would check it against them.
+     * @param aItem a segment, a via or a solid (the lines are checked segment by segment)
+     * @return true if a cached obstacle collides with aItem in aWorld
+     */
+    bool CheckColliding( NODE* aWorld, const ITEM* aItem );
+
+    ///> Adds an obstacle found in a branch of the root (only the items of the root are kept).
+    void Add( ITEM* aObstacle );
+
+private:
+    static const int MaxCachedItems = 4096;
+
+    struct VISITOR;
+
+    void update();
+    void evict();
+
+    NODE* m_root;
+
+    ///> generation of the root the cached items belong to
+    int m_generation;
+
+    SHAPE_INDEX<ITEM*> m_index;
+
+    ///> the cached items, with the number of collisions found since added (or last evicted)
+    std::unordered_map<ITEM*, int> m_hits;
+};
+
 /**
  * Class OPTIMIZER
  *
@@ -109,9 +166,6 @@ public:
 
 
     void SetWorld( NODE* aNode ) { m_world = aNode; }
-    void CacheStaticItem( ITEM* aItem );
-    void CacheRemove( ITEM* aItem );
-    void ClearCache( bool aStaticOnly = false );
 
     void SetCollisionMask( int aMask )
     {
@@ -131,18 +185,8 @@ public:
     }
 
 private:
-    static const int MaxCachedItems = 256;
-
     typedef std::vector<SHAPE_LINE_CHAIN> BREAKOUT_LIST;
 
-    struct CACHE_VISITOR;
-
-    struct CACHED_ITEM
-    {
-        int m_hits;
-        bool m_isStatic;
-    };
-
     bool mergeObtuse( LINE* aLine );
     bool mergeFull( LINE* aLine );
     bool removeUglyCorners( LINE* aLine );
@@ -154,9 +198,7 @@ private:
 
     bool checkColliding( ITEM* aItem, bool aUpdateCache = true );
     bool checkColliding( LINE* aLine, const SHAPE_LINE_CHAIN& aOptPath );
-
-    void cacheAdd( ITEM* aItem, bool aIsStatic );
-    void removeCachedSegments( LINE* aLine, int aStartVertex = 0, int aEndVertex = -1 );
+    bool checkCollidingSingle( const ITEM* aItem, bool aUpdateCache );
 
     BREAKOUT_LIST circleBreakouts( int aWidth, const SHAPE* aShape, bool aPermitDiagonal ) const;
     BREAKOUT_LIST rectBreakouts( int aWidth, const SHAPE* aShape, bool aPermitDiagonal ) const;
@@ -168,10 +210,34 @@ private:
 
     ITEM* findPadOrVia( int aLayer, int aNet, const VECTOR2I& aP ) const;
 
-    SHAPE_INDEX_LIST<ITEM*> m_cache;
+    /**
+     * Struct FREE_ITEM
+     *
+     * What the collisions of a segment or a via depend on: the key of the items found not
+     * to collide with anything in the world.
+     */
+    struct FREE_ITEM
+    {
+        int m_kind;
+        VECTOR2I m_a;           ///< start of the segment, position of the via
+        VECTOR2I m_b;           ///< end of the segment, position of the via
+        int m_width;            ///< width of the segment, diameter of the via
+        int m_drill;
+        int m_net;
+        int m_layerStart;
+        int m_layerEnd;
+        const BOARD_CONNECTED_ITEM* m_parent;
+
+        bool operator==( const FREE_ITEM& aOther ) const;
+    };
+
+    struct FREE_ITEM_HASH
+    {
+        std::size_t operator()( const FREE_ITEM& aItem ) const;
+    };
+
+    static const int MaxFreeItems = 16384;
 
-    typedef std::unordered_map<ITEM*, CACHED_ITEM> CachedItemTags;
-    CachedItemTags m_cacheTags;
     NODE* m_world;
     int m_collisionKindMask;
     int m_effortLevel;
@@ -179,6 +245,12 @@ private:
 
     BOX2I m_restrictArea;
     bool m_restrictAreaActive;
+
+    ///> the segments and vias found not to collide with anything in m_freeWorld, at its
+    ///> revision m_freeRevision (the candidate lines share most of their segments)
+    std::unordered_set<FREE_ITEM, FREE_ITEM_HASH> m_freeItems;
+    NODE* m_freeWorld;
+    unsigned long long m_freeRevision;
 };
 
 }
@@ -135,6 +135,8 @@ bool ROUTER::StartDragging( const VECTOR2I& aP, ITEM* aStartItem, int aDragMode
     if( !aStartItem || aStartItem->OfKind( ITEM::SOLID_T ) )
         return false;
 
+    logEvent( LOGGER::EVT_START_DRAG, aP, aStartItem, -1, aDragMode );
+
     m_dragger.reset( new DRAGGER( this ) );
     m_dragger->SetMode( aDragMode );
     m_dragger->SetWorld( m_world.get() );
@@ -178,6 +180,8 @@ bool ROUTER::StartRouting( const VECTOR2I& aP, ITEM* aStartItem, int aLayer )
 
     m_forceMarkObstaclesMode = false;
 
+    logEvent( LOGGER::EVT_START_ROUTE, aP, aStartItem, aLayer );
+
     switch( m_mode )
     {
         case PNS_MODE_ROUTE_SINGLE:
@@ -226,6 +230,9 @@ void ROUTER::Move( const VECTOR2I& aP, ITEM* endItem )
 {
     m_currentEnd = aP;
 
+    if( m_state != IDLE )
+        logEvent( LOGGER::EVT_MOVE, aP, endItem );
+
     switch( m_state )
     {
     case ROUTE_TRACK:
@@ -365,6 +372,9 @@ bool ROUTER::FixRoute( const VECTOR2I& aP, ITEM* aEndItem )
 {
     bool rv = false;
 
+    if( m_state != IDLE )
+        logEvent( LOGGER::EVT_FIX, aP, aEndItem );
+
     switch( m_state )
     {
     case ROUTE_TRACK:
@@ -403,6 +413,14 @@ void ROUTER::StopRouting()
     if( !RoutingInProgress() )
         return;
 
+    logEvent( LOGGER::EVT_STOP, m_currentEnd, nullptr );
+
+    if( m_eventLogger )
+    {
+        m_eventLogger->Save( m_eventLogFile, true );
+        m_eventLogger->Clear();
+    }
+
     m_placer.reset();
     m_dragger.reset();
 
@@ -418,6 +436,7 @@ void ROUTER::FlipPosture()
 {
     if( m_state == ROUTE_TRACK )
     {
+        logEvent( LOGGER::EVT_FLIP_POSTURE, m_currentEnd, nullptr );
         m_placer->FlipPosture();
     }
 }
@@ -428,6 +447,7 @@ void ROUTER::SwitchLayer( int aLayer )
     switch( m_state )
     {
     case ROUTE_TRACK:
+        logEvent( LOGGER::EVT_SWITCH_LAYER, m_currentEnd, nullptr, aLayer );
         m_placer->SetLayer( aLayer );
         break;
     default:
@@ -440,6 +460,8 @@ void ROUTER::ToggleViaPlacement()
 {
     if( m_state == ROUTE_TRACK )
     {
+        logEvent( LOGGER::EVT_TOGGLE_VIA, m_currentEnd, nullptr );
+
         bool toggle = !m_placer->IsPlacingVia();
         m_placer->ToggleVia( toggle );
     }
@@ -486,6 +508,47 @@ void ROUTER::DumpLog()
 }
 
 
+void ROUTER::SetEventLogFile( const std::string& aFilename )
+{
+    m_eventLogFile = aFilename;
+
+    if( m_eventLogFile.empty() )
+        m_eventLogger.reset();
+    else if( !m_eventLogger )
+        m_eventLogger.reset( new LOGGER );
+}
+
+
+void ROUTER::logEvent( LOGGER::EVENT_TYPE aType, const VECTOR2I& aP, const ITEM* aItem,
+                       int aLayer, int aDragMode )
+{
+    if( !m_eventLogger )
+        return;
+
+    LOGGER::EVENT_ENTRY evt;
+
+    evt.m_type = aType;
+    evt.m_p = aP;
+    evt.m_layer = aLayer;
+    evt.m_routerMode = m_mode;
+    evt.m_routingMode = m_settings.Mode();
+    evt.m_dragMode = aDragMode;
+    evt.m_trackWidth = m_sizes.TrackWidth();
+    evt.m_viaDiameter = m_sizes.ViaDiameter();
+    evt.m_viaDrill = m_sizes.ViaDrill();
+    evt.m_diffPairWidth = m_sizes.DiffPairWidth();
+    evt.m_diffPairGap = m_sizes.DiffPairGap();
+    evt.m_layerTop = m_sizes.GetLayerTop();
+    evt.m_layerBottom = m_sizes.GetLayerBottom();
+    evt.m_itemKind = aItem ? aItem->Kind() : 0;
+    evt.m_itemNet = aItem ? aItem->Net() : 0;
+    evt.m_itemLayerStart = aItem ? aItem->Layers().Start() : 0;
+    evt.m_itemLayerEnd = aItem ? aItem->Layers().End() : 0;
+
+    m_eventLogger->LogEvent( evt );
+}
+
+
 bool ROUTER::IsPlacingVia() const
 {
     if( !m_placer )
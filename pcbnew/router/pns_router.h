@@ -35,6 +35,7 @@
 #include "pns_item.h"
 #include "pns_itemset.h"
 #include "pns_node.h"
+#include "pns_logger.h"
 
 namespace KIGFX
 {
@@ -160,6 +161,14 @@ public:
 
     void DumpLog();
 
+    /**
+     * Function SetEventLogFile
+     * records the routing and dragging calls in \a aFilename, to replay the sessions
+     * without the GUI.  The events are appended to the file each time the routing
+     * stops.  An empty name disables the recording.
+     */
+    void SetEventLogFile( const std::string& aFilename );
+
     RULE_RESOLVER* GetRuleResolver() const
     {
         return m_iface->GetRuleResolver();
@@ -247,6 +256,9 @@ private:
     void markViolations( NODE* aNode, ITEM_SET& aCurrent, NODE::ITEM_VECTOR& aRemoved );
     bool isStartingPointRoutable( const VECTOR2I& aWhere, int aLayer );
 
+    void logEvent( LOGGER::EVENT_TYPE aType, const VECTOR2I& aP, const ITEM* aItem,
+                   int aLayer = -1, int aDragMode = 0 );
+
     VECTOR2I m_currentEnd;
     RouterState m_state;
 
@@ -271,6 +283,9 @@ private:
 
     wxString m_toolStatusbarName;
     wxString m_failureReason;
+
+    std::unique_ptr< LOGGER > m_eventLogger;
+    std::string               m_eventLogFile;
 };
 
 }
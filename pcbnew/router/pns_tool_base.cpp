@@ -109,6 +109,12 @@ void TOOL_BASE::Reset( RESET_REASON aReason )
     m_router->LoadSettings( m_savedSettings );
     m_router->UpdateSizes( m_savedSizes );
 
+    // Record the routing sessions for the headless replay benchmark (qa/pns_replay)
+    wxString eventLog;
+
+    if( wxGetEnv( wxT( "KICAD_PNS_EVENT_LOG" ), &eventLog ) && !eventLog.IsEmpty() )
+        m_router->SetEventLogFile( std::string( eventLog.mb_str() ) );
+
     m_gridHelper = new GRID_HELPER( frame() );
 }
 
@@ -19,7 +19,10 @@
  * with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <climits>
+
 #include <core/optional.h>
+#include <thread_pool.h>
 
 #include <geometry/shape_line_chain.h>
 
@@ -32,7 +35,6 @@ namespace PNS {
 
 void WALKAROUND::start( const LINE& aInitialPath )
 {
-    m_iteration = 0;
     m_iterationLimit = 50;
 }
 
@@ -52,12 +54,14 @@ NODE::OPT_OBSTACLE WALKAROUND::nearestObstacle( const LINE& aPath )
 
 
 WALKAROUND::WALKAROUND_STATUS WALKAROUND::singleStep( LINE& aPath,
-                                                              bool aWindingDirection )
+                                                              bool aWindingDirection,
+                                                              int aIteration )
 {
     OPT<OBSTACLE>& current_obs =
         aWindingDirection ? m_currentObstacle[0] : m_currentObstacle[1];
 
     bool& prev_recursive = aWindingDirection ? m_recursiveCollision[0] : m_recursiveCollision[1];
+    int& blockage_count = aWindingDirection ? m_recursiveBlockageCount[0] : m_recursiveBlockageCount[1];
 
     if( !current_obs )
         return DONE;
@@ -68,9 +72,9 @@ WALKAROUND::WALKAROUND_STATUS WALKAROUND::singleStep( LINE& aPath,
 
     if( ( current_obs->m_hull ).PointInside( last ) || ( current_obs->m_hull ).PointOnEdge( last ) )
     {
-        m_recursiveBlockageCount++;
+        blockage_count++;
 
-        if( m_recursiveBlockageCount < 3 )
+        if( blockage_count < 3 )
             aPath.Line().Append( current_obs->m_hull.NearestPoint( last ) );
         else
         {
@@ -85,7 +89,9 @@ WALKAROUND::WALKAROUND_STATUS WALKAROUND::singleStep( LINE& aPath,
                       path_post[1], !aWindingDirection );
 
 #ifdef DEBUG
-    m_logger.NewGroup( aWindingDirection ? "walk-cw" : "walk-ccw", m_iteration );
+    std::lock_guard<std::mutex> lock( m_loggerMutex );
+
+    m_logger.NewGroup( aWindingDirection ? "walk-cw" : "walk-ccw", aIteration );
     m_logger.Log( &path_walk[0], 0, "path-walk" );
     m_logger.Log( &path_pre[0], 1, "path-pre" );
     m_logger.Log( &path_post[0], 4, "path-post" );
@@ -141,12 +147,55 @@ WALKAROUND::WALKAROUND_STATUS WALKAROUND::singleStep( LINE& aPath,
 }
 
 
+void WALKAROUND::walkDirection( LINE& aPath, bool aWindingDirection,
+                                std::atomic_int* aDoneIteration )
+{
+    int dir = aWindingDirection ? 0 : 1;
+
+    for( int i = 0; i < m_iterationLimit; i++ )
+    {
+        if( !m_forceLongerPath && i > aDoneIteration[1 - dir] )
+            return;
+
+        if( singleStep( aPath, aWindingDirection, i ) == DONE )
+        {
+            aDoneIteration[dir] = i;
+            return;
+        }
+    }
+}
+
+
+/**
+ * Function isBetterPath
+ * compares two walkarounds with COST_ESTIMATOR.
+ * @return true if aA has lower length and corner costs than aB or, when each path has
+ * one lower cost, a lower length.
+ */
+static bool isBetterPath( LINE& aA, LINE& aB )
+{
+    COST_ESTIMATOR costA, costB;
+
+    costA.Add( aA );
+    costB.Add( aB );
+
+    if( costB.IsBetter( costA, 1.0, 1.0 ) )
+        return true;
+
+    if( costA.IsBetter( costB, 1.0, 1.0 ) )
+        return false;
+
+    return costA.GetLengthCost() < costB.GetLengthCost();
+}
+
+
 WALKAROUND::WALKAROUND_STATUS WALKAROUND::Route( const LINE& aInitialPath,
         LINE& aWalkPath, bool aOptimize )
 {
     LINE path_cw( aInitialPath ), path_ccw( aInitialPath );
     WALKAROUND_STATUS s_cw = IN_PROGRESS, s_ccw = IN_PROGRESS;
     SHAPE_LINE_CHAIN best_path;
+    std::atomic_int done_iter[2];
 
     // special case for via-in-the-middle-of-track placement
     if( aInitialPath.PointCount() <= 1 )
@@ -161,7 +210,8 @@ WALKAROUND::WALKAROUND_STATUS WALKAROUND::Route( const LINE& aInitialPath,
     start( aInitialPath );
 
     m_currentObstacle[0] = m_currentObstacle[1] = nearestObstacle( aInitialPath );
-    m_recursiveBlockageCount = 0;
+    m_recursiveBlockageCount[0] = m_recursiveBlockageCount[1] = 0;
+    done_iter[0] = done_iter[1] = INT_MAX;
 
     aWalkPath = aInitialPath;
 
@@ -174,49 +224,62 @@ WALKAROUND::WALKAROUND_STATUS WALKAROUND::Route( const LINE& aInitialPath,
         m_forceSingleDirection = false;
     }
 
-    while( m_iteration < m_iterationLimit )
+    // The directions are walked on their own, and the path is chosen from the iterations
+    // where they are done, like the former lockstep loop did.  The results can differ from
+    // the lockstep ones: each direction counts its own recursive blockages, and stops when
+    // it is first done, even if the longer path is wanted.  When both directions are done at
+    // the same iteration, the path is chosen with COST_ESTIMATOR rather than by length only.
+    THREAD_POOL& pool = THREAD_POOL::Instance();
+
+    if( s_cw != STUCK && s_ccw != STUCK && m_currentObstacle[0] && pool.GetThreadCount() > 1 )
+    {
+        auto ccw = pool.Submit( [&]() { walkDirection( path_ccw, false, done_iter ); } );
+
+        walkDirection( path_cw, true, done_iter );
+        pool.Wait( ccw );
+    }
+    else
     {
         if( s_cw != STUCK )
-            s_cw = singleStep( path_cw, true );
+            walkDirection( path_cw, true, done_iter );
 
         if( s_ccw != STUCK )
-            s_ccw = singleStep( path_ccw, false );
+            walkDirection( path_ccw, false, done_iter );
+    }
 
-        if( ( s_cw == DONE && s_ccw == DONE ) || ( s_cw == STUCK && s_ccw == STUCK ) )
-        {
-            int len_cw  = path_cw.CLine().Length();
-            int len_ccw = path_ccw.CLine().Length();
+    int iter_cw = done_iter[0];
+    int iter_ccw = done_iter[1];
+    int iter_end;
 
-            if( m_forceLongerPath )
-                aWalkPath = ( len_cw > len_ccw ? path_cw : path_ccw );
-            else
-                aWalkPath = ( len_cw < len_ccw ? path_cw : path_ccw );
+    if( m_forceLongerPath )
+        iter_end = ( iter_cw == INT_MAX || iter_ccw == INT_MAX ) ? INT_MAX : std::max( iter_cw, iter_ccw );
+    else
+        iter_end = std::min( iter_cw, iter_ccw );
 
-            break;
-        }
-        else if( s_cw == DONE && !m_forceLongerPath )
-        {
-            aWalkPath = path_cw;
-            break;
-        }
-        else if( s_ccw == DONE && !m_forceLongerPath )
-        {
-            aWalkPath = path_ccw;
-            break;
-        }
+    if( iter_cw != INT_MAX )
+        s_cw = DONE;
 
-        m_iteration++;
-    }
+    if( iter_ccw != INT_MAX )
+        s_ccw = DONE;
 
-    if( m_iteration == m_iterationLimit )
+    if( iter_end == INT_MAX || m_forceLongerPath
+            || ( iter_cw == iter_end && iter_ccw == iter_end ) )
     {
-        int len_cw  = path_cw.CLine().Length();
-        int len_ccw = path_ccw.CLine().Length();
-
+        // The longer path is wanted for its length (e.g. by the length tuner), so the
+        // corners are not weighed then
         if( m_forceLongerPath )
-            aWalkPath = ( len_cw > len_ccw ? path_cw : path_ccw );
+            aWalkPath = ( path_cw.CLine().Length() > path_ccw.CLine().Length() ? path_cw
+                                                                                : path_ccw );
         else
-            aWalkPath = ( len_cw < len_ccw ? path_cw : path_ccw );
+            aWalkPath = ( isBetterPath( path_cw, path_ccw ) ? path_cw : path_ccw );
+    }
+    else if( iter_cw == iter_end )
+    {
+        aWalkPath = path_cw;
+    }
+    else
+    {
+        aWalkPath = path_ccw;
     }
 
     if( m_cursorApproachMode )
@@ -22,6 +22,8 @@
 #ifndef __PNS_WALKAROUND_H
 #define __PNS_WALKAROUND_H
 
+#include <atomic>
+#include <mutex>
 #include <set>
 
 #include "pns_line.h"
@@ -49,9 +51,8 @@ public:
         m_itemMask = ITEM::ANY_T;
 
         // Initialize other members, to avoid uninitialized variables.
-        m_recursiveBlockageCount = 0;
+        m_recursiveBlockageCount[0] = m_recursiveBlockageCount[1] = 0;
         m_recursiveCollision[0] = m_recursiveCollision[1] = false;
-        m_iteration = 0;
         m_forceCw = false;
     }
 
@@ -129,13 +130,23 @@ public:
 private:
     void start( const LINE& aInitialPath );
 
-    WALKAROUND_STATUS singleStep( LINE& aPath, bool aWindingDirection );
+    WALKAROUND_STATUS singleStep( LINE& aPath, bool aWindingDirection, int aIteration );
+
+    /**
+     * Function walkDirection
+     * runs the steps of a single winding direction, until its path goes around all the
+     * obstacles (the iteration is then stored in aDoneIteration), the iteration limit is
+     * reached or, if the shortest path is wanted, the other direction has been done on
+     * an earlier iteration.  The two directions only share read-only data, so they can
+     * be walked at the same time; in particular each one has its own recursive blockage
+     * count.
+     */
+    void walkDirection( LINE& aPath, bool aWindingDirection, std::atomic_int* aDoneIteration );
     NODE::OPT_OBSTACLE nearestObstacle( const LINE& aPath );
 
     NODE* m_world;
 
-    int m_recursiveBlockageCount;
-    int m_iteration;
+    int m_recursiveBlockageCount[2];
     int m_iterationLimit;
     int m_itemMask;
     bool m_forceSingleDirection, m_forceLongerPath;
@@ -146,6 +157,9 @@ private:
     NODE::OPT_OBSTACLE m_currentObstacle[2];
     bool m_recursiveCollision[2];
     LOGGER m_logger;
+#ifdef DEBUG
+    std::mutex m_loggerMutex;
+#endif
     std::set<ITEM*> m_restrictedSet;
 };
 
@@ -34,13 +34,17 @@
 #include <pcbnew_id.h>
 #include <build_version.h>
 #include <class_board.h>
+#include <class_track.h>
 #include <class_drawpanel.h>
 #include <kicad_string.h>
 #include <io_mgr.h>
+#include <properties.h>
 #include <macros.h>
 #include <stdlib.h>
 #include <pcb_draw_panel_gal.h>
 #include <action_plugin.h>
+#include <drc.h>
+#include <token_snapshot.h>
 
 static PCB_EDIT_FRAME* s_PcbEditFrame = NULL;
 
@@ -101,6 +105,79 @@ bool SaveBoard( wxString& aFileName, BOARD* aBoard )
 }
 
 
+bool WriteDRCReport( BOARD* aBoard, wxString& aReportFileName, bool aJsonFormat,
+                     bool aRefillZones )
+{
+    DRC drc( aBoard );
+
+    drc.SetSettings( true,          // Pad to pad DRC test enabled
+                     true,          // unconnected pads DRC test enabled
+                     true,          // DRC test for zones enabled
+                     true,          // DRC test for keepout areas enabled
+                     aRefillZones,
+                     true,          // Footprint courtyard overlap test enabled
+                     true,          // Missing courtyard test enabled
+                     false,         // Report only the first error of each track
+                     aReportFileName, false );
+
+    drc.RunTests();
+
+    return drc.WriteReport( aReportFileName, aJsonFormat ? DRC_REPORT_JSON : DRC_REPORT_SEXPR );
+}
+
+
+std::vector<int> GetDRCRetestedTracks( BOARD* aBoard, BOARD_ITEM* aItem,
+                                       const EDA_RECT& aOldBBox )
+{
+    DRC drc( aBoard );
+    std::vector<TRACK*> tracks;
+    std::vector<D_PAD*> pads;
+    std::vector<int>    indices;
+
+    // The dirty areas of a modified item, as collected by BOARD_COMMIT::Push()
+    drc.GetRetestedItems( { aItem->GetBoundingBox(), aOldBBox }, tracks, pads );
+
+    int    ii = 0;
+    size_t next = 0;
+
+    for( TRACK* segm = aBoard->m_Track; segm && next < tracks.size(); segm = segm->Next() )
+    {
+        if( segm == tracks[next] )
+        {
+            indices.push_back( ii );
+            ++next;
+        }
+
+        ++ii;
+    }
+
+    return indices;
+}
+
+
+MODULE* FootprintLoadWithCacheSize( PLUGIN* aPlugin, const wxString& aLibraryPath,
+                                    const wxString& aFootprintName, int aCacheSize )
+{
+    PROPERTIES props;
+
+    props[ "footprint_cache_size" ] = UTF8( wxString::Format( "%d", aCacheSize ) );
+
+    return aPlugin->FootprintLoad( aLibraryPath, aFootprintName, &props );
+}
+
+
+unsigned long long GetTokenSnapshotHitCount()
+{
+    return TOKEN_SNAPSHOT_FILE::GetHitCount();
+}
+
+
+void WaitForTokenSnapshots()
+{
+    TOKEN_SNAPSHOT_FILE::WaitForBackgroundSaves();
+}
+
+
 void Refresh()
 {
     if( s_PcbEditFrame )
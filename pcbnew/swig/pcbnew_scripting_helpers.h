@@ -49,6 +49,48 @@ BOARD*  LoadBoard( wxString& aFileName );
 // so no option to choose the file format.
 bool    SaveBoard( wxString& aFileName, BOARD* aBoard );
 
+/**
+ * Run the DRC on aBoard, without using the board editor, and write the markers, the
+ * unconnected items and the duration of each test phase to aReportFileName.
+ * The markers are not added to the board, so it can also be the board being edited.
+ *
+ * @param aJsonFormat = true to write a JSON report, false to write a s-expression report
+ * @param aRefillZones = true to refill all zones before the tests
+ * @return true if the report was written
+ */
+bool    WriteDRCReport( BOARD* aBoard, wxString& aReportFileName, bool aJsonFormat = false,
+                        bool aRefillZones = false );
+
+/**
+ * Find the tracks which the incremental DRC of the board editor tests again once aItem
+ * has been changed, aOldBBox being the bounding box of aItem before the change.
+ *
+ * @return the indices of these tracks in the track list of aBoard
+ */
+std::vector<int> GetDRCRetestedTracks( BOARD* aBoard, BOARD_ITEM* aItem,
+                                       const EDA_RECT& aOldBBox );
+
+/**
+ * Load the footprint aFootprintName of the library aLibraryPath with aPlugin, with the
+ * "footprint_cache_size" library option set to aCacheSize megabytes.  The option only
+ * applies when aPlugin reads the library for the first time.
+ *
+ * @return the footprint, owned by the caller, or NULL if the library has no such footprint
+ */
+MODULE* FootprintLoadWithCacheSize( PLUGIN* aPlugin, const wxString& aLibraryPath,
+                                    const wxString& aFootprintName, int aCacheSize );
+
+/**
+ * @return the number of board and footprint files loaded from their token snapshot
+ * instead of their text, since the start.
+ */
+unsigned long long GetTokenSnapshotHitCount();
+
+/**
+ * Wait for the end of the token snapshots written in the background after a load.
+ */
+void    WaitForTokenSnapshots();
+
 /**
  * Update the board display after modifying it bu a python script
  * (note: it is automatically called by action plugins, after running the plugin,
@@ -1061,6 +1061,10 @@ int PCB_EDITOR_CONTROL::ShowLocalRatsnest( const TOOL_EVENT& aEvent )
 }
 
 
+///> Time (in ms) given to the dynamic ratsnest of the selection on each drag event
+static const int SELECTION_RATSNEST_BUDGET = 15;
+
+
 int PCB_EDITOR_CONTROL::UpdateSelectionRatsnest( const TOOL_EVENT& aEvent )
 {
     auto selectionTool = m_toolMgr->GetTool<SELECTION_TOOL>();
@@ -1081,16 +1085,21 @@ int PCB_EDITOR_CONTROL::UpdateSelectionRatsnest( const TOOL_EVENT& aEvent )
     {
         // Check how much time doest it take to calculate ratsnest
         PROF_COUNTER counter;
-        calculateSelectionRatsnest();
+        bool complete = calculateSelectionRatsnest( SELECTION_RATSNEST_BUDGET );
         counter.Stop();
 
-        // If it is too slow, then switch to 'slow ratsnest' mode when
+        // If it is too slow even with the budget, then switch to 'slow ratsnest' mode when
         // ratsnest is calculated when user stops dragging items for a moment
         if( counter.msecs() > 25 )
         {
             m_slowRatsnest = true;
             connectivity->HideDynamicRatsnest();
         }
+        else if( !complete )
+        {
+            // The nets which missed the budget are finished by the timer
+            m_ratsnestTimer.Start( 20 );
+        }
     }
 
     return 0;
@@ -1108,13 +1117,16 @@ int PCB_EDITOR_CONTROL::HideSelectionRatsnest( const TOOL_EVENT& aEvent )
 void PCB_EDITOR_CONTROL::ratsnestTimer( wxTimerEvent& aEvent )
 {
     m_ratsnestTimer.Stop();
-    calculateSelectionRatsnest();
+
+    if( !calculateSelectionRatsnest( m_slowRatsnest ? -1 : SELECTION_RATSNEST_BUDGET ) )
+        m_ratsnestTimer.Start( 20 );
+
     static_cast<PCB_DRAW_PANEL_GAL*>( m_frame->GetGalCanvas() )->RedrawRatsnest();
     m_frame->GetGalCanvas()->Refresh();
 }
 
 
-void PCB_EDITOR_CONTROL::calculateSelectionRatsnest()
+bool PCB_EDITOR_CONTROL::calculateSelectionRatsnest( int aTimeBudget )
 {
     auto selectionTool = m_toolMgr->GetTool<SELECTION_TOOL>();
     auto& selection = selectionTool->GetSelection();
@@ -1126,7 +1138,7 @@ void PCB_EDITOR_CONTROL::calculateSelectionRatsnest()
     for( auto item : selection )
         items.push_back( static_cast<BOARD_ITEM*>( item ) );
 
-    connectivity->ComputeDynamicRatsnest( items );
+    return connectivity->ComputeDynamicRatsnest( items, aTimeBudget );
 }
 
 
@@ -120,8 +120,9 @@ private:
     ///> Event handler to recalculate dynamic ratsnest
     void ratsnestTimer( wxTimerEvent& aEvent );
 
-    ///> Recalculates dynamic ratsnest for the current selection
-    void calculateSelectionRatsnest();
+    ///> Recalculates dynamic ratsnest for the current selection. Returns false if some
+    ///> nets did not fit in aTimeBudget (in ms, -1 for no limit).
+    bool calculateSelectionRatsnest( int aTimeBudget = -1 );
 
     ///> Sets up handlers for various events.
     void setTransitions() override;
@@ -141,7 +142,8 @@ private:
     ///> Flag to indicate whether the current selection ratsnest is slow to calculate.
     bool m_slowRatsnest;
 
-    ///> Timer that start ratsnest calculation when it is slow to compute.
+    ///> Timer that start ratsnest calculation when it is slow to compute, or finishes the
+    ///> nets which did not fit in the time budget of a drag event.
     wxTimer m_ratsnestTimer;
 
     ///> How to modify a property for selected items.
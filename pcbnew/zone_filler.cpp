@@ -26,6 +26,8 @@
 #include <cstdint>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <functional>
 
 #include <class_board.h>
 #include <class_zone.h>
@@ -40,6 +42,7 @@
 #include <board_commit.h>
 
 #include <widgets/progress_reporter.h>
+#include <thread_pool.h>
 
 #include <geometry/shape_poly_set.h>
 #include <geometry/shape_file_io.h>
@@ -64,8 +67,18 @@ extern void CreateThermalReliefPadPolygon( SHAPE_POLY_SET& aCornerBuffer,
 static double s_thermalRot = 450;    // angle of stubs in thermal reliefs for round pads
 static const bool s_DumpZonesWhenFilling = false;
 
+// Zones having more hole vertices than s_tiledFillMinVertexCount are filled by tiles,
+// each tile having about s_tiledFillTileVertexCount hole vertices.
+static const int s_tiledFillMinVertexCount = 20000;
+static const int s_tiledFillTileVertexCount = 5000;
+static const int s_tiledFillMaxTilesPerAxis = 16;
+
+// Overlap of the fill tiles, to avoid seams when merging them
+static const int s_tiledFillOverlap = Millimeter2iu( 0.01 );
+
+
 ZONE_FILLER::ZONE_FILLER(  BOARD* aBoard, COMMIT* aCommit ) :
-    m_board( aBoard ), m_commit( aCommit ), m_progressReporter( nullptr ), m_count_done( 0 )
+    m_board( aBoard ), m_commit( aCommit ), m_progressReporter( nullptr )
 {
 }
 
@@ -82,8 +95,6 @@ void ZONE_FILLER::SetProgressReporter( PROGRESS_REPORTER* aReporter )
 
 void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
 {
-    int parallelThreadCount = std::max( ( int )std::thread::hardware_concurrency(), 2 );
-
     std::vector<CN_ZONE_ISOLATED_ISLAND_LIST> toFill;
     auto connectivity = m_board->GetConnectivity();
 
@@ -93,15 +104,31 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
     // Remove segment zones
     m_board->m_Zone.DeleteAll();
 
+    std::vector<MD5_HASH> fingerprints;
+
     for( auto zone : aZones )
     {
         // Keepout zones are not filled
         if( zone->GetIsKeepout() )
             continue;
 
+        // Zones whose inputs did not change since their last fill are up to date
+        MD5_HASH fingerprint = zone->ComputeFillFingerprint();
+
+        if( zone->IsFilled() && zone->GetFillFingerprint().IsValid()
+                && zone->GetFillFingerprint() == fingerprint )
+            continue;
+
         CN_ZONE_ISOLATED_ISLAND_LIST l;
         l.m_zone = zone;
         toFill.push_back( l );
+        fingerprints.push_back( fingerprint );
+    }
+
+    if( toFill.empty() )
+    {
+        connectivity->Unlock();
+        return;
     }
 
     for( unsigned i = 0; i < toFill.size(); i++ )
@@ -118,44 +145,24 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
         m_progressReporter->SetMaxProgress( toFill.size() );
     }
 
-    m_next = 0;
-    m_count_done = 0;
-    std::vector<std::thread> fillWorkers;
-
-    for( ssize_t ii = 0; ii < parallelThreadCount; ++ii )
-    {
-        fillWorkers.push_back( std::thread( [ this, toFill ]()
-        {
-            size_t i = m_next.fetch_add( 1 );
-            while( i < toFill.size() )
-            {
-                SHAPE_POLY_SET rawPolys, finalPolys;
-                ZONE_SEGMENT_FILL segFill;
-                fillSingleZone( toFill[i].m_zone, rawPolys, finalPolys );
+    // Filling is not cancellable: a zone must not be left half updated
+    std::function<bool()> refresh;
 
-                toFill[i].m_zone->SetRawPolysList( rawPolys );
-                toFill[i].m_zone->SetFilledPolysList( finalPolys );
-                toFill[i].m_zone->SetIsFilled( true );
+    if( m_progressReporter )
+        refresh = [this]() { m_progressReporter->KeepRefreshing(); return true; };
 
-                if( m_progressReporter )
-                    m_progressReporter->AdvanceProgress();
+    THREAD_POOL::Instance().ParallelFor( toFill.size(), [&]( size_t i )
+    {
+        SHAPE_POLY_SET rawPolys, finalPolys;
+        fillSingleZone( toFill[i].m_zone, rawPolys, finalPolys );
 
-                m_count_done.fetch_add( 1 );
-                i = m_next.fetch_add( 1 );
-            }
-        } ) );
-    }
+        toFill[i].m_zone->SetRawPolysList( rawPolys );
+        toFill[i].m_zone->SetFilledPolysList( finalPolys );
+        toFill[i].m_zone->SetIsFilled( true );
 
-    while( m_count_done.load() < toFill.size() )
-    {
         if( m_progressReporter )
-            m_progressReporter->KeepRefreshing();
-        else
-            wxMilliSleep( 20 );
-    }
-
-    for( size_t ii = 0; ii < fillWorkers.size(); ++ii )
-        fillWorkers[ ii ].join();
+            m_progressReporter->AdvanceProgress();
+    }, refresh );
 
     // Now remove insulated copper islands
     if( m_progressReporter )
@@ -181,6 +188,9 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
         zone.m_zone->SetFilledPolysList( poly );
     }
 
+    for( unsigned i = 0; i < toFill.size(); i++ )
+        toFill[i].m_zone->SetFillFingerprint( fingerprints[i] );
+
     if( m_progressReporter )
     {
         m_progressReporter->AdvancePhase();
@@ -188,38 +198,13 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
         m_progressReporter->SetMaxProgress( toFill.size() );
     }
 
-    m_next = 0;
-    m_count_done = 0;
-    std::vector<std::thread> triangulationWorkers;
-
-    for( ssize_t ii = 0; ii < parallelThreadCount; ++ii )
-    {
-        triangulationWorkers.push_back( std::thread( [ this, toFill ]()
-        {
-            size_t i = m_next.fetch_add( 1 );
-            while( i < toFill.size() )
-            {
-                if( m_progressReporter )
-                    m_progressReporter->AdvanceProgress();
-
-                toFill[i].m_zone->CacheTriangulation();
-
-                m_count_done.fetch_add( 1 );
-                i = m_next.fetch_add( 1 );
-            }
-        } ) );
-    }
-
-    while( m_count_done.load() < toFill.size() )
+    THREAD_POOL::Instance().ParallelFor( toFill.size(), [&]( size_t i )
     {
         if( m_progressReporter )
-            m_progressReporter->KeepRefreshing();
-        else
-            wxMilliSleep( 10 );
-    }
+            m_progressReporter->AdvanceProgress();
 
-    for( size_t ii = 0; ii < triangulationWorkers.size(); ++ii )
-        triangulationWorkers[ ii ].join();
+        toFill[i].m_zone->CacheTriangulation();
+    }, refresh );
 
     // If some zones must be filled by segments, create the filling segments
     // (note, this is a outdated option, but it exists)
@@ -240,13 +225,12 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
             m_progressReporter->SetMaxProgress( zones_to_fill_count );
         }
 
-        // TODO: use thread pool to speedup calculations:
-        for( unsigned i = 0; i < toFill.size(); i++ )
+        THREAD_POOL::Instance().ParallelFor( toFill.size(), [&]( size_t i )
         {
             ZONE_CONTAINER* zone = toFill[i].m_zone;
 
             if( zone->GetFillMode() != ZFM_SEGMENTS )
-                continue;
+                return;
 
             if( m_progressReporter )
             {
@@ -257,7 +241,7 @@ void ZONE_FILLER::Fill( std::vector<ZONE_CONTAINER*> aZones )
 
             fillZoneWithSegments( zone, zone->GetFilledPolysList(), segFill );
             toFill[i].m_zone->SetFillSegments( segFill );
-        }
+        }, refresh );
     }
 
     if( m_progressReporter )
@@ -713,15 +697,15 @@ void ZONE_FILLER::computeRawFilledAreas( const ZONE_CONTAINER* aZone,
 
     // Generate the filled areas (currently, without thermal shapes, which will
     // be created later).
-    // Use SHAPE_POLY_SET::PM_STRICTLY_SIMPLE to generate strictly simple polygons
-    // needed by Gerber files and Fracture()
-    solidAreas.BooleanSubtract( holes, SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
+    // subtractHoles() generates strictly simple polygons needed by Gerber files
+    // and Fracture()
+    subtractHoles( solidAreas, holes );
 
     if( s_DumpZonesWhenFilling )
         dumper->Write( &solidAreas, "solid-areas-minus-holes" );
 
     SHAPE_POLY_SET areas_fractured = solidAreas;
-    areas_fractured.Fracture( SHAPE_POLY_SET::PM_FAST );
+    fractureAreas( areas_fractured );
 
     if( s_DumpZonesWhenFilling )
         dumper->Write( &areas_fractured, "areas_fractured" );
@@ -743,17 +727,16 @@ void ZONE_FILLER::computeRawFilledAreas( const ZONE_CONTAINER* aZone,
     if( !thermalHoles.IsEmpty() )
     {
         thermalHoles.Simplify( SHAPE_POLY_SET::PM_FAST );
-        // Remove unconnected stubs. Use SHAPE_POLY_SET::PM_STRICTLY_SIMPLE to
-        // generate strictly simple polygons
+        // Remove unconnected stubs. subtractHoles() generates strictly simple polygons
         // needed by Gerber files and Fracture()
-        solidAreas.BooleanSubtract( thermalHoles, SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
+        subtractHoles( solidAreas, thermalHoles );
 
         if( s_DumpZonesWhenFilling )
             dumper->Write( &thermalHoles, "thermal-holes" );
 
         // put these areas in m_FilledPolysList
         SHAPE_POLY_SET th_fractured = solidAreas;
-        th_fractured.Fracture( SHAPE_POLY_SET::PM_FAST );
+        fractureAreas( th_fractured );
 
         if( s_DumpZonesWhenFilling )
             dumper->Write( &th_fractured, "th_fractured" );
@@ -767,6 +750,124 @@ void ZONE_FILLER::computeRawFilledAreas( const ZONE_CONTAINER* aZone,
         dumper->EndGroup();
 }
 
+void ZONE_FILLER::subtractHoles( SHAPE_POLY_SET& aAreas, const SHAPE_POLY_SET& aHoles ) const
+{
+    int holeVertexCount = aHoles.TotalVertices();
+    int tilesPerAxis = KiROUND( sqrt( (double) holeVertexCount / s_tiledFillTileVertexCount ) );
+    tilesPerAxis = std::min( tilesPerAxis, s_tiledFillMaxTilesPerAxis );
+
+    if( holeVertexCount < s_tiledFillMinVertexCount || tilesPerAxis < 2
+            || aAreas.OutlineCount() == 0 )
+    {
+        aAreas.BooleanSubtract( aHoles, SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
+        return;
+    }
+
+    const BOX2I bbox = aAreas.BBox();
+    const int   tileSizeX = bbox.GetWidth() / tilesPerAxis + 1;
+    const int   tileSizeY = bbox.GetHeight() / tilesPerAxis + 1;
+
+    auto tileIndex = []( int aCoord, int aOrigin, int aSize, int aCount )
+    {
+        return std::min( std::max( ( aCoord - aOrigin ) / aSize, 0 ), aCount - 1 );
+    };
+
+    // Give to each tile the holes overlapping it, so a tile does not have to clip all
+    // the holes of the zone
+    std::vector<SHAPE_POLY_SET> tileHoles( tilesPerAxis * tilesPerAxis );
+
+    for( int ii = 0; ii < aHoles.OutlineCount(); ++ii )
+    {
+        const SHAPE_POLY_SET::POLYGON& hole = aHoles.CPolygon( ii );
+        const BOX2I holeBox = hole[0].BBox( 2 * s_tiledFillOverlap );
+
+        int x0 = tileIndex( holeBox.GetLeft(), bbox.GetLeft(), tileSizeX, tilesPerAxis );
+        int x1 = tileIndex( holeBox.GetRight(), bbox.GetLeft(), tileSizeX, tilesPerAxis );
+        int y0 = tileIndex( holeBox.GetTop(), bbox.GetTop(), tileSizeY, tilesPerAxis );
+        int y1 = tileIndex( holeBox.GetBottom(), bbox.GetTop(), tileSizeY, tilesPerAxis );
+
+        for( int ty = y0; ty <= y1; ++ty )
+        {
+            for( int tx = x0; tx <= x1; ++tx )
+            {
+                SHAPE_POLY_SET& holes = tileHoles[ ty * tilesPerAxis + tx ];
+                int outline = holes.AddOutline( hole[0] );
+
+                for( size_t jj = 1; jj < hole.size(); ++jj )
+                    holes.AddHole( hole[jj], outline );
+            }
+        }
+    }
+
+    std::vector<SHAPE_POLY_SET> tiles( tileHoles.size() );
+
+    THREAD_POOL::Instance().ParallelFor( tiles.size(), [&]( size_t aTile )
+    {
+        int left = bbox.GetLeft() + ( aTile % tilesPerAxis ) * tileSizeX - s_tiledFillOverlap;
+        int top  = bbox.GetTop() + ( aTile / tilesPerAxis ) * tileSizeY - s_tiledFillOverlap;
+        int right = left + tileSizeX + 2 * s_tiledFillOverlap;
+        int bottom = top + tileSizeY + 2 * s_tiledFillOverlap;
+
+        SHAPE_POLY_SET tileArea;
+        tileArea.NewOutline();
+        tileArea.Append( left, top );
+        tileArea.Append( right, top );
+        tileArea.Append( right, bottom );
+        tileArea.Append( left, bottom );
+
+        tiles[aTile].BooleanIntersection( aAreas, tileArea, SHAPE_POLY_SET::PM_FAST );
+        tiles[aTile].BooleanSubtract( tileHoles[aTile], SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
+    } );
+
+    // Stitch the tiles: they overlap, so merging them leaves no seam
+    aAreas.RemoveAllContours();
+
+    for( const auto& tile : tiles )
+        aAreas.Append( tile );
+
+    aAreas.Simplify( SHAPE_POLY_SET::PM_STRICTLY_SIMPLE );
+}
+
+
+void ZONE_FILLER::fractureAreas( SHAPE_POLY_SET& aAreas ) const
+{
+    if( aAreas.TotalVertices() < s_tiledFillMinVertexCount || aAreas.OutlineCount() < 2 )
+    {
+        aAreas.Fracture( SHAPE_POLY_SET::PM_FAST );
+        return;
+    }
+
+    // The polygons are disjoint, so they can be fractured separately.  Split them in
+    // groups of consecutive polygons, to keep the order of the serial version.
+    size_t groupCount = THREAD_POOL::Instance().GetThreadCount() * 4;
+    groupCount = std::min( groupCount, (size_t) aAreas.OutlineCount() );
+
+    std::vector<SHAPE_POLY_SET> groups( groupCount );
+
+    THREAD_POOL::Instance().ParallelFor( groupCount, [&]( size_t aGroup )
+    {
+        int first = aGroup * aAreas.OutlineCount() / groupCount;
+        int last = ( aGroup + 1 ) * aAreas.OutlineCount() / groupCount;
+
+        for( int ii = first; ii < last; ++ii )
+        {
+            const SHAPE_POLY_SET::POLYGON& poly = aAreas.CPolygon( ii );
+            int outline = groups[aGroup].AddOutline( poly[0] );
+
+            for( size_t jj = 1; jj < poly.size(); ++jj )
+                groups[aGroup].AddHole( poly[jj], outline );
+        }
+
+        groups[aGroup].Fracture( SHAPE_POLY_SET::PM_FAST );
+    } );
+
+    aAreas.RemoveAllContours();
+
+    for( const auto& group : groups )
+        aAreas.Append( group );
+}
+
+
 /* Build the filled solid areas data from real outlines (stored in m_Poly)
  * The solid areas can be more than one on copper layers, and do not have holes
  * ( holes are linked by overlapping segments to the main outline)
@@ -50,6 +50,20 @@ private:
     void buildZoneFeatureHoleList( const ZONE_CONTAINER* aZone,
             SHAPE_POLY_SET& aFeatures ) const;
 
+    /**
+     * Function subtractHoles
+     * Removes aHoles from aAreas, creating strictly simple polygons.
+     * When there are many holes (large zones), aAreas is cut in overlapping tiles, each
+     * tile being subtracted by a separate thread, and the tiles are merged back.
+     */
+    void subtractHoles( SHAPE_POLY_SET& aAreas, const SHAPE_POLY_SET& aHoles ) const;
+
+    /**
+     * Function fractureAreas
+     * Fractures aAreas, spreading the polygons of large zones over several threads.
+     */
+    void fractureAreas( SHAPE_POLY_SET& aAreas ) const;
+
     /**
      * Function computeRawFilledAreas
      * Add non copper areas polygons (pads and tracks with clearance)
@@ -119,11 +133,6 @@ private:
     BOARD* m_board;
     COMMIT* m_commit;
     PROGRESS_REPORTER* m_progressReporter;
-
-    std::atomic_size_t m_next;          // An index into the vector of zones to fill.
-                                        // Used by the variuos parallel thread sets during
-                                        // fill operations.
-    std::atomic_size_t m_count_done;
 };
 
 #endif
@@ -0,0 +1,130 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * Keyword lookup benchmark: lexes a board with the perfect hash of the keywords
+ * generated with PCB_LEXER, and with the hashtable DSNLEXER builds when there is no
+ * generated hash, and checks that both find the same tokens.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <pcb_lexer.h>
+#include <profile.h>
+
+
+/**
+ * Function lexTokens
+ * lexes the whole of \a aLexer.
+ * @return a checksum of the tokens, the same for the same token sequences.
+ */
+static unsigned long long lexTokens( DSNLEXER& aLexer, int* aTokenCount )
+{
+    unsigned long long checksum = 0;
+    int tok;
+
+    *aTokenCount = 0;
+
+    while( ( tok = aLexer.NextTok() ) != DSN_EOF )
+    {
+        checksum = checksum * 31 + (unsigned) ( tok - DSN_NONE );
+        ++*aTokenCount;
+    }
+
+    return checksum;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char*   filename = argc > 1 ? argv[1] : "../../demos/video/video.kicad_pcb";
+    const int     passes = 10;
+    std::ifstream file( filename, std::ios::binary );
+
+    if( !file )
+    {
+        printf( "Cannot open %s\n", filename );
+        return -1;
+    }
+
+    std::stringstream text;
+    text << file.rdbuf();
+
+    std::string board = text.str();
+
+    // The keyword table of PCB_LEXER, without its hash
+    PCB_LEXER             keywordSource( std::string( "" ) );
+    std::vector<KEYWORD>  keywords;
+
+    for( unsigned ii = 0; ii < keywordSource.GetKeywordCount(); ++ii )
+    {
+        KEYWORD keyword = { keywordSource.GetTokenText( ii ), int( ii ) };
+        keywords.push_back( keyword );
+    }
+
+    unsigned long long hashChecksum = 0;
+    unsigned long long mapChecksum = 0;
+    int                hashTokens = 0;
+    int                mapTokens = 0;
+    double             hashTime = 0.0;
+    double             mapTime = 0.0;
+
+    try
+    {
+        for( int pass = 0; pass < passes; ++pass )
+        {
+            PROF_COUNTER hashCounter( "perfect hash" );
+            PCB_LEXER    hashLexer( board );
+
+            hashChecksum = lexTokens( hashLexer, &hashTokens );
+            hashCounter.Stop();
+            hashTime += hashCounter.msecs();
+
+            PROF_COUNTER mapCounter( "hashtable" );
+            DSNLEXER     mapLexer( &keywords[0], keywords.size(), board, wxEmptyString );
+
+            mapChecksum = lexTokens( mapLexer, &mapTokens );
+            mapCounter.Stop();
+            mapTime += mapCounter.msecs();
+        }
+    }
+    catch( const IO_ERROR& ioe )
+    {
+        printf( "%s\n", (const char*) ioe.What().mb_str() );
+        return -1;
+    }
+
+    printf( "%s: %d tokens\n", filename, hashTokens );
+    printf( "perfect hash: %.1f ms per pass\n", hashTime / passes );
+    printf( "hashtable:    %.1f ms per pass\n", mapTime / passes );
+
+    if( hashTokens != mapTokens || hashChecksum != mapChecksum )
+    {
+        printf( "The token sequences differ\n" );
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+#include <geometry/shape_poly_set.h>
+#include <geometry/shape_line_chain.h>
+
+/**
+ * Allocation counter: every operator new of the test program is counted, so the tests
+ * can measure the allocations done by a polygon operation.
+ */
+static std::atomic_size_t s_allocCount( 0 );
+
+void* operator new( std::size_t aSize )
+{
+    ++s_allocCount;
+
+    void* ptr = std::malloc( aSize ? aSize : 1 );
+
+    if( !ptr )
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+
+void operator delete( void* aPtr ) noexcept
+{
+    std::free( aPtr );
+}
+
+
+/**
+ * A zone-like polygon set: a square area and a grid of round holes (pads or vias)
+ * inside it.
+ */
+struct PolySetAllocFixture
+{
+    static const int GRID = 20;
+    static const int PITCH = 1000000;
+    static const int RADIUS = 300000;
+    static const int SEGMENTS = 32;
+
+    SHAPE_POLY_SET m_area;
+    SHAPE_POLY_SET m_holes;
+
+    PolySetAllocFixture()
+    {
+        m_area.NewOutline();
+        m_area.Append( 0, 0 );
+        m_area.Append( GRID * PITCH, 0 );
+        m_area.Append( GRID * PITCH, GRID * PITCH );
+        m_area.Append( 0, GRID * PITCH );
+
+        for( int ii = 0; ii < GRID * GRID; ++ii )
+        {
+            int cx = ( ii % GRID ) * PITCH + PITCH / 2;
+            int cy = ( ii / GRID ) * PITCH + PITCH / 2;
+
+            m_holes.NewOutline();
+
+            for( int jj = 0; jj < SEGMENTS; ++jj )
+            {
+                double angle = 2.0 * M_PI * jj / SEGMENTS;
+
+                m_holes.Append( cx + int( RADIUS * cos( angle ) ),
+                                cy + int( RADIUS * sin( angle ) ) );
+            }
+        }
+    }
+
+    /**
+     * @return the allocations done by Clipper alone to subtract m_holes from aSubject,
+     * the input paths being converted beforehand.
+     */
+    size_t clipperAllocCount( const SHAPE_POLY_SET& aSubject ) const
+    {
+        ClipperLib::Paths subject, clip;
+
+        for( int ii = 0; ii < aSubject.OutlineCount(); ++ii )
+        {
+            const SHAPE_POLY_SET::POLYGON& poly = aSubject.CPolygon( ii );
+
+            for( size_t jj = 0; jj < poly.size(); ++jj )
+                subject.push_back( toClipper( poly[jj], jj == 0 ) );
+        }
+
+        for( int ii = 0; ii < m_holes.OutlineCount(); ++ii )
+            clip.push_back( toClipper( m_holes.COutline( ii ), true ) );
+
+        size_t start = s_allocCount;
+
+        {
+            ClipperLib::Clipper c;
+            c.AddPaths( subject, ClipperLib::ptSubject, true );
+            c.AddPaths( clip, ClipperLib::ptClip, true );
+
+            ClipperLib::PolyTree solution;
+            c.Execute( ClipperLib::ctDifference, solution, ClipperLib::pftNonZero,
+                       ClipperLib::pftNonZero );
+        }
+
+        return s_allocCount - start;
+    }
+
+    static ClipperLib::Path toClipper( const SHAPE_LINE_CHAIN& aChain, bool aOrientation )
+    {
+        ClipperLib::Path path;
+
+        for( int ii = 0; ii < aChain.PointCount(); ++ii )
+            path.push_back( ClipperLib::IntPoint( aChain.CPoint( ii ).x, aChain.CPoint( ii ).y ) );
+
+        if( ClipperLib::Orientation( path ) != aOrientation )
+            ClipperLib::ReversePath( path );
+
+        return path;
+    }
+};
+
+
+BOOST_FIXTURE_TEST_SUITE( PolySetAlloc, PolySetAllocFixture )
+
+/**
+ * Checks that repeated boolean operations give the same result when their buffers
+ * are reused.
+ */
+BOOST_AUTO_TEST_CASE( RepeatedSubtract )
+{
+    SHAPE_POLY_SET result( m_area );
+    result.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+
+    BOOST_CHECK_EQUAL( result.OutlineCount(), 1 );
+    BOOST_CHECK_EQUAL( result.HoleCount( 0 ), GRID * GRID );
+
+    int vertexCount = result.TotalVertices();
+
+    for( int ii = 0; ii < 3; ++ii )
+    {
+        result.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+
+        BOOST_CHECK_EQUAL( result.OutlineCount(), 1 );
+        BOOST_CHECK_EQUAL( result.HoleCount( 0 ), GRID * GRID );
+        BOOST_CHECK_EQUAL( result.TotalVertices(), vertexCount );
+    }
+}
+
+/**
+ * Allocation benchmark: once the buffers of the thread are warm, a boolean operation
+ * must not allocate more than Clipper itself does, i.e. the conversions to and from
+ * Clipper paths must not allocate anything.
+ */
+BOOST_AUTO_TEST_CASE( SubtractAllocations )
+{
+    SHAPE_POLY_SET result( m_area );
+    result.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+
+    // A new thread starts without any buffer to reuse
+    size_t coldAllocs = 0;
+
+    std::thread coldThread( [&]()
+    {
+        SHAPE_POLY_SET cold( result );
+
+        size_t start = s_allocCount;
+        cold.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+        coldAllocs = s_allocCount - start;
+    } );
+
+    coldThread.join();
+
+    // Let the results swap their storage a few times
+    for( int ii = 0; ii < 3; ++ii )
+        result.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+
+    size_t clipperAllocs = clipperAllocCount( result );
+
+    size_t start = s_allocCount;
+    result.BooleanSubtract( m_holes, SHAPE_POLY_SET::PM_FAST );
+    size_t warmAllocs = s_allocCount - start;
+
+    BOOST_TEST_MESSAGE( "BooleanSubtract allocations: cold " << coldAllocs
+                        << ", warm " << warmAllocs << ", Clipper alone " << clipperAllocs );
+
+    BOOST_CHECK_LE( warmAllocs, clipperAllocs );
+    BOOST_CHECK_LT( warmAllocs, coldAllocs );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
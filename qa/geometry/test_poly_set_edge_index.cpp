@@ -0,0 +1,204 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <cmath>
+
+#include <boost/test/unit_test.hpp>
+
+#include <geometry/shape_poly_set.h>
+#include <geometry/shape_line_chain.h>
+
+/**
+ * A zone-like polygon set: a square area with a grid of round holes, and a small island.
+ * The queries of m_indexed use the edge index once it has been queried a few times, the
+ * queries of m_reference always scan the edges, as the set is modified before each query.
+ */
+struct EdgeIndexFixture
+{
+    static const int GRID = 8;
+    static const int PITCH = 1000000;
+    static const int RADIUS = 300000;
+    static const int SEGMENTS = 24;
+
+    SHAPE_POLY_SET m_indexed;
+    SHAPE_POLY_SET m_reference;
+    unsigned int   m_seed;
+
+    EdgeIndexFixture() :
+        m_seed( 1 )
+    {
+        m_indexed.NewOutline();
+        m_indexed.Append( 0, 0 );
+        m_indexed.Append( GRID * PITCH, 0 );
+        m_indexed.Append( GRID * PITCH, GRID * PITCH );
+        m_indexed.Append( 0, GRID * PITCH );
+
+        for( int ii = 0; ii < GRID * GRID; ++ii )
+        {
+            int cx = ( ii % GRID ) * PITCH + PITCH / 2;
+            int cy = ( ii / GRID ) * PITCH + PITCH / 2;
+
+            m_indexed.NewHole();
+
+            for( int jj = 0; jj < SEGMENTS; ++jj )
+            {
+                double angle = 2.0 * M_PI * jj / SEGMENTS;
+
+                m_indexed.Append( cx + int( RADIUS * cos( angle ) ),
+                                  cy + int( RADIUS * sin( angle ) ), -1, ii );
+            }
+        }
+
+        m_indexed.NewOutline();
+        m_indexed.Append( GRID * PITCH + PITCH, 0 );
+        m_indexed.Append( GRID * PITCH + 2 * PITCH, PITCH / 2 );
+        m_indexed.Append( GRID * PITCH + PITCH, PITCH );
+
+        m_reference = m_indexed;
+    }
+
+    const SHAPE_POLY_SET& reference()
+    {
+        m_reference.Outline( 0 );   // drops the edge index
+        return m_reference;
+    }
+
+    int random( int aMax )
+    {
+        m_seed = m_seed * 1103515245 + 12345;
+        return ( m_seed >> 8 ) % aMax;
+    }
+
+    /**
+     * @return a point near the polygons: a random point, or a vertex of a contour, or a
+     * point next to it (the edge cases of the queries).
+     */
+    VECTOR2I randomPoint()
+    {
+        const int range = ( GRID + 3 ) * PITCH;
+
+        VECTOR2I p( random( range ) - PITCH / 2, random( range ) - PITCH / 2 );
+
+        switch( random( 4 ) )
+        {
+        case 0:
+            return p;
+
+        case 1:
+            return m_indexed.CVertex( random( m_indexed.TotalVertices() ) );
+
+        default:
+            return m_indexed.CVertex( random( m_indexed.TotalVertices() ) )
+                    + VECTOR2I( random( 5 ) - 2, random( 5 ) - 2 );
+        }
+    }
+};
+
+
+BOOST_FIXTURE_TEST_SUITE( PolySetEdgeIndex, EdgeIndexFixture )
+
+/**
+ * Checks that the point queries give the same results with and without the edge index.
+ */
+BOOST_AUTO_TEST_CASE( SameResults )
+{
+    for( int ii = 0; ii < 2000; ++ii )
+    {
+        VECTOR2I p = randomPoint();
+        VECTOR2I q = randomPoint();
+        SEG seg( p, q );
+
+        BOOST_CHECK_EQUAL( m_indexed.Contains( p ), reference().Contains( p ) );
+        BOOST_CHECK_EQUAL( m_indexed.Contains( p, -1, true ), reference().Contains( p, -1, true ) );
+        BOOST_CHECK_EQUAL( m_indexed.Contains( p, 1 ), reference().Contains( p, 1 ) );
+        BOOST_CHECK_EQUAL( m_indexed.PointOnEdge( p ), reference().PointOnEdge( p ) );
+        BOOST_CHECK_EQUAL( m_indexed.Distance( p ), reference().Distance( p ) );
+        BOOST_CHECK_EQUAL( m_indexed.Distance( seg, 1000 ), reference().Distance( seg, 1000 ) );
+        BOOST_CHECK_EQUAL( m_indexed.Collide( p, 200000 ), reference().Distance( p ) <= 200000 );
+    }
+}
+
+/**
+ * Checks that modifying the set drops its edge index, and that copies of the set do not
+ * share an out of date index.
+ */
+BOOST_AUTO_TEST_CASE( Invalidation )
+{
+    VECTOR2I inHole( PITCH / 2, PITCH / 2 );
+    VECTOR2I inArea( PITCH, PITCH / 2 );
+
+    for( int ii = 0; ii < 10; ++ii )
+    {
+        BOOST_CHECK( !m_indexed.Contains( inHole ) );
+        BOOST_CHECK( m_indexed.Contains( inArea ) );
+    }
+
+    SHAPE_POLY_SET copy( m_indexed );
+
+    m_indexed.Move( VECTOR2I( PITCH / 2, 0 ) );
+
+    BOOST_CHECK( m_indexed.Contains( inHole ) );
+    BOOST_CHECK( !m_indexed.Contains( inArea ) );
+    BOOST_CHECK( !copy.Contains( inHole ) );
+    BOOST_CHECK( copy.Contains( inArea ) );
+
+    m_indexed.RemoveContour( 1, 0 );
+
+    for( int ii = 0; ii < 10; ++ii )
+        BOOST_CHECK( m_indexed.Contains( inArea ) );
+}
+
+/**
+ * Checks that a copy made after a modification does not get the out of date index, and
+ * that the non-const accessors of the contours drop the index.
+ */
+BOOST_AUTO_TEST_CASE( CopyAfterModification )
+{
+    VECTOR2I inHole( PITCH / 2, PITCH / 2 );
+    VECTOR2I inArea( PITCH, PITCH / 2 );
+
+    for( int ii = 0; ii < 10; ++ii )
+        BOOST_CHECK( !m_indexed.Contains( inHole ) );
+
+    m_indexed.Move( VECTOR2I( PITCH / 2, 0 ) );
+
+    SHAPE_POLY_SET copy( m_indexed );
+    SHAPE_POLY_SET assigned;
+
+    assigned = m_indexed;
+
+    for( int ii = 0; ii < 10; ++ii )
+    {
+        BOOST_CHECK( copy.Contains( inHole ) );
+        BOOST_CHECK( !copy.Contains( inArea ) );
+        BOOST_CHECK( assigned.Contains( inHole ) );
+        BOOST_CHECK( !assigned.Contains( inArea ) );
+    }
+
+    m_indexed.Outline( 0 ).Move( VECTOR2I( 10 * GRID * PITCH, 0 ) );
+
+    BOOST_CHECK( !m_indexed.Contains( inArea ) );
+    BOOST_CHECK( !m_indexed.Contains( inHole ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
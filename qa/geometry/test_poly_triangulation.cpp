@@ -0,0 +1,104 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <atomic>
+
+#include <boost/test/unit_test.hpp>
+
+#include <geometry/shape_poly_set.h>
+#include <geometry/shape_line_chain.h>
+
+/**
+ * A set of square polygons, fractured like the filled areas of a zone.
+ */
+struct TriangulationFixture
+{
+    SHAPE_POLY_SET m_squares;
+
+    TriangulationFixture()
+    {
+        for( int ii = 0; ii < 4; ++ii )
+        {
+            int x = ii * 1000;
+
+            m_squares.NewOutline();
+            m_squares.Append( x, 0 );
+            m_squares.Append( x + 500, 0 );
+            m_squares.Append( x + 500, 500 );
+            m_squares.Append( x, 500 );
+        }
+
+        m_squares.Fracture( SHAPE_POLY_SET::PM_FAST );
+    }
+};
+
+
+BOOST_FIXTURE_TEST_SUITE( PolyTriangulation, TriangulationFixture )
+
+/**
+ * Checks that each polygon gets its triangulation, and that modifying the set makes
+ * the triangulation out of date.
+ */
+BOOST_AUTO_TEST_CASE( UpToDate )
+{
+    BOOST_CHECK( !m_squares.IsTriangulationUpToDate() );
+
+    m_squares.CacheTriangulation();
+
+    BOOST_CHECK( m_squares.IsTriangulationUpToDate() );
+
+    for( int ii = 0; ii < m_squares.OutlineCount(); ++ii )
+        BOOST_CHECK_EQUAL( m_squares.TriangulatedPolygon( ii )->GetTriangleCount(), 2 );
+
+    m_squares.Outline( 1 ).Point( 2 ).x += 100;
+
+    BOOST_CHECK( !m_squares.IsTriangulationUpToDate() );
+}
+
+/**
+ * Checks that only the modified polygons are triangulated again, including when the
+ * new polygons are assigned to the set (as when a zone is refilled).
+ */
+BOOST_AUTO_TEST_CASE( IncrementalUpdate )
+{
+    m_squares.CacheTriangulation();
+
+    std::vector<const SHAPE_POLY_SET::TRIANGULATED_POLYGON*> before;
+
+    for( int ii = 0; ii < m_squares.OutlineCount(); ++ii )
+        before.push_back( m_squares.TriangulatedPolygon( ii ) );
+
+    SHAPE_POLY_SET modified( m_squares );
+    modified.Outline( 1 ).Point( 2 ).x += 100;
+
+    m_squares = modified;
+    m_squares.CacheTriangulation();
+
+    BOOST_CHECK( m_squares.IsTriangulationUpToDate() );
+    BOOST_CHECK( m_squares.TriangulatedPolygon( 0 ) == before[0] );
+    BOOST_CHECK( m_squares.TriangulatedPolygon( 1 ) != before[1] );
+    BOOST_CHECK( m_squares.TriangulatedPolygon( 2 ) == before[2] );
+    BOOST_CHECK( m_squares.TriangulatedPolygon( 3 ) == before[3] );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,227 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <climits>
+
+#include <boost/test/unit_test.hpp>
+
+#include <geometry/seg_batch.h>
+#include <geometry/shape_line_chain.h>
+#include <profile.h>
+
+/**
+ * Random segments close to each other, most of them axis-aligned or diagonal like the
+ * tracks of a board, to go through all the cases of SEG::Collide().
+ */
+struct SegBatchFixture
+{
+    unsigned int m_seed = 1;
+
+    int random( int aMax )
+    {
+        m_seed = m_seed * 1103515245 + 12345;
+        return ( m_seed >> 8 ) % aMax;
+    }
+
+    int random( int aMin, int aMax )
+    {
+        return aMin + (int) ( ( (long long) random( 1 << 23 ) * ( (long long) aMax - aMin + 1 ) ) >> 23 );
+    }
+
+    VECTOR2I randomEnd( const VECTOR2I& aStart, int aLength )
+    {
+        int len = random( 0, aLength );
+
+        switch( random( 5 ) )
+        {
+        case 0:
+            return aStart + VECTOR2I( random( -aLength, aLength ), random( -aLength, aLength ) );
+
+        case 1:     // nearly horizontal or vertical
+            return aStart + ( random( 2 ) ? VECTOR2I( random( -1, 1 ), len ) : VECTOR2I( len, random( -1, 1 ) ) );
+
+        case 2:     // nearly diagonal
+            return aStart + VECTOR2I( len + random( -1, 1 ), random( 2 ) ? len : -len );
+
+        case 3:     // degenerate
+            return aStart;
+
+        default:
+            return aStart + VECTOR2I( random( -3, 3 ), random( -3, 3 ) );
+        }
+    }
+
+    SEG randomSeg( const VECTOR2I& aCentre, int aRange, int aLength )
+    {
+        VECTOR2I a = aCentre + VECTOR2I( random( -aRange, aRange ), random( -aRange, aRange ) );
+
+        return SEG( a, randomEnd( a, aLength ) );
+    }
+};
+
+
+BOOST_FIXTURE_TEST_SUITE( SegBatch, SegBatchFixture )
+
+/**
+ * Checks that the batch gives the results of SEG::Collide() and SHAPE_LINE_CHAIN::Collide(),
+ * for small and large coordinates.
+ */
+BOOST_AUTO_TEST_CASE( SameResults )
+{
+    const int scales[] = { 1000, 10000000, INT_MAX / 4 };
+
+    for( int scale : scales )
+    {
+        for( int ii = 0; ii < 2000; ++ii )
+        {
+            VECTOR2I centre( random( -scale, scale ), random( -scale, scale ) );
+            int maxClearance = scale / 10;
+            std::vector<SEG> segs;
+            std::vector<int> clearances;
+            SEG_BATCH batch;
+
+            for( int jj = random( 20 ); jj > 0; --jj )
+            {
+                segs.push_back( randomSeg( centre, scale / 2, scale / 2 ) );
+                clearances.push_back( random( 0, maxClearance ) );
+                batch.Add( segs.back(), clearances.back() );
+            }
+
+            SEG seg = randomSeg( centre, scale / 2, scale / 2 );
+            SHAPE_LINE_CHAIN line( seg.A, seg.B );
+
+            for( int jj = random( 4 ); jj > 0; --jj )
+                line.Append( randomEnd( line.CPoint( -1 ), scale / 2 ) );
+
+            int clearance = random( 0, maxClearance );
+            std::vector<bool> hits;
+            int count = 0;
+
+            BOOST_REQUIRE_EQUAL( batch.Size(), (int) segs.size() );
+
+            int batchCount = batch.Collide( seg, clearance, hits );
+
+            for( size_t jj = 0; jj < segs.size(); ++jj )
+            {
+                bool collide = seg.Collide( segs[jj], clearance + clearances[jj] );
+
+                BOOST_CHECK_EQUAL( hits[jj], collide );
+                count += collide;
+            }
+
+            BOOST_CHECK_EQUAL( batchCount, count );
+
+            batchCount = batch.Collide( line, clearance, hits );
+            count = 0;
+
+            for( size_t jj = 0; jj < segs.size(); ++jj )
+            {
+                bool collide = line.Collide( segs[jj], clearance + clearances[jj] );
+
+                BOOST_CHECK_EQUAL( hits[jj], collide );
+                count += collide;
+            }
+
+            BOOST_CHECK_EQUAL( batchCount, count );
+        }
+    }
+}
+
+/**
+ * Compares the time taken by the batch and by the one-by-one tests of the same tracks
+ * against a routed line: a micro-benchmark rather than a test.
+ */
+BOOST_AUTO_TEST_CASE( Benchmark )
+{
+    const int ROUNDS = 20000;
+    const int TRACKS = 64;
+    const int CLEARANCE = 200000;
+
+    std::vector<SEG> tracks;
+    SEG_BATCH batch;
+
+    for( int ii = 0; ii < TRACKS; ++ii )
+    {
+        VECTOR2I a( random( 0, 20000000 ), random( 0, 20000000 ) );
+        int len = random( 100000, 3000000 );
+        VECTOR2I dir( random( -1, 1 ), random( -1, 1 ) );
+
+        tracks.push_back( SEG( a, a + dir * len ) );
+        batch.Add( tracks.back(), 125000 );
+    }
+
+    SHAPE_LINE_CHAIN line;
+    VECTOR2I p( 10000000, 10000000 );
+
+    line.Append( p );
+
+    for( int ii = 0; ii < 4; ++ii )
+    {
+        p += VECTOR2I( random( -1, 1 ), random( -1, 1 ) ) * random( 1000000, 5000000 );
+        line.Append( p );
+    }
+
+    const SEG& seg = line.CSegment( 0 );
+    std::vector<bool> hits;
+    int batchHits = 0, hits1by1 = 0;
+
+    PROF_COUNTER segBatch( "segment, batch" );
+
+    for( int ii = 0; ii < ROUNDS; ++ii )
+        batchHits += batch.Collide( seg, CLEARANCE, hits );
+
+    segBatch.Stop();
+    PROF_COUNTER seg1by1( "segment, one by one" );
+
+    for( int ii = 0; ii < ROUNDS; ++ii )
+    {
+        for( const SEG& track : tracks )
+            hits1by1 += seg.Collide( track, CLEARANCE + 125000 );
+    }
+
+    seg1by1.Stop();
+    PROF_COUNTER lineBatch( "line, batch" );
+
+    for( int ii = 0; ii < ROUNDS; ++ii )
+        batchHits += batch.Collide( line, CLEARANCE, hits );
+
+    lineBatch.Stop();
+    PROF_COUNTER line1by1( "line, one by one" );
+
+    for( int ii = 0; ii < ROUNDS; ++ii )
+    {
+        for( const SEG& track : tracks )
+            hits1by1 += line.Collide( track, CLEARANCE + 125000 );
+    }
+
+    line1by1.Stop();
+
+    BOOST_TEST_MESSAGE( "SEG_BATCH, " << ROUNDS << " x " << TRACKS << " tracks: segment "
+                        << segBatch.msecs() << " ms (one by one " << seg1by1.msecs()
+                        << " ms), line " << lineBatch.msecs() << " ms (one by one "
+                        << line1by1.msecs() << " ms)" );
+
+    BOOST_CHECK_EQUAL( batchHits, hits1by1 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
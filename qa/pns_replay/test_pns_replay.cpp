@@ -0,0 +1,290 @@
+/*
+ * This program source code file is part of KiCad, a free EDA CAD application.
+ *
+ * Copyright (C) 2018 KiCad Developers, see AUTHORS.txt for contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you may find one here:
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ * or you may search the http://www.gnu.org website for the version 2 license,
+ * or you may write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+/**
+ * Interactive router replay benchmark: loads a board, replays the routing sessions
+ * recorded by Pcbnew with the KICAD_PNS_EVENT_LOG environment variable set to the
+ * event log file, and reports the latency percentiles of the router calls.
+ *
+ * The board must be the one the sessions were recorded on, as it was before the
+ * first recorded session.  Only the routing mode and the sizes are recorded, the
+ * other routing settings are the defaults.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <io_mgr.h>
+#include <kicad_plugin.h>
+#include <class_board.h>
+#include <profile.h>
+
+#include "pns_router.h"
+#include "pns_kicad_iface.h"
+#include "pns_logger.h"
+#include "pns_sizes_settings.h"
+
+using PNS::LOGGER;
+
+
+enum CATEGORY
+{
+    CAT_START = 0,
+    CAT_WALKAROUND,
+    CAT_SHOVE,
+    CAT_MARK_OBSTACLES,
+    CAT_DRAG,
+    CAT_FIX,
+    CAT_COUNT
+};
+
+static const char* categoryNames[CAT_COUNT] =
+{
+    "start",
+    "walkaround",
+    "shove",
+    "highlight",
+    "drag",
+    "fix"
+};
+
+
+BOARD* loadBoard( const std::string& filename )
+{
+    PLUGIN::RELEASER pi( new PCB_IO );
+    BOARD* brd = nullptr;
+
+    try
+    {
+        brd = pi->Load( wxString( filename.c_str() ), NULL, NULL );
+    }
+    catch( const IO_ERROR& ioe )
+    {
+        printf( "Error loading board.\n%s\n", (const char*) ioe.Problem().mb_str() );
+        return nullptr;
+    }
+
+    return brd;
+}
+
+
+/**
+ * Function findItem
+ * finds the item of the current router node matching the item recorded in \a aEvent.
+ * @return the item, or NULL if there is no recorded item or no matching item.
+ */
+static PNS::ITEM* findItem( PNS::ROUTER& aRouter, const LOGGER::EVENT_ENTRY& aEvent )
+{
+    if( !aEvent.m_itemKind )
+        return nullptr;
+
+    LAYER_RANGE layers( aEvent.m_itemLayerStart, aEvent.m_itemLayerEnd );
+
+    for( PNS::ITEM* item : aRouter.QueryHoverItems( aEvent.m_p ).Items() )
+    {
+        if( item->Kind() == aEvent.m_itemKind && item->Net() == aEvent.m_itemNet
+                && item->Layers() == layers )
+            return item;
+    }
+
+    return nullptr;
+}
+
+
+/**
+ * Function applySettings
+ * sets the router mode, the routing mode and the sizes recorded when a session started.
+ */
+static void applySettings( PNS::ROUTER& aRouter, const LOGGER::EVENT_ENTRY& aEvent )
+{
+    PNS::SIZES_SETTINGS sizes( aRouter.Sizes() );
+
+    sizes.SetTrackWidth( aEvent.m_trackWidth );
+    sizes.SetViaDiameter( aEvent.m_viaDiameter );
+    sizes.SetViaDrill( aEvent.m_viaDrill );
+    sizes.SetDiffPairWidth( aEvent.m_diffPairWidth );
+    sizes.SetDiffPairGap( aEvent.m_diffPairGap );
+    sizes.ClearLayerPairs();
+    sizes.AddLayerPair( aEvent.m_layerTop, aEvent.m_layerBottom );
+
+    aRouter.SetMode( (PNS::ROUTER_MODE) aEvent.m_routerMode );
+    aRouter.Settings().SetMode( (PNS::PNS_MODE) aEvent.m_routingMode );
+    aRouter.UpdateSizes( sizes );
+}
+
+
+static CATEGORY moveCategory( int aRoutingMode )
+{
+    switch( aRoutingMode )
+    {
+    case PNS::RM_Walkaround:    return CAT_WALKAROUND;
+    case PNS::RM_MarkObstacles: return CAT_MARK_OBSTACLES;
+    default:                    return CAT_SHOVE;
+    }
+}
+
+
+/**
+ * Function percentile
+ * @return the nearest-rank \a aRank percentile of the sorted latencies \a aTimes.
+ */
+static double percentile( const std::vector<double>& aTimes, double aRank )
+{
+    size_t n = (size_t) std::ceil( aRank * aTimes.size() / 100.0 );
+
+    n = std::max( n, (size_t) 1 );
+
+    return aTimes[ std::min( n, aTimes.size() ) - 1 ];
+}
+
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 3 )
+    {
+        printf( "usage: %s board.kicad_pcb events.log\n", argv[0] );
+        return -1;
+    }
+
+    std::vector<LOGGER::EVENT_ENTRY> events;
+
+    if( !LOGGER::LoadEvents( argv[2], events ) )
+    {
+        printf( "Cannot read %s\n", argv[2] );
+        return -1;
+    }
+
+    BOARD* brd = loadBoard( argv[1] );
+
+    if( !brd )
+        return -1;
+
+    // No view and no host tool: the routed items are committed to the router world only
+    PNS_KICAD_IFACE iface;
+    PNS::ROUTER     router;
+
+    iface.SetBoard( brd );
+    router.SetInterface( &iface );
+    router.ClearWorld();
+    router.SyncWorld();
+
+    std::vector<double> times[CAT_COUNT];
+    CATEGORY            routeCategory = CAT_SHOVE;
+    bool                dragging = false;
+    int                 missingItems = 0;
+    PROF_COUNTER        total( "replay" );
+
+    for( const LOGGER::EVENT_ENTRY& evt : events )
+    {
+        PNS::ITEM* item = findItem( router, evt );
+        int        category = -1;
+
+        if( evt.m_itemKind && !item )
+            missingItems++;
+
+        if( evt.m_type == LOGGER::EVT_START_ROUTE || evt.m_type == LOGGER::EVT_START_DRAG )
+        {
+            applySettings( router, evt );
+            routeCategory = moveCategory( evt.m_routingMode );
+            dragging = ( evt.m_type == LOGGER::EVT_START_DRAG );
+        }
+
+        PROF_COUNTER counter;
+
+        switch( evt.m_type )
+        {
+        case LOGGER::EVT_START_ROUTE:
+            router.StartRouting( evt.m_p, item, evt.m_layer );
+            category = CAT_START;
+            break;
+
+        case LOGGER::EVT_START_DRAG:
+            router.StartDragging( evt.m_p, item, evt.m_dragMode );
+            category = CAT_START;
+            break;
+
+        case LOGGER::EVT_MOVE:
+            router.Move( evt.m_p, item );
+            category = dragging ? CAT_DRAG : routeCategory;
+            break;
+
+        case LOGGER::EVT_FIX:
+            router.FixRoute( evt.m_p, item );
+            category = CAT_FIX;
+            break;
+
+        case LOGGER::EVT_STOP:
+            router.StopRouting();
+            break;
+
+        case LOGGER::EVT_TOGGLE_VIA:
+            router.ToggleViaPlacement();
+            break;
+
+        case LOGGER::EVT_SWITCH_LAYER:
+            router.SwitchLayer( evt.m_layer );
+            break;
+
+        case LOGGER::EVT_FLIP_POSTURE:
+            router.FlipPosture();
+            break;
+        }
+
+        double elapsed = counter.msecs();
+
+        if( category >= 0 )
+            times[category].push_back( elapsed );
+    }
+
+    if( router.RoutingInProgress() )
+        router.StopRouting();
+
+    printf( "%s: %d events replayed in %.1f ms\n", argv[2], (int) events.size(), total.msecs() );
+
+    if( missingItems )
+        printf( "%d recorded items not found, is this the recorded board?\n", missingItems );
+
+    printf( "%-12s %8s %10s %10s %10s %10s\n", "event", "count", "p50 ms", "p90 ms", "p99 ms",
+            "max ms" );
+
+    for( int i = 0; i < CAT_COUNT; i++ )
+    {
+        std::vector<double>& t = times[i];
+
+        if( t.empty() )
+            continue;
+
+        std::sort( t.begin(), t.end() );
+
+        printf( "%-12s %8d %10.3f %10.3f %10.3f %10.3f\n", categoryNames[i], (int) t.size(),
+                percentile( t, 50 ), percentile( t, 90 ), percentile( t, 99 ), t.back() );
+    }
+
+    router.ClearWorld();
+    delete brd;
+
+    return 0;
+}
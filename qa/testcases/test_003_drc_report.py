@@ -0,0 +1,45 @@
+import json
+import os
+import tempfile
+import unittest
+import pcbnew
+
+class TestDRCReport(unittest.TestCase):
+
+    def setUp(self):
+        self.pcb = pcbnew.LoadBoard("data/complex_hierarchy.kicad_pcb")
+        self.report = os.path.join(tempfile.mkdtemp(), "drc_report")
+
+    def tearDown(self):
+        if os.path.exists(self.report):
+            os.remove(self.report)
+
+    def test_json_report(self):
+        self.assertTrue(pcbnew.WriteDRCReport(self.pcb, self.report, True))
+
+        with open(self.report) as f:
+            report = json.load(f)
+
+        self.assertEqual(report["version"], 1)
+        self.assertTrue("markers" in report)
+        self.assertTrue("unconnected_items" in report)
+
+        phases = [phase["name"] for phase in report["phases"]]
+        self.assertTrue("track_clearances" in phases)
+
+    def test_sexpr_report(self):
+        self.assertTrue(pcbnew.WriteDRCReport(self.pcb, self.report))
+
+        with open(self.report) as f:
+            report = f.read()
+
+        self.assertTrue(report.startswith("(drc_report"))
+        self.assertTrue("(phases" in report)
+
+    def test_markers_not_added_to_board(self):
+        markers = self.pcb.GetMARKERCount()
+        pcbnew.WriteDRCReport(self.pcb, self.report, True)
+        self.assertEqual(self.pcb.GetMARKERCount(), markers)
+
+if __name__ == '__main__':
+    unittest.main()
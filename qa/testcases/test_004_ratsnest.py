@@ -0,0 +1,79 @@
+import time
+import unittest
+import pcbnew
+
+# Number of pads of the big net: the ratsnest of a GND net on a large board
+PAD_ROWS = 75
+PAD_COLUMNS = 70
+
+class TestRatsnest(unittest.TestCase):
+
+    def setUp(self):
+        self.pcb = pcbnew.BOARD()
+
+        self.net = pcbnew.NETINFO_ITEM(self.pcb, "GND")
+        self.pcb.Add(self.net)
+
+        module = pcbnew.MODULE(self.pcb)
+        module.SetReference("U1")
+        self.pcb.Add(module)
+
+        for y in range(PAD_ROWS):
+            for x in range(PAD_COLUMNS):
+                pad = pcbnew.D_PAD(module)
+                pad.SetSize(pcbnew.wxSizeMM(1.0, 1.0))
+                pad.SetDrillSize(pcbnew.wxSizeMM(0.6, 0.6))
+                pos = pcbnew.wxPointMM(2.54 * x, 2.54 * y)
+                pad.SetPos0(pos)
+                pad.SetPosition(pos)
+                pad.SetName(str(y * PAD_COLUMNS + x + 1))
+                pad.SetNet(self.net)
+                module.Add(pad)
+
+        self.module = module
+
+    def rebuild(self, connectivity):
+        connectivity.MarkItemNetAsDirty(self.module)
+        start = time.time()
+        connectivity.RecalculateRatsnest()
+        return time.time() - start
+
+    def test_big_net_ratsnest(self):
+        connectivity = self.pcb.GetConnectivity()
+
+        start = time.time()
+        connectivity.Build(self.pcb)
+        connectivity.RecalculateRatsnest()
+        build = time.time() - start
+
+        pads = PAD_ROWS * PAD_COLUMNS
+        self.assertEqual(connectivity.GetPadCount(self.net.GetNet()), pads)
+
+        # No pad is connected: the ratsnest is a spanning tree of the pads
+        self.assertEqual(connectivity.GetUnconnectedCount(), pads - 1)
+
+        rebuilds = [self.rebuild(connectivity) for i in range(5)]
+        self.assertEqual(connectivity.GetUnconnectedCount(), pads - 1)
+
+        print("\nratsnest of a %d pad net: build %.1f ms, rebuild %.1f ms (best of %d)"
+              % (pads, build * 1000, min(rebuilds) * 1000, len(rebuilds)))
+
+    def test_board_ratsnest(self):
+        pcb = pcbnew.LoadBoard("data/complex_hierarchy.kicad_pcb")
+        connectivity = pcb.GetConnectivity()
+
+        unconnected = connectivity.GetUnconnectedCount()
+
+        for module in pcb.GetModules():
+            connectivity.MarkItemNetAsDirty(module)
+
+        start = time.time()
+        connectivity.RecalculateRatsnest()
+        rebuild = time.time() - start
+
+        self.assertEqual(connectivity.GetUnconnectedCount(), unconnected)
+
+        print("\nratsnest of complex_hierarchy.kicad_pcb: rebuild %.1f ms" % (rebuild * 1000))
+
+if __name__ == '__main__':
+    unittest.main()
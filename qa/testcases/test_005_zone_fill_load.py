@@ -0,0 +1,73 @@
+import os
+import tempfile
+import unittest
+import pcbnew
+
+class TestZoneFillLoad(unittest.TestCase):
+
+    def setUp(self):
+        self.pcb = pcbnew.LoadBoard("data/complex_hierarchy.kicad_pcb")
+        self.zone = self.pcb.GetArea(0)
+        self.zone.SetIsFilled(True)
+        self.vertices = self.zone.GetFilledPolysList().TotalVertices()
+        self.filename = tempfile.mktemp() + ".kicad_pcb"
+
+    def tearDown(self):
+        if os.path.exists(self.filename):
+            os.remove(self.filename)
+
+    def reload(self):
+        self.assertTrue(pcbnew.SaveBoard(self.filename, self.pcb))
+        self.pcb = pcbnew.LoadBoard(self.filename)
+        return self.pcb.GetArea(0)
+
+    def test_deferred_fill(self):
+        # The filled polygons are parsed when first needed
+        self.assertGreater(self.vertices, 0)
+        self.assertTrue(pcbnew.SaveBoard(self.filename, self.pcb))
+
+        # LoadBoard() builds the connectivity, which reads the fills: use the plugin
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+        self.pcb = plugin.Load(self.filename)
+        zone = self.pcb.GetArea(0)
+        self.assertTrue(zone.IsFilled())
+        self.assertFalse(zone.IsFillLoaded())
+
+        self.assertEqual(zone.GetFilledPolysList().TotalVertices(), self.vertices)
+        self.assertTrue(zone.IsFillLoaded())
+
+    def test_up_to_date_fill(self):
+        self.zone.SetFillFingerprint(self.zone.ComputeFillFingerprint())
+
+        zone = self.reload()
+        self.assertTrue(zone.IsFilled())
+        self.assertEqual(zone.GetFilledPolysList().TotalVertices(), self.vertices)
+
+    def test_stale_fill(self):
+        self.zone.SetFillFingerprint(self.zone.ComputeFillFingerprint())
+
+        # The zone is modified after its fill: the fill is discarded when loading
+        self.zone.SetMinThickness(self.zone.GetMinThickness() + pcbnew.FromMM(0.1))
+
+        zone = self.reload()
+        self.assertFalse(zone.IsFilled())
+        self.assertTrue(zone.GetFilledPolysList().IsEmpty())
+
+    def test_netclass_fill(self):
+        # The fingerprint of a zone and pads in a net class other than the default one
+        self.pcb = pcbnew.LoadBoard("data/zone_netclass.kicad_pcb")
+        self.pcb.SynchronizeNetsAndNetClasses()
+        zone = self.pcb.GetArea(0)
+        self.assertEqual(zone.GetNetClassName(), "HighVoltage")
+
+        zone.SetFillFingerprint(zone.ComputeFillFingerprint())
+        vertices = zone.GetFilledPolysList().TotalVertices()
+        self.assertGreater(vertices, 0)
+
+        zone = self.reload()
+        self.assertEqual(zone.GetNetClassName(), "HighVoltage")
+        self.assertTrue(zone.IsFilled())
+        self.assertEqual(zone.GetFilledPolysList().TotalVertices(), vertices)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,119 @@
+import os
+import shutil
+import tempfile
+import time
+import unittest
+import pcbnew
+
+BOARD = os.path.abspath("data/complex_hierarchy.kicad_pcb")
+
+class TestBoardSnapshot(unittest.TestCase):
+
+    def setUp(self):
+        # The snapshots are kept in the user cache directory: start with an empty one
+        self.cache = tempfile.mkdtemp()
+        self.saved_env = {var: os.environ.get(var)
+                          for var in ("XDG_CACHE_HOME", "KICAD_SNAPSHOTS_MAX_SIZE")}
+        os.environ["XDG_CACHE_HOME"] = self.cache
+        self.snapshots = os.path.join(self.cache, "kicad", "snapshots")
+
+    def tearDown(self):
+        pcbnew.WaitForTokenSnapshots()
+
+        for var, value in self.saved_env.items():
+            if value is None:
+                os.environ.pop(var, None)
+            else:
+                os.environ[var] = value
+
+        shutil.rmtree(self.cache, True)
+
+    def load(self, board=BOARD):
+        pcb = pcbnew.LoadBoard(board)
+
+        modules = [(m.GetReference(), m.GetPosition().x, m.GetPosition().y, m.GetOrientation())
+                   for m in pcb.GetModules()]
+        tracks = [(t.GetStart().x, t.GetStart().y, t.GetEnd().x, t.GetEnd().y, t.GetNetCode())
+                  for t in pcb.GetTracks()]
+        zones = [(pcb.GetArea(i).GetNetname(), pcb.GetArea(i).GetFilledPolysList().TotalVertices())
+                 for i in range(pcb.GetAreaCount())]
+
+        return (modules, tracks, zones, pcb.GetNetCount())
+
+    def snapshot_files(self):
+        # The snapshot is written in the background after the board is loaded
+        pcbnew.WaitForTokenSnapshots()
+
+        if not os.path.isdir(self.snapshots):
+            return set()
+
+        return set(f for f in os.listdir(self.snapshots) if f.endswith(".snapshot"))
+
+    def wait_for_snapshot(self):
+        files = self.snapshot_files()
+
+        if not files:
+            self.fail("no snapshot written in %s" % self.snapshots)
+
+        return os.path.join(self.snapshots, files.pop())
+
+    def copy_board(self, name):
+        board = os.path.join(self.cache, name)
+        shutil.copy(BOARD, board)
+        return board
+
+    def test_snapshot_load(self):
+        first = self.load()
+        self.wait_for_snapshot()
+
+        hits = pcbnew.GetTokenSnapshotHitCount()
+        self.assertEqual(self.load(), first)
+
+        # The board was read from the snapshot
+        self.assertEqual(pcbnew.GetTokenSnapshotHitCount(), hits + 1)
+
+    def test_corrupt_snapshot(self):
+        first = self.load()
+        snapshot = self.wait_for_snapshot()
+
+        with open(snapshot, "r+b") as f:
+            f.seek(os.path.getsize(snapshot) // 2)
+            f.write(b"\xff" * 16)
+
+        # The corrupt snapshot is ignored, and written again
+        hits = pcbnew.GetTokenSnapshotHitCount()
+        self.assertEqual(self.load(), first)
+        self.assertEqual(pcbnew.GetTokenSnapshotHitCount(), hits)
+
+        self.wait_for_snapshot()
+        self.assertEqual(self.load(), first)
+        self.assertEqual(pcbnew.GetTokenSnapshotHitCount(), hits + 1)
+
+    def test_size_limit(self):
+        first = self.copy_board("first.kicad_pcb")
+        second = self.copy_board("second.kicad_pcb")
+        third = self.copy_board("third.kicad_pcb")
+
+        self.load(first)
+        first_snapshot = self.snapshot_files()
+        size = os.path.getsize(os.path.join(self.snapshots, min(first_snapshot)))
+
+        self.load(second)
+        second_snapshot = self.snapshot_files() - first_snapshot
+
+        # The first board is used again after the second one (the times have a 1 s resolution)
+        time.sleep(1.1)
+        self.load(first)
+        time.sleep(1.1)
+
+        # Only two snapshots fit: the least recently used one is removed
+        os.environ["KICAD_SNAPSHOTS_MAX_SIZE"] = str(2 * size + size // 2)
+        self.load(third)
+
+        files = self.snapshot_files()
+        self.assertEqual(len(files), 2)
+        self.assertTrue(first_snapshot <= files)
+        self.assertFalse(second_snapshot & files)
+
+if __name__ == '__main__':
+    unittest.main()
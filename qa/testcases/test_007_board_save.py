@@ -0,0 +1,61 @@
+import os
+import tempfile
+import time
+import unittest
+import pcbnew
+
+# Number of tracks of the saved board
+TRACK_COUNT = 100000
+
+class TestBoardSave(unittest.TestCase):
+
+    def setUp(self):
+        self.filename = tempfile.mktemp() + ".kicad_pcb"
+
+    def tearDown(self):
+        if os.path.exists(self.filename):
+            os.remove(self.filename)
+
+    def test_save_tracks(self):
+        pcb = pcbnew.BOARD()
+
+        # A net name which must be quoted and escaped
+        net = pcbnew.NETINFO_ITEM(pcb, 'Net-(R1 "Pad1")')
+        pcb.Add(net)
+
+        for i in range(TRACK_COUNT):
+            track = pcbnew.TRACK(pcb)
+            track.SetStart(pcbnew.wxPointMM(0.5 * (i % 1000), 0.5 * (i // 1000)))
+            track.SetEnd(pcbnew.wxPointMM(0.5 * (i % 1000) + 0.25, -0.5 * (i // 1000)))
+            track.SetWidth(pcbnew.FromMM(0.25))
+            track.SetNet(net)
+            pcb.Add(track)
+
+        start = time.time()
+        self.assertTrue(pcbnew.SaveBoard(self.filename, pcb))
+        save = time.time() - start
+
+        loaded = pcbnew.LoadBoard(self.filename)
+        tracks = list(loaded.GetTracks())
+        self.assertEqual(len(tracks), TRACK_COUNT)
+        self.assertEqual(tracks[0].GetNetname(), 'Net-(R1 "Pad1")')
+        self.assertTrue(any(t.GetEnd() == pcbnew.wxPointMM(499.75, -49.5) for t in tracks))
+
+        print("\nsave of %d tracks: %.1f ms" % (TRACK_COUNT, save * 1000))
+
+    def test_save_board(self):
+        pcb = pcbnew.LoadBoard("data/complex_hierarchy.kicad_pcb")
+        self.assertTrue(pcbnew.SaveBoard(self.filename, pcb))
+
+        # The saved board saves again identically
+        with open(self.filename) as f:
+            saved = f.read()
+
+        loaded = pcbnew.LoadBoard(self.filename)
+        self.assertTrue(pcbnew.SaveBoard(self.filename, loaded))
+
+        with open(self.filename) as f:
+            self.assertEqual(f.read(), saved)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,140 @@
+import os
+import shutil
+import tempfile
+import unittest
+import pcbnew
+
+# Number of footprints of the test library
+FOOTPRINT_COUNT = 20
+
+# Footprints of about 110 kB, for a cache of 1 MB
+BIG_FOOTPRINT_COUNT = 16
+BIG_PAD_COUNT = 1200
+
+class TestFootprintCache(unittest.TestCase):
+
+    def setUp(self):
+        self.dir = tempfile.mkdtemp()
+        self.lib = os.path.join(self.dir, "test.pretty")
+
+        pcbnew.FootprintLibCreate(self.lib)
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+
+        for i in range(FOOTPRINT_COUNT):
+            self.save_footprint(plugin, "fp%d" % i, "footprint %d" % i, i + 1)
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def save_footprint(self, plugin, name, description, pad_count):
+        module = pcbnew.MODULE(None)
+        module.SetFPID(pcbnew.LIB_ID(name))
+        module.SetDescription(description)
+
+        for j in range(pad_count):
+            pos = pcbnew.wxPointMM(2.54 * (j % 40), 2.54 * (j // 40))
+            pad = pcbnew.D_PAD(module)
+            pad.SetName(str(j + 1))
+            pad.SetPos0(pos)
+            pad.SetPosition(pos)
+            module.Add(pad)
+
+        plugin.FootprintSave(self.lib, module)
+
+    def rewrite_keeping_time(self, name, old, new):
+        filename = os.path.join(self.lib, name + ".kicad_mod")
+        stat = os.stat(filename)
+
+        with open(filename) as f:
+            text = f.read()
+
+        with open(filename, "w") as f:
+            f.write(text.replace(old, new))
+
+        os.utime(filename, ns=(stat.st_atime_ns, stat.st_mtime_ns))
+
+    def test_load(self):
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+
+        names = plugin.FootprintEnumerate(self.lib)
+        self.assertEqual(len(names), FOOTPRINT_COUNT)
+
+        module = plugin.FootprintLoad(self.lib, "fp7")
+        self.assertEqual(module.GetPadCount(), 8)
+        self.assertEqual(module.GetDescription(), "footprint 7")
+
+        self.assertIsNone(plugin.FootprintLoad(self.lib, "nonexistent"))
+
+    def test_broken_footprint(self):
+        # The footprints are parsed when loaded: a broken one does not hide the others
+        with open(os.path.join(self.lib, "broken.kicad_mod"), "w") as f:
+            f.write("(module broken (layer F.Cu)")
+
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+
+        names = plugin.FootprintEnumerate(self.lib)
+        self.assertEqual(len(names), FOOTPRINT_COUNT + 1)
+
+        module = plugin.FootprintLoad(self.lib, "fp3")
+        self.assertEqual(module.GetPadCount(), 4)
+
+    def test_modified_footprint(self):
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+
+        module = plugin.FootprintLoad(self.lib, "fp2")
+        self.assertEqual(module.GetDescription(), "footprint 2")
+
+        # The footprint file is changed outside of the plugin
+        filename = os.path.join(self.lib, "fp2.kicad_mod")
+
+        with open(filename) as f:
+            text = f.read()
+
+        with open(filename, "w") as f:
+            f.write(text.replace("footprint 2", "changed footprint"))
+
+        mtime = os.path.getmtime(filename) + 10
+        os.utime(filename, (mtime, mtime))
+
+        module = plugin.FootprintLoad(self.lib, "fp2")
+        self.assertEqual(module.GetDescription(), "changed footprint")
+
+    def test_small_cache(self):
+        plugin = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+        names = ["big%d" % i for i in range(BIG_FOOTPRINT_COUNT)]
+
+        for i, name in enumerate(names):
+            self.save_footprint(plugin, name, "big footprint %d" % i, BIG_PAD_COUNT + i)
+
+        # A plugin of its own, so its cache is created with the option
+        loader = pcbnew.IO_MGR.PluginFind(pcbnew.IO_MGR.KICAD_SEXP)
+
+        def load(name):
+            return pcbnew.FootprintLoadWithCacheSize(loader, self.lib, name, 1)
+
+        for name in names:
+            load(name)
+
+        # The files are changed without changing their time: a footprint still in the
+        # cache is not parsed again, an evicted one is
+        for i, name in enumerate(names):
+            self.rewrite_keeping_time(name, "big footprint %d" % i, "changed %d" % i)
+
+        last = BIG_FOOTPRINT_COUNT - 1
+        module = load(names[last])
+        self.assertEqual(module.GetDescription(), "big footprint %d" % last)
+        self.assertEqual(module.GetPadCount(), BIG_PAD_COUNT + last)
+
+        module = load(names[0])
+        self.assertEqual(module.GetDescription(), "changed 0")
+        self.assertEqual(module.GetPadCount(), BIG_PAD_COUNT)
+
+        # Loading them all again evicts and parses them again as needed
+        for i, name in enumerate(names):
+            module = load(name)
+            self.assertIn(module.GetDescription(), ("big footprint %d" % i, "changed %d" % i))
+            self.assertEqual(module.GetPadCount(), BIG_PAD_COUNT + i)
+            self.assertEqual(str(module.GetFPID().GetLibItemName()), name)
+
+if __name__ == '__main__':
+    unittest.main()
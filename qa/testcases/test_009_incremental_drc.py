@@ -0,0 +1,38 @@
+import unittest
+import pcbnew
+
+class TestIncrementalDRC(unittest.TestCase):
+
+    def setUp(self):
+        self.pcb = pcbnew.LoadBoard("data/complex_hierarchy.kicad_pcb")
+
+    def test_move_footprint(self):
+        module = self.pcb.FindModuleByReference("R3")
+        pads = set((p.GetPosition().x, p.GetPosition().y) for p in module.Pads())
+        old_bbox = module.GetBoundingBox()
+
+        module.Move(pcbnew.wxPointMM(1, 0))
+
+        tracks = list(self.pcb.GetTracks())
+        retested = set(pcbnew.GetDRCRetestedTracks(self.pcb, module, old_bbox))
+
+        # The tracks ending on the pads of the footprint are tested again...
+        connected = set(i for i, t in enumerate(tracks)
+                        if (t.GetStart().x, t.GetStart().y) in pads
+                        or (t.GetEnd().x, t.GetEnd().y) in pads)
+
+        self.assertTrue(connected)
+        self.assertTrue(connected.issubset(retested))
+
+        # ... but not the tracks far from it
+        self.assertLess(len(retested), len(tracks) / 4)
+
+        area = pcbnew.EDA_RECT(old_bbox.GetOrigin(), old_bbox.GetSize())
+        area.Merge(module.GetBoundingBox())
+        area.Inflate(pcbnew.FromMM(5))
+
+        for i in retested:
+            self.assertTrue(area.Intersects(tracks[i].GetBoundingBox()))
+
+if __name__ == '__main__':
+    unittest.main()